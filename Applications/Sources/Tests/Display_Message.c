@@ -25,7 +25,12 @@ static char *String_Error_Codes[] =
 	"Bad file descriptor (greater than the maximum number of simultaneous opened files)",
 	"Bad UART parameters",
 	"File to download is larger than RAM",
-	"File not executable"
+	"File not executable",
+	"File reading failed",
+	"Asynchronous request pending",
+	"Bad asynchronous request",
+	"Can't submit more asynchronous requests",
+	"File not empty"
 };
 
 //-------------------------------------------------------------------------------------------------
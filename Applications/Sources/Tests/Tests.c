@@ -45,6 +45,14 @@ static TTest Tests[] =
 		"File renaming",
 		TestsFileRename
 	},
+	{
+		"Asynchronous file requests",
+		TestsFileAsynchronousRequests
+	},
+	{
+		"File preallocation",
+		TestsFilePreallocation
+	},
 	// Memory API tests
 	{
 		"MemoryCopyArea() with a small area size",
@@ -62,6 +70,11 @@ static TTest Tests[] =
 		"MemorySetAreaValue() with a big area size",
 		TestsMemorySetBigAreaValue
 	},
+	// Network API tests
+	{
+		"TCP payload size computation",
+		TestsNetworkTCPComputePayloadSize
+	},
 	// String API tests
 	{
 		"StringCompare()",
@@ -73,6 +73,18 @@ int TestsFileCloseDeletedOpenedFile(void);
  */
 int TestsFileRename(void);
 
+/** Write then read a file using several asynchronous requests, and check that the data are not altered.
+ * @return 0 if test was successful,
+ * @return 1 if the test failed.
+ */
+int TestsFileAsynchronousRequests(void);
+
+/** Preallocate a file larger than the written data and check that the unused blocks are released when the file is closed.
+ * @return 0 if test was successful,
+ * @return 1 if the test failed.
+ */
+int TestsFilePreallocation(void);
+
 // Memory API
 /** Copy a small amount of data.
  * @return 0 if test was successful,
@@ -98,6 +110,13 @@ int TestsMemorySetSmallAreaValue(void);
  */
 int TestsMemorySetBigAreaValue(void);
 
+// Network API
+/** Check the TCP payload size against the recipient window size, including a window smaller than a segment.
+ * @return 0 if test was successful,
+ * @return 1 if the test failed.
+ */
+int TestsNetworkTCPComputePayloadSize(void);
+
 // String API
 /** Test the StringCompare() function.
  * @return 0 if all tests were successful,
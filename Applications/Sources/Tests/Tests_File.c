@@ -507,3 +507,179 @@ Exit:
 	LibrariesFileDelete("_test3_");
 	return Return_Value;
 }
+
+int TestsFileAsynchronousRequests(void)
+{
+	unsigned int File_Size_Bytes, Chunk_Size_Bytes, Written_Data_CRC, Read_Data_CRC, i, CRC_Seed, File_ID = LIBRARIES_FILE_MAXIMUM_OPENED_COUNT, Request_IDs[4], Processed_Bytes_Count, Total_Bytes_Count; // This file identifier is never valid, so closing it does nothing if the file could not be opened
+	int Result, Return_Value = 1;
+	
+	// Choose a random file size between 400 KB and 3.2 MB, split into 4 requests
+	File_Size_Bytes = ((LibrariesRandomGenerateNumber() % 8) + 1) * 1024 * 400;
+	Chunk_Size_Bytes = File_Size_Bytes / 4;
+	for (i = 0; i < File_Size_Bytes; i++) Buffer[i] = (unsigned char) LibrariesRandomGenerateNumber();
+	CRC_Seed = LibrariesRandomGenerateNumber();
+	Written_Data_CRC = crc32(CRC_Seed, Buffer, File_Size_Bytes);
+	
+	LibrariesScreenWriteString("Writing data to file... ");
+	Result = LibrariesFileOpen("_test_", 'w', &File_ID);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		DisplayMessageErrorAndCode("when opening the file in write mode", Result);
+		goto Exit;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		Result = LibrariesFileSubmitAsynchronousRequest(File_ID, &Buffer[i * Chunk_Size_Bytes], Chunk_Size_Bytes, &Request_IDs[i]);
+		if (Result != ERROR_CODE_NO_ERROR)
+		{
+			DisplayMessageErrorAndCode("when submitting a write request", Result);
+			goto Exit;
+		}
+	}
+	// Each poll makes the first request progress until it is completed
+	do
+	{
+		Result = LibrariesFilePollAsynchronousRequest(Request_IDs[0], &Processed_Bytes_Count);
+	} while (Result == ERROR_CODE_ASYNCHRONOUS_REQUEST_PENDING);
+	if ((Result != ERROR_CODE_NO_ERROR) || (Processed_Bytes_Count != Chunk_Size_Bytes))
+	{
+		DisplayMessageErrorAndCode("when polling the first write request", Result);
+		goto Exit;
+	}
+	// The request has been released, it can't be polled anymore
+	Result = LibrariesFilePollAsynchronousRequest(Request_IDs[0], &Processed_Bytes_Count);
+	if (Result != ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST)
+	{
+		DisplayMessageErrorAndCode("when polling a released request", Result);
+		goto Exit;
+	}
+	// Wait for the second one, let the file closing complete the other ones
+	Result = LibrariesFileWaitAsynchronousRequest(Request_IDs[1], &Processed_Bytes_Count);
+	if ((Result != ERROR_CODE_NO_ERROR) || (Processed_Bytes_Count != Chunk_Size_Bytes))
+	{
+		DisplayMessageErrorAndCode("when waiting for the second write request", Result);
+		goto Exit;
+	}
+	LibrariesFileClose(File_ID);
+	File_ID = LIBRARIES_FILE_MAXIMUM_OPENED_COUNT; // Do not close the file again if the next opening fails
+	LibrariesScreenWriteString("done\n");
+	
+	// Flush read buffer
+	LibrariesMemorySetAreaValue(Buffer, File_Size_Bytes, 0);
+	
+	LibrariesScreenWriteString("Reading data from file... ");
+	Result = LibrariesFileOpen("_test_", 'r', &File_ID);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		DisplayMessageErrorAndCode("when opening the file in read mode", Result);
+		goto Exit;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		Result = LibrariesFileSubmitAsynchronousRequest(File_ID, &Buffer[i * Chunk_Size_Bytes], Chunk_Size_Bytes, &Request_IDs[i]);
+		if (Result != ERROR_CODE_NO_ERROR)
+		{
+			DisplayMessageErrorAndCode("when submitting a read request", Result);
+			goto Exit;
+		}
+	}
+	Total_Bytes_Count = 0;
+	for (i = 0; i < 4; i++)
+	{
+		Result = LibrariesFileWaitAsynchronousRequest(Request_IDs[i], &Processed_Bytes_Count);
+		if (Result != ERROR_CODE_NO_ERROR)
+		{
+			DisplayMessageErrorAndCode("when waiting for a read request", Result);
+			goto Exit;
+		}
+		Total_Bytes_Count += Processed_Bytes_Count;
+	}
+	LibrariesScreenWriteString("done (");
+	LibrariesScreenWriteUnsignedInteger(Total_Bytes_Count);
+	LibrariesScreenWriteString(" bytes read)\n");
+	
+	Read_Data_CRC = crc32(CRC_Seed, Buffer, File_Size_Bytes);
+	if ((Total_Bytes_Count == File_Size_Bytes) && (Read_Data_CRC == Written_Data_CRC)) Return_Value = 0;
+	
+Exit:
+	LibrariesFileClose(File_ID);
+	LibrariesFileDelete("_test_");
+	return Return_Value;
+}
+
+int TestsFilePreallocation(void)
+{
+	unsigned int File_ID = LIBRARIES_FILE_MAXIMUM_OPENED_COUNT, Block_Size, Blocks_Count, Files_Count, Initial_Free_Blocks_Count, Free_Blocks_Count; // This file identifier is never valid, so closing it does nothing if the file could not be opened
+	int Result, Return_Value = 1;
+	
+	// Get the free blocks count before opening the file, because opening the file allocates its first block
+	LibrariesFileSystemGetTotalSize(&Block_Size, &Blocks_Count, &Files_Count);
+	LibrariesFileSystemGetFreeSize(&Initial_Free_Blocks_Count, &Files_Count);
+	if (Initial_Free_Blocks_Count < 10)
+	{
+		DisplayMessageError("there are not enough free blocks to run the test");
+		return 1;
+	}
+	
+	Result = LibrariesFileOpen("_test_", 'w', &File_ID);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		DisplayMessageErrorAndCode("when opening the file in write mode", Result);
+		goto Exit;
+	}
+	
+	// Asking for more than the free space must fail without reserving anything
+	Result = LibrariesFilePreallocate(File_ID, (Initial_Free_Blocks_Count + 1) * Block_Size);
+	if (Result != ERROR_CODE_BLOCKS_LIST_FULL)
+	{
+		DisplayMessageErrorAndCode("when preallocating more than the free space", Result);
+		goto Exit;
+	}
+	
+	// Reserve 10 blocks (the block allocated when opening the file is part of them)
+	Result = LibrariesFilePreallocate(File_ID, 10 * Block_Size);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		DisplayMessageErrorAndCode("when preallocating the file", Result);
+		goto Exit;
+	}
+	LibrariesFileSystemGetFreeSize(&Free_Blocks_Count, &Files_Count);
+	if (Free_Blocks_Count != Initial_Free_Blocks_Count - 10)
+	{
+		DisplayMessageError("the preallocated blocks count is wrong");
+		goto Exit;
+	}
+	
+	// Write 2 blocks and a half, the file must keep only 3 blocks
+	LibrariesMemorySetAreaValue(Buffer, Block_Size * 3, 0xA5);
+	Result = LibrariesFileWrite(File_ID, Buffer, (Block_Size * 5) / 2);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		DisplayMessageErrorAndCode("when writing to the file", Result);
+		goto Exit;
+	}
+	
+	// The file is not empty anymore
+	Result = LibrariesFilePreallocate(File_ID, Block_Size);
+	if (Result != ERROR_CODE_FILE_NOT_EMPTY)
+	{
+		DisplayMessageErrorAndCode("when preallocating a non-empty file", Result);
+		goto Exit;
+	}
+	
+	LibrariesFileClose(File_ID);
+	File_ID = LIBRARIES_FILE_MAXIMUM_OPENED_COUNT; // Do not close the file again when exiting
+	LibrariesFileSystemGetFreeSize(&Free_Blocks_Count, &Files_Count);
+	if (Free_Blocks_Count != Initial_Free_Blocks_Count - 3)
+	{
+		DisplayMessageError("the unused preallocated blocks were not released");
+		goto Exit;
+	}
+	
+	Return_Value = 0;
+	
+Exit:
+	LibrariesFileClose(File_ID);
+	LibrariesFileDelete("_test_");
+	return Return_Value;
+}
@@ -0,0 +1,51 @@
+/** @file Tests_Network.c
+ * Test the Libraries Network functions that do not need a connected recipient.
+ * @author Adrien RICCIARDI
+ */
+#include <Libraries.h>
+#include <Network_Base.h>
+#include "Display_Message.h"
+#include "Tests.h"
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int TestsNetworkTCPComputePayloadSize(void)
+{
+	// Testing with a window big enough for all data
+	if (NetworkBaseTCPComputePayloadSize(1000, 65535) != 1000)
+	{
+		DisplayMessageError("the data fitting in the window were not sent at once.");
+		return 1;
+	}
+	
+	// Testing with a window bigger than a segment but smaller than the data
+	if (NetworkBaseTCPComputePayloadSize(5000, 3000) != 3000)
+	{
+		DisplayMessageError("the payload does not fill the window.");
+		return 1;
+	}
+	
+	// Testing with a window smaller than a segment, a single segment must be sent
+	if (NetworkBaseTCPComputePayloadSize(5000, 500) != NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE)
+	{
+		DisplayMessageError("the payload is not limited to a single segment when the window is smaller than a segment.");
+		return 1;
+	}
+	
+	// Testing with a zero window, a single segment must be sent
+	if (NetworkBaseTCPComputePayloadSize(5000, 0) != NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE)
+	{
+		DisplayMessageError("the payload is not limited to a single segment when the window is zero.");
+		return 1;
+	}
+	
+	// Testing with a window smaller than the data, which are smaller than a segment
+	if (NetworkBaseTCPComputePayloadSize(1000, 500) != 1000)
+	{
+		DisplayMessageError("the payload is bigger than the remaining data.");
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,108 @@
+/** @file Command_Iostat.c
+ * Display the hard disk activity since the system started.
+ * @author Adrien RICCIARDI
+ */
+#include <Libraries.h>
+#include "Commands.h"
+#include "Strings.h"
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Display the duration range and the commands count of each histogram bucket containing commands.
+ * @param String_Title The histogram title.
+ * @param Pointer_Histogram The histogram buckets.
+ * @param Cycles_Per_Millisecond The timestamp counter frequency, used to convert the buckets limits to time.
+ */
+static void IostatDisplayLatencyHistogram(char *String_Title, unsigned int *Pointer_Histogram, unsigned int Cycles_Per_Millisecond)
+{
+	unsigned int i, Is_Histogram_Empty = 1;
+	unsigned long long Nanoseconds;
+	
+	LibrariesScreenWriteString(String_Title);
+	
+	for (i = 0; i < SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT; i++)
+	{
+		if (Pointer_Histogram[i] == 0) continue;
+		Is_Histogram_Empty = 0;
+		
+		// Convert the bucket lower limit to the most readable unit
+		Nanoseconds = ((1ULL << i) * 1000000ULL) / Cycles_Per_Millisecond;
+		LibrariesScreenWriteString("  >= ");
+		if (Nanoseconds < 10000)
+		{
+			LibrariesScreenWriteUnsignedInteger((unsigned int) Nanoseconds);
+			LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_UNIT_NANOSECONDS);
+		}
+		else if (Nanoseconds < 10000000)
+		{
+			LibrariesScreenWriteUnsignedInteger((unsigned int) (Nanoseconds / 1000));
+			LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_UNIT_MICROSECONDS);
+		}
+		else
+		{
+			LibrariesScreenWriteUnsignedInteger((unsigned int) (Nanoseconds / 1000000));
+			LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_UNIT_MILLISECONDS);
+		}
+		
+		LibrariesScreenWriteString(" : ");
+		LibrariesScreenWriteUnsignedInteger(Pointer_Histogram[i]);
+		LibrariesScreenWriteCharacter('\n');
+	}
+	
+	if (Is_Histogram_Empty) LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_NO_COMMAND);
+}
+
+/** Display a transfer kind counters.
+ * @param String_Title The transfer kind.
+ * @param Commands_Count How many commands were sent to the drive.
+ * @param Sectors_Count How many sectors were transferred.
+ */
+static void IostatDisplayTransferCounters(char *String_Title, unsigned int Commands_Count, unsigned int Sectors_Count)
+{
+	LibrariesScreenWriteString(String_Title);
+	LibrariesScreenWriteUnsignedInteger(Commands_Count);
+	LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_COMMANDS);
+	LibrariesScreenWriteUnsignedInteger(Sectors_Count);
+	LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_SECTORS);
+	LibrariesScreenWriteUnsignedInteger(Sectors_Count / 2); // A sector is 512 bytes large
+	LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_KILOBYTES);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Command entry point
+//-------------------------------------------------------------------------------------------------
+int CommandMainIostat(int argc, char __attribute__((unused)) *argv[])
+{
+	TSystemCallHardDiskStatistics Statistics;
+	
+	// Check parameters
+	if (argc != 1)
+	{
+		LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_USAGE);
+		return -1;
+	}
+	
+	LibrariesSystemGetHardDiskStatistics(&Statistics);
+	
+	// Display the counters
+	IostatDisplayTransferCounters(STRING_COMMAND_IOSTAT_READS, Statistics.Read_Commands_Count, Statistics.Read_Sectors_Count);
+	IostatDisplayTransferCounters(STRING_COMMAND_IOSTAT_WRITES, Statistics.Write_Commands_Count, Statistics.Written_Sectors_Count);
+	LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_FLUSHES);
+	LibrariesScreenWriteUnsignedInteger(Statistics.Flush_Commands_Count);
+	LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_ERRORS);
+	LibrariesScreenWriteUnsignedInteger(Statistics.Errors_Count);
+	LibrariesScreenWriteCharacter('\n');
+	
+	// Display the latency distributions, the processors without timestamp counter can't measure them
+	if (Statistics.Cycles_Per_Millisecond == 0)
+	{
+		LibrariesScreenWriteString(STRING_COMMAND_IOSTAT_NO_LATENCY);
+		return 0;
+	}
+	IostatDisplayLatencyHistogram(STRING_COMMAND_IOSTAT_READ_LATENCY, Statistics.Read_Latency_Histogram, Statistics.Cycles_Per_Millisecond);
+	IostatDisplayLatencyHistogram(STRING_COMMAND_IOSTAT_WRITE_LATENCY, Statistics.Write_Latency_Histogram, Statistics.Cycles_Per_Millisecond);
+	IostatDisplayLatencyHistogram(STRING_COMMAND_IOSTAT_FLUSH_LATENCY, Statistics.Flush_Latency_Histogram, Statistics.Cycles_Per_Millisecond);
+	
+	return 0;
+}
@@ -11,6 +11,8 @@
 //-------------------------------------------------------------------------------------------------
 /** The data transfer mode for read and write requests. */
 #define STRING_TFTP_TRANSFER_MODE "octet"
+/** The option used to ask the server for the file size (see RFC 2349). */
+#define STRING_TFTP_OPTION_TRANSFER_SIZE "tsize"
 
 /** How many time to wait for a packet to be received (in milliseconds). */
 #define TFTP_PACKET_RECEPTION_TIMEOUT 1000
@@ -24,6 +26,66 @@ static TNetworkSocket Socket_Server;
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
+/** Wait for the file write request of a received packet to complete, so the packet can be reused.
+ * @param Pointer_Is_Request_Pending Tell if a request was submitted for the packet, cleared on output.
+ * @param Request_ID The request identifier.
+ * @return 0 if the data were successfully written (or if there was no request),
+ * @return 1 if an error occurred.
+ */
+static int TFTPWaitForFileWrite(int *Pointer_Is_Request_Pending, unsigned int Request_ID)
+{
+	unsigned int Written_Bytes_Count;
+	
+	if (!*Pointer_Is_Request_Pending) return 0;
+	*Pointer_Is_Request_Pending = 0;
+	
+	if (LibrariesFileWaitAsynchronousRequest(Request_ID, &Written_Bytes_Count) != 0)
+	{
+		LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_CANT_WRITE_TO_FILE);
+		return 1;
+	}
+	return 0;
+}
+
+/** Reserve the downloaded file space if the server told the file size in its option acknowledgment.
+ * @param File_ID The file to preallocate.
+ * @param Pointer_Packet The OACK packet.
+ * @param Packet_Size The OACK packet size in bytes.
+ * @return 0 if the file was preallocated or if the server did not provide the file size,
+ * @return 1 if there is not enough space to store the file.
+ */
+static int TFTPPreallocateFile(unsigned int File_ID, TNetworkTFTPPacket *Pointer_Packet, unsigned int Packet_Size)
+{
+	unsigned int Offset = 0, Options_Size;
+	char *String_Option_Name, *String_Option_Value;
+	
+	// Make sure the strings are terminated even if the server sent a malformed packet
+	Options_Size = Packet_Size - sizeof(Pointer_Packet->Opcode);
+	if (Options_Size >= sizeof(Pointer_Packet->Option_Acknowledgment.String_Options)) Options_Size = sizeof(Pointer_Packet->Option_Acknowledgment.String_Options) - 1;
+	Pointer_Packet->Option_Acknowledgment.String_Options[Options_Size] = 0;
+	
+	// Find the transfer size option among the acknowledged options
+	while (Offset < Options_Size)
+	{
+		String_Option_Name = &Pointer_Packet->Option_Acknowledgment.String_Options[Offset];
+		Offset += LibrariesStringGetSize(String_Option_Name) + 1;
+		if (Offset >= Options_Size) break;
+		String_Option_Value = &Pointer_Packet->Option_Acknowledgment.String_Options[Offset];
+		Offset += LibrariesStringGetSize(String_Option_Value) + 1;
+		
+		if (LibrariesStringCompare(String_Option_Name, STRING_TFTP_OPTION_TRANSFER_SIZE))
+		{
+			if (LibrariesFilePreallocate(File_ID, LibrariesStringConvertStringToUnsignedInteger(String_Option_Value)) != 0)
+			{
+				LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_NOT_ENOUGH_SPACE);
+				return 1;
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
 /** Receive a file from the remote server.
  * @param String_File_Name The remote file name.
  * @return 0 if the file was successfully retrieved,
@@ -31,19 +93,25 @@ static TNetworkSocket Socket_Server;
  */
 int TFTPExecuteCommandGet(char *String_File_Name)
 {
-	TNetworkTFTPPacket Packet;
-	unsigned int File_Name_Length, Transfer_Mode_Length, File_ID, Data_Size;
-	int Return_Value = 1;
+	TNetworkTFTPPacket Packets[2], *Pointer_Packet = &Packets[0]; // Two packets are used alternately, so a packet data can be written to the file in background while the next packet is received
+	unsigned int File_Name_Length, Transfer_Mode_Length, Request_Size, File_ID, Data_Size, Packet_Index, Request_IDs[2];
+	int Return_Value = 1, Is_Request_Pending[2] = {0, 0}, Is_Packet_Received = 0;
 	unsigned short Received_Block_Number, Expected_Block_Number = 1;
 	
 	// Prepare the read request
-	Packet.Opcode = NETWORK_SWAP_WORD(NETWORK_TFTP_OPCODE_READ_REQUEST);
+	Pointer_Packet->Opcode = NETWORK_SWAP_WORD(NETWORK_TFTP_OPCODE_READ_REQUEST);
 	// Append the requested file name
-	LibrariesStringCopyUpToNumber(String_File_Name, Packet.Request.String_File_Name_And_Mode, LIBRARIES_FILE_NAME_LENGTH);
-	File_Name_Length = LibrariesStringGetSize(Packet.Request.String_File_Name_And_Mode);
+	LibrariesStringCopyUpToNumber(String_File_Name, Pointer_Packet->Request.String_File_Name_And_Mode, LIBRARIES_FILE_NAME_LENGTH);
+	File_Name_Length = LibrariesStringGetSize(Pointer_Packet->Request.String_File_Name_And_Mode);
 	// Append the transfer mode
-	LibrariesStringCopy(STRING_TFTP_TRANSFER_MODE, &Packet.Request.String_File_Name_And_Mode[File_Name_Length + 1]); // Append the string right after the file name string terminating zero
+	LibrariesStringCopy(STRING_TFTP_TRANSFER_MODE, &Pointer_Packet->Request.String_File_Name_And_Mode[File_Name_Length + 1]); // Append the string right after the file name string terminating zero
 	Transfer_Mode_Length = LibrariesStringGetSize(STRING_TFTP_TRANSFER_MODE);
+	Request_Size = File_Name_Length + 1 + Transfer_Mode_Length + 1; // +2 bytes for both strings terminating zeroes
+	// Ask for the file size to reserve the file space before downloading (servers that do not support options ignore it)
+	LibrariesStringCopy(STRING_TFTP_OPTION_TRANSFER_SIZE, &Pointer_Packet->Request.String_File_Name_And_Mode[Request_Size]);
+	Request_Size += sizeof(STRING_TFTP_OPTION_TRANSFER_SIZE); // The terminating zero is included
+	LibrariesStringCopy("0", &Pointer_Packet->Request.String_File_Name_And_Mode[Request_Size]); // The value is 0 for a read request
+	Request_Size += 2;
 	
 	// Open the file to be ready to write it's content
 	if (LibrariesFileOpen(String_File_Name, LIBRARIES_FILE_OPENING_MODE_WRITE, &File_ID) != 0)
@@ -53,7 +121,7 @@ int TFTPExecuteCommandGet(char *String_File_Name)
 	}
 	
 	// Send the read request
-	if (NetworkUDPSendBuffer(&Socket_Server, sizeof(Packet.Opcode) + File_Name_Length + 1 + Transfer_Mode_Length + 1, &Packet) != 0) // +2 bytes for both strings terminating zeroes
+	if (NetworkUDPSendBuffer(&Socket_Server, sizeof(Pointer_Packet->Opcode) + Request_Size, Pointer_Packet) != 0)
 	{
 		LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_NETWORK_TRANSMISSION_FAILED);
 		goto Exit;
@@ -61,35 +129,63 @@ int TFTPExecuteCommandGet(char *String_File_Name)
 	
 	LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_STARTING_DOWNLOAD);
 	
+	// The server answers with an option acknowledgment if it supports options, or directly with the first data packet
+	Pointer_Packet = &Packets[Expected_Block_Number & 1];
+	if (NetworkTFTPReceivePacket(&Socket_Server, TFTP_PACKET_RECEPTION_TIMEOUT, &Data_Size, Pointer_Packet) != 0)
+	{
+		LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_NETWORK_RECEPTION_FAILED);
+		goto Exit;
+	}
+	if (NETWORK_SWAP_WORD(Pointer_Packet->Opcode) == NETWORK_TFTP_OPCODE_OPTION_ACKNOWLEDGMENT)
+	{
+		if (TFTPPreallocateFile(File_ID, Pointer_Packet, Data_Size) != 0) goto Exit;
+		
+		// Acknowledge the options to start the transfer
+		Pointer_Packet->Opcode = NETWORK_SWAP_WORD(NETWORK_TFTP_OPCODE_ACKNOWLEDGMENT);
+		Pointer_Packet->Acknowledgment.Block_Number = 0;
+		if (NetworkUDPSendBuffer(&Socket_Server, sizeof(Pointer_Packet->Opcode) + sizeof(Pointer_Packet->Acknowledgment.Block_Number), Pointer_Packet) != 0)
+		{
+			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_NETWORK_TRANSMISSION_FAILED);
+			goto Exit;
+		}
+	}
+	else Is_Packet_Received = 1;
+	
 	// Receive the file
 	do
 	{
-		// Get a packet
-		if (NetworkTFTPReceivePacket(&Socket_Server, TFTP_PACKET_RECEPTION_TIMEOUT, &Data_Size, &Packet) != 0) // Data_Size contains for now the raw TFTP packet size
+		// Make sure the data previously received in this packet are in the file before overwriting them
+		Packet_Index = Expected_Block_Number & 1;
+		Pointer_Packet = &Packets[Packet_Index];
+		if (TFTPWaitForFileWrite(&Is_Request_Pending[Packet_Index], Request_IDs[Packet_Index]) != 0) goto Exit;
+		
+		// Get a packet (unless the first one was received yet)
+		if (Is_Packet_Received) Is_Packet_Received = 0;
+		else if (NetworkTFTPReceivePacket(&Socket_Server, TFTP_PACKET_RECEPTION_TIMEOUT, &Data_Size, Pointer_Packet) != 0) // Data_Size contains for now the raw TFTP packet size
 		{
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_NETWORK_RECEPTION_FAILED);
 			goto Exit;
 		}
-		Packet.Opcode = NETWORK_SWAP_WORD(Packet.Opcode);
+		Pointer_Packet->Opcode = NETWORK_SWAP_WORD(Pointer_Packet->Opcode);
 		
 		// Did an error occurred ?
-		if (Packet.Opcode == NETWORK_TFTP_OPCODE_ERROR)
+		if (Pointer_Packet->Opcode == NETWORK_TFTP_OPCODE_ERROR)
 		{
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_SERVER_ERROR_1);
-			LibrariesScreenWriteString(Packet.Error.String_Error_Message);
+			LibrariesScreenWriteString(Pointer_Packet->Error.String_Error_Message);
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_SERVER_ERROR_2);
 			goto Exit;
 		}
 		
 		// Is it a data packet ?
-		if (Packet.Opcode != NETWORK_TFTP_OPCODE_DATA)
+		if (Pointer_Packet->Opcode != NETWORK_TFTP_OPCODE_DATA)
 		{
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_BAD_NETWORK_PACKET_RECEIVED);
 			goto Exit;
 		}
 		
 		// Make sure the received block is the expected one
-		Received_Block_Number = NETWORK_SWAP_WORD(Packet.Data.Block_Number);
+		Received_Block_Number = NETWORK_SWAP_WORD(Pointer_Packet->Data.Block_Number);
 		if (Received_Block_Number != Expected_Block_Number)
 		{
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_BAD_BLOCK_NUMBER_1);
@@ -102,34 +198,39 @@ int TFTPExecuteCommandGet(char *String_File_Name)
 		Expected_Block_Number++;
 		
 		// Adjust size to fit only the data size
-		Data_Size -= sizeof(Packet.Opcode) + sizeof(Packet.Data.Block_Number);
+		Data_Size -= sizeof(Pointer_Packet->Opcode) + sizeof(Pointer_Packet->Data.Block_Number);
 		
-		// Store data in the file
-		if (LibrariesFileWrite(File_ID, Packet.Data.Buffer, Data_Size) != 0)
+		// Store data in the file while the next packet is received
+		if (LibrariesFileSubmitAsynchronousRequest(File_ID, Pointer_Packet->Data.Buffer, Data_Size, &Request_IDs[Packet_Index]) != 0)
 		{
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_CANT_WRITE_TO_FILE);
 			goto Exit;
 		}
+		Is_Request_Pending[Packet_Index] = 1;
 		
 		// Send an Acknowledgment packet
-		Packet.Opcode = NETWORK_SWAP_WORD(NETWORK_TFTP_OPCODE_ACKNOWLEDGMENT); // No need to set the block number as it is at the same place than the one received (and it must have the same value)
-		if (NetworkUDPSendBuffer(&Socket_Server, sizeof(Packet.Opcode) + sizeof(Packet.Data.Block_Number), &Packet) != 0)
+		Pointer_Packet->Opcode = NETWORK_SWAP_WORD(NETWORK_TFTP_OPCODE_ACKNOWLEDGMENT); // No need to set the block number as it is at the same place than the one received (and it must have the same value), the data buffer is not modified so the file write can go on
+		if (NetworkUDPSendBuffer(&Socket_Server, sizeof(Pointer_Packet->Opcode) + sizeof(Pointer_Packet->Data.Block_Number), Pointer_Packet) != 0)
 		{
 			LibrariesScreenWriteString(STRING_COMMAND_TFTP_GENERIC_NETWORK_TRANSMISSION_FAILED);
 			goto Exit;
 		}
 	} while (Data_Size == NETWORK_TFTP_BLOCK_SIZE); // Exit if the data size is different from a block size
 	
+	// Wait for the last data to be written
+	if (TFTPWaitForFileWrite(&Is_Request_Pending[0], Request_IDs[0]) != 0) goto Exit;
+	if (TFTPWaitForFileWrite(&Is_Request_Pending[1], Request_IDs[1]) != 0) goto Exit;
+	
 	// Display a success message
 	LibrariesScreenSetFontColor(LIBRARIES_SCREEN_COLOR_GREEN);
 	LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_DOWNLOAD_SUCCESSFUL_1);
-	LibrariesScreenWriteUnsignedInteger(NETWORK_SWAP_WORD(Packet.Data.Block_Number));
+	LibrariesScreenWriteUnsignedInteger(NETWORK_SWAP_WORD(Pointer_Packet->Data.Block_Number));
 	LibrariesScreenWriteString(STRING_COMMAND_TFTP_GET_DOWNLOAD_SUCCESSFUL_2);
 	LibrariesScreenSetFontColor(LIBRARIES_SCREEN_COLOR_BLUE);
 	Return_Value = 0;
 	
 Exit:
-	LibrariesFileClose(File_ID);
+	LibrariesFileClose(File_ID); // This also completes the pending file writes
 	if (Return_Value != 0) LibrariesFileDelete(String_File_Name); // Remove the partial file
 	return Return_Value;
 }
@@ -32,6 +32,14 @@ int CommandMainDf(int argc, char *argv[]);
  */
 int CommandMainDiff(int argc, char *argv[]);
 
+/** The "input/output statistics" command.
+ * @param argc Parameters count.
+ * @param argv Parameters value.
+ * @return 0 in case of success,
+ * @return a negative value if an error happened.
+ */
+int CommandMainIostat(int argc, char *argv[]);
+
 /** The "list" command.
  * @param argc Parameters count.
  * @param argv Parameters value.
@@ -34,6 +34,10 @@ static TCommand Commands[] =
 		"diff",
 		CommandMainDiff
 	},
+	{
+		"iostat",
+		CommandMainIostat
+	},
 	{
 		"ls",
 		CommandMainLs
@@ -65,6 +65,25 @@
 	#define STRING_COMMAND_DIFF_FILES_ARE_DIFFERENT "Les fichiers sont diff\202rents.\n"
 	#define STRING_COMMAND_DIFF_FILES_ARE_EQUAL "Les fichiers sont identiques.\n"
 	
+	// "iostat" command
+	#define STRING_COMMAND_IOSTAT_USAGE "Affiche l'activit\202 du disque dur depuis le d\202marrage du syst\212me.\n" \
+		"Cette commande n'a pas de param\212tre.\n"
+	#define STRING_COMMAND_IOSTAT_READS "Lectures : "
+	#define STRING_COMMAND_IOSTAT_WRITES "\220critures : "
+	#define STRING_COMMAND_IOSTAT_COMMANDS " commande(s), "
+	#define STRING_COMMAND_IOSTAT_SECTORS " secteur(s) ("
+	#define STRING_COMMAND_IOSTAT_KILOBYTES " Ko)\n"
+	#define STRING_COMMAND_IOSTAT_FLUSHES "Vidages du cache : "
+	#define STRING_COMMAND_IOSTAT_ERRORS ", erreurs : "
+	#define STRING_COMMAND_IOSTAT_READ_LATENCY "Dur\202e des lectures :\n"
+	#define STRING_COMMAND_IOSTAT_WRITE_LATENCY "Dur\202e des \202critures :\n"
+	#define STRING_COMMAND_IOSTAT_FLUSH_LATENCY "Dur\202e des vidages du cache :\n"
+	#define STRING_COMMAND_IOSTAT_NO_COMMAND "  aucune commande\n"
+	#define STRING_COMMAND_IOSTAT_NO_LATENCY "Le processeur ne peut pas mesurer la dur\202e des commandes.\n"
+	#define STRING_COMMAND_IOSTAT_UNIT_NANOSECONDS " ns"
+	#define STRING_COMMAND_IOSTAT_UNIT_MICROSECONDS " \346s"
+	#define STRING_COMMAND_IOSTAT_UNIT_MILLISECONDS " ms"
+	
 	// "ls" command
 	#define STRING_COMMAND_LS_USAGE "Liste dans l'ordre alphab\202tique tous les fichiers pr\202sents sur le disque dur.\n" \
 		"Cette commande n'a pas de param\212tre.\n"
@@ -106,6 +125,7 @@
 	// "get" command specific messages
 	#define STRING_COMMAND_TFTP_GET_CANT_OPEN_FILE "Erreur lors de l'ouverture du fichier local.\n"
 	#define STRING_COMMAND_TFTP_GET_CANT_WRITE_TO_FILE "Erreur lors de l'\202criture dans le fichier.\n"
+	#define STRING_COMMAND_TFTP_GET_NOT_ENOUGH_SPACE "Erreur : il n'y a pas assez de place pour stocker le fichier.\n"
 	#define STRING_COMMAND_TFTP_GET_STARTING_DOWNLOAD "T\202l\202chargement en cours...\n"
 	#define STRING_COMMAND_TFTP_GET_DOWNLOAD_SUCCESSFUL_1 "T\202l\202chargement de "
 	#define STRING_COMMAND_TFTP_GET_DOWNLOAD_SUCCESSFUL_2 " bloc(s) r\202ussi.\n"
@@ -0,0 +1,719 @@
+/** @file File_System_Image_Tool.c
+ * Tool to create, list, extract, write, check and analyze Lemon file systems directly into a hard disk image (or a raw file system image), without having to boot the system.
+ * The image can be a whole disk image containing a Lemon partition (the file system is located after the partition MBR and kernel) or a raw file system image starting at the image first byte.
+ * Compile using : gcc -W -Wall -I../../System/Includes File_System_Image_Tool.c -o File_System_Image_Tool.out
+ * @author Adrien RICCIARDI
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+// Use the system default limits if the tool is not compiled with the Kconfig values
+#ifndef CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES
+	/** The maximum Blocks List entries count the kernel can mount. */
+	#define CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES 2048
+#endif
+#ifndef CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES
+	/** The maximum Files List entries count the kernel can mount. */
+	#define CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES 128
+#endif
+#ifndef CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES
+	/** The biggest block size the kernel can mount, it is also the default size of the created file systems. */
+	#define CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES 4096
+#endif
+
+// The file system structures are shared with the system, so the on-disk layout can't diverge
+#include <File_System/File_System.h>
+
+/** The MBR boot signature location. */
+#define MASTER_BOOT_RECORD_SIGNATURE_OFFSET 510
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The loaded file system. */
+TFileSystem File_System; // Declared by File_System.h
+
+/** The opened image file. */
+static FILE *File_Image;
+/** The first image sector containing the file system. */
+static unsigned int Starting_Sector;
+
+/** The Blocks List size in sectors (the file system informations are included). */
+static unsigned int Blocks_List_Size_Sectors;
+/** The Files List size in sectors. */
+static unsigned int Files_List_Size_Sectors;
+/** The first data sector. */
+static unsigned int Data_First_Sector_Number;
+/** The loaded file system block size in bytes. */
+static unsigned int Block_Size_Bytes;
+/** The loaded file system block size in sectors. */
+static unsigned int Block_Size_Sectors;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Read or write some consecutive sectors in the image.
+ * @param Is_Write_Operation Set to 1 to write, set to 0 to read.
+ * @param First_Sector_Number The first sector to access.
+ * @param Sectors_Count How many sectors to access.
+ * @param Pointer_Buffer The data to write or the read data.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int AccessSectors(int Is_Write_Operation, unsigned int First_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	size_t Size;
+
+	if (fseeko(File_Image, (off_t) First_Sector_Number * FILE_SYSTEM_SECTOR_SIZE_BYTES, SEEK_SET) != 0)
+	{
+		printf("Error : failed to seek to sector %u (%s).\n", First_Sector_Number, strerror(errno));
+		return -1;
+	}
+
+	if (Is_Write_Operation) Size = fwrite(Pointer_Buffer, FILE_SYSTEM_SECTOR_SIZE_BYTES, Sectors_Count, File_Image);
+	else Size = fread(Pointer_Buffer, FILE_SYSTEM_SECTOR_SIZE_BYTES, Sectors_Count, File_Image);
+	if (Size != Sectors_Count)
+	{
+		printf("Error : failed to %s %u sectors from sector %u.\n", Is_Write_Operation ? "write" : "read", Sectors_Count, First_Sector_Number);
+		return -1;
+	}
+	return 0;
+}
+
+/** Compute the file system structures location from the file system informations. */
+static void ComputeLayout(void)
+{
+	unsigned int Temp;
+
+	// Same computations than the kernel FileSystemInitialize()
+	Temp = File_System.File_System_Informations.Total_Blocks_Count * sizeof(unsigned int) + sizeof(TFileSystemInformations);
+	Blocks_List_Size_Sectors = Temp / FILE_SYSTEM_SECTOR_SIZE_BYTES;
+	if (Temp % FILE_SYSTEM_SECTOR_SIZE_BYTES != 0) Blocks_List_Size_Sectors++;
+
+	Temp = File_System.File_System_Informations.Total_Files_Count * sizeof(TFilesListEntry);
+	Files_List_Size_Sectors = Temp / FILE_SYSTEM_SECTOR_SIZE_BYTES;
+	if (Temp % FILE_SYSTEM_SECTOR_SIZE_BYTES != 0) Files_List_Size_Sectors++;
+
+	Data_First_Sector_Number = Starting_Sector + Blocks_List_Size_Sectors + Files_List_Size_Sectors;
+
+	Block_Size_Bytes = File_System.File_System_Informations.Block_Size_Bytes;
+	Block_Size_Sectors = Block_Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES;
+}
+
+/** Tell if a block size can be used by the kernel.
+ * @param Size_Bytes The block size to check.
+ * @return 1 if the block size is valid,
+ * @return 0 if the block size is not a power of two or is out of the supported range.
+ */
+static int IsBlockSizeValid(unsigned int Size_Bytes)
+{
+	if ((Size_Bytes < FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES) || (Size_Bytes > CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES)) return 0;
+	if ((Size_Bytes & (Size_Bytes - 1)) != 0) return 0;
+	return 1;
+}
+
+/** Find where the file system is located in the image. A disk image containing a Lemon partition stores the file system after the MBR and the kernel, otherwise the image is considered as a raw file system.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int FindStartingSector(void)
+{
+	unsigned char Sector[FILE_SYSTEM_SECTOR_SIZE_BYTES];
+	TFileSystemMasterBootLoaderPartitionTableEntry *Pointer_Partition_Entry;
+	int i;
+
+	Starting_Sector = 0;
+
+	// An empty image is a raw file system that is being created
+	if (fread(Sector, sizeof(Sector), 1, File_Image) != 1) return 0;
+
+	// Is this a MBR ?
+	if ((Sector[MASTER_BOOT_RECORD_SIGNATURE_OFFSET] != 0x55) || (Sector[MASTER_BOOT_RECORD_SIGNATURE_OFFSET + 1] != 0xAA)) return 0;
+
+	// Search for the Lemon partition
+	Pointer_Partition_Entry = (TFileSystemMasterBootLoaderPartitionTableEntry *) &Sector[FILE_SYSTEM_MASTER_BOOT_LOADER_PARTITION_TABLE_OFFSET];
+	for (i = 0; i < FILE_SYSTEM_MASTER_BOOT_LOADER_PARTITION_TABLE_ENTRIES_COUNT; i++)
+	{
+		if (Pointer_Partition_Entry[i].Type == FILE_SYSTEM_MASTER_BOOT_LOADER_PARTITION_TABLE_PARTITION_TYPE_LEMON)
+		{
+			// The Lemon MBR located at the partition start records the kernel size, the file system is stored right after the kernel
+			Starting_Sector = Pointer_Partition_Entry[i].First_Sector_LBA;
+			if (AccessSectors(0, Starting_Sector, 1, Sector) != 0) return -1;
+			Starting_Sector += CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET(Sector[CONFIGURATION_FILE_SYSTEM_MBR_KERNEL_SECTORS_COUNT_OFFSET] | (Sector[CONFIGURATION_FILE_SYSTEM_MBR_KERNEL_SECTORS_COUNT_OFFSET + 1] << 8));
+			return 0;
+		}
+	}
+
+	printf("Error : the image contains a MBR but no Lemon partition.\n");
+	return -1;
+}
+
+/** Load the file system structures from the image.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int LoadFileSystem(void)
+{
+	// Retrieve the file system informations
+	if (AccessSectors(0, Starting_Sector, 1, &File_System) != 0) return -1;
+	if (File_System.File_System_Informations.Magic_Number != FILE_SYSTEM_MAGIC_NUMBER)
+	{
+		printf("Error : no Lemon file system found at sector %u.\n", Starting_Sector);
+		return -1;
+	}
+	if ((File_System.File_System_Informations.Total_Blocks_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES) || (File_System.File_System_Informations.Total_Files_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES))
+	{
+		printf("Error : the file system (%u blocks, %u files) is bigger than the maximum supported size (%u blocks, %u files).\n", File_System.File_System_Informations.Total_Blocks_Count, File_System.File_System_Informations.Total_Files_Count, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES);
+		return -1;
+	}
+	if (!IsBlockSizeValid(File_System.File_System_Informations.Block_Size_Bytes))
+	{
+		printf("Error : the file system block size (%u bytes) is not supported (the maximum is %u bytes).\n", File_System.File_System_Informations.Block_Size_Bytes, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES);
+		return -1;
+	}
+
+	// Load the lists
+	ComputeLayout();
+	if (AccessSectors(0, Starting_Sector, Blocks_List_Size_Sectors, &File_System) != 0) return -1;
+	if (AccessSectors(0, Starting_Sector + Blocks_List_Size_Sectors, Files_List_Size_Sectors, File_System.Files_List) != 0) return -1;
+	return 0;
+}
+
+/** Write the file system structures back to the image.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int SaveFileSystem(void)
+{
+	if (AccessSectors(1, Starting_Sector, Blocks_List_Size_Sectors, &File_System) != 0) return -1;
+	if (AccessSectors(1, Starting_Sector + Blocks_List_Size_Sectors, Files_List_Size_Sectors, File_System.Files_List) != 0) return -1;
+	return 0;
+}
+
+/** Find a file in the Files List.
+ * @param String_File_Name The file name.
+ * @return The file entry if found,
+ * @return NULL if the file does not exist.
+ */
+static TFilesListEntry *FindFile(char *String_File_Name)
+{
+	unsigned int i;
+
+	for (i = 0; i < File_System.File_System_Informations.Total_Files_Count; i++)
+	{
+		if (strncmp(String_File_Name, File_System.Files_List[i].String_Name, CONFIGURATION_FILE_NAME_LENGTH) == 0) return &File_System.Files_List[i];
+	}
+	return NULL;
+}
+
+/** Count the free blocks.
+ * @return The free blocks count.
+ */
+static unsigned int GetFreeBlocksCount(void)
+{
+	unsigned int Block, Count = 0;
+
+	Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+	while ((Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) && (Count < File_System.File_System_Informations.Total_Blocks_Count))
+	{
+		Block = File_System.Blocks_List[Block];
+		Count++;
+	}
+	return Count;
+}
+
+/** Give a file blocks back to the free blocks list the same way the kernel FileDelete() does.
+ * @param Pointer_File_Entry The file to delete.
+ */
+static void DeleteFile(TFilesListEntry *Pointer_File_Entry)
+{
+	unsigned int Last_Block;
+
+	// Find the file last block
+	Last_Block = Pointer_File_Entry->Start_Block;
+	while (File_System.Blocks_List[Last_Block] != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) Last_Block = File_System.Blocks_List[Last_Block];
+
+	// Prepend the file blocks to the free blocks list
+	File_System.Blocks_List[Last_Block] = File_System.File_System_Informations.Free_Blocks_List_Head;
+	File_System.File_System_Informations.Free_Blocks_List_Head = Pointer_File_Entry->Start_Block;
+	Pointer_File_Entry->String_Name[0] = 0;
+}
+
+/** Create a new empty file system.
+ * @param Blocks_Count The Blocks List entries count.
+ * @param Files_Count The Files List entries count.
+ * @param Requested_Block_Size_Bytes The block size.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int CommandCreate(unsigned int Blocks_Count, unsigned int Files_Count, unsigned int Requested_Block_Size_Bytes)
+{
+	unsigned int i;
+	unsigned char Sector[FILE_SYSTEM_SECTOR_SIZE_BYTES];
+
+	// Check parameters the same way than the kernel
+	if ((Blocks_Count == 0) || (Files_Count == 0) || (Blocks_Count < Files_Count))
+	{
+		printf("Error : the blocks count must be greater or equal to the files count.\n");
+		return -1;
+	}
+	if ((Blocks_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES) || (Files_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES))
+	{
+		printf("Error : the kernel can't mount more than %u blocks and %u files.\n", CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES);
+		return -1;
+	}
+	if (!IsBlockSizeValid(Requested_Block_Size_Bytes))
+	{
+		printf("Error : the block size must be a power of two from %u to %u bytes.\n", FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES);
+		return -1;
+	}
+
+	// Create the informations record
+	memset(&File_System, 0, sizeof(File_System));
+	File_System.File_System_Informations.Magic_Number = FILE_SYSTEM_MAGIC_NUMBER;
+	File_System.File_System_Informations.Total_Blocks_Count = Blocks_Count;
+	File_System.File_System_Informations.Total_Files_Count = Files_Count;
+	File_System.File_System_Informations.Block_Size_Bytes = Requested_Block_Size_Bytes;
+
+	// Chain all blocks in the free blocks list
+	File_System.File_System_Informations.Free_Blocks_List_Head = 0;
+	for (i = 0; i < Blocks_Count - 1; i++) File_System.Blocks_List[i] = i + 1;
+	File_System.Blocks_List[Blocks_Count - 1] = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+
+	ComputeLayout();
+	if (SaveFileSystem() != 0) return -1;
+
+	// Make sure the image is big enough to contain the whole data area
+	memset(Sector, 0, sizeof(Sector));
+	if (AccessSectors(1, Data_First_Sector_Number + (Blocks_Count * Block_Size_Sectors) - 1, 1, Sector) != 0) return -1;
+
+	printf("Created a file system of %u blocks of %u bytes (%llu bytes) and %u files at sector %u.\n", Blocks_Count, Block_Size_Bytes, (unsigned long long) Blocks_Count * Block_Size_Bytes, Files_Count, Starting_Sector);
+	return 0;
+}
+
+/** Display all files with their size. */
+static void CommandList(void)
+{
+	unsigned int i, Files_Count = 0;
+
+	for (i = 0; i < File_System.File_System_Informations.Total_Files_Count; i++)
+	{
+		if (File_System.Files_List[i].String_Name[0] == 0) continue;
+		printf("%-*.*s %10u\n", CONFIGURATION_FILE_NAME_LENGTH, CONFIGURATION_FILE_NAME_LENGTH, File_System.Files_List[i].String_Name, File_System.Files_List[i].Size_Bytes);
+		Files_Count++;
+	}
+	printf("%u file(s), %u free block(s) of %u bytes.\n", Files_Count, GetFreeBlocksCount(), Block_Size_Bytes);
+}
+
+/** Copy a file from the Lemon file system to the host.
+ * @param String_File_Name The Lemon file name.
+ * @param String_Host_File_Name The host file to create.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int CommandExtract(char *String_File_Name, char *String_Host_File_Name)
+{
+	TFilesListEntry *Pointer_File_Entry;
+	FILE *File_Host;
+	unsigned int Block, Remaining_Bytes, Bytes_Count;
+	unsigned char Buffer[CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES];
+	int Return_Value = -1;
+
+	Pointer_File_Entry = FindFile(String_File_Name);
+	if (Pointer_File_Entry == NULL)
+	{
+		printf("Error : the file '%s' does not exist.\n", String_File_Name);
+		return -1;
+	}
+
+	File_Host = fopen(String_Host_File_Name, "wb");
+	if (File_Host == NULL)
+	{
+		printf("Error : can't create the file '%s' (%s).\n", String_Host_File_Name, strerror(errno));
+		return -1;
+	}
+
+	// Follow the file blocks chain
+	Block = Pointer_File_Entry->Start_Block;
+	Remaining_Bytes = Pointer_File_Entry->Size_Bytes;
+	while (Remaining_Bytes > 0)
+	{
+		if ((Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) || (Block >= File_System.File_System_Informations.Total_Blocks_Count))
+		{
+			printf("Error : the file blocks chain is broken, run the 'fsck' command.\n");
+			goto Exit;
+		}
+
+		if (AccessSectors(0, Data_First_Sector_Number + Block * Block_Size_Sectors, Block_Size_Sectors, Buffer) != 0) goto Exit;
+
+		if (Remaining_Bytes > Block_Size_Bytes) Bytes_Count = Block_Size_Bytes;
+		else Bytes_Count = Remaining_Bytes;
+		if (fwrite(Buffer, 1, Bytes_Count, File_Host) != Bytes_Count)
+		{
+			printf("Error : failed to write to '%s'.\n", String_Host_File_Name);
+			goto Exit;
+		}
+
+		Remaining_Bytes -= Bytes_Count;
+		Block = File_System.Blocks_List[Block];
+	}
+	Return_Value = 0;
+
+Exit:
+	fclose(File_Host);
+	return Return_Value;
+}
+
+/** Copy a host file to the Lemon file system, replacing any existing file with the same name. Blocks are allocated in the same order than the kernel does.
+ * @param String_Host_File_Name The file to copy.
+ * @param String_File_Name The Lemon file name.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int CommandWrite(char *String_Host_File_Name, char *String_File_Name)
+{
+	TFilesListEntry *Pointer_File_Entry, *Pointer_Existing_File_Entry;
+	FILE *File_Host;
+	struct stat File_Status;
+	unsigned int i, Blocks_Count, Available_Blocks_Count, Block;
+	unsigned char Buffer[CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES];
+	int Return_Value = -1;
+
+	if ((strlen(String_File_Name) == 0) || (strlen(String_File_Name) > CONFIGURATION_FILE_NAME_LENGTH))
+	{
+		printf("Error : the file name must contain from 1 to %d characters.\n", CONFIGURATION_FILE_NAME_LENGTH);
+		return -1;
+	}
+
+	File_Host = fopen(String_Host_File_Name, "rb");
+	if (File_Host == NULL)
+	{
+		printf("Error : can't open the file '%s' (%s).\n", String_Host_File_Name, strerror(errno));
+		return -1;
+	}
+	if ((fstat(fileno(File_Host), &File_Status) != 0) || (File_Status.st_size > 0xFFFFFFFFLL))
+	{
+		printf("Error : can't determine the file '%s' size or the file is bigger than 4 GB.\n", String_Host_File_Name);
+		goto Exit;
+	}
+
+	// An empty file still owns a block
+	Blocks_Count = (File_Status.st_size + Block_Size_Bytes - 1) / Block_Size_Bytes;
+	if (Blocks_Count == 0) Blocks_Count = 1;
+
+	// Check for enough room before modifying anything (the replaced file blocks will be freed)
+	Pointer_Existing_File_Entry = FindFile(String_File_Name);
+	Available_Blocks_Count = GetFreeBlocksCount();
+	if (Pointer_Existing_File_Entry != NULL)
+	{
+		Block = Pointer_Existing_File_Entry->Start_Block;
+		while (Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
+		{
+			Available_Blocks_Count++;
+			Block = File_System.Blocks_List[Block];
+		}
+		DeleteFile(Pointer_Existing_File_Entry);
+	}
+	if (Blocks_Count > Available_Blocks_Count)
+	{
+		printf("Error : not enough free space (%u blocks needed, %u available).\n", Blocks_Count, Available_Blocks_Count);
+		goto Exit;
+	}
+
+	// Allocate the file entry
+	Pointer_File_Entry = NULL;
+	for (i = 0; i < File_System.File_System_Informations.Total_Files_Count; i++)
+	{
+		if (File_System.Files_List[i].String_Name[0] == 0)
+		{
+			Pointer_File_Entry = &File_System.Files_List[i];
+			break;
+		}
+	}
+	if (Pointer_File_Entry == NULL)
+	{
+		printf("Error : the Files List is full.\n");
+		goto Exit;
+	}
+	strncpy(Pointer_File_Entry->String_Name, String_File_Name, CONFIGURATION_FILE_NAME_LENGTH);
+	Pointer_File_Entry->Size_Bytes = File_Status.st_size;
+	Pointer_File_Entry->Start_Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+
+	// Write each block taken from the free blocks list head
+	for (i = 0; i < Blocks_Count; i++)
+	{
+		Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+		File_System.File_System_Informations.Free_Blocks_List_Head = File_System.Blocks_List[Block];
+
+		memset(Buffer, 0, sizeof(Buffer));
+		if ((fread(Buffer, 1, sizeof(Buffer), File_Host) == 0) && ferror(File_Host))
+		{
+			printf("Error : failed to read from '%s'.\n", String_Host_File_Name);
+			goto Exit;
+		}
+		if (AccessSectors(1, Data_First_Sector_Number + Block * Block_Size_Sectors, Block_Size_Sectors, Buffer) != 0) goto Exit;
+
+		// Terminate the file chain on the last block, the other blocks are already chained by the free blocks list
+		if (i == Blocks_Count - 1) File_System.Blocks_List[Block] = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+	}
+
+	Return_Value = SaveFileSystem();
+
+Exit:
+	fclose(File_Host);
+	return Return_Value;
+}
+
+/** Check the file system consistency : blocks out of range, cross-linked blocks, loops, lost blocks, bad file sizes and duplicate file names.
+ * @return 0 if the file system is consistent,
+ * @return -1 if errors were found.
+ */
+static int CommandCheck(void)
+{
+	static unsigned int Block_Owners[CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES]; // 0 means unused, 1 means free blocks list, otherwise it is the Files List index + 2
+	unsigned int i, j, Block, Owner, Blocks_Count, Expected_Blocks_Count, Total_Blocks_Count, Errors_Count = 0;
+	TFilesListEntry *Pointer_File_Entry;
+
+	Total_Blocks_Count = File_System.File_System_Informations.Total_Blocks_Count;
+	memset(Block_Owners, 0, sizeof(Block_Owners));
+
+	// Walk the free blocks list
+	Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+	while (Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
+	{
+		if (Block >= Total_Blocks_Count)
+		{
+			printf("Free blocks list : block %u is out of range.\n", Block);
+			Errors_Count++;
+			break;
+		}
+		if (Block_Owners[Block] != 0)
+		{
+			printf("Free blocks list : loop detected on block %u.\n", Block);
+			Errors_Count++;
+			break;
+		}
+		Block_Owners[Block] = 1;
+		Block = File_System.Blocks_List[Block];
+	}
+
+	// Walk each file chain
+	for (i = 0; i < File_System.File_System_Informations.Total_Files_Count; i++)
+	{
+		Pointer_File_Entry = &File_System.Files_List[i];
+		if (Pointer_File_Entry->String_Name[0] == 0) continue;
+
+		// Look for duplicate names
+		for (j = i + 1; j < File_System.File_System_Informations.Total_Files_Count; j++)
+		{
+			if (strncmp(Pointer_File_Entry->String_Name, File_System.Files_List[j].String_Name, CONFIGURATION_FILE_NAME_LENGTH) == 0)
+			{
+				printf("File '%.*s' : name is duplicated at Files List entry %u.\n", CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, j);
+				Errors_Count++;
+			}
+		}
+
+		Blocks_Count = 0;
+		Block = Pointer_File_Entry->Start_Block;
+		while (Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
+		{
+			if (Block >= Total_Blocks_Count)
+			{
+				printf("File '%.*s' : block %u is out of range.\n", CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, Block);
+				Errors_Count++;
+				break;
+			}
+			Owner = Block_Owners[Block];
+			if (Owner == i + 2)
+			{
+				printf("File '%.*s' : loop detected on block %u.\n", CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, Block);
+				Errors_Count++;
+				break;
+			}
+			if (Owner != 0)
+			{
+				if (Owner == 1) printf("File '%.*s' : block %u is also in the free blocks list.\n", CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, Block);
+				else printf("File '%.*s' : block %u is cross-linked with file '%.*s'.\n", CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, Block, CONFIGURATION_FILE_NAME_LENGTH, File_System.Files_List[Owner - 2].String_Name);
+				Errors_Count++;
+				break;
+			}
+			Block_Owners[Block] = i + 2;
+			Blocks_Count++;
+			Block = File_System.Blocks_List[Block];
+		}
+
+		// An empty file owns one block
+		Expected_Blocks_Count = (unsigned int) (((unsigned long long) Pointer_File_Entry->Size_Bytes + Block_Size_Bytes - 1) / Block_Size_Bytes);
+		if (Expected_Blocks_Count == 0) Expected_Blocks_Count = 1;
+		if (Blocks_Count != Expected_Blocks_Count)
+		{
+			printf("File '%.*s' : %u bytes need %u blocks but %u blocks are chained.\n", CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, Pointer_File_Entry->Size_Bytes, Expected_Blocks_Count, Blocks_Count);
+			Errors_Count++;
+		}
+	}
+
+	// Find the blocks owned by nobody
+	Blocks_Count = 0;
+	for (i = 0; i < Total_Blocks_Count; i++)
+	{
+		if (Block_Owners[i] == 0) Blocks_Count++;
+	}
+	if (Blocks_Count > 0)
+	{
+		printf("%u lost block(s) belong neither to a file nor to the free blocks list.\n", Blocks_Count);
+		Errors_Count++;
+	}
+
+	if (Errors_Count == 0)
+	{
+		printf("The file system is consistent.\n");
+		return 0;
+	}
+	printf("%u error(s) found.\n", Errors_Count);
+	return -1;
+}
+
+/** Display how many extents (runs of physically consecutive blocks) each file and the free space are split into. */
+static void CommandFragmentation(void)
+{
+	unsigned int i, Block, Previous_Block, Extents_Count, Blocks_Count, Files_Count = 0, Fragmented_Files_Count = 0, Total_Extents_Count = 0, Total_Blocks_Count = 0, Longest_Free_Extent = 0, Current_Free_Extent = 0;
+	TFilesListEntry *Pointer_File_Entry;
+
+	printf("%-*s %8s %8s\n", CONFIGURATION_FILE_NAME_LENGTH, "File", "Blocks", "Extents");
+	for (i = 0; i < File_System.File_System_Informations.Total_Files_Count; i++)
+	{
+		Pointer_File_Entry = &File_System.Files_List[i];
+		if (Pointer_File_Entry->String_Name[0] == 0) continue;
+
+		Extents_Count = 0;
+		Blocks_Count = 0;
+		Previous_Block = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+		Block = Pointer_File_Entry->Start_Block;
+		while ((Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) && (Block < File_System.File_System_Informations.Total_Blocks_Count) && (Blocks_Count < File_System.File_System_Informations.Total_Blocks_Count))
+		{
+			if ((Previous_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) || (Block != Previous_Block + 1)) Extents_Count++;
+			Blocks_Count++;
+			Previous_Block = Block;
+			Block = File_System.Blocks_List[Block];
+		}
+		printf("%-*.*s %8u %8u\n", CONFIGURATION_FILE_NAME_LENGTH, CONFIGURATION_FILE_NAME_LENGTH, Pointer_File_Entry->String_Name, Blocks_Count, Extents_Count);
+
+		Files_Count++;
+		if (Extents_Count > 1) Fragmented_Files_Count++;
+		Total_Extents_Count += Extents_Count;
+		Total_Blocks_Count += Blocks_Count;
+	}
+
+	printf("\n%u/%u file(s) fragmented", Fragmented_Files_Count, Files_Count);
+	if (Files_Count > 0) printf(" (%u%%), %.2f extents per file on average", Fragmented_Files_Count * 100 / Files_Count, (double) Total_Extents_Count / Files_Count);
+	printf(".\n");
+
+	// Free space is fragmented when the free blocks list is not made of consecutive blocks
+	Extents_Count = 0;
+	Blocks_Count = 0;
+	Previous_Block = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+	Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+	while ((Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) && (Block < File_System.File_System_Informations.Total_Blocks_Count) && (Blocks_Count < File_System.File_System_Informations.Total_Blocks_Count))
+	{
+		if ((Previous_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) || (Block != Previous_Block + 1))
+		{
+			Extents_Count++;
+			Current_Free_Extent = 0;
+		}
+		Current_Free_Extent++;
+		if (Current_Free_Extent > Longest_Free_Extent) Longest_Free_Extent = Current_Free_Extent;
+		Blocks_Count++;
+		Previous_Block = Block;
+		Block = File_System.Blocks_List[Block];
+	}
+	printf("Free space : %u block(s) in %u extent(s), longest contiguous extent is %u block(s).\n", Blocks_Count, Extents_Count, Longest_Free_Extent);
+}
+
+/** Display the program usage.
+ * @param String_Program_Name The program name.
+ */
+static void DisplayUsage(char *String_Program_Name)
+{
+	printf("Usage : %s Image_File Command [Arguments]\n"
+		"Commands :\n"
+		"  create Blocks_Count Files_Count [Block_Size] : create an empty file system (the default block size is %d bytes)\n"
+		"  list : list the files\n"
+		"  extract Lemon_File Host_File : copy a file from the image to the host\n"
+		"  write Host_File Lemon_File : copy a host file to the image (an existing file is replaced)\n"
+		"  fsck : check the file system consistency\n"
+		"  fragmentation : report files and free space fragmentation\n"
+		"If the image contains a MBR with a Lemon partition, the file system is located after the partition MBR and the kernel (the kernel size is read from the partition MBR), otherwise it starts at the image beginning.\n", String_Program_Name, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+	char *String_Command;
+	int Return_Value = EXIT_FAILURE;
+
+	// Check parameters
+	if (argc < 3)
+	{
+		DisplayUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	String_Command = argv[2];
+
+	// Open the image (it is created if a new raw file system is requested)
+	File_Image = fopen(argv[1], "r+b");
+	if ((File_Image == NULL) && (errno == ENOENT) && (strcmp(String_Command, "create") == 0)) File_Image = fopen(argv[1], "w+b");
+	if (File_Image == NULL)
+	{
+		printf("Error : can't open the image '%s' (%s).\n", argv[1], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (FindStartingSector() != 0) goto Exit;
+
+	if (strcmp(String_Command, "create") == 0)
+	{
+		if ((argc != 5) && (argc != 6))
+		{
+			DisplayUsage(argv[0]);
+			goto Exit;
+		}
+		if (CommandCreate(strtoul(argv[3], NULL, 0), strtoul(argv[4], NULL, 0), argc == 6 ? strtoul(argv[5], NULL, 0) : CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES) != 0) goto Exit;
+		Return_Value = EXIT_SUCCESS;
+		goto Exit;
+	}
+
+	// All other commands need an existing file system
+	if (LoadFileSystem() != 0) goto Exit;
+
+	if ((strcmp(String_Command, "list") == 0) && (argc == 3)) CommandList();
+	else if ((strcmp(String_Command, "extract") == 0) && (argc == 5))
+	{
+		if (CommandExtract(argv[3], argv[4]) != 0) goto Exit;
+	}
+	else if ((strcmp(String_Command, "write") == 0) && (argc == 5))
+	{
+		if (CommandWrite(argv[3], argv[4]) != 0) goto Exit;
+	}
+	else if ((strcmp(String_Command, "fsck") == 0) && (argc == 3))
+	{
+		if (CommandCheck() != 0) goto Exit;
+	}
+	else if ((strcmp(String_Command, "fragmentation") == 0) && (argc == 3)) CommandFragmentation();
+	else
+	{
+		DisplayUsage(argv[0]);
+		goto Exit;
+	}
+	Return_Value = EXIT_SUCCESS;
+
+Exit:
+	fclose(File_Image);
+	return Return_Value;
+}
@@ -1,2 +1,3 @@
 SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES = 128
 SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES = 2048
+SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES = 4096
@@ -93,6 +93,47 @@ int LibrariesFileWrite(unsigned int File_ID, void *Pointer_Buffer, unsigned int
  */
 void LibrariesFileClose(unsigned int File_ID);
 
+/** Reserve all the blocks needed by a file whose final size is known before writing it, so the write can't fail halfway through because the file system is full. The blocks are contiguous when possible, which makes reading the file faster. Reserved blocks that are not written are released when the file is closed.
+ * @param File_ID The file identifier. The file must be opened in write mode and must be empty.
+ * @param Bytes_Count The final file size in bytes.
+ * @return ERROR_CODE_NO_ERROR if the blocks were reserved,
+ * @return ERROR_CODE_BAD_FILE_DESCRIPTOR if the supplied file descriptor exceeds the maximum number of files that the kernel can open at the same time,
+ * @return ERROR_CODE_FILE_NOT_OPENED if the file is not opened,
+ * @return ERROR_CODE_BAD_OPENING_MODE if the file is not opened in write mode,
+ * @return ERROR_CODE_FILE_NOT_EMPTY if data were written to the file yet,
+ * @return ERROR_CODE_BLOCKS_LIST_FULL if there is not enough free space on the file system, nothing is reserved in this case.
+ */
+int LibrariesFilePreallocate(unsigned int File_ID, unsigned int Bytes_Count);
+
+/** Start reading (if the file is opened in read mode) or writing (if the file is opened in write mode) data a block at a time, each LibrariesFileSubmitAsynchronousRequest() or LibrariesFilePollAsynchronousRequest() call making the oldest request progress, so the program can do other work between the calls. Requests are processed in submission order, a synchronous read, write or close of the same file completes the file pending requests first.
+ * @param File_ID The file identifier.
+ * @param Pointer_Buffer The buffer to read data to or to write data from. Do not access it until the request is completed.
+ * @param Bytes_Count How many bytes to read or write.
+ * @param Pointer_Request_ID On output, contain the request identifier to give to LibrariesFilePollAsynchronousRequest() or LibrariesFileWaitAsynchronousRequest().
+ * @return ERROR_CODE_NO_ERROR if the request was submitted,
+ * @return ERROR_CODE_BAD_FILE_DESCRIPTOR if the supplied file descriptor exceeds the maximum number of files that the kernel can open at the same time,
+ * @return ERROR_CODE_FILE_NOT_OPENED if the file is not opened,
+ * @return ERROR_CODE_CANT_SUBMIT_MORE_ASYNCHRONOUS_REQUESTS if too many requests are not collected yet.
+ */
+int LibrariesFileSubmitAsynchronousRequest(unsigned int File_ID, void *Pointer_Buffer, unsigned int Bytes_Count, unsigned int *Pointer_Request_ID);
+
+/** Tell whether an asynchronous request is completed. A completed request is released, so its result can be retrieved only once.
+ * @param Request_ID The request identifier.
+ * @param Pointer_Processed_Bytes_Count On output, contain how many bytes were read or written yet (a read request can complete with less bytes than requested if the file end is reached).
+ * @return ERROR_CODE_ASYNCHRONOUS_REQUEST_PENDING if the request is still in progress,
+ * @return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST if the identifier does not match a submitted request,
+ * @return the same error codes than LibrariesFileRead() or LibrariesFileWrite() if the request is completed.
+ */
+int LibrariesFilePollAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count);
+
+/** Complete an asynchronous request right now and release it.
+ * @param Request_ID The request identifier.
+ * @param Pointer_Processed_Bytes_Count On output, contain how many bytes were read or written.
+ * @return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST if the identifier does not match a submitted request,
+ * @return the same error codes than LibrariesFileRead() or LibrariesFileWrite().
+ */
+int LibrariesFileWaitAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count);
+
 /** Delete an existing file.
  * @param String_File_Name The file to delete.
  * @return ERROR_CODE_NO_ERROR if the file has been successfully deleted,
@@ -24,4 +24,9 @@ int LibrariesSystemCall(TSystemCall Request_Code, int Integer_1, int Integer_2,
 /** Abort the current program execution and return to system. */
 void LibrariesSystemExitProgram(void);
 
+/** Retrieve the hard disk activity counters and commands latency histograms since the system started. This call lasts a few milliseconds.
+ * @param Pointer_Statistics On output, contain the statistics.
+ */
+void LibrariesSystemGetHardDiskStatistics(TSystemCallHardDiskStatistics *Pointer_Statistics);
+
 #endif
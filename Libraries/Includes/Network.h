@@ -84,6 +84,7 @@ typedef struct
 	unsigned int TCP_Sequence_Number; //<! The TCP sequence number (stored in little endian).
 	unsigned int TCP_Acknowledgement_Number; //<! The TCP acknowledgement number (stored in little endian).
 	int Is_TCP_Connection_Established; //<! Tell if the socket is successfully connected to a server or not.
+	unsigned int TCP_Destination_Window_Size; //<! How many bytes the recipient can receive, as advertised by its last TCP packet.
 	// TODO flag pour indiquer qu'il faut envoyer ACK avec SendBuffer
 	// TODO bit field pour les flags pour économiser de la place
 } TNetworkSocket;
@@ -127,7 +128,8 @@ typedef enum
 	NETWORK_TFTP_OPCODE_WRITE_REQUEST,
 	NETWORK_TFTP_OPCODE_DATA,
 	NETWORK_TFTP_OPCODE_ACKNOWLEDGMENT,
-	NETWORK_TFTP_OPCODE_ERROR
+	NETWORK_TFTP_OPCODE_ERROR,
+	NETWORK_TFTP_OPCODE_OPTION_ACKNOWLEDGMENT //!< Defined by RFC 2347.
 } TNetworkTFTPOpcode;
 
 /** All known TFTP error codes. */
@@ -169,6 +171,12 @@ typedef struct __attribute__((packed))
 	char String_Error_Message[NETWORK_TFTP_BLOCK_SIZE]; //!< A human readable error string.
 } TNetworkTFTPPacketError;
 
+/** TFTP OACK packet specific header part. */
+typedef struct __attribute__((packed))
+{
+	char String_Options[NETWORK_TFTP_BLOCK_SIZE]; //!< Pairs of ASCIIZ strings, an option name followed by the option value.
+} TNetworkTFTPPacketOptionAcknowledgment;
+
 /** The TFTP protocol header for all existing packets. */
 typedef struct __attribute__((packed))
 {
@@ -179,6 +187,7 @@ typedef struct __attribute__((packed))
 		TNetworkTFTPPacketData Data; //!< DATA packet specific fields.
 		TNetworkTFTPPacketAcknowledgment Acknowledgment; //!< ACK packet specific fields.
 		TNetworkTFTPPacketError Error; //!< ERROR packet specific fields.
+		TNetworkTFTPPacketOptionAcknowledgment Option_Acknowledgment; //!< OACK packet specific fields.
 	};
 } TNetworkTFTPPacket;
 
@@ -274,7 +283,7 @@ int NetworkTCPConnectToServer(TNetworkSocket *Pointer_Socket);
 
 /** Send a data buffer to the connected recipient.
  * @param Pointer_Socket The connected socket used to transmit data.
- * @param Buffer_Size The buffer size in bytes.
+ * @param Buffer_Size The buffer size in bytes. When the ethernet controller can split TCP packets, the buffer can be up to SYSTEM_CALL_ETHERNET_MAXIMUM_SEGMENTED_PAYLOAD_SIZE bytes, otherwise it must fit in a single packet.
  * @param Pointer_Buffer The buffer content.
  * @return 0 if data were successfully sent and received by the recipient,
  * @return 1 if a transmission error occurred,
@@ -13,6 +13,9 @@
 /** How many time to wait before considering a packet reception failed (in milliseconds). */
 #define NETWORK_BASE_TCP_RECEPTION_TIMEOUT_MILLISECONDS 5000
 
+/** The biggest TCP payload size in bytes that fits in a standard 1500-byte ethernet payload, it is the size of the frames sent by the ethernet controller when it splits a TCP packet. */
+#define NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE (1500 - sizeof(TNetworkIPv4Header) - sizeof(TNetworkTCPHeader))
+
 //-------------------------------------------------------------------------------------------------
 // Variables
 //-------------------------------------------------------------------------------------------------
@@ -74,15 +77,41 @@ void NetworkBaseTCPPrepareHeader(TNetworkSocket *Pointer_Socket, unsigned short
  * @param Bytes_Count The TCP header size plus the TCP payload size in bytes.
  * @return The checksum to put in the corresponding TCP header field.
  * @note The TCP checksum field must be set to zero prior to call this function.
+ * @note When the ethernet controller can insert the checksums, only the pseudo header sum is computed and NetworkBaseIPSendPacket() tells the controller to finish the job, so the packet must be sent with this function.
  * @warning The TCP pseudo header needed to compute the checksum will be appended just before the Pointer_Data address.
  */
 unsigned short NetworkBaseTCPComputeChecksum(TNetworkSocket *Pointer_Socket, void *Pointer_Data, unsigned int Bytes_Count);
 
+/** Tell whether the ethernet controller can split big TCP packets (see NetworkBaseTCPSendSegmentedPacket()).
+ * @return 1 if TCP packets can be segmented,
+ * @return 0 if all TCP packets must fit in NETWORK_MAXIMUM_PACKET_SIZE bytes.
+ */
+int NetworkBaseTCPIsSegmentationAvailable(void);
+
+/** Compute how many bytes of the data to send the next TCP packet can carry without overflowing the recipient window.
+ * @param Remaining_Bytes_Count How many bytes are left to send.
+ * @param Window_Size How many bytes the recipient can receive.
+ * @return The payload size in bytes, a window smaller than NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE still allows a single segment to be sent so the transfer can't be stuck.
+ */
+unsigned int NetworkBaseTCPComputePayloadSize(unsigned int Remaining_Bytes_Count, unsigned int Window_Size);
+
+/** Send a TCP packet with a big payload, the ethernet controller splits it into NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE frames.
+ * @param Pointer_Socket The connected socket used to transmit the packet.
+ * @param Payload_Size The TCP payload size in bytes (the TCP header is not included).
+ * @param Pointer_Packet_Buffer The buffer containing the TCP header yet initialized (with a zero checksum field), at the same offset than for NetworkBaseIPSendPacket().
+ * @param Pointer_Payload The TCP payload, it is not copied to the packet buffer.
+ * @return 0 if the packet was successfully transmitted,
+ * @return 1 if the packet was not sent because the controller can't segment packets or because the payload was too big.
+ * @note The TCP checksum is computed by this function.
+ */
+int NetworkBaseTCPSendSegmentedPacket(TNetworkSocket *Pointer_Socket, unsigned int Payload_Size, void *Pointer_Packet_Buffer, void *Pointer_Payload);
+
 /** Wait NETWORK_BASE_TCP_RECEPTION_TIMEOUT_MILLISECONDS milliseconds for a TCP packet to be received.
  * @param Pointer_Socket The socket used to transmit and receive data (the socket is not required to be connected).
  * @param Flags_To_Check If different from 0, the received TCP packet header flags must fit exactly the provided flags. If equal to 0, all flags configuration are accepted.
  * @param Pointer_Packet_Size On output, contain received packet full size in bytes (including lower layers).
  * @param Pointer_Packet_Buffer On output, contain the packet data (with lower layers too).
+ * @note The socket recipient window size is updated with the received packet one.
  * @return 0 if a packet was successfully received,
  * @return 1 if a reception error occurred,
  * @return 2 if the reception timed out.
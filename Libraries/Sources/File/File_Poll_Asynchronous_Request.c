@@ -0,0 +1,14 @@
+/** @file File_Poll_Asynchronous_Request.c
+ * @author Adrien RICCIARDI
+ */
+#include <Libraries.h>
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int LibrariesFilePollAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count)
+{
+	*Pointer_Processed_Bytes_Count = 0; // Force to 0 to return 0 in case of error
+	
+	return LibrariesSystemCall(SYSTEM_CALL_FILE_POLL_ASYNCHRONOUS_REQUEST, Request_ID, 0, Pointer_Processed_Bytes_Count, NULL);
+}
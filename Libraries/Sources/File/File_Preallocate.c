@@ -0,0 +1,12 @@
+/** @file File_Preallocate.c
+ * @author Adrien RICCIARDI
+ */
+#include <Libraries.h>
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int LibrariesFilePreallocate(unsigned int File_ID, unsigned int Bytes_Count)
+{
+	return LibrariesSystemCall(SYSTEM_CALL_FILE_PREALLOCATE, File_ID, Bytes_Count, NULL, NULL);
+}
@@ -0,0 +1,12 @@
+/** @file File_Submit_Asynchronous_Request.c
+ * @author Adrien RICCIARDI
+ */
+#include <Libraries.h>
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int LibrariesFileSubmitAsynchronousRequest(unsigned int File_ID, void *Pointer_Buffer, unsigned int Bytes_Count, unsigned int *Pointer_Request_ID)
+{
+	return LibrariesSystemCall(SYSTEM_CALL_FILE_SUBMIT_ASYNCHRONOUS_REQUEST, File_ID, Bytes_Count, Pointer_Buffer, Pointer_Request_ID);
+}
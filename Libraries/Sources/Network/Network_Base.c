@@ -84,6 +84,9 @@ static TNetworkBaseARPTableEntry Network_Base_ARP_Table_Entries[NETWORK_BASE_ARP
 /** The ARP table current size (how many entries are occupied). */
 static int Network_Base_ARP_Table_Used_Entries_Count;
 
+/** The work the ethernet controller can do instead of the processor (see SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_XXX). */
+static unsigned int Network_Base_Ethernet_Offload_Capabilities;
+
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
@@ -99,10 +102,21 @@ static inline void NetworkBaseEthernetReceivePacket(unsigned int *Pointer_Packet
 /** Send an ethernet frame.
  * @param Frame_Size The frame size in bytes.
  * @param Pointer_Buffer The frame content.
+ * @param Offload_Flags The checksums the ethernet controller must insert (see SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_XXX).
+ */
+static inline void NetworkBaseEthernetSendPacket(unsigned int Packet_Size, void *Pointer_Buffer, unsigned int Offload_Flags)
+{
+	LibrariesSystemCall(SYSTEM_CALL_ETHERNET_SEND_PACKET, Packet_Size, Offload_Flags, Pointer_Buffer, NULL);
+}
+
+/** Send a TCP packet the ethernet controller will split into several frames.
+ * @param Frame_Size The headers size plus the TCP payload size in bytes.
+ * @param Pointer_Headers_Buffer The ethernet, IPv4 and TCP headers.
+ * @param Pointer_Payload The TCP payload.
  */
-static inline void NetworkBaseEthernetSendPacket(unsigned int Packet_Size, void *Pointer_Buffer)
+static inline void NetworkBaseEthernetSendSegmentedTCPPacket(unsigned int Frame_Size, void *Pointer_Headers_Buffer, void *Pointer_Payload)
 {
-	LibrariesSystemCall(SYSTEM_CALL_ETHERNET_SEND_PACKET, Packet_Size, 0, Pointer_Buffer, NULL);
+	LibrariesSystemCall(SYSTEM_CALL_ETHERNET_SEND_PACKET, Frame_Size, SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP | SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_SIZE(NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE), Pointer_Headers_Buffer, Pointer_Payload);
 }
 
 /** Tell in a non-blocking way if a packet has been received or not.
@@ -157,7 +171,7 @@ static int NetworkBaseARPSendRequest(TNetworkIPAddress *Pointer_Known_IP_Address
 	// Send the request and try to get a reply
 	for (i = 0; i < 5; i++)
 	{
-		NetworkBaseEthernetSendPacket(sizeof(TNetworkEthernetHeader) + sizeof(TNetworkBaseARPPayload), Transmission_Packet);
+		NetworkBaseEthernetSendPacket(sizeof(TNetworkEthernetHeader) + sizeof(TNetworkBaseARPPayload), Transmission_Packet, 0);
 		
 		// Wait 3ms for a reply
 		Timeout_Value = LibrariesTimerGetValue() + 3;
@@ -222,7 +236,7 @@ static void NetworkBaseARPSendReply(void *Pointer_Packet_Buffer)
 	LibrariesMemoryCopyArea(Pointer_ARP_Payload->Target_Harware_Address, Pointer_Ethernet_Header->Destination_MAC_Address, NETWORK_MAC_ADDRESS_SIZE);
 	
 	// Send the reply
-	NetworkBaseEthernetSendPacket(sizeof(TNetworkEthernetHeader) + sizeof(TNetworkBaseARPPayload), Pointer_Packet_Buffer);
+	NetworkBaseEthernetSendPacket(sizeof(TNetworkEthernetHeader) + sizeof(TNetworkBaseARPPayload), Pointer_Packet_Buffer, 0);
 }
 
 /** Compute one's complement checksum.
@@ -288,6 +302,53 @@ static int NetworkBaseIPIsReceivedPacketValid(TNetworkSocket *Pointer_Socket, vo
 	return 1;
 }
 
+/** Fill the ethernet and IPv4 headers of a packet.
+ * @param Pointer_Socket The socket containing all useful connection parameters.
+ * @param Payload_Size The IP packet payload (starting from OSI layer 4) size in bytes.
+ * @param Pointer_Packet_Buffer The buffer starting with the ethernet header.
+ * @note The IPv4 header checksum is not computed.
+ */
+static void NetworkBaseIPFillHeaders(TNetworkSocket *Pointer_Socket, unsigned int Payload_Size, void *Pointer_Packet_Buffer)
+{
+	TNetworkEthernetHeader *Pointer_Ethernet_Header = (TNetworkEthernetHeader *) Pointer_Packet_Buffer;
+	TNetworkIPv4Header *Pointer_IP_Header = (TNetworkIPv4Header *) (Pointer_Packet_Buffer + sizeof(TNetworkEthernetHeader));
+	
+	// Fill the ethernet header
+	LibrariesMemoryCopyArea(Pointer_Socket->Destination_MAC_Address, Pointer_Ethernet_Header->Destination_MAC_Address, NETWORK_MAC_ADDRESS_SIZE); // Set the destination MAC address
+	Pointer_Ethernet_Header->Protocol_Type = NETWORK_BASE_ETHERNET_PROTOCOL_TYPE_IP; // Tell that the frame contains IP data
+	
+	// Fill the IPv4 header
+	Pointer_IP_Header->Version_And_Size = (4 << 4) | ((sizeof(TNetworkIPv4Header) / 4) & 0x0F); // IP version 4, fixed header size (header size will never change as options won't be used)
+	Pointer_IP_Header->Differentiated_Services_Code_Point_And_Explicit_Congestion_Notification = 0; // Not used
+	Pointer_IP_Header->Total_Length = NETWORK_SWAP_WORD(sizeof(TNetworkIPv4Header) + Payload_Size); // Header length + payload length
+	Pointer_IP_Header->Identification = 0; // Unused
+	Pointer_IP_Header->Flags_And_Fragment_Offset = 0; // Unused
+	Pointer_IP_Header->Time_To_Live = NETWORK_BASE_IP_DEFAULT_TIME_TO_LIVE_VALUE; // How much hops the packet can do before being dropped
+	Pointer_IP_Header->Protocol = (unsigned char) Pointer_Socket->IP_Protocol; // What does the payload contain
+	Pointer_IP_Header->Source_IP_Address = Network_Base_System_IP_Address.Address; // This system is the packet sender
+	Pointer_IP_Header->Destination_IP_Address = Pointer_Socket->Destination_IP_Address; // Who will receive this packet
+	Pointer_IP_Header->Header_Checksum = 0; // Set the checksum field to zero as told by the RFC
+}
+
+/** Fill the TCP pseudo header located just before the TCP header.
+ * @param Pointer_Socket The TCP socket used to transmit the packet.
+ * @param Pointer_Data The TCP header followed by the TCP payload.
+ * @param Bytes_Count The TCP header size plus the TCP payload size in bytes.
+ * @return The pseudo header address.
+ */
+static TNetworkBaseTCPPseudoHeader *NetworkBaseTCPFillPseudoHeader(TNetworkSocket *Pointer_Socket, void *Pointer_Data, unsigned int Bytes_Count)
+{
+	TNetworkBaseTCPPseudoHeader *Pointer_TCP_Pseudo_Header = (TNetworkBaseTCPPseudoHeader *) (Pointer_Data - sizeof(TNetworkBaseTCPPseudoHeader));
+	
+	Pointer_TCP_Pseudo_Header->Source_Address = Network_Base_System_IP_Address.Address;
+	Pointer_TCP_Pseudo_Header->Destination_Address = Pointer_Socket->Destination_IP_Address;
+	Pointer_TCP_Pseudo_Header->Zero = 0;
+	Pointer_TCP_Pseudo_Header->Protocol = NETWORK_IP_PROTOCOL_TCP;
+	Pointer_TCP_Pseudo_Header->TCP_Header_And_Payload_Length = NETWORK_SWAP_WORD(Bytes_Count);
+	
+	return Pointer_TCP_Pseudo_Header;
+}
+
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
@@ -304,6 +365,9 @@ int NetworkBaseInitialize(TNetworkIPAddress *Pointer_System_IP_Address, TNetwork
 	// Set the network stack source MAC address
 	LibrariesSystemCall(SYSTEM_CALL_SYSTEM_GET_PARAMETER, SYSTEM_CALL_SYSTEM_PARAMETER_ID_ETHERNET_CONTROLLER_MAC_ADDRESS, 0, Network_Base_System_MAC_Address, NULL);
 	
+	// Find which checksums the ethernet controller can compute
+	if (LibrariesSystemCall(SYSTEM_CALL_SYSTEM_GET_PARAMETER, SYSTEM_CALL_SYSTEM_PARAMETER_ID_ETHERNET_CONTROLLER_OFFLOAD_CAPABILITIES, 0, &Network_Base_Ethernet_Offload_Capabilities, NULL) != 0) Network_Base_Ethernet_Offload_Capabilities = 0;
+	
 	// Set IP addresses
 	LibrariesMemoryCopyArea(Pointer_System_IP_Address, &Network_Base_System_IP_Address, sizeof(TNetworkIPAddress));
 	LibrariesMemoryCopyArea(Pointer_Gateway_IP_Address, &Network_Base_Gateway_IP_Address, sizeof(TNetworkIPAddress)); // Do not cache the gateway MAC address now because this equipment could be down at the network configuration time
@@ -401,49 +465,37 @@ int NetworkBaseIPReceivePacket(TNetworkSocket *Pointer_Socket, int Is_Call_Block
 
 int NetworkBaseIPSendPacket(TNetworkSocket *Pointer_Socket, unsigned int Payload_Size, void *Pointer_Packet_Buffer)
 {
-	TNetworkEthernetHeader *Pointer_Ethernet_Header = (TNetworkEthernetHeader *) Pointer_Packet_Buffer;
 	TNetworkIPv4Header *Pointer_IP_Header = (TNetworkIPv4Header *) (Pointer_Packet_Buffer + sizeof(TNetworkEthernetHeader));
-	unsigned int Total_Packet_Size;
+	unsigned int Total_Packet_Size, Offload_Flags = 0;
 	
 	// Discard the packet if it is too big
 	Total_Packet_Size = sizeof(TNetworkEthernetHeader) + sizeof(TNetworkIPv4Header) + Payload_Size;
 	if (Total_Packet_Size > NETWORK_MAXIMUM_PACKET_SIZE) return 1;
 	
-	// Fill the ethernet header
-	LibrariesMemoryCopyArea(Pointer_Socket->Destination_MAC_Address, Pointer_Ethernet_Header->Destination_MAC_Address, NETWORK_MAC_ADDRESS_SIZE); // Set the destination MAC address
-	Pointer_Ethernet_Header->Protocol_Type = NETWORK_BASE_ETHERNET_PROTOCOL_TYPE_IP; // Tell that the frame contains IP data
-	
-	// Fill the IPv4 header
-	Pointer_IP_Header->Version_And_Size = (4 << 4) | ((sizeof(TNetworkIPv4Header) / 4) & 0x0F); // IP version 4, fixed header size (header size will never change as options won't be used)
-	Pointer_IP_Header->Differentiated_Services_Code_Point_And_Explicit_Congestion_Notification = 0; // Not used
-	Pointer_IP_Header->Total_Length = NETWORK_SWAP_WORD(sizeof(TNetworkIPv4Header) + Payload_Size); // Header length + payload length
-	Pointer_IP_Header->Identification = 0; // Unused
-	Pointer_IP_Header->Flags_And_Fragment_Offset = 0; // Unused
-	Pointer_IP_Header->Time_To_Live = NETWORK_BASE_IP_DEFAULT_TIME_TO_LIVE_VALUE; // How much hops the packet can do before being dropped
-	Pointer_IP_Header->Protocol = (unsigned char) Pointer_Socket->IP_Protocol; // What does the payload contain
-	Pointer_IP_Header->Source_IP_Address = Network_Base_System_IP_Address.Address; // This system is the packet sender
-	Pointer_IP_Header->Destination_IP_Address = Pointer_Socket->Destination_IP_Address; // Who will receive this packet
+	NetworkBaseIPFillHeaders(Pointer_Socket, Payload_Size, Pointer_Packet_Buffer);
 	
 	// Compute the IP header checksum
-	Pointer_IP_Header->Header_Checksum = 0; // Set the checksum field to zero as told by the RFC
-	Pointer_IP_Header->Header_Checksum = NetworkBaseComputeChecksum(Pointer_IP_Header, sizeof(TNetworkIPv4Header)); // No need to swap result to big endian because input data were swapped yet, giving a good result
+	if (Network_Base_Ethernet_Offload_Capabilities & SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TRANSMIT_CHECKSUMS)
+	{
+		Offload_Flags = SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_INSERT_IP_CHECKSUM;
+		if (Pointer_IP_Header->Protocol == NETWORK_IP_PROTOCOL_TCP) Offload_Flags |= SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_INSERT_TRANSPORT_CHECKSUM; // NetworkBaseTCPComputeChecksum() did only the pseudo header sum
+	}
+	else Pointer_IP_Header->Header_Checksum = NetworkBaseComputeChecksum(Pointer_IP_Header, sizeof(TNetworkIPv4Header)); // No need to swap result to big endian because input data were swapped yet, giving a good result
 	
 	// Transmit the packet
-	NetworkBaseEthernetSendPacket(Total_Packet_Size, Pointer_Packet_Buffer);
+	NetworkBaseEthernetSendPacket(Total_Packet_Size, Pointer_Packet_Buffer, Offload_Flags);
 	
 	return 0;
 }
 
 unsigned short NetworkBaseTCPComputeChecksum(TNetworkSocket *Pointer_Socket, void *Pointer_Data, unsigned int Bytes_Count)
 {
-	TNetworkBaseTCPPseudoHeader *Pointer_TCP_Pseudo_Header = (TNetworkBaseTCPPseudoHeader *) (Pointer_Data - sizeof(TNetworkBaseTCPPseudoHeader));
+	TNetworkBaseTCPPseudoHeader *Pointer_TCP_Pseudo_Header;
 	
-	// Fill the pseudo header
-	Pointer_TCP_Pseudo_Header->Source_Address = Network_Base_System_IP_Address.Address;
-	Pointer_TCP_Pseudo_Header->Destination_Address = Pointer_Socket->Destination_IP_Address;
-	Pointer_TCP_Pseudo_Header->Zero = 0;
-	Pointer_TCP_Pseudo_Header->Protocol = NETWORK_IP_PROTOCOL_TCP;
-	Pointer_TCP_Pseudo_Header->TCP_Header_And_Payload_Length = NETWORK_SWAP_WORD(Bytes_Count);
+	Pointer_TCP_Pseudo_Header = NetworkBaseTCPFillPseudoHeader(Pointer_Socket, Pointer_Data, Bytes_Count);
+	
+	// The ethernet controller computes the checksum of the TCP header and payload when it sends the packet, it only needs the pseudo header sum (not complemented) in the checksum field
+	if (Network_Base_Ethernet_Offload_Capabilities & SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TRANSMIT_CHECKSUMS) return ~NetworkBaseComputeChecksum(Pointer_TCP_Pseudo_Header, sizeof(TNetworkBaseTCPPseudoHeader));
 	
 	return NetworkBaseComputeChecksum(Pointer_TCP_Pseudo_Header, sizeof(TNetworkBaseTCPPseudoHeader) + Bytes_Count);
 }
@@ -460,6 +512,43 @@ void NetworkBaseTCPPrepareHeader(TNetworkSocket *Pointer_Socket, unsigned short
 	Pointer_TCP_Header->Checksum = 0; // The checksum field must be zero prior to compute the checksum
 }
 
+int NetworkBaseTCPIsSegmentationAvailable(void)
+{
+	if (Network_Base_Ethernet_Offload_Capabilities & SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TCP_SEGMENTATION) return 1;
+	return 0;
+}
+
+unsigned int NetworkBaseTCPComputePayloadSize(unsigned int Remaining_Bytes_Count, unsigned int Window_Size)
+{
+	// Send all data if the recipient can receive them
+	if (Remaining_Bytes_Count <= Window_Size) return Remaining_Bytes_Count;
+	
+	// Fill the recipient window
+	if (Window_Size >= NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE) return Window_Size;
+	
+	// The window is too small for a full-size segment, send a single segment anyway
+	if (Remaining_Bytes_Count > NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE) return NETWORK_BASE_TCP_MAXIMUM_SEGMENT_SIZE;
+	return Remaining_Bytes_Count;
+}
+
+int NetworkBaseTCPSendSegmentedPacket(TNetworkSocket *Pointer_Socket, unsigned int Payload_Size, void *Pointer_Packet_Buffer, void *Pointer_Payload)
+{
+	TNetworkTCPHeader *Pointer_TCP_Header = (TNetworkTCPHeader *) (Pointer_Packet_Buffer + sizeof(TNetworkEthernetHeader) + sizeof(TNetworkIPv4Header));
+	TNetworkBaseTCPPseudoHeader *Pointer_TCP_Pseudo_Header;
+	
+	if (!NetworkBaseTCPIsSegmentationAvailable() || (Payload_Size > SYSTEM_CALL_ETHERNET_MAXIMUM_SEGMENTED_PAYLOAD_SIZE)) return 1;
+	
+	// The controller adds each frame TCP length to the pseudo header sum, so the length must be zero here (the pseudo header overwrites the IPv4 header, so compute it first)
+	Pointer_TCP_Pseudo_Header = NetworkBaseTCPFillPseudoHeader(Pointer_Socket, Pointer_TCP_Header, 0);
+	Pointer_TCP_Header->Checksum = ~NetworkBaseComputeChecksum(Pointer_TCP_Pseudo_Header, sizeof(TNetworkBaseTCPPseudoHeader));
+	
+	// The controller sets the IPv4 length of each frame and inserts its checksum
+	NetworkBaseIPFillHeaders(Pointer_Socket, sizeof(TNetworkTCPHeader) + Payload_Size, Pointer_Packet_Buffer);
+	
+	NetworkBaseEthernetSendSegmentedTCPPacket(sizeof(TNetworkEthernetHeader) + sizeof(TNetworkIPv4Header) + sizeof(TNetworkTCPHeader) + Payload_Size, Pointer_Packet_Buffer, Pointer_Payload);
+	return 0;
+}
+
 int NetworkBaseTCPReceivePacket(TNetworkSocket *Pointer_Socket, unsigned short Flags_To_Check, unsigned int *Pointer_Packet_Size, void *Pointer_Packet_Buffer)
 {
 	unsigned int Timeout_Milliseconds;
@@ -489,6 +578,9 @@ int NetworkBaseTCPReceivePacket(TNetworkSocket *Pointer_Socket, unsigned short F
 				if (((Pointer_TCP_Header->Header_Size_And_Flags & NETWORK_SWAP_WORD(0x01FF)) & Flags_To_Check) != Flags_To_Check) continue;
 			}
 			
+			// Remember how many bytes the recipient can receive
+			Pointer_Socket->TCP_Destination_Window_Size = NETWORK_SWAP_WORD(Pointer_TCP_Header->Window_Size);
+			
 			return 0;
 		}
 	}
@@ -9,36 +9,62 @@
 //-------------------------------------------------------------------------------------------------
 int NetworkTCPSendBuffer(TNetworkSocket *Pointer_Socket, unsigned int Buffer_Size, void *Pointer_Buffer)
 {
-	unsigned char Packet_Buffer[NETWORK_MAXIMUM_PACKET_SIZE];
+	unsigned char Packet_Buffer[NETWORK_MAXIMUM_PACKET_SIZE], *Pointer_Buffer_Bytes = Pointer_Buffer;
 	TNetworkTCPHeader *Pointer_TCP_Header = (TNetworkTCPHeader *) (Packet_Buffer + sizeof(TNetworkEthernetHeader) + sizeof(TNetworkIPv4Header));
-	unsigned int TCP_Packet_Size;
+	unsigned int TCP_Packet_Size, Maximum_Single_Packet_Payload_Size, Payload_Size, Expected_Acknowledgement_Number, Acknowledgement_Number;
 	int Result;
 	
-	// Make sure the buffer content can be sent in a single packet
-	if (Buffer_Size > NETWORK_MAXIMUM_PACKET_SIZE - sizeof(TNetworkEthernetHeader) - sizeof(TNetworkIPv4Header) - sizeof(TNetworkTCPHeader)) return 2;
+	// Make sure the buffer content can be sent in a single packet, or in a single segmented packet if the ethernet controller can split it
+	Maximum_Single_Packet_Payload_Size = NETWORK_MAXIMUM_PACKET_SIZE - sizeof(TNetworkEthernetHeader) - sizeof(TNetworkIPv4Header) - sizeof(TNetworkTCPHeader);
+	if (NetworkBaseTCPIsSegmentationAvailable())
+	{
+		if (Buffer_Size > SYSTEM_CALL_ETHERNET_MAXIMUM_SEGMENTED_PAYLOAD_SIZE) return 2;
+	}
+	else if (Buffer_Size > Maximum_Single_Packet_Payload_Size) return 2;
 	
 	// Make sure the connection is established
 	if (!Pointer_Socket->Is_TCP_Connection_Established) return 3;
 	
-	// Fill the TCP header
-	NetworkBaseTCPPrepareHeader(Pointer_Socket, NETWORK_TCP_FLAG_ACK | NETWORK_TCP_FLAG_PUSH, Pointer_TCP_Header); // Set the PUSH flag to force the recipient to flush its buffer and to send an ACK
-	Pointer_TCP_Header->Sequence_Number = NETWORK_SWAP_DOUBLE_WORD(Pointer_Socket->TCP_Sequence_Number);
-	Pointer_TCP_Header->Acknowledgment_Number = NETWORK_SWAP_DOUBLE_WORD(Pointer_Socket->TCP_Acknowledgement_Number);
-	// Append TCP data
-	LibrariesMemoryCopyArea(Pointer_Buffer, Packet_Buffer + sizeof(TNetworkEthernetHeader) + sizeof(TNetworkIPv4Header) + sizeof(TNetworkTCPHeader), Buffer_Size);
-	// Compute the TCP checksum now that the TCP packet is complete
-	TCP_Packet_Size = sizeof(TNetworkTCPHeader) + Buffer_Size;
-	Pointer_TCP_Header->Checksum = NetworkBaseTCPComputeChecksum(Pointer_Socket, Pointer_TCP_Header, TCP_Packet_Size);
-	
-	// Send the packet
-	if (NetworkBaseIPSendPacket(Pointer_Socket, TCP_Packet_Size, Packet_Buffer) != 0) return 1;
-	
-	// Wait for the acknowledge
-	Result = NetworkBaseTCPReceivePacket(Pointer_Socket, NETWORK_TCP_FLAG_ACK, &TCP_Packet_Size, Packet_Buffer);
-	if (Result != 0) return Result;
-	
-	// Update sequence number with the received acknowledgement number
-	Pointer_Socket->TCP_Sequence_Number = NETWORK_SWAP_DOUBLE_WORD(Pointer_TCP_Header->Acknowledgment_Number);
+	// Send at least one packet, even if the buffer is empty
+	do
+	{
+		// Do not send more data than the recipient can receive
+		Payload_Size = NetworkBaseTCPComputePayloadSize(Buffer_Size, Pointer_Socket->TCP_Destination_Window_Size);
+		
+		// Fill the TCP header
+		NetworkBaseTCPPrepareHeader(Pointer_Socket, NETWORK_TCP_FLAG_ACK | NETWORK_TCP_FLAG_PUSH, Pointer_TCP_Header); // Set the PUSH flag to force the recipient to flush its buffer and to send an ACK
+		Pointer_TCP_Header->Sequence_Number = NETWORK_SWAP_DOUBLE_WORD(Pointer_Socket->TCP_Sequence_Number);
+		Pointer_TCP_Header->Acknowledgment_Number = NETWORK_SWAP_DOUBLE_WORD(Pointer_Socket->TCP_Acknowledgement_Number);
+		
+		if (Payload_Size <= Maximum_Single_Packet_Payload_Size)
+		{
+			// Append TCP data
+			LibrariesMemoryCopyArea(Pointer_Buffer_Bytes, Packet_Buffer + sizeof(TNetworkEthernetHeader) + sizeof(TNetworkIPv4Header) + sizeof(TNetworkTCPHeader), Payload_Size);
+			// Compute the TCP checksum now that the TCP packet is complete
+			TCP_Packet_Size = sizeof(TNetworkTCPHeader) + Payload_Size;
+			Pointer_TCP_Header->Checksum = NetworkBaseTCPComputeChecksum(Pointer_Socket, Pointer_TCP_Header, TCP_Packet_Size);
+			
+			// Send the packet
+			if (NetworkBaseIPSendPacket(Pointer_Socket, TCP_Packet_Size, Packet_Buffer) != 0) return 1;
+		}
+		// Let the ethernet controller split the data into several frames, the data are directly read from the provided buffer
+		else if (NetworkBaseTCPSendSegmentedPacket(Pointer_Socket, Payload_Size, Packet_Buffer, Pointer_Buffer_Bytes) != 0) return 1;
+		
+		// Wait for all sent data to be acknowledged (a segmented packet can be acknowledged by several packets)
+		Expected_Acknowledgement_Number = Pointer_Socket->TCP_Sequence_Number + Payload_Size;
+		do
+		{
+			Result = NetworkBaseTCPReceivePacket(Pointer_Socket, NETWORK_TCP_FLAG_ACK, &TCP_Packet_Size, Packet_Buffer);
+			if (Result != 0) return Result;
+			Acknowledgement_Number = NETWORK_SWAP_DOUBLE_WORD(Pointer_TCP_Header->Acknowledgment_Number);
+		} while ((int) (Expected_Acknowledgement_Number - Acknowledgement_Number) > 0); // The subtraction result is negative if the acknowledgement number wrapped around
+		
+		// Update sequence number with the received acknowledgement number
+		Pointer_Socket->TCP_Sequence_Number = Acknowledgement_Number;
+		
+		Pointer_Buffer_Bytes += Payload_Size;
+		Buffer_Size -= Payload_Size;
+	} while (Buffer_Size > 0);
 	
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+/** @file System_Get_Hard_Disk_Statistics.c
+ * @author Adrien RICCIARDI
+ */
+#include <Libraries.h>
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void LibrariesSystemGetHardDiskStatistics(TSystemCallHardDiskStatistics *Pointer_Statistics)
+{
+	LibrariesSystemCall(SYSTEM_CALL_SYSTEM_GET_PARAMETER, SYSTEM_CALL_SYSTEM_PARAMETER_ID_HARD_DISK_STATISTICS, 0, Pointer_Statistics, NULL);
+}
@@ -14,6 +14,9 @@
 /** Enable the interrupts. */
 #define ARCHITECTURE_INTERRUPTS_ENABLE() asm("sti")
 
+/** Atomically enable the interrupts and halt the processor until the next interrupt, then disable the interrupts again. "sti" enables the interrupts only after the next instruction, so no interrupt can be lost between a condition check made with the interrupts disabled and the halt. */
+#define ARCHITECTURE_INTERRUPTS_WAIT() asm("sti\n" "hlt\n" "cli")
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
@@ -26,4 +29,31 @@ void ArchitectureSwitchToUserSpace(void);
 /** Add delay needed by some low speed hardware. */
 void ArchitectureIODelay(void);
 
+/** Tell whether the processor interrupts are enabled.
+ * @return 1 if the interrupts are enabled,
+ * @return 0 if the interrupts are disabled.
+ */
+int ArchitectureAreInterruptsEnabled(void);
+
+/** Find the biggest usable RAM area located above a given address, according to the memory map provided by the BIOS at boot time.
+ * @param Minimum_Address The area can't start before this address.
+ * @param Pointer_Area_Size On output, contain the area size in bytes.
+ * @return The area start address,
+ * @return 0 if the BIOS did not provide a memory map or if there is no usable RAM above the address (the area size is set to 0 too).
+ * @note Only the 32-bit address space is considered.
+ */
+unsigned int ArchitectureFindBiggestFreeMemoryArea(unsigned int Minimum_Address, unsigned int *Pointer_Area_Size);
+
+/** Route an hardware interrupt line to the hard disk interrupt handler.
+ * @param Interrupt_Line The PIC interrupt line (0 to 15) the hard disk controller is wired to.
+ * @note This function is only available when the hard disk driver uses interrupts.
+ */
+void ArchitectureInstallHardDiskInterruptHandler(unsigned int Interrupt_Line);
+
+/** Route an hardware interrupt line to the ethernet controller interrupt handler. The hard disk handler is called too if the hard disk controller shares the same line.
+ * @param Interrupt_Line The PIC interrupt line (0 to 15) the ethernet controller is wired to.
+ * @note This function is only available when the ethernet controller driver uses interrupts. Call it after the hard disk driver has been initialized.
+ */
+void ArchitectureInstallEthernetInterruptHandler(unsigned int Interrupt_Line);
+
 #endif
\ No newline at end of file
@@ -9,12 +9,18 @@
 // Constants
 //-------------------------------------------------------------------------------------------------
 // File system
-/** The size of a file system block in bytes (must be a multiple of 512). */
-#define CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES 4096
-/** The file system is stored just behind the kernel on the hard disk. This value is in LBA addressing mode. */
-#define CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET 129 // 1 sector for the MBR + 128 sectors (= 64 KB) for the kernel
+/** The MBR stores the kernel size in sectors as a 16-bit value at this offset, right before the partition table. Keep in sync with MBR.asm. */
+#define CONFIGURATION_FILE_SYSTEM_MBR_KERNEL_SECTORS_COUNT_OFFSET 444
+/** The file system is stored just behind the kernel on the hard disk. This value is in LBA addressing mode.
+ * @param Kernel_Sectors_Count The kernel size in sectors, as recorded in the MBR.
+ */
+#define CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET(Kernel_Sectors_Count) (1 + (Kernel_Sectors_Count)) // 1 sector for the MBR + the kernel sectors
 /** The system can't open more files than specified here simultaneously. */
 #define CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT 8
+/** How many asynchronous file requests can be submitted and not yet collected simultaneously. */
+#define CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT 8
+/** How many disk transfers the file system can queue before they are sorted and given to the hard disk driver. */
+#define CONFIGURATION_FILE_SYSTEM_BLOCK_QUEUE_MAXIMUM_REQUESTS_COUNT 64
 /** Maximum length of a file name in characters. */
 #define CONFIGURATION_FILE_NAME_LENGTH 12
 /** Name of the program that is automatically started on system boot. */
@@ -25,6 +31,10 @@
 #define CONFIGURATION_SYSTEM_MBR_LOAD_ADDRESS 0x7C00
 /** Kernel stack address. */
 #define CONFIGURATION_KERNEL_STACK_ADDRESS 0x10000
+/** The MBR stores the BIOS physical memory map here (a 16-bit entries count followed by the entries). Keep in sync with MBR.asm. */
+#define CONFIGURATION_SYSTEM_MEMORY_MAP_ADDRESS 0x500
+/** The maximum amount of memory map entries the MBR can store. Keep in sync with MBR.asm. */
+#define CONFIGURATION_SYSTEM_MEMORY_MAP_MAXIMUM_ENTRIES_COUNT 32
 
 // User space definitions
 /** User space base address. This reserves the first MB of RAM for the kernel. */
@@ -5,6 +5,8 @@
 #ifndef H_DRIVER_ETHERNET_H
 #define H_DRIVER_ETHERNET_H
 
+#include <System_Calls.h>
+
 //-------------------------------------------------------------------------------------------------
 // Constants
 //-------------------------------------------------------------------------------------------------
@@ -36,10 +38,22 @@ void EthernetReceivePacket(unsigned int *Pointer_Buffer_Size, void *Pointer_Buff
 /** Send an ethernet frame. Destination MAC address and layer 3 data type must be set.
  * @param Buffer_Size The ethernet frame size in bytes.
  * @param Pointer_Buffer The ethernet frame content.
+ * @param Offload_Flags The checksums the controller must insert (see SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_XXX). The flags are ignored if the frame does not contain an IPv4 packet.
  * @note There is no need to set the source MAC address, the driver will automatically set it.
+ * @note The frame is copied to a driver buffer, so the function may return before the frame is transmitted and the buffer can be immediately reused.
  * @warning Only CONFIGURATION_ETHERNET_BUFFER_SIZE bytes will be sent if the packet is too large.
  */
-void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer);
+void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer, unsigned int Offload_Flags);
+
+/** Send a big TCP payload that the controller splits into several ethernet frames, all headers being replicated and updated in each frame.
+ * @param Frame_Size The headers size plus the TCP payload size in bytes.
+ * @param Pointer_Headers The ethernet, IPv4 and TCP headers. Destination MAC address and IPv4 and TCP fields must be set, the TCP checksum field must contain the pseudo header sum computed with a zero TCP length.
+ * @param Pointer_Payload The TCP payload, up to SYSTEM_CALL_ETHERNET_MAXIMUM_SEGMENTED_PAYLOAD_SIZE bytes.
+ * @param Maximum_Segment_Size The maximum TCP payload size of each frame.
+ * @note Like EthernetSendPacket(), the source MAC address is set by the driver and the data are copied so the buffers can be immediately reused.
+ * @warning The packet is dropped if it is not a TCP over IPv4 one, if its payload is empty or too big, or if the controller can't segment packets (see EthernetGetOffloadCapabilities()).
+ */
+void EthernetSendSegmentedTCPPacket(unsigned int Frame_Size, void *Pointer_Headers, void *Pointer_Payload, unsigned int Maximum_Segment_Size);
 
 /** Tell whether a packet is available or not.
  * @return 1 if a packet has been received,
@@ -47,4 +61,14 @@ void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer);
  */
 int EthernetIsPacketReceived(void);
 
+/** Tell which work the controller can do instead of the processor.
+ * @return A bit field of SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_XXX flags.
+ */
+unsigned int EthernetGetOffloadCapabilities(void);
+
+/** Called by the controller interrupt to queue the received packets.
+ * @note Only the drivers able to use interrupts implement this function.
+ */
+void EthernetInterruptHandler(void);
+
 #endif
\ No newline at end of file
@@ -11,12 +11,26 @@
 /** A standard hard disk sector size in bytes. */
 #define HARD_DISK_SECTOR_SIZE 512
 
+/** The maximum requests count the block queue gives to HardDiskExecuteRequests() at once, it matches the biggest Native Command Queuing queue depth. */
+#define HARD_DISK_MAXIMUM_REQUESTS_COUNT 32
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** A consecutive sectors transfer. */
+typedef struct
+{
+	unsigned int Logical_Sector_Number; //!< The first LBA sector to access.
+	unsigned int Sectors_Count; //!< How many sectors to access.
+	void *Pointer_Buffer; //!< The data to write or the read data.
+} THardDiskRequest;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
 /** Probe the hard disk to determine the LBA addressing to use.
  * @return 0 if the LBA addressing was successfully found,
- * @return 1 if the disk does not support LBA addressing,
+ * @return 1 if the disk does not support LBA addressing or the configured LBA mode,
  * @return 2 if the SATA disk was not found.
  */
 int HardDiskInitialize(void);
@@ -33,6 +47,55 @@ void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer
  */
 void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer);
 
+/** Read consecutive logical sectors using as few commands as the drive allows.
+ * @param Logical_Sector_Number The first LBA sector to read.
+ * @param Sectors_Count How many sectors to read.
+ * @param Pointer_Buffer A pointer on a buffer big enough to store all sectors.
+ */
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer);
+
+/** Write consecutive logical sectors using as few commands as the drive allows.
+ * @param Logical_Sector_Number The first LBA sector to write.
+ * @param Sectors_Count How many sectors to write.
+ * @param Pointer_Buffer A pointer on a buffer containing all sectors data.
+ */
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer);
+
+/** Execute several independent transfers of the same kind. The drive can reorder them to reduce the seek time when it supports command queuing, otherwise they are executed one after the other.
+ * @param Is_Write_Operation Set to 1 to write the requests data, set to 0 to read it.
+ * @param Pointer_Requests The requests to execute.
+ * @param Requests_Count How many requests to execute.
+ * @note The function returns when all requests are completed.
+ */
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count);
+
+/** Called by the controller interrupt to record the completed commands.
+ * @note Only the drivers able to use interrupts implement this function.
+ */
+void HardDiskInterruptHandler(void);
+
+/** Wait until all the data stored in the drive volatile write cache is written to the media. Nothing is done if the write cache is disabled. */
+void HardDiskFlushCache(void);
+
+/** Enable or disable the drive volatile write cache.
+ * @param Is_Enabled Set to 1 to enable the write cache, set to 0 to disable it.
+ * @return 0 if the write cache was configured,
+ * @return 1 if the drive has no write cache or can't change its state.
+ */
+int HardDiskSetWriteCacheEnabled(int Is_Enabled);
+
+/** Tell whether the drive acknowledges the writes before storing them on the media.
+ * @return 1 if the write cache is enabled, 0 if it is disabled or if the drive has no write cache.
+ */
+int HardDiskIsWriteCacheEnabled(void);
+
+/** Get the address of a sector when the storage is memory-mapped, so the data can be accessed in place without being copied.
+ * @param Logical_Sector_Number The LBA sector to access.
+ * @return A pointer on the sector data, the following sectors are stored right after it,
+ * @return NULL if the storage can't be directly accessed.
+ */
+void *HardDiskMapSector(unsigned int Logical_Sector_Number);
+
 /** Get the total size of the hard disk 0 in sectors.
  * @return The hard disk size in sectors.
  */
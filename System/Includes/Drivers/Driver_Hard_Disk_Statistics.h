@@ -0,0 +1,56 @@
+/** @file Driver_Hard_Disk_Statistics.h
+ * Count the commands executed by the hard disk driver and measure their latency with the processor timestamp counter.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_DRIVER_HARD_DISK_STATISTICS_H
+#define H_DRIVER_HARD_DISK_STATISTICS_H
+
+#include <System_Calls.h>
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** Set by HardDiskStatisticsInitialize() if the processor has a timestamp counter. */
+extern int Hard_Disk_Statistics_Is_Timestamp_Counter_Available;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Read the processor timestamp counter, which is incremented on each clock cycle.
+ * @return The current counter value,
+ * @return 0 if the processor has no timestamp counter, so all commands fall in the shortest latency bucket.
+ */
+static inline __attribute__((always_inline)) unsigned long long HardDiskStatisticsGetTimestamp(void)
+{
+	unsigned long long Timestamp;
+	
+	// The "rdtsc" instruction does not exist on the processors older than the Pentium
+	if (!Hard_Disk_Statistics_Is_Timestamp_Counter_Available) return 0;
+	
+	asm volatile ("rdtsc" : "=A" (Timestamp));
+	return Timestamp;
+}
+
+/** Find whether the processor has a timestamp counter and measure its frequency. Call this function once the timer is running, before the hard disk driver is initialized. It lasts a few milliseconds. */
+void HardDiskStatisticsInitialize(void);
+
+/** Account a completed read or write command.
+ * @param Is_Write_Operation Set to 1 if the command wrote sectors, set to 0 if it read them.
+ * @param Sectors_Count How many sectors the command transferred.
+ * @param Start_Timestamp The timestamp counter value read with HardDiskStatisticsGetTimestamp() when the command was sent to the drive.
+ * @param Is_Error Set to 1 if the drive reported an error, set to 0 if the command succeeded.
+ */
+void HardDiskStatisticsRecordTransfer(int Is_Write_Operation, unsigned int Sectors_Count, unsigned long long Start_Timestamp, int Is_Error);
+
+/** Account a completed write cache flush command.
+ * @param Start_Timestamp The timestamp counter value read with HardDiskStatisticsGetTimestamp() when the command was sent to the drive.
+ * @param Is_Error Set to 1 if the drive reported an error, set to 0 if the command succeeded.
+ */
+void HardDiskStatisticsRecordFlush(unsigned long long Start_Timestamp, int Is_Error);
+
+/** Retrieve all statistics since the system started.
+ * @param Pointer_Statistics On output, contain the statistics.
+ */
+void HardDiskStatisticsGet(TSystemCallHardDiskStatistics *Pointer_Statistics);
+
+#endif
@@ -12,16 +12,22 @@
 #define PCI_VENDOR_ID_INTEL 0x8086
 /** Realtek vendor ID. */
 #define PCI_VENDOR_ID_REALTEK 0x10EC
+/** Red Hat (virtio devices) vendor ID. */
+#define PCI_VENDOR_ID_VIRTIO 0x1AF4
 
 /** Mass storage class base code. */
 #define PCI_CLASS_CODE_BASE_MASS_STORAGE 0x01
 /** Network controller class base code. */
 #define PCI_CLASS_CODE_BASE_NETWORK_CONTROLLER 0x02
 
+/** IDE controller sub-class code. */
+#define PCI_CLASS_CODE_SUB_CLASS_IDE 0x01
 /** Ethernet controller sub-class code. */
 #define PCI_CLASS_CODE_SUB_CLASS_ETHERNET 0x00
 /** SATA controller sub-class code. */
 #define PCI_CLASS_CODE_SUB_CLASS_SATA 0x06
+/** Non-Volatile Memory controller (i.e. NVMe) sub-class code. */
+#define PCI_CLASS_CODE_SUB_CLASS_NON_VOLATILE_MEMORY 0x08
 
 /** Extract from a Base Address Register the physical address part.
  * @param Base_Address_Register_Value The base address register value read from the PCI configuration space.
@@ -99,6 +105,11 @@ int PCIFindDeviceFromClass(unsigned char Class_Code_Base, unsigned char Class_Co
  */
 int PCIGetConfigurationSpaceHeader(TPCIDeviceID *Pointer_Device_ID, TPCIConfigurationSpaceHeader *Pointer_Configuration_Space_Header);
 
+/** Allow a device to initiate DMA transfers on the bus.
+ * @param Pointer_Device_ID The device to configure.
+ */
+void PCIEnableBusMastering(TPCIDeviceID *Pointer_Device_ID);
+
 /** Display all system PCI devices on screen.
  * @note This function is available only in debug mode.
  */
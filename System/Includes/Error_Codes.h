@@ -26,7 +26,11 @@ typedef enum
 	ERROR_CODE_BAD_UART_PARAMETERS, //!< Bad parameters were provided to UART during initialization.
 	ERROR_CODE_FILE_LARGER_THAN_RAM, //!< There is not enough room in RAM to load the file.
 	ERROR_CODE_FILE_NOT_EXECUTABLE, //!< The file is not an executable program.
-	ERROR_CODE_FILE_READING_FAILED //!< Failed to read a file content from the disk.
+	ERROR_CODE_FILE_READING_FAILED, //!< Failed to read a file content from the disk.
+	ERROR_CODE_ASYNCHRONOUS_REQUEST_PENDING, //!< The asynchronous file request is not completed yet.
+	ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST, //!< The asynchronous file request identifier does not match a submitted request.
+	ERROR_CODE_CANT_SUBMIT_MORE_ASYNCHRONOUS_REQUESTS, //!< The maximum asynchronous file requests count is reached.
+	ERROR_CODE_FILE_NOT_EMPTY //!< The operation can be done only on an empty file.
 } TErrorCode;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,23 @@
+/** @file Block_Queue.h
+ * Gather the file system disk transfers, merge the adjacent ones and give them to the hard disk driver in elevator order.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_BLOCK_QUEUE_H
+#define H_BLOCK_QUEUE_H
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Queue a consecutive sectors transfer. The request is merged with a queued one when they are contiguous both on the disk and in memory.
+ * @param Is_Write_Operation Set to 1 to write the buffer data to the disk, set to 0 to read the disk to the buffer.
+ * @param Logical_Sector_Number The first LBA sector to access.
+ * @param Sectors_Count How many sectors to access.
+ * @param Pointer_Buffer The data to write or the read data. The buffer must stay valid until BlockQueueFlush() returns.
+ * @note Queuing a request of the other kind or queuing a request when the queue is full dispatches the queued requests first, so a read always returns the previously written data.
+ */
+void BlockQueueAddRequest(int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer);
+
+/** Give all queued requests to the hard disk driver, sorted by increasing sector number starting from the current head position, and wait for their completion. */
+void BlockQueueFlush(void);
+
+#endif
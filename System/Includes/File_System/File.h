@@ -51,7 +51,7 @@ int FileDelete(char *String_File_Name);
  */
 unsigned int FileSize(char *String_File_Name);
 
-/** Reset all files (without closing them) to prevent a user program from opening all files and never closing them, resulting in an unusable file system. */
+/** Reset all files (without closing them) to prevent a user program from opening all files and never closing them, resulting in an unusable file system. All asynchronous requests are canceled too, and the preallocated blocks that were not written are released. */
 void FileResetFileDescriptors(void);
 
 /** Open a file.
@@ -93,9 +93,53 @@ int FileRead(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned
  */
 int FileWrite(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count);
 
-/** Close a file. 
+/** Close a file. The file pending asynchronous requests are completed first, then all the file asynchronous requests are released.
  * @param File_Descriptor_Index Index of the opened file (do nothing if the file was not opened).
  */
 void FileClose(unsigned int File_Descriptor_Index);
 
+/** Reserve the blocks needed to store a file whose size is known in advance, so the write can't fail halfway through because the file system is full. The blocks are contiguous if the free space allows it, preallocated blocks not used when the file is closed are released.
+ * @param File_Descriptor_Index The file descriptor identifying the file.
+ * @param Bytes_Count How many bytes will be written to the file.
+ * @return ERROR_CODE_NO_ERROR if the blocks were reserved,
+ * @return ERROR_CODE_BAD_FILE_DESCRIPTOR if the supplied file descriptor exceeds the maximum number of files that the kernel can open at the same time,
+ * @return ERROR_CODE_FILE_NOT_OPENED if the file is not opened,
+ * @return ERROR_CODE_BAD_OPENING_MODE if the file is not opened in write mode,
+ * @return ERROR_CODE_FILE_NOT_EMPTY if data were written to the file yet,
+ * @return ERROR_CODE_BLOCKS_LIST_FULL if there are not enough free blocks, nothing is reserved in this case.
+ */
+int FilePreallocate(unsigned int File_Descriptor_Index, unsigned int Bytes_Count);
+
+/** Queue a read (if the file is opened in read mode) or a write (if the file is opened in write mode) that is processed a block at a time by the following FileSubmitAsynchronousRequest() and FilePollAsynchronousRequest() calls, so the program can do other work between the calls. Requests are processed in submission order, and FileRead(), FileWrite() or FileClose() complete the file pending requests before doing their own work.
+ * @param File_Descriptor_Index The file descriptor identifying the file.
+ * @param Pointer_Buffer The buffer to read data to or to write data from. It must not be accessed by the program until the request is completed.
+ * @param Bytes_Count How many bytes to transfer.
+ * @param Pointer_Request_ID On output, contain the identifier to provide to FilePollAsynchronousRequest() or FileWaitAsynchronousRequest().
+ * @return ERROR_CODE_NO_ERROR if the request was queued,
+ * @return ERROR_CODE_BAD_FILE_DESCRIPTOR if the supplied file descriptor exceeds the maximum number of files that the kernel can open at the same time,
+ * @return ERROR_CODE_FILE_NOT_OPENED if the file is not opened,
+ * @return ERROR_CODE_CANT_SUBMIT_MORE_ASYNCHRONOUS_REQUESTS if all requests slots are used.
+ */
+int FileSubmitAsynchronousRequest(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count, unsigned int *Pointer_Request_ID);
+
+/** Process up to one block of the oldest pending asynchronous request, then tell whether an asynchronous request is completed. A completed request is released, so its status can be retrieved only once.
+ * @param Request_ID The request identifier.
+ * @param Pointer_Processed_Bytes_Count On output, contain how many bytes were transferred yet.
+ * @return ERROR_CODE_ASYNCHRONOUS_REQUEST_PENDING if the request is not completed,
+ * @return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST if the identifier does not match a submitted request,
+ * @return the FileRead() or FileWrite() error code if the request is completed.
+ */
+int FilePollAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count);
+
+/** Complete an asynchronous request (and all requests submitted before it) right now, then release it.
+ * @param Request_ID The request identifier.
+ * @param Pointer_Processed_Bytes_Count On output, contain how many bytes were transferred.
+ * @return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST if the identifier does not match a submitted request,
+ * @return the FileRead() or FileWrite() error code.
+ */
+int FileWaitAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count);
+
+/** Drop all asynchronous requests, used when the program that submitted them is terminated (its buffers are no more valid). */
+void FileCancelAsynchronousRequests(void);
+
 #endif
@@ -10,6 +10,14 @@
 //-------------------------------------------------------------------------------------------------
 // Constants
 //-------------------------------------------------------------------------------------------------
+/** Tell if a correct file system is stored on the disk or not. */
+#define FILE_SYSTEM_MAGIC_NUMBER 0x12345679 // Changed when the block size was added to the file system informations
+
+/** The smallest block size a file system can be created with. */
+#define FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES 1024
+/** The biggest block size a file system can be created with. */
+#define FILE_SYSTEM_MAXIMUM_BLOCK_SIZE_BYTES 65536
+
 /** Hard disk physical sector size in bytes. */
 #define FILE_SYSTEM_SECTOR_SIZE_BYTES 512
 
@@ -38,6 +46,7 @@ typedef struct __attribute__((packed))
 	unsigned int Total_Blocks_Count; //!< Total number of blocks in the Blocks List.
 	unsigned int Total_Files_Count; //!< Total number of files in the Files List (ie maximum number of files allowed).
 	unsigned int Free_Blocks_List_Head; //!< The list of empty blocks starts here.
+	unsigned int Block_Size_Bytes; //!< A storage block size, chosen when creating the file system.
 } TFileSystemInformations;
 
 /** The Files List is an array of this structure. */
@@ -102,6 +111,13 @@ unsigned int FileSystemGetFreeBlocksCount(void);
  */
 unsigned int FileSystemGetFreeFilesListEntriesCount(void);
 
+/** Get the address of a block data when the hard disk is memory-mapped (RAM disk), so the block can be read or written in place.
+ * @param Block The block to access.
+ * @return A pointer on the block data,
+ * @return NULL if the block must be transferred with FileSystemReadBlocks() and FileSystemWriteBlocks().
+ */
+unsigned char *FileSystemMapBlock(unsigned int Block);
+
 /** Read logically chained blocks from the hard disk.
  * @param Start_Block The block to start reading from.
  * @param Blocks_Count How many blocks to read.
@@ -117,6 +133,7 @@ unsigned int FileSystemReadBlocks(unsigned int Start_Block, unsigned int Blocks_
  * @return The last block written.
  * @warning This function does not check if the Blocks List is full or not, you must be sure that there are enough free blocks to write the data before calling this function.
  * @note This function automatically adds the EOF code to the last Blocks List written block.
+ * @note A block whose data is provided in place (see FileSystemMapBlock()) is not copied.
  */
 unsigned int FileSystemWriteBlocks(unsigned int Start_Block, unsigned int Blocks_Count, unsigned char *Pointer_Buffer);
 
@@ -140,34 +157,44 @@ TFilesListEntry *FileSystemReadFilesListEntry(char *String_File_Name);
  */
 unsigned int FileSystemAllocateBlock(void);
 
+/** Reserve several blocks at once, trying to find physically contiguous blocks to avoid file fragmentation. If no contiguous area is large enough, the blocks are taken from the free blocks list head.
+ * @param Blocks_Count How many blocks to allocate (must be greater than 0).
+ * @return The first block of the newly allocated blocks chain (the last block contains FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF),
+ * @return FILE_SYSTEM_BLOCKS_LIST_FULL_CODE if there are not enough free blocks, in this case no block is allocated.
+ */
+unsigned int FileSystemAllocateBlocks(unsigned int Blocks_Count);
+
 /** Create a new file system on the hard disk.
  * @param Blocks_Count Number of blocks on the new file system.
  * @param Files_Count Number of files on the new file system.
+ * @param Block_Size_Bytes A block size, it must be a power of two between FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES and CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES.
  * @param Starting_Sector The file system starting sector.
  * @return 0 if the new file system was successfully created,
  * @return 1 if Blocks_Count and/or Files_Count variables are incoherent values,
  * @return 2 if hard disk size is less than requested file system size.
  * @warning This function overwrites any previously created file system. When this function terminates, the new file system is in use.
  */
-int FileSystemCreate(unsigned int Blocks_Count, unsigned int Files_Count, unsigned int Starting_Sector);
+int FileSystemCreate(unsigned int Blocks_Count, unsigned int Files_Count, unsigned int Block_Size_Bytes, unsigned int Starting_Sector);
 
-/** Compute a file system whole size (file system structures plus storage data) in sectors.
+/** Compute a file system whole size (file system structures plus storage data) in sectors. The MBR and the kernel stored before the file system are not counted.
  * @param Blocks_Count How many entries in the Blocks List.
  * @param Files_Count How many entries in the Files List.
+ * @param Block_Size_Bytes A block size in bytes.
  * @return The total file system size in sectors.
  */
-static inline unsigned int FileSystemComputeSizeSectors(unsigned int Blocks_Count, unsigned int Files_Count)
+static inline unsigned int FileSystemComputeSizeSectors(unsigned int Blocks_Count, unsigned int Files_Count, unsigned int Block_Size_Bytes)
 {
 	unsigned int Size;
 	
 	// Compute the size in bytes
-	Size = sizeof(TFileSystemInformations) + (Blocks_Count * sizeof(unsigned int)) + (Files_Count * sizeof(TFilesListEntry)) + (Blocks_Count * CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES) + (CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET * FILE_SYSTEM_SECTOR_SIZE_BYTES); // Size of the file system + size of data area + (size of MBR + size of kernel)
+	Size = sizeof(TFileSystemInformations) + (Blocks_Count * sizeof(unsigned int)) + (Files_Count * sizeof(TFilesListEntry));
 	// Add one more sector if the file system size is not a multiple of the sector size
 	if (Size % FILE_SYSTEM_SECTOR_SIZE_BYTES != 0) Size += FILE_SYSTEM_SECTOR_SIZE_BYTES;
 	// Convert size to sectors
 	Size /= FILE_SYSTEM_SECTOR_SIZE_BYTES;
 	
-	return Size;
+	// Add the data area size (directly in sectors, because big blocks could overflow the bytes count)
+	return Size + (Blocks_Count * (Block_Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES));
 }
 
 #endif
\ No newline at end of file
@@ -33,6 +33,8 @@
 	#define STRING_KERNEL_ERROR_UNKNOWN_SYSTEM_CALL "Erreur : le programme a demand\202 un appel syst\212me inconnu.\nAppuyez sur Entr\202e pour continuer.\n"
 	#define STRING_KERNEL_ERROR_HARD_DISK_NOT_LBA_COMPATIBLE "Erreur : le disque dur n'est pas compatible avec l'adressage LBA.\n"
 	#define STRING_KERNEL_ERROR_SATA_HARD_DISK_NOT_FOUND "Erreur : le disque dur SATA est introuvable.\n"
+	#define STRING_KERNEL_ERROR_VIRTIO_HARD_DISK_NOT_FOUND "Erreur : le disque dur virtio est introuvable.\n"
+	#define STRING_KERNEL_ERROR_NVME_HARD_DISK_NOT_FOUND "Erreur : le disque dur NVMe est introuvable.\n"
 	#define STRING_KERNEL_ERROR_FAILED_TO_CREATE_RAM_DISK "Erreur : impossible de cr\202er le syst\212me de fichiers en RAM.\n"
 	#define STRING_KERNEL_ERROR_FAILED_TO_POPULATE_RAM_DISK "Erreur : impossible d'installer les fichiers dans le disque RAM.\n"
 	#define STRING_KERNEL_ERROR_ETHERNET_CONTROLLER_NOT_FOUND "Erreur : aucun contr\223leur ethernet n'a \202t\202 d\202tect\202.\n"
@@ -41,8 +43,17 @@
 	#define STRING_KERNEL_ERROR_FILE_STARTED_ON_BOOT_LARGER_THAN_RAM "Erreur : le syst\212me ne dispose pas d'assez de m\202moire pour ex\202cuter le programmelanc\202 automatiquement au d\202marrage.\n"
 	#define STRING_KERNEL_ERROR_FILE_STARTED_ON_BOOT_READ_FAILURE "Erreur : impossible de lire le fichier contenant le programme lanc\202\nautomatiquement au d\202marrage.\n"
 	
+	// IDE hard disk driver
+	#define STRING_DRIVER_HARD_DISK_IDE_ERROR_INPUT_OUTPUT "Erreur : impossible d'acc\202der au disque dur IDE.\nAppuyez sur Entr\202e pour continuer.\n"
+	
 	// SATA hard disk driver
 	#define STRING_DRIVER_HARD_DISK_SATA_ERROR_INPUT_OUTPUT "Erreur : impossible d'acc\202der au disque dur SATA.\nAppuyez sur Entr\202e pour continuer.\n"
+	
+	// Virtio hard disk driver
+	#define STRING_DRIVER_HARD_DISK_VIRTIO_ERROR_INPUT_OUTPUT "Erreur : impossible d'acc\202der au disque dur virtio.\nAppuyez sur Entr\202e pour continuer.\n"
+	
+	// NVMe hard disk driver
+	#define STRING_DRIVER_HARD_DISK_NVME_ERROR_INPUT_OUTPUT "Erreur : impossible d'acc\202der au disque dur NVMe.\nAppuyez sur Entr\202e pour continuer.\n"
 
 	// Shell welcoming message shown only at system startup
 	#define STRING_SHELL_WELCOME "Bienvenue sur Lemon !\n"
@@ -21,9 +21,47 @@ typedef enum
 	SYSTEM_CALL_SYSTEM_PARAMETER_ID_FILE_SYSTEM_FREE_BLOCKS_LIST_ENTRIES_COUNT, //!< How many Blocks List entries are available.
 	SYSTEM_CALL_SYSTEM_PARAMETER_ID_ETHERNET_CONTROLLER_IS_ENABLED, //!< Is the ethernet controller support available or not.
 	SYSTEM_CALL_SYSTEM_PARAMETER_ID_ETHERNET_CONTROLLER_MAC_ADDRESS, //!< Get the ethernet board MAC address.
+	SYSTEM_CALL_SYSTEM_PARAMETER_ID_HARD_DISK_STATISTICS, //!< Get the hard disk activity counters and commands latency (see TSystemCallHardDiskStatistics).
+	SYSTEM_CALL_SYSTEM_PARAMETER_ID_ETHERNET_CONTROLLER_OFFLOAD_CAPABILITIES, //!< Tell which work the ethernet controller can do instead of the processor (see SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_XXX).
 	SYSTEM_CALL_SYSTEM_PARAMETER_IDS_COUNT //! The total number of parameters.
 } TSystemCallSystemParameterID;
 
+/** The ethernet controller can insert the IPv4 header checksum and the TCP or UDP checksum in the sent frames (see SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_XXX). */
+#define SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TRANSMIT_CHECKSUMS (1 << 0)
+/** The ethernet controller verifies the IPv4 header checksum and the TCP or UDP checksum of the received frames, and the driver drops the frames with a bad checksum. */
+#define SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_RECEIVE_CHECKSUMS (1 << 1)
+/** The ethernet controller can split a big TCP payload into several frames (see SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP). */
+#define SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TCP_SEGMENTATION (1 << 2)
+
+/** Tell the ethernet controller to compute and insert the IPv4 header checksum of the sent frame. */
+#define SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_INSERT_IP_CHECKSUM (1 << 0)
+/** Tell the ethernet controller to compute and insert the TCP or UDP checksum of the sent frame. The checksum field must contain the pseudo header sum (not complemented). */
+#define SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_INSERT_TRANSPORT_CHECKSUM (1 << 1)
+/** Tell the ethernet controller to split the TCP payload into frames carrying at most the segment size set with SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_SIZE(). The frame buffer contains only the ethernet, IPv4 and TCP headers, the payload is stored in a separate buffer. The controller updates the IPv4 length and identification fields, the TCP sequence number and flags, and inserts both checksums in each frame. The TCP checksum field must contain the pseudo header sum computed with a zero TCP length (not complemented). */
+#define SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP (1 << 2)
+/** Set the maximum TCP payload size of each frame sent with SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP. */
+#define SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_SIZE(Maximum_Segment_Size) ((Maximum_Segment_Size) << 16)
+/** The biggest TCP payload size in bytes that can be sent with SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP. */
+#define SYSTEM_CALL_ETHERNET_MAXIMUM_SEGMENTED_PAYLOAD_SIZE 65536
+
+/** How many buckets a hard disk latency histogram has. The bucket N counts the commands that lasted from 2^N to 2^(N+1) - 1 timestamp counter cycles, the last bucket also counts all longer commands. */
+#define SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT 40
+
+/** The hard disk activity since the system started. */
+typedef struct
+{
+	unsigned int Read_Commands_Count; //!< How many read commands were sent to the drive.
+	unsigned int Write_Commands_Count; //!< How many write commands were sent to the drive.
+	unsigned int Flush_Commands_Count; //!< How many write cache flush commands were sent to the drive.
+	unsigned int Errors_Count; //!< How many commands failed, whatever their kind.
+	unsigned int Read_Sectors_Count; //!< How many sectors were read.
+	unsigned int Written_Sectors_Count; //!< How many sectors were written.
+	unsigned int Read_Latency_Histogram[SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT]; //!< The read commands duration distribution.
+	unsigned int Write_Latency_Histogram[SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT]; //!< The write commands duration distribution.
+	unsigned int Flush_Latency_Histogram[SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT]; //!< The flush commands duration distribution.
+	unsigned int Cycles_Per_Millisecond; //!< The timestamp counter frequency measured when the system started, it converts the latencies to time. It is zero if the processor has no timestamp counter, the latencies are not measured in this case.
+} TSystemCallHardDiskStatistics;
+
 /** All the available system calls. */
 typedef enum
 {
@@ -219,9 +257,9 @@ typedef enum
 
 	/** Send an ethernet frame.
 	 * @param ebx = Frame length in bytes.
-	 * @param ecx = don't care
+	 * @param ecx = The checksums the controller must insert (see SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_XXX), only set the flags matching the controller capabilities.
 	 * @param edx = Buffer address.
-	 * @param esi = don't care
+	 * @param esi = The TCP payload address when SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP is set (the frame length includes the payload), don't care otherwise.
 	 * @return Nothing.
 	 */
 	SYSTEM_CALL_ETHERNET_SEND_PACKET,
@@ -364,6 +402,42 @@ typedef enum
 	 * @return Nothing.
 	 */
 	SYSTEM_CALL_RTC_GET_TIME,
+	
+	/** Queue a read or a write (according to the file opening mode) that will be processed a block at a time by the following submit and poll calls.
+	 * @param ebx = File descriptor.
+	 * @param ecx = How many bytes to read or write.
+	 * @param edx = Buffer to read data to or write data from. The buffer must not be accessed until the request is completed.
+	 * @param esi = Pointer on an unsigned int which will hold the request identifier.
+	 * @return The FileSubmitAsynchronousRequest() error code.
+	 */
+	SYSTEM_CALL_FILE_SUBMIT_ASYNCHRONOUS_REQUEST,
+	
+	/** Tell if an asynchronous request is completed, releasing it if this is the case.
+	 * @param ebx = Request identifier.
+	 * @param ecx = don't care
+	 * @param edx = Pointer on an unsigned int which will hold how many bytes were processed.
+	 * @param esi = don't care
+	 * @return The FilePollAsynchronousRequest() error code.
+	 */
+	SYSTEM_CALL_FILE_POLL_ASYNCHRONOUS_REQUEST,
+	
+	/** Complete an asynchronous request immediately and release it.
+	 * @param ebx = Request identifier.
+	 * @param ecx = don't care
+	 * @param edx = Pointer on an unsigned int which will hold how many bytes were processed.
+	 * @param esi = don't care
+	 * @return The FileWaitAsynchronousRequest() error code.
+	 */
+	SYSTEM_CALL_FILE_WAIT_ASYNCHRONOUS_REQUEST,
+	
+	/** Reserve the blocks needed by a file opened in write mode before writing to it.
+	 * @param ebx = File descriptor.
+	 * @param ecx = The final file size in bytes.
+	 * @param edx = don't care
+	 * @param esi = don't care
+	 * @return The FilePreallocate() error code.
+	 */
+	SYSTEM_CALL_FILE_PREALLOCATE,
 
 	/** How many system calls are available. */
 	SYSTEM_CALLS_COUNT
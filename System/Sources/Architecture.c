@@ -4,6 +4,7 @@
  */
 #include <Architecture.h>
 #include <Configuration.h>
+#include <Drivers/Driver_Hard_Disk.h> // To have the hard disk interrupt handler
 #include <Drivers/Driver_Keyboard.h> // To have the keyboard interrupt handler
 #include <Drivers/Driver_PIC.h> // To have the PIC acknowledge interrupt macro
 #include <Drivers/Driver_Timer.h> // To have the timer interrupt handler
@@ -41,6 +42,16 @@
 /** The task state segment index (used to switch from user space to kernel space and vice versa). */
 #define ARCHITECTURE_MEMORY_PROTECTION_SEGMENT_INDEX_TASK_STATE_SEGMENT 6
 
+/** A BIOS memory map range type telling that the range is available RAM. */
+#define ARCHITECTURE_MEMORY_MAP_ENTRY_TYPE_USABLE_RAM 1
+
+/** Tell whether the compiled hard disk driver uses an interrupt line (the RAM disk does not). */
+#if defined(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_IDE) || defined(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA) || defined(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_VIRTIO) || defined(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_NVME)
+	#define ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED 1
+#else
+	#define ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED 0
+#endif
+
 /** Save all user registers onto kernel stack and switch to kernel data segment. */
 #define ARCHITECTURE_SAVE_USER_REGISTERS() \
 	asm \
@@ -119,6 +130,23 @@ typedef struct __attribute__((packed))
 	TArchitectureInterruptDescriptor *Pointer_Table; //!< The Interrupt Descriptor Table base address.
 } TArchitectureInterruptDescriptorTableRegister;
 
+/** A BIOS INT 15h, function E820h memory map entry. */
+typedef struct __attribute__((packed))
+{
+	unsigned long long Base_Address; //!< The range physical start address.
+	unsigned long long Length; //!< The range size in bytes.
+	unsigned int Type; //!< The range type, only type 1 ranges are usable RAM.
+	unsigned int Extended_Attributes; //!< ACPI 3.0 extended attributes, bit 0 cleared tells that the entry must be ignored.
+} TArchitectureMemoryMapEntry;
+
+/** The memory map stored by the MBR. */
+typedef struct __attribute__((packed))
+{
+	unsigned short Entries_Count; //!< How many entries the BIOS returned.
+	unsigned char Reserved[6]; //!< Padding to align the entries on 8 bytes.
+	TArchitectureMemoryMapEntry Entries[CONFIGURATION_SYSTEM_MEMORY_MAP_MAXIMUM_ENTRIES_COUNT]; //!< The memory ranges.
+} TArchitectureMemoryMap;
+
 /** A TSS descriptor. */
 typedef struct __attribute__((packed))
 {
@@ -178,6 +206,11 @@ static volatile TArchitectureInterruptDescriptorTableRegister Architecture_Inter
 /** The TSS involved in context switching. */
 static volatile TArchitectureTaskStateSegment Architecture_Kernel_Task_State_Segment;
 
+#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+	/** The PIC interrupt line the hard disk controller is wired to (0 is the timer line, so it means that the hard disk does not use interrupts). */
+	static unsigned int Architecture_Hard_Disk_Interrupt_Line = 0;
+#endif
+
 //-------------------------------------------------------------------------------------------------
 // Function prototypes
 //-------------------------------------------------------------------------------------------------
@@ -193,6 +226,18 @@ void ArchitectureInterruptLauncherStackException(void);
 void ArchitectureInterruptLauncherTimer(void);
 /** Called when the keyboard trigger an interrupt. */
 void ArchitectureInterruptLauncherKeyboard(void);
+#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+	/** Called when the hard disk controller triggers an interrupt. */
+	void ArchitectureInterruptLauncherHardDisk(void);
+#endif
+#ifdef CONFIGURATION_SYSTEM_ETHERNET_CONTROLLER_DRIVER_82540EM
+	/** Called when the ethernet controller triggers an interrupt. */
+	void ArchitectureInterruptLauncherEthernet(void);
+	#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+		/** Called when the hard disk controller and the ethernet controller share the same interrupt line and one of them triggers an interrupt. */
+		void ArchitectureInterruptLauncherHardDiskAndEthernet(void);
+	#endif
+#endif
 /** Called when an user space application performs a system call. */
 void ArchitectureInterruptLauncherSystemCalls(void);
 /** Notify the interrupts controller that the interrupt has been handled.
@@ -387,6 +432,34 @@ static void __attribute__((used)) ArchitectureInterruptLaunchers(void)
 	ARCHITECTURE_RESTORE_USER_REGISTERS();
 	asm("jmp ArchitectureInterruptExit");
 	
+	#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+		// Hard disk
+		asm("ArchitectureInterruptLauncherHardDisk:");
+		ARCHITECTURE_SAVE_USER_REGISTERS();
+		asm("call HardDiskInterruptHandler"); // The handler is contained in the selected Drivers/Driver_Hard_Disk_XXX.c file
+		ARCHITECTURE_RESTORE_USER_REGISTERS();
+		asm("jmp ArchitectureInterruptExit");
+	#endif
+	
+	#ifdef CONFIGURATION_SYSTEM_ETHERNET_CONTROLLER_DRIVER_82540EM
+		// Ethernet
+		asm("ArchitectureInterruptLauncherEthernet:");
+		ARCHITECTURE_SAVE_USER_REGISTERS();
+		asm("call EthernetInterruptHandler"); // The handler is contained in the selected Drivers/Driver_Ethernet_XXX.c file
+		ARCHITECTURE_RESTORE_USER_REGISTERS();
+		asm("jmp ArchitectureInterruptExit");
+		
+		#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+			// Hard disk and ethernet on the same shared PCI interrupt line, both handlers ignore an interrupt their device did not trigger
+			asm("ArchitectureInterruptLauncherHardDiskAndEthernet:");
+			ARCHITECTURE_SAVE_USER_REGISTERS();
+			asm("call HardDiskInterruptHandler");
+			asm("call EthernetInterruptHandler");
+			ARCHITECTURE_RESTORE_USER_REGISTERS();
+			asm("jmp ArchitectureInterruptExit");
+		#endif
+	#endif
+	
 	// Default interrupt handler (do nothing)
 	asm("ArchitectureInterruptExit:");
 	PIC_ACKNOWLEDGE_INTERRUPT();
@@ -443,3 +516,89 @@ void ArchitectureIODelay(void)
 		"nop\n"
 	);
 }
+
+int ArchitectureAreInterruptsEnabled(void)
+{
+	unsigned int Flags;
+	
+	asm
+	(
+		"pushf\n"
+		"pop %0"
+		: "=r" (Flags)
+		: // No input parameters
+		: // No clobbered registers
+	);
+	
+	if (Flags & 0x200) return 1; // Interrupt Flag bit
+	return 0;
+}
+
+unsigned int ArchitectureFindBiggestFreeMemoryArea(unsigned int Minimum_Address, unsigned int *Pointer_Area_Size)
+{
+	TArchitectureMemoryMap *Pointer_Memory_Map = (TArchitectureMemoryMap *) CONFIGURATION_SYSTEM_MEMORY_MAP_ADDRESS;
+	TArchitectureMemoryMapEntry *Pointer_Entry;
+	unsigned long long Start_Address, End_Address;
+	unsigned int i, Entries_Count, Biggest_Area_Address = 0, Biggest_Area_Size = 0;
+	
+	// Do not trust a corrupted entries count
+	Entries_Count = Pointer_Memory_Map->Entries_Count;
+	if (Entries_Count > CONFIGURATION_SYSTEM_MEMORY_MAP_MAXIMUM_ENTRIES_COUNT) Entries_Count = CONFIGURATION_SYSTEM_MEMORY_MAP_MAXIMUM_ENTRIES_COUNT;
+	
+	for (i = 0; i < Entries_Count; i++)
+	{
+		Pointer_Entry = &Pointer_Memory_Map->Entries[i];
+		
+		// Keep only usable RAM
+		if ((Pointer_Entry->Type != ARCHITECTURE_MEMORY_MAP_ENTRY_TYPE_USABLE_RAM) || !(Pointer_Entry->Extended_Attributes & 1)) continue;
+		
+		// Clip the range to the allowed addresses
+		Start_Address = Pointer_Entry->Base_Address;
+		End_Address = Start_Address + Pointer_Entry->Length;
+		if (Start_Address < Minimum_Address) Start_Address = Minimum_Address;
+		if (End_Address > 0xFFFFFFFFULL) End_Address = 0xFFFFFFFFULL; // Keep the last byte out to make the size fit in 32 bits
+		if (End_Address <= Start_Address) continue;
+		
+		if (End_Address - Start_Address > Biggest_Area_Size)
+		{
+			Biggest_Area_Address = (unsigned int) Start_Address;
+			Biggest_Area_Size = (unsigned int) (End_Address - Start_Address);
+		}
+	}
+	
+	*Pointer_Area_Size = Biggest_Area_Size;
+	return Biggest_Area_Address;
+}
+
+#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+	void ArchitectureInstallHardDiskInterruptHandler(unsigned int Interrupt_Line)
+	{
+		unsigned int Interrupt_Vector;
+		
+		// Interrupt lines are remapped by the PIC to start right after the processor exceptions
+		Interrupt_Vector = 32 + Interrupt_Line;
+		ArchitectureMemoryProtectionAddInterruptDescriptor(Interrupt_Vector, 0, ArchitectureInterruptLauncherHardDisk);
+		Architecture_Hard_Disk_Interrupt_Line = Interrupt_Line;
+	}
+#endif
+
+#ifdef CONFIGURATION_SYSTEM_ETHERNET_CONTROLLER_DRIVER_82540EM
+	void ArchitectureInstallEthernetInterruptHandler(unsigned int Interrupt_Line)
+	{
+		unsigned int Interrupt_Vector;
+		
+		// Interrupt lines are remapped by the PIC to start right after the processor exceptions
+		Interrupt_Vector = 32 + Interrupt_Line;
+		
+		// PCI devices can share the same interrupt line, in this case both handlers must be called (the hard disk is initialized first, so its handler is already installed)
+		#if ARCHITECTURE_IS_HARD_DISK_INTERRUPT_USED
+			if (Interrupt_Line == Architecture_Hard_Disk_Interrupt_Line)
+			{
+				ArchitectureMemoryProtectionAddInterruptDescriptor(Interrupt_Vector, 0, ArchitectureInterruptLauncherHardDiskAndEthernet);
+				return;
+			}
+		#endif
+		
+		ArchitectureMemoryProtectionAddInterruptDescriptor(Interrupt_Vector, 0, ArchitectureInterruptLauncherEthernet);
+	}
+#endif
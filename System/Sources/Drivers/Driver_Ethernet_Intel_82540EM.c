@@ -2,6 +2,7 @@
  * Intel 82540EM Gigabit ethernet controller (also known as Intel PRO/1000) driver.
  * @author Adrien RICCIARDI
  */
+#include <Architecture.h>
 #include <Configuration.h>
 #include <Debug.h>
 #include <Drivers/Driver_Ethernet.h>
@@ -11,6 +12,13 @@
 //-------------------------------------------------------------------------------------------------
 // Private constants
 //-------------------------------------------------------------------------------------------------
+/** How many receive descriptors the ring contains. Each descriptor owns a CONFIGURATION_ETHERNET_BUFFER_SIZE buffer, so the controller can store this amount of back-to-back frames before the system reads them. The ring size in bytes must be a multiple of 128. */
+#define ETHERNET_CONTROLLER_RECEIVE_DESCRIPTORS_COUNT 256
+/** How many transmit descriptors the ring contains. Each descriptor owns a CONFIGURATION_ETHERNET_BUFFER_SIZE buffer, so this amount of frames can wait to be transmitted while the system keeps working. The ring size in bytes must be a multiple of 128. */
+#define ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT 64
+/** How many received packets the kernel queue can store. The interrupt handler empties the receive ring into this queue, so the controller always has free descriptors while the application is busy. */
+#define ETHERNET_CONTROLLER_RECEIVE_QUEUE_PACKETS_COUNT 128
+
 /** Set to 1 to enable auto-speed detection, set to 0 to force the link speed by software. */
 #define ETHERNET_CONTROLLER_DEVICE_CONTROL_REGISTER_AUTO_SPEED_DETECTION_ENABLE_BIT 5
 /** Allow the PHY to communicate with an eventual partner. */
@@ -21,11 +29,25 @@
 /** Tell if the link is up or down. */
 #define ETHERNET_CONTROLLER_DEVICE_STATUS_REGISTER_LINK_UP_INDICATION_BIT 1
 
+/** The number of free receive descriptors fell below the minimum threshold. */
+#define ETHERNET_CONTROLLER_INTERRUPT_REGISTER_RECEIVE_DESCRIPTOR_MINIMUM_THRESHOLD_BIT 4
+/** A packet was dropped because there was no free receive descriptor. */
+#define ETHERNET_CONTROLLER_INTERRUPT_REGISTER_RECEIVER_OVERRUN_BIT 6
+/** A packet has been stored in memory. */
+#define ETHERNET_CONTROLLER_INTERRUPT_REGISTER_RECEIVER_TIMER_BIT 7
+/** All interrupt causes telling that the receive ring must be emptied. The same bits are used in the Interrupt Cause Read, Interrupt Mask Set and Interrupt Mask Clear registers. */
+#define ETHERNET_CONTROLLER_RECEIVE_INTERRUPTS_MASK ((1 << ETHERNET_CONTROLLER_INTERRUPT_REGISTER_RECEIVE_DESCRIPTOR_MINIMUM_THRESHOLD_BIT) | (1 << ETHERNET_CONTROLLER_INTERRUPT_REGISTER_RECEIVER_OVERRUN_BIT) | (1 << ETHERNET_CONTROLLER_INTERRUPT_REGISTER_RECEIVER_TIMER_BIT))
+
 /** Enable reception when set to 1, disable reception when set to 0. */
 #define ETHERNET_CONTROLLER_RECEIVE_CONTROL_REGISTER_RECEIVER_ENABLE_BIT 1
 /** Set to 1 to receive broadcast packets, set to 0 to disable broadcast packets reception. */
 #define ETHERNET_CONTROLLER_RECEIVE_CONTROL_REGISTER_BROADCAST_ACCEPT_MODE_BIT 15
 
+/** Set to 1 to make the controller verify the IPv4 header checksum of the received packets. */
+#define ETHERNET_CONTROLLER_RECEIVE_CHECKSUM_CONTROL_REGISTER_IP_CHECKSUM_OFFLOAD_ENABLE_BIT 8
+/** Set to 1 to make the controller verify the TCP and UDP checksums of the received packets. */
+#define ETHERNET_CONTROLLER_RECEIVE_CHECKSUM_CONTROL_REGISTER_TCP_UDP_CHECKSUM_OFFLOAD_ENABLE_BIT 9
+
 /** Enable transmission when set to 1, disable transmission when set to 0. */
 #define ETHERNET_CONTROLLER_TRANSMIT_CONTROL_REGISTER_TRANSMIT_ENABLE_BIT 1
 /** Enable or disable short packets padding. */
@@ -36,9 +58,62 @@
 /** Tell the ethernet controller to set the Descriptor Done bit in the transmit descriptor when a packet has been successfully transmitted. */
 #define ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_COMMAND_REGISTER_REPORT_STATUS_BIT (3 + 8) // Add 8 because the command byte is accessed as a 16-bit word with a little-endian processor
 
+/** The extended descriptor type field value telling that the descriptor is a context descriptor. The field is located in the same double word as the command byte. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_TYPE_CONTEXT (0 << 20)
+/** The extended descriptor type field value telling that the descriptor is a data descriptor. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_TYPE_DATA (1 << 20)
+/** Context descriptor command bit telling that the packet is a TCP one (it is an UDP one when the bit is cleared). */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_TCP_BIT 24
+/** Data descriptor command bit telling that the descriptor is the last one of the packet. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_END_OF_PACKET_BIT 24
+/** Context descriptor command bit telling that the packet is an IPv4 one. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_IP_BIT 25
+/** Data descriptor command bit telling the controller to append the ethernet CRC. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_INSERT_FRAME_CHECK_SEQUENCE_BIT 25
+/** Context and data descriptors command bit telling that the packet must be split into several frames (TCP segmentation). */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_TCP_SEGMENTATION_ENABLE_BIT 26
+/** Make the controller set the Descriptor Done bit when it has processed the descriptor. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_REPORT_STATUS_BIT 27
+/** Tell that the descriptor uses one of the extended formats instead of the legacy one. */
+#define ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_EXTENSION_BIT 29
+
+/** Make the controller insert the IPv4 header checksum at the offset given by the last context descriptor. */
+#define ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_INSERT_IP_CHECKSUM_BIT 0
+/** Make the controller insert the TCP or UDP checksum at the offset given by the last context descriptor. */
+#define ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_INSERT_TCP_UDP_CHECKSUM_BIT 1
+
+/** Tell that the controller has finished storing a packet in the buffer pointed by the receive descriptor. */
+#define ETHERNET_CONTROLLER_RECEIVE_DESCRIPTOR_STATUS_REGISTER_DESCRIPTOR_DONE_BIT 0
+
+/** The controller found a bad TCP or UDP checksum in the received packet. */
+#define ETHERNET_CONTROLLER_RECEIVE_DESCRIPTOR_ERRORS_REGISTER_TCP_UDP_CHECKSUM_ERROR_BIT 5
+/** The controller found a bad IPv4 header checksum in the received packet. */
+#define ETHERNET_CONTROLLER_RECEIVE_DESCRIPTOR_ERRORS_REGISTER_IP_CHECKSUM_ERROR_BIT 6
+
 /** Tell that the packet has been successfully transmitted. */
 #define ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_STATUS_REGISTER_DESCRIPTOR_DONE 0
 
+/** An ethernet header size in bytes. */
+#define ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE 14
+/** The smallest IPv4 header size in bytes. */
+#define ETHERNET_CONTROLLER_IP_MINIMUM_HEADER_SIZE 20
+/** The protocol field offset in the IPv4 header. */
+#define ETHERNET_CONTROLLER_IP_HEADER_PROTOCOL_OFFSET 9
+/** The checksum field offset in the IPv4 header. */
+#define ETHERNET_CONTROLLER_IP_HEADER_CHECKSUM_OFFSET 10
+/** The IPv4 protocol value of TCP. */
+#define ETHERNET_CONTROLLER_IP_PROTOCOL_TCP 6
+/** The IPv4 protocol value of UDP. */
+#define ETHERNET_CONTROLLER_IP_PROTOCOL_UDP 17
+/** The smallest TCP header size in bytes. */
+#define ETHERNET_CONTROLLER_TCP_MINIMUM_HEADER_SIZE 20
+/** The data offset field (the header size in 32-bit words, stored in the upper 4 bits) offset in the TCP header. */
+#define ETHERNET_CONTROLLER_TCP_HEADER_DATA_OFFSET_OFFSET 12
+/** The checksum field offset in the TCP header. */
+#define ETHERNET_CONTROLLER_TCP_HEADER_CHECKSUM_OFFSET 16
+/** The checksum field offset in the UDP header. */
+#define ETHERNET_CONTROLLER_UDP_HEADER_CHECKSUM_OFFSET 6
+
 //-------------------------------------------------------------------------------------------------
 // Private types
 //-------------------------------------------------------------------------------------------------
@@ -245,7 +320,12 @@ typedef struct __attribute__((packed))
 	// Offset 0x40FC
 	unsigned int TCP_Segmentation_Context_Transmit_Fail_Count;
 	
-	unsigned char Reserved_15[0x5200 - 0x4100];
+	unsigned char Reserved_15[0x5000 - 0x4100];
+	
+	// Offset 0x5000
+	unsigned int Receive_Checksum_Control;
+	
+	unsigned char Reserved_16[0x5200 - 0x5004];
 	
 	// Offset 0x5200
 	unsigned int Multicast_Table_Array_Entries[128];
@@ -277,27 +357,213 @@ typedef struct __attribute__((packed))
 	unsigned short Special;
 } TEthernetControllerTransmitDescriptor;
 
+/** A transmit context descriptor, it tells the controller where to compute and insert the checksums of the packets described by the following data descriptors. */
+typedef struct __attribute__((packed))
+{
+	unsigned char IP_Checksum_Start; //! The offset of the first byte of the IPv4 header.
+	unsigned char IP_Checksum_Offset; //! The offset of the IPv4 header checksum field.
+	unsigned short IP_Checksum_End; //! The offset of the last byte of the IPv4 header.
+	unsigned char TCP_UDP_Checksum_Start; //! The offset of the first byte of the TCP or UDP header.
+	unsigned char TCP_UDP_Checksum_Offset; //! The offset of the TCP or UDP checksum field.
+	unsigned short TCP_UDP_Checksum_End; //! The offset of the last byte to compute the checksum on, 0 means the packet end.
+	unsigned int Payload_Length_And_Command; //! The payload length (bits 0 to 19), the descriptor type (bits 20 to 23) and the command (bits 24 to 31).
+	unsigned char Status;
+	unsigned char Header_Length;
+	unsigned short Maximum_Segment_Size;
+} TEthernetControllerTransmitContextDescriptor;
+
+/** A transmit data descriptor, it is used instead of a legacy descriptor when the controller must process the packet content. */
+typedef struct __attribute__((packed))
+{
+	void *Pointer_Buffer_Address;
+	void *Pointer_Buffer_Address_High;
+	unsigned int Length_And_Command; //! The buffer length (bits 0 to 19), the descriptor type (bits 20 to 23) and the command (bits 24 to 31).
+	unsigned char Status;
+	unsigned char Packet_Options;
+	unsigned short Special;
+} TEthernetControllerTransmitDataDescriptor;
+
+/** All transmit descriptor formats share the same ring slots, the status byte is located at the same offset in all formats. */
+typedef union
+{
+	TEthernetControllerTransmitDescriptor Legacy;
+	TEthernetControllerTransmitContextDescriptor Context;
+	TEthernetControllerTransmitDataDescriptor Data;
+} TEthernetControllerTransmitRingDescriptor;
+
+/** A packet waiting in the kernel receive queue. */
+typedef struct
+{
+	unsigned int Size; //! The packet size in bytes.
+	unsigned char Buffer[CONFIGURATION_ETHERNET_BUFFER_SIZE]; //! The packet content.
+} TEthernetReceiveQueuePacket;
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
 /** The controller registers. */
-static TEthernetControllerRegisters *Pointer_Ethernet_Controller_Registers;
+static volatile TEthernetControllerRegisters *Pointer_Ethernet_Controller_Registers;
+
+/** The receive buffer descriptors ring. */
+static volatile TEthernetControllerReceiveDescriptor __attribute__((aligned(16))) Ethernet_Controller_Receive_Descriptors[ETHERNET_CONTROLLER_RECEIVE_DESCRIPTORS_COUNT]; // Must be aligned on an Intel paragraph
+/** The next receive descriptor the controller will fill, packets are retrieved in the same order they were received. */
+static unsigned int Ethernet_Controller_Receive_Descriptor_Index = 0;
+/** The transmit buffer descriptors ring. */
+static volatile TEthernetControllerTransmitRingDescriptor __attribute__((aligned(16))) Ethernet_Controller_Transmit_Descriptors[ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT]; // Must be aligned on an Intel paragraph
+/** The next transmit descriptor to fill with a packet, it is the value of the controller tail register. */
+static unsigned int Ethernet_Controller_Transmit_Descriptor_Index = 0;
+/** The oldest transmit descriptor that has not been reclaimed yet. The ring is empty when this index is equal to the transmit descriptor index. */
+static unsigned int Ethernet_Controller_Transmit_Descriptor_Reclaim_Index = 0;
+/** The headers layout described by the last context descriptor sent to the controller (the IPv4 header size in the upper bits and the transport protocol in the lower byte). The controller keeps using this context until a new context descriptor is sent. The value is 0 when no context has been sent yet. */
+static unsigned int Ethernet_Controller_Transmit_Context_Key = 0;
 
-/** The receive buffer descriptors list (currently limited to only one descriptor). */
-static volatile TEthernetControllerReceiveDescriptor __attribute__((aligned(16))) Ethernet_Controller_Receive_Descriptor; // Must be aligned on an Intel paragraph
-/** The transmit buffer descriptors list (currently limited to only one descriptor). */
-static volatile TEthernetControllerTransmitDescriptor __attribute__((aligned(16))) Ethernet_Controller_Transmit_Descriptor; // Must be aligned on an Intel paragraph
+/** The buffers dedicated to packets reception, one for each receive descriptor. */
+static unsigned char Ethernet_Controller_Reception_Buffers[ETHERNET_CONTROLLER_RECEIVE_DESCRIPTORS_COUNT][CONFIGURATION_ETHERNET_BUFFER_SIZE];
+/** The buffers dedicated to packets transmission, one for each transmit descriptor. */
+static unsigned char Ethernet_Controller_Transmission_Buffers[ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT][CONFIGURATION_ETHERNET_BUFFER_SIZE];
 
-/** The buffer dedicated to packets reception. */
-static unsigned char Ethernet_Controller_Reception_Buffer[CONFIGURATION_ETHERNET_BUFFER_SIZE];
-/** The buffer dedicated to packets transmission. */
-static unsigned char Ethernet_Controller_Transmission_Buffer[CONFIGURATION_ETHERNET_BUFFER_SIZE];
+/** The received packets not yet read by the system. */
+static TEthernetReceiveQueuePacket Ethernet_Receive_Queue_Packets[ETHERNET_CONTROLLER_RECEIVE_QUEUE_PACKETS_COUNT];
+/** The next queued packet to read. The queue is empty when this index is equal to the write index. */
+static unsigned int Ethernet_Receive_Queue_Read_Index = 0;
+/** The next queue slot to fill with a received packet. */
+static unsigned int Ethernet_Receive_Queue_Write_Index = 0;
+
+/** Tell whether the controller interrupt is routed to the processor. */
+static int Ethernet_Is_Interrupt_Available = 0;
 
 //-------------------------------------------------------------------------------------------------
 // Public variables
 //-------------------------------------------------------------------------------------------------
 unsigned char Ethernet_Controller_MAC_Address[ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE];
 
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Give back to the driver all transmit descriptors whose packet has been transmitted. Descriptors are completed in order, so stop at the first one the controller still owns. */
+static void EthernetReclaimTransmitDescriptors(void)
+{
+	while (Ethernet_Controller_Transmit_Descriptor_Reclaim_Index != Ethernet_Controller_Transmit_Descriptor_Index)
+	{
+		if (!(Ethernet_Controller_Transmit_Descriptors[Ethernet_Controller_Transmit_Descriptor_Reclaim_Index].Legacy.Status & (1 << ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_STATUS_REGISTER_DESCRIPTOR_DONE))) break;
+		
+		Ethernet_Controller_Transmit_Descriptor_Reclaim_Index++;
+		if (Ethernet_Controller_Transmit_Descriptor_Reclaim_Index >= ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT) Ethernet_Controller_Transmit_Descriptor_Reclaim_Index = 0;
+	}
+}
+
+/** Tell how many transmit descriptors can be filled.
+ * @return The free descriptors count.
+ */
+static unsigned int EthernetGetFreeTransmitDescriptorsCount(void)
+{
+	// One descriptor is always left unused, otherwise a full ring could not be distinguished from an empty one
+	if (Ethernet_Controller_Transmit_Descriptor_Reclaim_Index > Ethernet_Controller_Transmit_Descriptor_Index) return Ethernet_Controller_Transmit_Descriptor_Reclaim_Index - Ethernet_Controller_Transmit_Descriptor_Index - 1;
+	return ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT - (Ethernet_Controller_Transmit_Descriptor_Index - Ethernet_Controller_Transmit_Descriptor_Reclaim_Index) - 1;
+}
+
+/** Fill the next transmit descriptor with a context descriptor telling where the checksums are located in the following packets.
+ * @param IP_Header_Size The IPv4 header size in bytes.
+ * @param Transport_Protocol The IPv4 protocol value of the packet payload (ETHERNET_CONTROLLER_IP_PROTOCOL_TCP or ETHERNET_CONTROLLER_IP_PROTOCOL_UDP), or 0 if only the IPv4 header checksum is needed.
+ * @note The caller must make sure that a descriptor is free and must update the tail register.
+ */
+static void EthernetFillTransmitChecksumContextDescriptor(unsigned int IP_Header_Size, unsigned int Transport_Protocol)
+{
+	volatile TEthernetControllerTransmitContextDescriptor *Pointer_Descriptor;
+	unsigned int Transport_Header_Offset, Command;
+	
+	Pointer_Descriptor = &Ethernet_Controller_Transmit_Descriptors[Ethernet_Controller_Transmit_Descriptor_Index].Context;
+	Transport_Header_Offset = ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + IP_Header_Size;
+	
+	// IPv4 header checksum
+	Pointer_Descriptor->IP_Checksum_Start = ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE;
+	Pointer_Descriptor->IP_Checksum_Offset = ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + ETHERNET_CONTROLLER_IP_HEADER_CHECKSUM_OFFSET;
+	Pointer_Descriptor->IP_Checksum_End = Transport_Header_Offset - 1;
+	
+	// TCP or UDP checksum, it covers the transport header and the payload
+	Command = (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_EXTENSION_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_REPORT_STATUS_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_IP_BIT);
+	Pointer_Descriptor->TCP_UDP_Checksum_Start = Transport_Header_Offset;
+	if (Transport_Protocol == ETHERNET_CONTROLLER_IP_PROTOCOL_TCP)
+	{
+		Pointer_Descriptor->TCP_UDP_Checksum_Offset = Transport_Header_Offset + ETHERNET_CONTROLLER_TCP_HEADER_CHECKSUM_OFFSET;
+		Command |= 1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_TCP_BIT;
+	}
+	else Pointer_Descriptor->TCP_UDP_Checksum_Offset = Transport_Header_Offset + ETHERNET_CONTROLLER_UDP_HEADER_CHECKSUM_OFFSET;
+	Pointer_Descriptor->TCP_UDP_Checksum_End = 0;
+	
+	Pointer_Descriptor->Payload_Length_And_Command = ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_TYPE_CONTEXT | Command;
+	Pointer_Descriptor->Status = 0;
+	Pointer_Descriptor->Header_Length = 0;
+	Pointer_Descriptor->Maximum_Segment_Size = 0;
+	
+	Ethernet_Controller_Transmit_Descriptor_Index++;
+	if (Ethernet_Controller_Transmit_Descriptor_Index >= ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT) Ethernet_Controller_Transmit_Descriptor_Index = 0;
+}
+
+/** Fill the next transmit descriptor with a data descriptor pointing to its transmission buffer.
+ * @param Buffer_Size How many bytes of the transmission buffer to send.
+ * @param Packet_Options The checksums to insert (a combination of ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_XXX bits).
+ * @param Command The command bits to add to the mandatory ones, like the end of packet one when this descriptor is the last of the packet.
+ * @note The caller must make sure that a descriptor is free, must copy the data to the transmission buffer and must update the tail register.
+ */
+static void EthernetFillTransmitDataDescriptor(unsigned int Buffer_Size, unsigned int Packet_Options, unsigned int Command)
+{
+	volatile TEthernetControllerTransmitDataDescriptor *Pointer_Descriptor;
+	
+	// The buffer address must be set again because a context descriptor may have used this slot
+	Pointer_Descriptor = &Ethernet_Controller_Transmit_Descriptors[Ethernet_Controller_Transmit_Descriptor_Index].Data;
+	Pointer_Descriptor->Pointer_Buffer_Address = Ethernet_Controller_Transmission_Buffers[Ethernet_Controller_Transmit_Descriptor_Index];
+	Pointer_Descriptor->Pointer_Buffer_Address_High = NULL;
+	Pointer_Descriptor->Status = 0;
+	Pointer_Descriptor->Packet_Options = Packet_Options;
+	Pointer_Descriptor->Special = 0;
+	Pointer_Descriptor->Length_And_Command = Buffer_Size | ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_TYPE_DATA | Command | (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_INSERT_FRAME_CHECK_SEQUENCE_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_REPORT_STATUS_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_EXTENSION_BIT);
+	
+	Ethernet_Controller_Transmit_Descriptor_Index++;
+	if (Ethernet_Controller_Transmit_Descriptor_Index >= ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT) Ethernet_Controller_Transmit_Descriptor_Index = 0;
+}
+
+/** Move all packets stored by the controller from the receive ring to the kernel queue, and give the freed descriptors back to the controller. The packets stay in the ring when the queue is full.
+ * @warning This function must be called with the interrupts disabled.
+ */
+static void EthernetMoveReceivedPackets(void)
+{
+	volatile TEthernetControllerReceiveDescriptor *Pointer_Descriptor;
+	TEthernetReceiveQueuePacket *Pointer_Packet;
+	unsigned int Packet_Size, Next_Write_Index;
+	
+	while (1)
+	{
+		// Stop at the first descriptor the controller has not filled yet
+		Pointer_Descriptor = &Ethernet_Controller_Receive_Descriptors[Ethernet_Controller_Receive_Descriptor_Index];
+		if (!(Pointer_Descriptor->Status & (1 << ETHERNET_CONTROLLER_RECEIVE_DESCRIPTOR_STATUS_REGISTER_DESCRIPTOR_DONE_BIT))) break;
+		
+		// Drop the packets the controller found a bad checksum in (the error bits are set only for the checksums the controller verified)
+		if (!(Pointer_Descriptor->Errors & ((1 << ETHERNET_CONTROLLER_RECEIVE_DESCRIPTOR_ERRORS_REGISTER_TCP_UDP_CHECKSUM_ERROR_BIT) | (1 << ETHERNET_CONTROLLER_RECEIVE_DESCRIPTOR_ERRORS_REGISTER_IP_CHECKSUM_ERROR_BIT))))
+		{
+			// Is there room in the queue ?
+			Next_Write_Index = Ethernet_Receive_Queue_Write_Index + 1;
+			if (Next_Write_Index >= ETHERNET_CONTROLLER_RECEIVE_QUEUE_PACKETS_COUNT) Next_Write_Index = 0;
+			if (Next_Write_Index == Ethernet_Receive_Queue_Read_Index) break;
+			
+			// Queue the packet
+			Packet_Size = Pointer_Descriptor->Length;
+			if (Packet_Size > CONFIGURATION_ETHERNET_BUFFER_SIZE) Packet_Size = CONFIGURATION_ETHERNET_BUFFER_SIZE; // The controller can't write more than a buffer size, but make sure a corrupted descriptor can't overflow the queue buffer
+			Pointer_Packet = &Ethernet_Receive_Queue_Packets[Ethernet_Receive_Queue_Write_Index];
+			Pointer_Packet->Size = Packet_Size;
+			memcpy(Pointer_Packet->Buffer, Ethernet_Controller_Reception_Buffers[Ethernet_Controller_Receive_Descriptor_Index], Packet_Size);
+			Ethernet_Receive_Queue_Write_Index = Next_Write_Index;
+		}
+		
+		// Give the descriptor back to the controller
+		Pointer_Descriptor->Status = 0; // Reset status bits as suggested in datasheet
+		Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Tail = Ethernet_Controller_Receive_Descriptor_Index; // The freed descriptor becomes the last one the controller can fill, the tail always stays one descriptor behind the next packet to read
+		
+		Ethernet_Controller_Receive_Descriptor_Index++;
+		if (Ethernet_Controller_Receive_Descriptor_Index >= ETHERNET_CONTROLLER_RECEIVE_DESCRIPTORS_COUNT) Ethernet_Controller_Receive_Descriptor_Index = 0;
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
@@ -343,43 +609,60 @@ int EthernetInitialize(void)
 	
 	// Clear interrupts mask
 	Pointer_Ethernet_Controller_Registers->Interrupt_Mask_Set_Read = 0;
-	// Disable all interrupts (the system does not need to be told whether a packet arrived or not)
+	// Disable all interrupts until the receive ring is ready
 	Pointer_Ethernet_Controller_Registers->Interrupt_Mask_Clear = 0xFFFFFFFF;
 	
-	// Set the receive descriptors list starting address
+	// Configure the receive descriptors
+	for (i = 0; i < ETHERNET_CONTROLLER_RECEIVE_DESCRIPTORS_COUNT; i++)
+	{
+		Ethernet_Controller_Receive_Descriptors[i].Pointer_Buffer_Address = Ethernet_Controller_Reception_Buffers[i];
+		Ethernet_Controller_Receive_Descriptors[i].Pointer_Buffer_Address_High = NULL;
+		Ethernet_Controller_Receive_Descriptors[i].Status = 0;
+		Ethernet_Controller_Receive_Descriptors[i].Errors = 0;
+	}
+	Ethernet_Controller_Receive_Descriptor_Index = 0;
+	Ethernet_Receive_Queue_Read_Index = 0;
+	Ethernet_Receive_Queue_Write_Index = 0;
+	
+	// Set the receive descriptors ring starting address
 	Pointer_Ethernet_Controller_Registers->Pointer_Receive_Descriptor_Base_Address_High = NULL;
-	Pointer_Ethernet_Controller_Registers->Pointer_Receive_Descriptor_Base_Address_Low = &Ethernet_Controller_Receive_Descriptor;
-	// Set the receive descriptors list length
-	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Length = sizeof(Ethernet_Controller_Receive_Descriptor) << 6; // The value must be 128-bit aligned
-	// Select the only available descriptor
+	Pointer_Ethernet_Controller_Registers->Pointer_Receive_Descriptor_Base_Address_Low = Ethernet_Controller_Receive_Descriptors;
+	// Set the receive descriptors ring length
+	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Length = sizeof(Ethernet_Controller_Receive_Descriptors); // The value must be 128-byte aligned
+	// Give all descriptors but one to the controller (the ring would look empty if the tail was equal to the head)
 	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Head = 0;
-	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Tail = 1;
-	
-	// Configure the receive descriptor
-	Ethernet_Controller_Receive_Descriptor.Status = 0;
-	Ethernet_Controller_Receive_Descriptor.Errors = 0;
-	Ethernet_Controller_Receive_Descriptor.Pointer_Buffer_Address = Ethernet_Controller_Reception_Buffer;
+	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Tail = ETHERNET_CONTROLLER_RECEIVE_DESCRIPTORS_COUNT - 1;
 	
 	// Configure the reception behaviour
 	// TODO switch with available buffer values or always use 2048 ?
 	Pointer_Ethernet_Controller_Registers->Receive_Control = 1 << ETHERNET_CONTROLLER_RECEIVE_CONTROL_REGISTER_BROADCAST_ACCEPT_MODE_BIT;
 	Pointer_Ethernet_Controller_Registers->Receive_Delay_Timer = 0; // Generate an interrupt each time a packet is received
+	// Verify the IPv4, TCP and UDP checksums of the received packets
+	Pointer_Ethernet_Controller_Registers->Receive_Checksum_Control = (1 << ETHERNET_CONTROLLER_RECEIVE_CHECKSUM_CONTROL_REGISTER_IP_CHECKSUM_OFFLOAD_ENABLE_BIT) | (1 << ETHERNET_CONTROLLER_RECEIVE_CHECKSUM_CONTROL_REGISTER_TCP_UDP_CHECKSUM_OFFLOAD_ENABLE_BIT);
 	
 	//===============================================
 	// Transmission initialization section of the datasheet
 	//===============================================
-	// Set the transmit descriptors list starting address
+	// Configure the transmit descriptors
+	for (i = 0; i < ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT; i++)
+	{
+		Ethernet_Controller_Transmit_Descriptors[i].Legacy.Pointer_Buffer_Address = Ethernet_Controller_Transmission_Buffers[i];
+		Ethernet_Controller_Transmit_Descriptors[i].Legacy.Pointer_Buffer_Address_High = NULL;
+		Ethernet_Controller_Transmit_Descriptors[i].Legacy.Status = 0;
+	}
+	Ethernet_Controller_Transmit_Descriptor_Index = 0;
+	Ethernet_Controller_Transmit_Descriptor_Reclaim_Index = 0;
+	Ethernet_Controller_Transmit_Context_Key = 0;
+	
+	// Set the transmit descriptors ring starting address
 	Pointer_Ethernet_Controller_Registers->Pointer_Transmit_Descriptor_Base_Address_High = NULL;
-	Pointer_Ethernet_Controller_Registers->Pointer_Transmit_Descriptor_Base_Address_Low = &Ethernet_Controller_Transmit_Descriptor;
-	// Set the receive descriptors list length
-	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Length = sizeof(Ethernet_Controller_Transmit_Descriptor) << 6; // The value must be 128-bit aligned
-	// Select the only available descriptor
+	Pointer_Ethernet_Controller_Registers->Pointer_Transmit_Descriptor_Base_Address_Low = Ethernet_Controller_Transmit_Descriptors;
+	// Set the transmit descriptors ring length
+	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Length = sizeof(Ethernet_Controller_Transmit_Descriptors); // The value must be 128-byte aligned
+	// The ring is empty
 	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Head = 0;
 	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Tail = 0;
 	
-	// Configure the transmit descriptor
-	Ethernet_Controller_Transmit_Descriptor.Pointer_Buffer_Address = Ethernet_Controller_Transmission_Buffer;
-	
 	// Configure the transmission behaviour
 	Pointer_Ethernet_Controller_Registers->Transmit_Control = (0x40 << 12) | (0x0F << 4) | (1 << ETHERNET_CONTROLLER_TRANSMIT_CONTROL_REGISTER_PAD_SHORT_PACKETS_BIT);
 	// Set the Inter Packet Gap value
@@ -403,6 +686,32 @@ int EthernetInitialize(void)
 	// Enable reception
 	Pointer_Ethernet_Controller_Registers->Receive_Control |= 1 << ETHERNET_CONTROLLER_RECEIVE_CONTROL_REGISTER_RECEIVER_ENABLE_BIT;
 	
+	// Route the controller interrupt to the processor if the firmware assigned a legacy interrupt line to it (lines 0 to 2 are used by the timer, the keyboard and the PIC cascade), so the received packets are queued even when no application is waiting for them
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Interrupt line : ");
+		ScreenWriteString(itoa(Configuration_Space_Header.Interrupt_Line));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	if ((Configuration_Space_Header.Interrupt_Line >= 3) && (Configuration_Space_Header.Interrupt_Line <= 15))
+	{
+		ArchitectureInstallEthernetInterruptHandler(Configuration_Space_Header.Interrupt_Line);
+		
+		// Enable the reception interrupts
+		Pointer_Ethernet_Controller_Registers->Interrupt_Cause_Read; // Reading the register resets all pending causes
+		Pointer_Ethernet_Controller_Registers->Interrupt_Mask_Set_Read = ETHERNET_CONTROLLER_RECEIVE_INTERRUPTS_MASK;
+		Ethernet_Is_Interrupt_Available = 1;
+	}
+	else
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("No usable interrupt line, the driver will poll the controller.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+	}
+	
 	DEBUG_SECTION_START
 	DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
 	{
@@ -458,47 +767,185 @@ int EthernetInitialize(void)
 
 void EthernetReceivePacket(unsigned int *Pointer_Buffer_Size, void *Pointer_Buffer)
 {
-	// Wait for a packet to be received
-	while (!Ethernet_Controller_Receive_Descriptor.Status);
+	TEthernetReceiveQueuePacket *Pointer_Packet;
+	int Were_Interrupts_Enabled;
 	
-	// TODO check for max packet size ?
+	// The interrupt handler must not modify the queue while it is read
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	
+	// Wait for a packet to be received (the ring is polled too because the system calls run with the interrupts disabled)
+	while (1)
+	{
+		EthernetMoveReceivedPackets();
+		if (Ethernet_Receive_Queue_Read_Index != Ethernet_Receive_Queue_Write_Index) break;
+		if (Were_Interrupts_Enabled && Ethernet_Is_Interrupt_Available) ARCHITECTURE_INTERRUPTS_WAIT();
+	}
 	
 	// Send packet to userspace
-	*Pointer_Buffer_Size = Ethernet_Controller_Receive_Descriptor.Length; // Get packet size
-	memcpy(Pointer_Buffer, Ethernet_Controller_Reception_Buffer, *Pointer_Buffer_Size); // Copy the packet content to userspace
+	Pointer_Packet = &Ethernet_Receive_Queue_Packets[Ethernet_Receive_Queue_Read_Index];
+	*Pointer_Buffer_Size = Pointer_Packet->Size;
+	memcpy(Pointer_Buffer, Pointer_Packet->Buffer, Pointer_Packet->Size);
 	
-	// Re-enable packet reception
-	Ethernet_Controller_Receive_Descriptor.Status = 0; // Reset status bits as suggested in datasheet
-	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Head = 0; // Reset reception buffer descriptors queue
-	Pointer_Ethernet_Controller_Registers->Receive_Descriptor_Tail = 1;
+	Ethernet_Receive_Queue_Read_Index++;
+	if (Ethernet_Receive_Queue_Read_Index >= ETHERNET_CONTROLLER_RECEIVE_QUEUE_PACKETS_COUNT) Ethernet_Receive_Queue_Read_Index = 0;
+	
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
 }
 
-void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer)
+void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer, unsigned int Offload_Flags)
 {
+	volatile TEthernetControllerTransmitRingDescriptor *Pointer_Descriptor;
+	unsigned char *Pointer_Frame = Pointer_Buffer;
+	unsigned int IP_Header_Size = 0, Transport_Protocol = 0, Packet_Options = 0, Context_Key = 0, Descriptors_Count = 1;
+	
 	// Set the source MAC address
 	memcpy(Pointer_Buffer + ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE, Ethernet_Controller_MAC_Address, ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE);
 	
-	// Copy the packet content to the ethernet controller transmission buffer
 	if (Buffer_Size > CONFIGURATION_ETHERNET_BUFFER_SIZE) Buffer_Size = CONFIGURATION_ETHERNET_BUFFER_SIZE; // Make sure the packet is not too big for the destination buffer
-	memcpy(Ethernet_Controller_Transmission_Buffer, Pointer_Buffer, Buffer_Size);
+	
+	// The checksums can be inserted only in IPv4 packets (the protocol type 0x0800 is stored in big endian)
+	if ((Offload_Flags != 0) && (Buffer_Size >= ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + ETHERNET_CONTROLLER_IP_MINIMUM_HEADER_SIZE) && (Pointer_Frame[12] == 0x08) && (Pointer_Frame[13] == 0x00) && ((Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE] >> 4) == 4))
+	{
+		IP_Header_Size = (Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE] & 0x0F) * 4;
+		if ((IP_Header_Size >= ETHERNET_CONTROLLER_IP_MINIMUM_HEADER_SIZE) && (Buffer_Size >= ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + IP_Header_Size))
+		{
+			if (Offload_Flags & SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_INSERT_IP_CHECKSUM) Packet_Options |= 1 << ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_INSERT_IP_CHECKSUM_BIT;
+			if (Offload_Flags & SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_INSERT_TRANSPORT_CHECKSUM)
+			{
+				Transport_Protocol = Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + ETHERNET_CONTROLLER_IP_HEADER_PROTOCOL_OFFSET];
+				if ((Transport_Protocol == ETHERNET_CONTROLLER_IP_PROTOCOL_TCP) || (Transport_Protocol == ETHERNET_CONTROLLER_IP_PROTOCOL_UDP)) Packet_Options |= 1 << ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_INSERT_TCP_UDP_CHECKSUM_BIT;
+				else Transport_Protocol = 0;
+			}
+			
+			// A context descriptor is needed only when the headers layout changes, the controller remembers the last one
+			if (Packet_Options != 0)
+			{
+				Context_Key = (IP_Header_Size << 8) | Transport_Protocol;
+				if (Context_Key != Ethernet_Controller_Transmit_Context_Key) Descriptors_Count = 2;
+			}
+		}
+	}
+	
+	// Reclaim the transmitted descriptors only when a new packet needs some, and wait for the oldest packets to be transmitted if the ring is full
+	EthernetReclaimTransmitDescriptors();
+	while (EthernetGetFreeTransmitDescriptorsCount() < Descriptors_Count) EthernetReclaimTransmitDescriptors();
+	
+	if (Descriptors_Count == 2)
+	{
+		EthernetFillTransmitChecksumContextDescriptor(IP_Header_Size, Transport_Protocol);
+		Ethernet_Controller_Transmit_Context_Key = Context_Key;
+	}
+	
+	// Copy the packet content to the descriptor transmission buffer, so the caller can reuse its buffer as soon as this function returns
+	memcpy(Ethernet_Controller_Transmission_Buffers[Ethernet_Controller_Transmit_Descriptor_Index], Pointer_Buffer, Buffer_Size);
 	
 	// Configure the transmission descriptor
-	Ethernet_Controller_Transmit_Descriptor.Status = 0;
-	Ethernet_Controller_Transmit_Descriptor.Length = Buffer_Size;
-	Ethernet_Controller_Transmit_Descriptor.Command_And_Checksum_Offset = (1 << ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_COMMAND_REGISTER_END_OF_PACKET_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_COMMAND_REGISTER_REPORT_STATUS_BIT); // Tell that the packet is fully contained in the descriptor so it can be sent; make the "descriptor done" status bit be set when the packet has been transmitted
+	if (Packet_Options == 0)
+	{
+		Pointer_Descriptor = &Ethernet_Controller_Transmit_Descriptors[Ethernet_Controller_Transmit_Descriptor_Index];
+		Pointer_Descriptor->Legacy.Pointer_Buffer_Address = Ethernet_Controller_Transmission_Buffers[Ethernet_Controller_Transmit_Descriptor_Index]; // The buffer address must be set again because a context descriptor may have used this slot
+		Pointer_Descriptor->Legacy.Pointer_Buffer_Address_High = NULL;
+		Pointer_Descriptor->Legacy.Status = 0;
+		Pointer_Descriptor->Legacy.Length = Buffer_Size;
+		Pointer_Descriptor->Legacy.Command_And_Checksum_Offset = (1 << ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_COMMAND_REGISTER_END_OF_PACKET_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_COMMAND_REGISTER_REPORT_STATUS_BIT); // Tell that the packet is fully contained in the descriptor so it can be sent; make the "descriptor done" status bit be set when the packet has been transmitted
+		
+		Ethernet_Controller_Transmit_Descriptor_Index++;
+		if (Ethernet_Controller_Transmit_Descriptor_Index >= ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTORS_COUNT) Ethernet_Controller_Transmit_Descriptor_Index = 0;
+	}
+	else EthernetFillTransmitDataDescriptor(Buffer_Size, Packet_Options, 1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_END_OF_PACKET_BIT);
 	
-	// Send the packet
-	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Head = 0; // Reset transmission buffer descriptors queue
-	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Tail = 1;
+	// Queue the packet, the controller transmits it while the system keeps working
+	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Tail = Ethernet_Controller_Transmit_Descriptor_Index;
+}
+
+void EthernetSendSegmentedTCPPacket(unsigned int Frame_Size, void *Pointer_Headers, void *Pointer_Payload, unsigned int Maximum_Segment_Size)
+{
+	volatile TEthernetControllerTransmitContextDescriptor *Pointer_Context_Descriptor;
+	unsigned char *Pointer_Frame = Pointer_Headers, *Pointer_Payload_Bytes = Pointer_Payload;
+	unsigned int IP_Header_Size, TCP_Header_Size, Headers_Size, Payload_Size, Chunk_Size, Descriptors_Count, Packet_Options, Command;
 	
-	// Wait for the packet to be transmitted
-	while (!(Ethernet_Controller_Transmit_Descriptor.Status & (1 << ETHERNET_CONTROLLER_TRANSMIT_DESCRIPTOR_STATUS_REGISTER_DESCRIPTOR_DONE)));
+	// Set the source MAC address
+	memcpy(Pointer_Headers + ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE, Ethernet_Controller_MAC_Address, ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE);
+	
+	// Only TCP over IPv4 packets can be segmented (the protocol type 0x0800 is stored in big endian)
+	if ((Pointer_Frame[12] != 0x08) || (Pointer_Frame[13] != 0x00) || ((Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE] >> 4) != 4)) return;
+	if (Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + ETHERNET_CONTROLLER_IP_HEADER_PROTOCOL_OFFSET] != ETHERNET_CONTROLLER_IP_PROTOCOL_TCP) return;
+	IP_Header_Size = (Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE] & 0x0F) * 4;
+	if (IP_Header_Size < ETHERNET_CONTROLLER_IP_MINIMUM_HEADER_SIZE) return;
+	TCP_Header_Size = (Pointer_Frame[ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + IP_Header_Size + ETHERNET_CONTROLLER_TCP_HEADER_DATA_OFFSET_OFFSET] >> 4) * 4;
+	if (TCP_Header_Size < ETHERNET_CONTROLLER_TCP_MINIMUM_HEADER_SIZE) return;
+	Headers_Size = ETHERNET_CONTROLLER_ETHERNET_HEADER_SIZE + IP_Header_Size + TCP_Header_Size;
+	
+	// Make sure the payload fits in the transmit ring and each frame fits in the controller frame size
+	if (Frame_Size <= Headers_Size) return;
+	Payload_Size = Frame_Size - Headers_Size;
+	if (Payload_Size > SYSTEM_CALL_ETHERNET_MAXIMUM_SEGMENTED_PAYLOAD_SIZE) return;
+	if ((Maximum_Segment_Size == 0) || (Headers_Size + Maximum_Segment_Size > CONFIGURATION_ETHERNET_BUFFER_SIZE)) return;
+	
+	// A context descriptor, a descriptor for the headers and as many descriptors as needed to hold the payload (the biggest payload needs less than half the ring)
+	Descriptors_Count = 2 + (Payload_Size + CONFIGURATION_ETHERNET_BUFFER_SIZE - 1) / CONFIGURATION_ETHERNET_BUFFER_SIZE;
+	EthernetReclaimTransmitDescriptors();
+	while (EthernetGetFreeTransmitDescriptorsCount() < Descriptors_Count) EthernetReclaimTransmitDescriptors();
+	
+	// Tell the controller which headers to replicate in front of each frame and how to split the payload
+	Pointer_Context_Descriptor = &Ethernet_Controller_Transmit_Descriptors[Ethernet_Controller_Transmit_Descriptor_Index].Context;
+	EthernetFillTransmitChecksumContextDescriptor(IP_Header_Size, ETHERNET_CONTROLLER_IP_PROTOCOL_TCP);
+	Pointer_Context_Descriptor->Payload_Length_And_Command |= Payload_Size | (1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_TCP_SEGMENTATION_ENABLE_BIT);
+	Pointer_Context_Descriptor->Header_Length = Headers_Size;
+	Pointer_Context_Descriptor->Maximum_Segment_Size = Maximum_Segment_Size;
+	Ethernet_Controller_Transmit_Context_Key = 0; // This context can't be reused by a non-segmented packet, so force EthernetSendPacket() to send a new one
+	
+	// The first data descriptor holds the headers, the controller updates and inserts the checksums in each frame
+	Packet_Options = (1 << ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_INSERT_IP_CHECKSUM_BIT) | (1 << ETHERNET_CONTROLLER_TRANSMIT_DATA_DESCRIPTOR_PACKET_OPTIONS_INSERT_TCP_UDP_CHECKSUM_BIT);
+	Command = 1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_TCP_SEGMENTATION_ENABLE_BIT;
+	memcpy(Ethernet_Controller_Transmission_Buffers[Ethernet_Controller_Transmit_Descriptor_Index], Pointer_Headers, Headers_Size);
+	EthernetFillTransmitDataDescriptor(Headers_Size, Packet_Options, Command);
+	
+	// Spread the payload over the following descriptors, copying it so the caller can reuse its buffer as soon as this function returns
+	while (Payload_Size > 0)
+	{
+		if (Payload_Size > CONFIGURATION_ETHERNET_BUFFER_SIZE) Chunk_Size = CONFIGURATION_ETHERNET_BUFFER_SIZE;
+		else
+		{
+			Chunk_Size = Payload_Size;
+			Command |= 1 << ETHERNET_CONTROLLER_TRANSMIT_EXTENDED_DESCRIPTOR_COMMAND_END_OF_PACKET_BIT; // This is the last descriptor of the packet
+		}
+		
+		memcpy(Ethernet_Controller_Transmission_Buffers[Ethernet_Controller_Transmit_Descriptor_Index], Pointer_Payload_Bytes, Chunk_Size);
+		EthernetFillTransmitDataDescriptor(Chunk_Size, Packet_Options, Command);
+		
+		Pointer_Payload_Bytes += Chunk_Size;
+		Payload_Size -= Chunk_Size;
+	}
+	
+	// Queue the packet, the controller transmits all frames while the system keeps working
+	Pointer_Ethernet_Controller_Registers->Transmit_Descriptor_Tail = Ethernet_Controller_Transmit_Descriptor_Index;
 }
 
 int EthernetIsPacketReceived(void)
 {
-	if (Ethernet_Controller_Receive_Descriptor.Status) return 1;
-	return 0;
+	int Were_Interrupts_Enabled, Is_Packet_Received = 0;
+	
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	
+	EthernetMoveReceivedPackets();
+	if (Ethernet_Receive_Queue_Read_Index != Ethernet_Receive_Queue_Write_Index) Is_Packet_Received = 1;
+	
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+	return Is_Packet_Received;
+}
+
+unsigned int EthernetGetOffloadCapabilities(void)
+{
+	return SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TRANSMIT_CHECKSUMS | SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_RECEIVE_CHECKSUMS | SYSTEM_CALL_ETHERNET_OFFLOAD_CAPABILITY_TCP_SEGMENTATION;
+}
+
+void EthernetInterruptHandler(void)
+{
+	// Reading the register acknowledges all interrupt causes, so the controller stops asserting its interrupt line (nothing is read if the interrupt came from another device sharing the line)
+	if (Pointer_Ethernet_Controller_Registers->Interrupt_Cause_Read & ETHERNET_CONTROLLER_RECEIVE_INTERRUPTS_MASK) EthernetMoveReceivedPackets();
 }
 
 // TODO
@@ -283,7 +283,7 @@ void EthernetReceivePacket(unsigned int __attribute__((unused)) *Pointer_Buffer_
 	ScreenWriteString("+++ EthernetReceivePacket +++\n");
 }
 
-void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer)
+void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer, unsigned int __attribute__((unused)) Offload_Flags)
 {
 	// Set the source MAC address
 	memcpy(Pointer_Buffer + ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE, Ethernet_Controller_MAC_Address, ETHERNET_CONTROLLER_MAC_ADDRESS_SIZE);
@@ -303,8 +303,18 @@ void EthernetSendPacket(unsigned int Buffer_Size, void *Pointer_Buffer)
 	Pointer_Ethernet_Controller_Registers->Interrupt_Status |= (1 << ETHERNET_CONTROLLER_INTERRUPT_STATUS_REGISTER_TRANSMIT_OK_BIT) | (1 << ETHERNET_CONTROLLER_INTERRUPT_STATUS_REGISTER_TRANSMIT_ERROR_BIT);
 }
 
+void EthernetSendSegmentedTCPPacket(unsigned int __attribute__((unused)) Frame_Size, void __attribute__((unused)) *Pointer_Headers, void __attribute__((unused)) *Pointer_Payload, unsigned int __attribute__((unused)) Maximum_Segment_Size)
+{
+	// The driver does not tell it can segment packets, so this function is never called
+}
+
 int EthernetIsPacketReceived(void)
 {
 	// TODO
 	return 0;
+}
+
+unsigned int EthernetGetOffloadCapabilities(void)
+{
+	return 0;
 }
\ No newline at end of file
@@ -5,7 +5,10 @@
 #include <Architecture.h>
 #include <Debug.h>
 #include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
+#include <Drivers/Driver_PCI.h>
 #include <Hardware_Functions.h> // To have inb() and outb()
+#include <Strings.h>
 
 //-------------------------------------------------------------------------------------------------
 // Private constants and macros
@@ -23,6 +26,12 @@
 #else
 	#define HARD_DISK_PORT_DATA 0x0170
 #endif
+/** Hold the parameter of the SET FEATURES command. */
+#ifdef CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_IDE_BUS_PRIMARY
+	#define HARD_DISK_PORT_FEATURES 0x01F1
+#else
+	#define HARD_DISK_PORT_FEATURES 0x0171
+#endif
 /** Hold the number of sectors to read or to write. */
 #ifdef CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_IDE_BUS_PRIMARY
 	#define HARD_DISK_PORT_SECTOR_COUNT 0x01F2
@@ -65,13 +74,116 @@
 #else
 	#define HARD_DISK_PORT_STATUS 0x0376
 #endif
+/** Control the drive interrupt (this write-only register is located at the same address than the alternate status register). */
+#define HARD_DISK_PORT_DEVICE_CONTROL HARD_DISK_PORT_STATUS
+
+/** The channel bus master registers offset from the controller bus master base address, and the legacy interrupt line the channel is wired to. */
+#ifdef CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_IDE_BUS_PRIMARY
+	#define HARD_DISK_BUS_MASTER_CHANNEL_OFFSET 0
+	#define HARD_DISK_INTERRUPT_LINE 14
+#else
+	#define HARD_DISK_BUS_MASTER_CHANNEL_OFFSET 8
+	#define HARD_DISK_INTERRUPT_LINE 15
+#endif
+/** Bus master Command register offset. */
+#define HARD_DISK_BUS_MASTER_REGISTER_COMMAND 0
+/** Bus master Status register offset. */
+#define HARD_DISK_BUS_MASTER_REGISTER_STATUS 2
+/** Bus master PRD Table Address register offset. */
+#define HARD_DISK_BUS_MASTER_REGISTER_PHYSICAL_REGION_DESCRIPTOR_TABLE_ADDRESS 4
+
+// Bus master Command register useful bits
+/** Start/Stop Bus Master bit. */
+#define HARD_DISK_BIT_BUS_MASTER_COMMAND_START 1
+/** Read or Write Control bit, set it when the bus master writes to the memory (i.e. for a drive read operation). */
+#define HARD_DISK_BIT_BUS_MASTER_COMMAND_WRITE_TO_MEMORY (1 << 3)
+// Bus master Status register useful bits
+/** Error bit. */
+#define HARD_DISK_BIT_BUS_MASTER_STATUS_ERROR (1 << 1)
+/** Interrupt bit. */
+#define HARD_DISK_BIT_BUS_MASTER_STATUS_INTERRUPT (1 << 2)
 
 /** Command to start reading with automatic retries in case of failure. */
 #define HARD_DISK_COMMAND_READ_WITH_RETRIES 0x20
 /** Command to start writing with automatic retries in case of failure. */
 #define HARD_DISK_COMMAND_WRITE_WITH_RETRIES 0x30
+/** Command to start reading using a 48-bit address. */
+#define HARD_DISK_COMMAND_READ_EXTENDED 0x24
+/** Command to start writing using a 48-bit address. */
+#define HARD_DISK_COMMAND_WRITE_EXTENDED 0x34
+/** Command to read a block of sectors per data request. */
+#define HARD_DISK_COMMAND_READ_MULTIPLE 0xC4
+/** Command to write a block of sectors per data request. */
+#define HARD_DISK_COMMAND_WRITE_MULTIPLE 0xC5
+/** Command to read a block of sectors per data request using a 48-bit address. */
+#define HARD_DISK_COMMAND_READ_MULTIPLE_EXTENDED 0x29
+/** Command to write a block of sectors per data request using a 48-bit address. */
+#define HARD_DISK_COMMAND_WRITE_MULTIPLE_EXTENDED 0x39
+/** Command to configure the sectors count per data request of the multiple commands. */
+#define HARD_DISK_COMMAND_SET_MULTIPLE_MODE 0xC6
+/** Command to start a DMA read. */
+#define HARD_DISK_COMMAND_READ_DMA 0xC8
+/** Command to start a DMA write. */
+#define HARD_DISK_COMMAND_WRITE_DMA 0xCA
+/** Command to start a DMA read using a 48-bit address. */
+#define HARD_DISK_COMMAND_READ_DMA_EXTENDED 0x25
+/** Command to start a DMA write using a 48-bit address. */
+#define HARD_DISK_COMMAND_WRITE_DMA_EXTENDED 0x35
 /** Command to identify the device. */
 #define HARD_DISK_COMMAND_IDENTIFY_DEVICE 0xEC
+/** Command to change a drive feature, the feature is selected by the Features register. */
+#define HARD_DISK_COMMAND_SET_FEATURES 0xEF
+/** Command to write the drive cache content to the media. */
+#define HARD_DISK_COMMAND_FLUSH_CACHE 0xE7
+/** Command to write the drive cache content to the media when the drive has more than 2^28 sectors. */
+#define HARD_DISK_COMMAND_FLUSH_CACHE_EXTENDED 0xEA
+
+// SET FEATURES command useful features
+/** Enable the volatile write cache. */
+#define HARD_DISK_FEATURE_ENABLE_WRITE_CACHE 0x02
+/** Disable the volatile write cache. */
+#define HARD_DISK_FEATURE_DISABLE_WRITE_CACHE 0x82
+
+/** The commands to use and the maximum sectors count they can transfer according to the configured addressing mode (the biggest count is encoded as 0). */
+#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
+	#define HARD_DISK_COMMAND_READ HARD_DISK_COMMAND_READ_WITH_RETRIES
+	#define HARD_DISK_COMMAND_WRITE HARD_DISK_COMMAND_WRITE_WITH_RETRIES
+	#define HARD_DISK_COMMAND_MULTIPLE_READ HARD_DISK_COMMAND_READ_MULTIPLE
+	#define HARD_DISK_COMMAND_MULTIPLE_WRITE HARD_DISK_COMMAND_WRITE_MULTIPLE
+	#define HARD_DISK_COMMAND_DMA_READ HARD_DISK_COMMAND_READ_DMA
+	#define HARD_DISK_COMMAND_DMA_WRITE HARD_DISK_COMMAND_WRITE_DMA
+	#define HARD_DISK_MAXIMUM_SECTORS_PER_COMMAND 256
+	#define HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND 256
+	#define HARD_DISK_COMMAND_FLUSH HARD_DISK_COMMAND_FLUSH_CACHE
+#else
+	#define HARD_DISK_COMMAND_READ HARD_DISK_COMMAND_READ_EXTENDED
+	#define HARD_DISK_COMMAND_WRITE HARD_DISK_COMMAND_WRITE_EXTENDED
+	#define HARD_DISK_COMMAND_MULTIPLE_READ HARD_DISK_COMMAND_READ_MULTIPLE_EXTENDED
+	#define HARD_DISK_COMMAND_MULTIPLE_WRITE HARD_DISK_COMMAND_WRITE_MULTIPLE_EXTENDED
+	#define HARD_DISK_COMMAND_DMA_READ HARD_DISK_COMMAND_READ_DMA_EXTENDED
+	#define HARD_DISK_COMMAND_DMA_WRITE HARD_DISK_COMMAND_WRITE_DMA_EXTENDED
+	#define HARD_DISK_MAXIMUM_SECTORS_PER_COMMAND 65536
+	#define HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND 2048 // Limit a DMA command to 1 MB to keep the PRD Table small
+	#define HARD_DISK_COMMAND_FLUSH HARD_DISK_COMMAND_FLUSH_CACHE_EXTENDED
+#endif
+
+/** A PIO command transfers all its data with the interrupts disabled, so limit it to 128 KB to avoid losing timer ticks. */
+#define HARD_DISK_PIO_MAXIMUM_SECTORS_PER_COMMAND 256
+
+// Status register useful bits
+/** ERR bit. */
+#define HARD_DISK_BIT_STATUS_ERROR 0x01
+/** DRQ bit. */
+#define HARD_DISK_BIT_STATUS_DATA_REQUEST 0x08
+/** DF bit. */
+#define HARD_DISK_BIT_STATUS_DEVICE_FAULT 0x20
+
+/** A PRD can describe up to 64 KB and can't cross a 64 KB boundary. */
+#define HARD_DISK_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT 65536
+/** How many PRDs are needed to describe the biggest DMA command buffer (a buffer not aligned on 64 KB needs one more descriptor). */
+#define HARD_DISK_PHYSICAL_REGION_DESCRIPTORS_COUNT (((HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND * HARD_DISK_SECTOR_SIZE) / HARD_DISK_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT) + 1)
+/** Set in the last PRD of the table. */
+#define HARD_DISK_PHYSICAL_REGION_DESCRIPTOR_FLAG_END_OF_TABLE 0x8000
 
 /** Wait until the controller signals it is ready. */
 #define WAIT_BUSY_CONTROLLER() \
@@ -87,21 +199,55 @@ typedef struct __attribute__((packed))
 {
 	unsigned short Padding_0[27];
 	char String_Model_Number[40]; //!< Words 27..46 in ATA specification. Warning : this string is padded with spaces but not zero-terminated.
-	unsigned short Padding_1[2];
+	unsigned short Multiple_Maximum_Sectors_Count; //!< Word 47 in ATA specification, the low byte is the maximum sectors count per data request of the READ/WRITE MULTIPLE commands.
+	unsigned short Padding_1;
 	unsigned int Capabilities; //!< Words 49..50 in ATA specification.
 	unsigned short Padding_2[9];
 	unsigned int LBA_28_Maximum_Addressable_Logical_Sectors_Count; //!< Words 60..61 in ATA specification.
-	unsigned short Padding_3[38];
+	unsigned short Padding_3[20];
+	unsigned short Command_Set_Supported; //!< Word 82 in ATA specification, bit 5 is set when the drive has a volatile write cache.
+	unsigned short Command_Sets_Supported; //!< Word 83 in ATA specification, bit 10 is set when the drive supports LBA-48 mode.
+	unsigned short Padding_4[1];
+	unsigned short Command_Set_Enabled; //!< Word 85 in ATA specification, bit 5 is set when the volatile write cache is enabled.
+	unsigned short Padding_5[14];
 	unsigned long long LBA_48_Maximum_Addressable_Logical_Sectors_Count; //!< Words 100..103 in ATA specification, available only when drive supports LBA-48 mode.
-	unsigned short Padding_4[152];
+	unsigned short Padding_6[152];
 } THardDiskIdentifyDeviceAnswer;
 
+/** A Physical Region Descriptor, describing a memory area the bus master transfers data to or from. */
+typedef struct __attribute__((packed))
+{
+	unsigned int Physical_Address; //!< Must be word-aligned.
+	unsigned short Bytes_Count; //!< Must be even, 0 means 64 KB.
+	unsigned short Flags;
+} THardDiskPhysicalRegionDescriptor;
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
 /** Keep the hard disk total LBA sectors count. */
 static unsigned long long Hard_Disk_LBA_Sectors_Count;
 
+/** How many sectors are transferred per data request by the READ/WRITE MULTIPLE commands, or 0 if these commands can't be used. */
+static unsigned int Hard_Disk_IDE_Multiple_Sectors_Count = 0;
+
+/** Set to 1 when the controller handles 32-bit accesses to the data register. */
+static int Hard_Disk_IDE_Is_32_Bit_Data_Access_Enabled = 0;
+
+/** The channel bus master registers base port, or 0 if DMA can't be used. */
+static unsigned short Hard_Disk_IDE_Bus_Master_Port = 0;
+
+/** The bus master PRD Table, it must be 4-byte aligned and can't cross a 64 KB boundary (a 256-byte alignment guarantees it as the table is smaller). */
+static THardDiskPhysicalRegionDescriptor __attribute__((aligned(256))) Hard_Disk_IDE_Physical_Region_Descriptor_Table[HARD_DISK_PHYSICAL_REGION_DESCRIPTORS_COUNT];
+
+/** The bus master status flags acknowledged by the interrupt handler and not yet consumed by the waiting code. */
+static volatile unsigned char Hard_Disk_IDE_Recorded_Bus_Master_Status = 0;
+
+/** Set to 1 when the drive has a volatile write cache. */
+static int Hard_Disk_IDE_Is_Write_Cache_Supported = 0;
+/** Set to 1 when the drive acknowledges the writes before storing them on the media. */
+static int Hard_Disk_IDE_Is_Write_Cache_Enabled = 0;
+
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
@@ -143,6 +289,312 @@ static inline __attribute__((always_inline)) void HardDiskSendIdentifyDeviceComm
 	ARCHITECTURE_INTERRUPTS_ENABLE();
 }
 
+/** Program the controller registers with a transfer address and size, then send the read or write command.
+ * @param Command The command to send.
+ * @param Logical_Sector_Number The first LBA sector to access.
+ * @param Sectors_Count How many sectors to access, the maximum value is HARD_DISK_MAXIMUM_SECTORS_PER_COMMAND.
+ * @warning The interrupts must be disabled and the controller must be ready.
+ */
+static void HardDiskIDESendTransferCommand(unsigned char Command, unsigned int Logical_Sector_Number, unsigned int Sectors_Count)
+{
+	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
+		// Select master device and send high LBA address nibble
+		outb(HARD_DISK_PORT_DEVICE_HEAD, 0xE0 | (HARD_DISK_IDE_DRIVE_INDEX << 4) | ((Logical_Sector_Number >> 24) & 0x0F));
+		
+		// Send LBA address remaining bytes
+		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, Logical_Sector_Number >> 16);
+		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, Logical_Sector_Number >> 8);
+		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number);
+		
+		// Send the sectors count (256 sectors are encoded as 0)
+		outb(HARD_DISK_PORT_SECTOR_COUNT, Sectors_Count);
+	#else
+		// Select master device and configure for 48-LBA
+		outb(HARD_DISK_PORT_DEVICE_HEAD, 0x40 | (HARD_DISK_IDE_DRIVE_INDEX << 4));
+		
+		// Send the sectors count (65536 sectors are encoded as 0)
+		outb(HARD_DISK_PORT_SECTOR_COUNT, Sectors_Count >> 8); // High byte
+		outb(HARD_DISK_PORT_SECTOR_COUNT, Sectors_Count); // Low byte
+		
+		// Send the sector address
+		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number >> 24); // Byte 3
+		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, 0); // Byte 4 (always 0 as the addresses are 32-bit long)
+		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, 0); // Byte 5 (always 0 as the addresses are 32-bit long)
+		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number); // Byte 0
+		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, Logical_Sector_Number >> 8); // Byte 1
+		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, Logical_Sector_Number >> 16); // Byte 2
+	#endif
+	
+	outb(HARD_DISK_PORT_COMMAND, Command);
+}
+
+/** Look for a PCI IDE controller to enable the fastest transfer modes it provides. PCI controllers handle 32-bit data register accesses, and bus master controllers can transfer the data with DMA.
+ * @param Is_Direct_Memory_Access_Supported_By_Drive Set to 1 if the drive reported DMA support.
+ */
+static void HardDiskIDEInitializePCIController(int Is_Direct_Memory_Access_Supported_By_Drive)
+{
+	TPCIDeviceID IDE_Device_ID;
+	TPCIConfigurationSpaceHeader Device_Configuration_Space_Header;
+	
+	// Find the IDE controller on the PCI bus
+	if (PCIFindDeviceFromClass(PCI_CLASS_CODE_BASE_MASS_STORAGE, PCI_CLASS_CODE_SUB_CLASS_IDE, &IDE_Device_ID) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("No PCI IDE controller found, DMA and 32-bit PIO will not be used.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return;
+	}
+	if (PCIGetConfigurationSpaceHeader(&IDE_Device_ID, &Device_Configuration_Space_Header) != 0) return;
+	
+	// The PCI bus data path is 32-bit wide
+	Hard_Disk_IDE_Is_32_Bit_Data_Access_Enabled = 1;
+	if (!Is_Direct_Memory_Access_Supported_By_Drive) return;
+	
+	// The controller must support bus mastering (Programming Interface bit 7) and map the bus master registers in the I/O space
+	if (!(Device_Configuration_Space_Header.Class_Code_Interface & 0x80) || !(Device_Configuration_Space_Header.Base_Address_Registers[4] & 1))
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("The IDE controller is not a bus master, DMA will not be used.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return;
+	}
+	
+	PCIEnableBusMastering(&IDE_Device_ID);
+	Hard_Disk_IDE_Bus_Master_Port = PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[4]) + HARD_DISK_BUS_MASTER_CHANNEL_OFFSET;
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("IDE controller found.\nVendor ID : 0x");
+		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Vendor_ID);
+		ScreenWriteString(", device ID : 0x");
+		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Device_ID);
+		ScreenWriteString(", bus master port : 0x");
+		DebugWriteHexadecimalInteger(Hard_Disk_IDE_Bus_Master_Port);
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	// The table address never changes
+	outd(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_PHYSICAL_REGION_DESCRIPTOR_TABLE_ADDRESS, (unsigned int) Hard_Disk_IDE_Physical_Region_Descriptor_Table);
+	
+	// Let the drive signal the end of the DMA transfers with an interrupt
+	ArchitectureInstallHardDiskInterruptHandler(HARD_DISK_INTERRUPT_LINE);
+	outb(HARD_DISK_PORT_DEVICE_CONTROL, 0); // Clear the nIEN bit
+}
+
+/** Read or write consecutive sectors with a single DMA command. The processor is halted until the transfer completion if the caller runs with the interrupts enabled, otherwise the controller is polled.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first LBA sector to access.
+ * @param Sectors_Count How many sectors to access, the maximum value is HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND.
+ * @param Pointer_Buffer The data buffer, it must be word-aligned.
+ */
+static void HardDiskIDETransferSectorsDirectMemoryAccess(int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned int Entries_Count = 0, Data_Address = (unsigned int) Pointer_Buffer, Bytes_Count = Sectors_Count * HARD_DISK_SECTOR_SIZE, Entry_Bytes_Count;
+	unsigned char Bus_Master_Command, Bus_Master_Status, Drive_Status;
+	int Were_Interrupts_Enabled, Is_Error = 0;
+	unsigned long long Start_Timestamp;
+	
+	// Split the buffer on 64 KB boundaries (the kernel memory is not paged, so the buffer is physically contiguous)
+	while (Bytes_Count > 0)
+	{
+		Entry_Bytes_Count = HARD_DISK_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT - (Data_Address & (HARD_DISK_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT - 1));
+		if (Entry_Bytes_Count > Bytes_Count) Entry_Bytes_Count = Bytes_Count;
+		
+		Hard_Disk_IDE_Physical_Region_Descriptor_Table[Entries_Count].Physical_Address = Data_Address;
+		Hard_Disk_IDE_Physical_Region_Descriptor_Table[Entries_Count].Bytes_Count = (unsigned short) Entry_Bytes_Count; // 64 KB are encoded as 0
+		Hard_Disk_IDE_Physical_Region_Descriptor_Table[Entries_Count].Flags = 0;
+		
+		Data_Address += Entry_Bytes_Count;
+		Bytes_Count -= Entry_Bytes_Count;
+		Entries_Count++;
+	}
+	Hard_Disk_IDE_Physical_Region_Descriptor_Table[Entries_Count - 1].Flags = HARD_DISK_PHYSICAL_REGION_DESCRIPTOR_FLAG_END_OF_TABLE;
+	
+	// Keep the interrupts disabled while programming the controller, so the interrupt handler can't see a partially configured transfer
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	WAIT_BUSY_CONTROLLER();
+	
+	// Configure the bus master transfer direction and reset the previous transfer flags
+	if (Is_Write_Operation) Bus_Master_Command = 0;
+	else Bus_Master_Command = HARD_DISK_BIT_BUS_MASTER_COMMAND_WRITE_TO_MEMORY;
+	outb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_COMMAND, Bus_Master_Command);
+	outb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_STATUS, HARD_DISK_BIT_BUS_MASTER_STATUS_ERROR | HARD_DISK_BIT_BUS_MASTER_STATUS_INTERRUPT); // Set a flag to '1' to reset it
+	Hard_Disk_IDE_Recorded_Bus_Master_Status = 0;
+	
+	// Send the command to the drive, then start the bus master
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	if (Is_Write_Operation) HardDiskIDESendTransferCommand(HARD_DISK_COMMAND_DMA_WRITE, Logical_Sector_Number, Sectors_Count);
+	else HardDiskIDESendTransferCommand(HARD_DISK_COMMAND_DMA_READ, Logical_Sector_Number, Sectors_Count);
+	outb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_COMMAND, Bus_Master_Command | HARD_DISK_BIT_BUS_MASTER_COMMAND_START);
+	
+	// Wait for the drive interrupt, the status register must be checked again after each wake up because the timer interrupt wakes the processor too
+	while (1)
+	{
+		Bus_Master_Status = Hard_Disk_IDE_Recorded_Bus_Master_Status | inb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_STATUS);
+		if (Bus_Master_Status & (HARD_DISK_BIT_BUS_MASTER_STATUS_ERROR | HARD_DISK_BIT_BUS_MASTER_STATUS_INTERRUPT)) break;
+		if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_WAIT();
+	}
+	
+	// Stop the bus master and acknowledge the drive interrupt by reading its status register
+	outb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_COMMAND, 0);
+	Drive_Status = inb(HARD_DISK_PORT_COMMAND);
+	outb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_STATUS, HARD_DISK_BIT_BUS_MASTER_STATUS_ERROR | HARD_DISK_BIT_BUS_MASTER_STATUS_INTERRUPT); // Set a flag to '1' to reset it
+	Hard_Disk_IDE_Recorded_Bus_Master_Status = 0;
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+	
+	// Was the transfer successful ? (check the bus master error flag and the drive ERR and DF bits)
+	if ((Bus_Master_Status & HARD_DISK_BIT_BUS_MASTER_STATUS_ERROR) || (Drive_Status & 0x21)) Is_Error = 1;
+	HardDiskStatisticsRecordTransfer(Is_Write_Operation, Sectors_Count, Start_Timestamp, Is_Error);
+	
+	if (Is_Error)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_IDE_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
+/** Wait for the drive to request the next data block transfer.
+ * @return 0 if the drive is ready to transfer data,
+ * @return 1 if the command failed.
+ */
+static int HardDiskIDEWaitForDataRequest(void)
+{
+	unsigned char Status;
+	
+	// The status is valid 400 ns after the previous data block transfer, reading the alternate status register takes about 100 ns
+	inb(HARD_DISK_PORT_STATUS);
+	inb(HARD_DISK_PORT_STATUS);
+	inb(HARD_DISK_PORT_STATUS);
+	inb(HARD_DISK_PORT_STATUS);
+	
+	WAIT_BUSY_CONTROLLER();
+	Status = inb(HARD_DISK_PORT_STATUS);
+	if ((Status & (HARD_DISK_BIT_STATUS_ERROR | HARD_DISK_BIT_STATUS_DEVICE_FAULT)) || !(Status & HARD_DISK_BIT_STATUS_DATA_REQUEST)) return 1;
+	return 0;
+}
+
+/** Send a command that transfers no data and wait for its completion. If the caller had the interrupts enabled, they are enabled again while the drive executes the command, as a cache flush can last several seconds. They stay disabled otherwise, so a system call can't be interrupted by the shell restart.
+ * @param Features The Features register value.
+ * @param Command The command to send.
+ * @return 0 if the command succeeded,
+ * @return 1 if the drive reported an error.
+ */
+static int HardDiskIDEExecuteNonDataCommand(unsigned char Features, unsigned char Command)
+{
+	unsigned char Status;
+	int Were_Interrupts_Enabled;
+	
+	// Wait for the controller to be ready
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	WAIT_BUSY_CONTROLLER();
+	
+	outb(HARD_DISK_PORT_DEVICE_HEAD, HARD_DISK_IDE_DRIVE_INDEX << 4);
+	outb(HARD_DISK_PORT_FEATURES, Features);
+	outb(HARD_DISK_PORT_COMMAND, Command);
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+	
+	// The status is valid 400 ns after the command was sent, reading the alternate status register takes about 100 ns
+	inb(HARD_DISK_PORT_STATUS);
+	inb(HARD_DISK_PORT_STATUS);
+	inb(HARD_DISK_PORT_STATUS);
+	inb(HARD_DISK_PORT_STATUS);
+	
+	// Acknowledge the drive interrupt by reading its status register
+	WAIT_BUSY_CONTROLLER();
+	Status = inb(HARD_DISK_PORT_COMMAND);
+	if (Status & (HARD_DISK_BIT_STATUS_ERROR | HARD_DISK_BIT_STATUS_DEVICE_FAULT)) return 1;
+	return 0;
+}
+
+/** Read or write consecutive sectors with a single PIO command, using the READ/WRITE MULTIPLE commands when available.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first LBA sector to access.
+ * @param Sectors_Count How many sectors to access, the maximum value is HARD_DISK_PIO_MAXIMUM_SECTORS_PER_COMMAND.
+ * @param Pointer_Buffer The data buffer.
+ */
+static void HardDiskIDETransferSectorsProgrammedInputOutput(int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned int Block_Sectors_Count, Transfer_Units_Count, Command_Sectors_Count = Sectors_Count;
+	unsigned char Command;
+	int Is_Error = 0;
+	unsigned long long Start_Timestamp;
+	
+	// Select the command
+	if (Hard_Disk_IDE_Multiple_Sectors_Count > 0)
+	{
+		if (Is_Write_Operation) Command = HARD_DISK_COMMAND_MULTIPLE_WRITE;
+		else Command = HARD_DISK_COMMAND_MULTIPLE_READ;
+	}
+	else
+	{
+		if (Is_Write_Operation) Command = HARD_DISK_COMMAND_WRITE;
+		else Command = HARD_DISK_COMMAND_READ;
+	}
+	
+	// Wait for the controller to be ready
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	WAIT_BUSY_CONTROLLER();
+	
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	HardDiskIDESendTransferCommand(Command, Logical_Sector_Number, Sectors_Count);
+	
+	// Transfer a data block at each drive request
+	while (Sectors_Count > 0)
+	{
+		if (HardDiskIDEWaitForDataRequest() != 0)
+		{
+			Is_Error = 1;
+			break;
+		}
+		
+		// The last block of a multiple command can be smaller than the others
+		if (Hard_Disk_IDE_Multiple_Sectors_Count == 0) Block_Sectors_Count = 1;
+		else if (Sectors_Count < Hard_Disk_IDE_Multiple_Sectors_Count) Block_Sectors_Count = Sectors_Count;
+		else Block_Sectors_Count = Hard_Disk_IDE_Multiple_Sectors_Count;
+		
+		// Transfer the block data
+		if (Hard_Disk_IDE_Is_32_Bit_Data_Access_Enabled)
+		{
+			Transfer_Units_Count = (Block_Sectors_Count * HARD_DISK_SECTOR_SIZE) / 4;
+			if (Is_Write_Operation) asm volatile ("rep outsd" : "+S" (Pointer_Buffer), "+c" (Transfer_Units_Count) : "d" (HARD_DISK_PORT_DATA) : "memory");
+			else asm volatile ("rep insd" : "+D" (Pointer_Buffer), "+c" (Transfer_Units_Count) : "d" (HARD_DISK_PORT_DATA) : "memory");
+		}
+		else
+		{
+			Transfer_Units_Count = (Block_Sectors_Count * HARD_DISK_SECTOR_SIZE) / 2;
+			if (Is_Write_Operation) asm volatile ("rep outsw" : "+S" (Pointer_Buffer), "+c" (Transfer_Units_Count) : "d" (HARD_DISK_PORT_DATA) : "memory");
+			else asm volatile ("rep insw" : "+D" (Pointer_Buffer), "+c" (Transfer_Units_Count) : "d" (HARD_DISK_PORT_DATA) : "memory");
+		}
+		
+		Sectors_Count -= Block_Sectors_Count;
+	}
+	
+	// Wait for the last written data to be committed, then acknowledge the drive interrupt by reading its status register
+	WAIT_BUSY_CONTROLLER();
+	if (inb(HARD_DISK_PORT_COMMAND) & (HARD_DISK_BIT_STATUS_ERROR | HARD_DISK_BIT_STATUS_DEVICE_FAULT)) Is_Error = 1;
+	
+	ARCHITECTURE_INTERRUPTS_ENABLE();
+	
+	HardDiskStatisticsRecordTransfer(Is_Write_Operation, Command_Sectors_Count, Start_Timestamp, Is_Error);
+	
+	if (Is_Error)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_IDE_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
@@ -160,9 +612,37 @@ int HardDiskInitialize(void)
 	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
 		Hard_Disk_LBA_Sectors_Count = Identify_Device_Answer.LBA_28_Maximum_Addressable_Logical_Sectors_Count;
 	#else
+		// Does the device handle the 48-bit addresses ?
+		if (!(Identify_Device_Answer.Command_Sets_Supported & 0x0400)) return 1;
+		
 		Hard_Disk_LBA_Sectors_Count = Identify_Device_Answer.LBA_48_Maximum_Addressable_Logical_Sectors_Count;
 	#endif
 	
+	// Use the controller fast transfer modes, DMA transfers need the drive support
+	HardDiskIDEInitializePCIController(Identify_Device_Answer.Capabilities & 0x00000100);
+	
+	// Transfer as many sectors as possible per data request when DMA is not available
+	Hard_Disk_IDE_Multiple_Sectors_Count = Identify_Device_Answer.Multiple_Maximum_Sectors_Count & 0x00FF;
+	if (Hard_Disk_IDE_Multiple_Sectors_Count > 1)
+	{
+		ARCHITECTURE_INTERRUPTS_DISABLE();
+		WAIT_BUSY_CONTROLLER();
+		outb(HARD_DISK_PORT_DEVICE_HEAD, HARD_DISK_IDE_DRIVE_INDEX << 4);
+		outb(HARD_DISK_PORT_SECTOR_COUNT, Hard_Disk_IDE_Multiple_Sectors_Count);
+		outb(HARD_DISK_PORT_COMMAND, HARD_DISK_COMMAND_SET_MULTIPLE_MODE);
+		WAIT_BUSY_CONTROLLER();
+		if (inb(HARD_DISK_PORT_COMMAND) & HARD_DISK_BIT_STATUS_ERROR) Hard_Disk_IDE_Multiple_Sectors_Count = 0; // The drive refused the value
+		ARCHITECTURE_INTERRUPTS_ENABLE();
+	}
+	else Hard_Disk_IDE_Multiple_Sectors_Count = 0;
+	
+	// Keep the write cache state the drive booted with until the kernel configures it
+	if (Identify_Device_Answer.Command_Set_Supported & 0x0020)
+	{
+		Hard_Disk_IDE_Is_Write_Cache_Supported = 1;
+		if (Identify_Device_Answer.Command_Set_Enabled & 0x0020) Hard_Disk_IDE_Is_Write_Cache_Enabled = 1;
+	}
+	
 	DEBUG_SECTION_START
 	{
 		unsigned int i;
@@ -180,6 +660,12 @@ int HardDiskInitialize(void)
 		// Display sectors count
 		ScreenWriteString("\nTotal sectors count : ");
 		ScreenWriteString(itoa((unsigned int) Hard_Disk_LBA_Sectors_Count)); // TODO : display the whole sectors count
+		ScreenWriteString(".\nSectors per multiple data request : ");
+		ScreenWriteString(itoa(Hard_Disk_IDE_Multiple_Sectors_Count));
+		ScreenWriteString(", 32-bit PIO : ");
+		ScreenWriteString(itoa(Hard_Disk_IDE_Is_32_Bit_Data_Access_Enabled));
+		ScreenWriteString(", write cache supported : ");
+		ScreenWriteString(itoa(Hard_Disk_IDE_Is_Write_Cache_Supported));
 		ScreenWriteString(".\n");
 		
 		KeyboardReadCharacter();
@@ -191,130 +677,147 @@ int HardDiskInitialize(void)
 
 void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
 {
-	unsigned char *Pointer_Buffer_Bytes = Pointer_Buffer;
-	
-	// Wait for the controller to be ready
-	ARCHITECTURE_INTERRUPTS_DISABLE();
-	WAIT_BUSY_CONTROLLER();
+	HardDiskReadSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	HardDiskWriteSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned int Command_Sectors_Count;
 	
-	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
-		// Select master device and send high LBA address nibble
-		outb(HARD_DISK_PORT_DEVICE_HEAD, 0xE0 | (HARD_DISK_IDE_DRIVE_INDEX << 4) | ((Logical_Sector_Number >> 24) & 0x0F));
-		
-		// Send LBA address remaining bytes
-		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, Logical_Sector_Number >> 16);
-		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, Logical_Sector_Number >> 8);
-		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number);
-		
-		// Send the sectors count to read (always 1 to avoid issues with the 400 ns delay between sectors)
-		outb(HARD_DISK_PORT_SECTOR_COUNT, 1);
-	#else
-		// Select master device and configure for 48-LBA
-		outb(HARD_DISK_PORT_DEVICE_HEAD, 0x40 | (HARD_DISK_IDE_DRIVE_INDEX << 4));
-		
-		// Send the sectors to read count (always 1 to avoid issues with the 400 ns delay between sectors)
-		outb(HARD_DISK_PORT_SECTOR_COUNT, 0); // High byte
-		outb(HARD_DISK_PORT_SECTOR_COUNT, 1); // Low byte
+	while (Sectors_Count > 0)
+	{
+		// Use DMA if available, the bus master can't access a buffer that is not aligned on 2 bytes
+		if ((Hard_Disk_IDE_Bus_Master_Port != 0) && !((unsigned int) Pointer_Buffer & 1))
+		{
+			if (Sectors_Count > HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND) Command_Sectors_Count = HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND;
+			else Command_Sectors_Count = Sectors_Count;
+			
+			HardDiskIDETransferSectorsDirectMemoryAccess(0, Logical_Sector_Number, Command_Sectors_Count, Pointer_Buffer);
+		}
+		else
+		{
+			if (Sectors_Count > HARD_DISK_PIO_MAXIMUM_SECTORS_PER_COMMAND) Command_Sectors_Count = HARD_DISK_PIO_MAXIMUM_SECTORS_PER_COMMAND;
+			else Command_Sectors_Count = Sectors_Count;
+			
+			HardDiskIDETransferSectorsProgrammedInputOutput(0, Logical_Sector_Number, Command_Sectors_Count, Pointer_Buffer);
+		}
 		
-		// Send the sector address
-		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number >> 24); // Byte 3
-		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, 0); // Byte 4 (always 0 as the addresses are 32-bit long)
-		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, 0); // Byte 5 (always 0 as the addresses are 32-bit long)
-		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number); // Byte 0
-		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, Logical_Sector_Number >> 8); // Byte 1
-		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, Logical_Sector_Number >> 16); // Byte 2
-	#endif
-	
-	// Send read command with automatic retries
-	outb(HARD_DISK_PORT_COMMAND, HARD_DISK_COMMAND_READ_WITH_RETRIES);
-	
-	// Wait for read clearance
-	WAIT_BUSY_CONTROLLER();
-	// Read data
-	asm
-	(
-		"push edi\n"
-		"push ecx\n"
-		"push edx\n"
-		"mov ecx, %0\n" // Sector size is divided by two because we read words from the bus
-		"mov edi, %1\n"
-		"mov edx, %2\n"
-		"rep insw\n"
-		"pop edx\n"
-		"pop ecx\n"
-		"pop edi"
-		: // No output
-		: "g" (HARD_DISK_SECTOR_SIZE / 2), "g" (Pointer_Buffer_Bytes), "g" (HARD_DISK_PORT_DATA)
-		: "ecx", "edx", "edi"
-	);
+		Logical_Sector_Number += Command_Sectors_Count;
+		Pointer_Buffer += Command_Sectors_Count * HARD_DISK_SECTOR_SIZE;
+		Sectors_Count -= Command_Sectors_Count;
+	}
+}
+
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned int Command_Sectors_Count;
 	
-	ARCHITECTURE_INTERRUPTS_ENABLE();
+	while (Sectors_Count > 0)
+	{
+		// Use DMA if available, the bus master can't access a buffer that is not aligned on 2 bytes
+		if ((Hard_Disk_IDE_Bus_Master_Port != 0) && !((unsigned int) Pointer_Buffer & 1))
+		{
+			if (Sectors_Count > HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND) Command_Sectors_Count = HARD_DISK_DMA_MAXIMUM_SECTORS_PER_COMMAND;
+			else Command_Sectors_Count = Sectors_Count;
+			
+			HardDiskIDETransferSectorsDirectMemoryAccess(1, Logical_Sector_Number, Command_Sectors_Count, Pointer_Buffer);
+		}
+		else
+		{
+			if (Sectors_Count > HARD_DISK_PIO_MAXIMUM_SECTORS_PER_COMMAND) Command_Sectors_Count = HARD_DISK_PIO_MAXIMUM_SECTORS_PER_COMMAND;
+			else Command_Sectors_Count = Sectors_Count;
+			
+			HardDiskIDETransferSectorsProgrammedInputOutput(1, Logical_Sector_Number, Command_Sectors_Count, Pointer_Buffer);
+		}
+		
+		Logical_Sector_Number += Command_Sectors_Count;
+		Pointer_Buffer += Command_Sectors_Count * HARD_DISK_SECTOR_SIZE;
+		Sectors_Count -= Command_Sectors_Count;
+	}
 }
 
-void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
 {
-	unsigned char *Pointer_Buffer_Bytes = Pointer_Buffer;
+	unsigned int i;
 	
-	// Wait for the controller to be ready
-	ARCHITECTURE_INTERRUPTS_DISABLE();
-	WAIT_BUSY_CONTROLLER();
+	for (i = 0; i < Requests_Count; i++)
+	{
+		if (Is_Write_Operation) HardDiskWriteSectors(Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+		else HardDiskReadSectors(Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+	}
+}
+
+void HardDiskFlushCache(void)
+{
+	unsigned long long Start_Timestamp;
+	int Is_Error = 0;
 	
-	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
-		// Select master device and send high LBA address nibble
-		outb(HARD_DISK_PORT_DEVICE_HEAD, 0xE0 | (HARD_DISK_IDE_DRIVE_INDEX << 4) | ((Logical_Sector_Number >> 24) & 0x0F));
-		
-		// Send LBA address remaining bytes
-		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, Logical_Sector_Number >> 16);
-		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, Logical_Sector_Number >> 8);
-		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number);
-		
-		// Send the sectors count to write (always 1 to avoid issues with the 400 ns delay between sectors)
-		outb(HARD_DISK_PORT_SECTOR_COUNT, 1);
-	#else
-		// Select master device and configure for 48-LBA
-		outb(HARD_DISK_PORT_DEVICE_HEAD, 0x40 | (HARD_DISK_IDE_DRIVE_INDEX << 4));
-		
-		// Send the sectors to write count (always 1 to avoid issues with the 400 ns delay between sectors)
-		outb(HARD_DISK_PORT_SECTOR_COUNT, 0); // High byte
-		outb(HARD_DISK_PORT_SECTOR_COUNT, 1); // Low byte
-		
-		// Send the sector address
-		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number >> 24); // Byte 3
-		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, 0); // Byte 4 (always 0 as the addresses are 32-bit long)
-		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, 0); // Byte 5 (always 0 as the addresses are 32-bit long)
-		outb(HARD_DISK_PORT_LBA_ADDRESS_LOW, Logical_Sector_Number); // Byte 0
-		outb(HARD_DISK_PORT_LBA_ADDRESS_MIDDLE, Logical_Sector_Number >> 8); // Byte 1
-		outb(HARD_DISK_PORT_LBA_ADDRESS_HIGH, Logical_Sector_Number >> 16); // Byte 2
-	#endif
+	if (!Hard_Disk_IDE_Is_Write_Cache_Enabled) return;
 	
-	// Send write command with automatic retries
-	outb(HARD_DISK_PORT_COMMAND, HARD_DISK_COMMAND_WRITE_WITH_RETRIES);
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	if (HardDiskIDEExecuteNonDataCommand(0, HARD_DISK_COMMAND_FLUSH) != 0) Is_Error = 1;
+	HardDiskStatisticsRecordFlush(Start_Timestamp, Is_Error);
 	
-	// Wait for write clearance
-	WAIT_BUSY_CONTROLLER();
-	// Write data
-	asm
-	(
-		"push esi\n"
-		"push ecx\n"
-		"push edx\n"
-		"mov ecx, %0\n" // Sector size is divided by two because we write words to the bus
-		"mov esi, %1\n"
-		"mov edx, %2\n"
-		"rep outsw\n"
-		"pop edx\n"
-		"pop ecx\n"
-		"pop esi"
-		: // No output
-		: "g" (HARD_DISK_SECTOR_SIZE / 2), "g" (Pointer_Buffer_Bytes), "g" (HARD_DISK_PORT_DATA)
-		: "ecx", "edx", "esi"
-	);
+	if (Is_Error)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_IDE_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
+int HardDiskSetWriteCacheEnabled(int Is_Enabled)
+{
+	if (!Hard_Disk_IDE_Is_Write_Cache_Supported) return 1;
 	
-	ARCHITECTURE_INTERRUPTS_ENABLE();
+	if (Is_Enabled)
+	{
+		if (HardDiskIDEExecuteNonDataCommand(HARD_DISK_FEATURE_ENABLE_WRITE_CACHE, HARD_DISK_COMMAND_SET_FEATURES) != 0) return 1;
+		Hard_Disk_IDE_Is_Write_Cache_Enabled = 1;
+	}
+	else
+	{
+		// Do not lose the cached data
+		HardDiskFlushCache();
+		if (HardDiskIDEExecuteNonDataCommand(HARD_DISK_FEATURE_DISABLE_WRITE_CACHE, HARD_DISK_COMMAND_SET_FEATURES) != 0) return 1;
+		Hard_Disk_IDE_Is_Write_Cache_Enabled = 0;
+	}
+	return 0;
+}
+
+int HardDiskIsWriteCacheEnabled(void)
+{
+	return Hard_Disk_IDE_Is_Write_Cache_Enabled;
+}
+
+void *HardDiskMapSector(unsigned int __attribute__((unused)) Logical_Sector_Number)
+{
+	// The data can only be reached through the controller
+	return NULL;
 }
 
 unsigned int HardDiskGetDriveSizeSectors(void)
 {
-	// TODO : handle the LBA48 48-bit value
+	// The sector numbers are 32-bit long, so only the first 2 TB of a bigger drive can be used
+	if (Hard_Disk_LBA_Sectors_Count > 0xFFFFFFFF) return 0xFFFFFFFF;
 	return (unsigned int) Hard_Disk_LBA_Sectors_Count;
-}
\ No newline at end of file
+}
+
+void HardDiskInterruptHandler(void)
+{
+	unsigned char Bus_Master_Status;
+	
+	// Keep the bus master flags for the waiting code
+	Bus_Master_Status = inb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_STATUS);
+	Hard_Disk_IDE_Recorded_Bus_Master_Status |= Bus_Master_Status;
+	
+	// Acknowledge the interrupt (the PIO commands also trigger it), reading the drive status register makes the drive release its interrupt line
+	inb(HARD_DISK_PORT_COMMAND);
+	outb(Hard_Disk_IDE_Bus_Master_Port + HARD_DISK_BUS_MASTER_REGISTER_STATUS, Bus_Master_Status & (HARD_DISK_BIT_BUS_MASTER_STATUS_ERROR | HARD_DISK_BIT_BUS_MASTER_STATUS_INTERRUPT)); // Set a flag to '1' to reset it
+}
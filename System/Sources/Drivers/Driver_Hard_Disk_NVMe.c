@@ -0,0 +1,891 @@
+/** @file Driver_Hard_Disk_NVMe.c
+ * NVM Express hard disk driver. This driver is based on NVM Express Revision 1.2 Specification.
+ * @author Adrien RICCIARDI
+ */
+#include <Architecture.h>
+#include <Configuration.h>
+#include <Debug.h>
+#include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
+#include <Drivers/Driver_PCI.h>
+#include <Standard_Functions.h>
+#include <Strings.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The memory page size used by the controller, this is the smallest size all controllers support. */
+#define HARD_DISK_NVME_PAGE_SIZE 4096
+
+/** The admin queues entries count, only one command is executed at a time. */
+#define HARD_DISK_NVME_ADMIN_QUEUE_ENTRIES_COUNT 8
+/** The I/O queues biggest entries count, a submission queue fits in a single page. */
+#define HARD_DISK_NVME_IO_QUEUE_MAXIMUM_ENTRIES_COUNT 64
+/** The I/O queue pair identifier. */
+#define HARD_DISK_NVME_IO_QUEUE_ID 1
+
+/** How many commands can be in flight at the same time. */
+#define HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT 32
+/** Each slot PRP List entries count, it limits a command data size. */
+#define HARD_DISK_NVME_PRP_LIST_ENTRIES_COUNT 64
+
+/** The namespace the file system is stored on. */
+#define HARD_DISK_NVME_NAMESPACE_ID 1
+
+// Admin commands opcodes
+/** The "Create I/O Submission Queue" command. */
+#define HARD_DISK_NVME_ADMIN_COMMAND_CREATE_IO_SUBMISSION_QUEUE 0x01
+/** The "Create I/O Completion Queue" command. */
+#define HARD_DISK_NVME_ADMIN_COMMAND_CREATE_IO_COMPLETION_QUEUE 0x05
+/** The "Identify" command. */
+#define HARD_DISK_NVME_ADMIN_COMMAND_IDENTIFY 0x06
+/** The "Set Features" command. */
+#define HARD_DISK_NVME_ADMIN_COMMAND_SET_FEATURES 0x09
+
+// NVM commands opcodes
+/** The "Flush" command. */
+#define HARD_DISK_NVME_COMMAND_FLUSH 0x00
+/** The "Write" command. */
+#define HARD_DISK_NVME_COMMAND_WRITE 0x01
+/** The "Read" command. */
+#define HARD_DISK_NVME_COMMAND_READ 0x02
+
+// Identify command CNS values
+/** Identify the namespace. */
+#define HARD_DISK_NVME_IDENTIFY_NAMESPACE 0
+/** Identify the controller. */
+#define HARD_DISK_NVME_IDENTIFY_CONTROLLER 1
+
+/** The "Number of Queues" feature identifier. */
+#define HARD_DISK_NVME_FEATURE_NUMBER_OF_QUEUES 0x07
+/** The "Volatile Write Cache" feature identifier, bit 0 of the command double word 11 enables the cache. */
+#define HARD_DISK_NVME_FEATURE_VOLATILE_WRITE_CACHE 0x06
+
+// Controller Capabilities useful fields (high double word)
+/** DSTRD field, the doorbells stride. */
+#define HARD_DISK_NVME_GET_CAPABILITIES_DOORBELL_STRIDE(Capabilities_High) ((Capabilities_High) & 0x0F)
+/** MPSMIN field, the smallest supported memory page size. */
+#define HARD_DISK_NVME_GET_CAPABILITIES_MEMORY_PAGE_SIZE_MINIMUM(Capabilities_High) (((Capabilities_High) >> 16) & 0x0F)
+
+// Controller Configuration register values
+/** EN bit. */
+#define HARD_DISK_NVME_BIT_CONTROLLER_CONFIGURATION_ENABLE (1 << 0)
+/** IOSQES field, a submission queue entry is 2^6 bytes long. */
+#define HARD_DISK_NVME_CONTROLLER_CONFIGURATION_IO_SUBMISSION_QUEUE_ENTRY_SIZE (6 << 16)
+/** IOCQES field, a completion queue entry is 2^4 bytes long. */
+#define HARD_DISK_NVME_CONTROLLER_CONFIGURATION_IO_COMPLETION_QUEUE_ENTRY_SIZE (4 << 20)
+
+// Controller Status register bits
+/** RDY bit. */
+#define HARD_DISK_NVME_BIT_CONTROLLER_STATUS_READY (1 << 0)
+/** CFS bit. */
+#define HARD_DISK_NVME_BIT_CONTROLLER_STATUS_FATAL_STATUS (1 << 1)
+
+// Create I/O queue commands bits
+/** PC bit, the queue is physically contiguous. */
+#define HARD_DISK_NVME_BIT_CREATE_QUEUE_PHYSICALLY_CONTIGUOUS (1 << 0)
+/** IEN bit, the completion queue raises interrupts. */
+#define HARD_DISK_NVME_BIT_CREATE_QUEUE_INTERRUPTS_ENABLED (1 << 1)
+
+/** The completion queue entry Phase Tag bit, located in the double word 3. */
+#define HARD_DISK_NVME_BIT_COMPLETION_QUEUE_ENTRY_PHASE_TAG (1 << 16)
+/** Extract the Status Field from a completion queue entry double word 3. */
+#define HARD_DISK_NVME_GET_COMPLETION_QUEUE_ENTRY_STATUS(Double_Word_3) ((Double_Word_3) >> 17)
+
+// Identify data structures useful fields
+/** MDTS field offset in the Identify Controller data structure, the maximum data transfer size as a power of two of the minimum page size (0 means no limit). */
+#define HARD_DISK_NVME_IDENTIFY_CONTROLLER_OFFSET_MAXIMUM_DATA_TRANSFER_SIZE 77
+/** VWC field offset in the Identify Controller data structure, bit 0 is set when the controller has a volatile write cache. */
+#define HARD_DISK_NVME_IDENTIFY_CONTROLLER_OFFSET_VOLATILE_WRITE_CACHE 525
+/** NSZE field offset in the Identify Namespace data structure, the namespace size in logical blocks. */
+#define HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_SIZE 0
+/** FLBAS field offset in the Identify Namespace data structure, bits 3 to 0 select the LBA format in use. */
+#define HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_FORMATTED_LBA_SIZE 26
+/** LBAF0 field offset in the Identify Namespace data structure, each LBA format is 4-byte long. */
+#define HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_LBA_FORMATS 128
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** NVMe controller registers.
+ * @note The doorbells follow these registers, their location depends on the doorbell stride.
+ */
+typedef struct __attribute__((packed))
+{
+	unsigned int Capabilities_Low;
+	unsigned int Capabilities_High;
+	unsigned int Version;
+	unsigned int Interrupt_Mask_Set; //!< Set a bit to '1' to mask the corresponding interrupt vector.
+	unsigned int Interrupt_Mask_Clear; //!< Set a bit to '1' to unmask the corresponding interrupt vector.
+	unsigned int Controller_Configuration;
+	unsigned int Reserved;
+	unsigned int Controller_Status;
+	unsigned int NVM_Subsystem_Reset;
+	unsigned int Admin_Queue_Attributes;
+	unsigned int Admin_Submission_Queue_Base_Address;
+	unsigned int Admin_Submission_Queue_Base_Address_High_Double_Word; //! Only required for 64-bit accesses.
+	unsigned int Admin_Completion_Queue_Base_Address;
+	unsigned int Admin_Completion_Queue_Base_Address_High_Double_Word; //! Only required for 64-bit accesses.
+} THardDiskNVMeControllerRegisters;
+
+/** A submission queue entry, describing a command. */
+typedef struct __attribute__((packed))
+{
+	unsigned char Opcode;
+	unsigned char Flags;
+	unsigned short Command_Identifier; //!< Returned in the command completion queue entry.
+	unsigned int Namespace_Identifier;
+	unsigned int Reserved[2];
+	unsigned long long Metadata_Pointer; //!< Not used here.
+	unsigned long long PRP_Entry_1; //!< The data first page address, it can start anywhere in the page.
+	unsigned long long PRP_Entry_2; //!< The data second page address, or the PRP List address if the data spans more than 2 pages.
+	unsigned int Command_Specific[6]; //!< Command double words 10 to 15.
+} THardDiskNVMeSubmissionQueueEntry;
+
+/** A completion queue entry, describing a command result. */
+typedef struct __attribute__((packed))
+{
+	unsigned int Command_Specific;
+	unsigned int Reserved;
+	unsigned int Submission_Queue_Head_And_Identifier; //!< Not used here.
+	unsigned int Command_Identifier_Phase_And_Status; //!< Bits 15 to 0 hold the command identifier, bit 16 is the phase tag and bits 31 to 17 are the status field.
+} THardDiskNVMeCompletionQueueEntry;
+
+/** A queue pair state. */
+typedef struct
+{
+	volatile THardDiskNVMeSubmissionQueueEntry *Pointer_Submission_Queue;
+	volatile THardDiskNVMeCompletionQueueEntry *Pointer_Completion_Queue;
+	volatile unsigned int *Pointer_Submission_Queue_Tail_Doorbell;
+	volatile unsigned int *Pointer_Completion_Queue_Head_Doorbell;
+	unsigned int Entries_Count; //!< Both queues have the same size.
+	unsigned int Submission_Queue_Tail;
+	unsigned int Completion_Queue_Head;
+	unsigned int Expected_Phase_Tag; //!< The phase tag value of a completion queue entry that has just been posted by the controller, it toggles each time the queue wraps.
+} THardDiskNVMeQueuePair;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The controller registers. */
+static volatile THardDiskNVMeControllerRegisters *Pointer_Hard_Disk_NVMe_Controller_Registers;
+
+/** Set to 1 when the controller interrupt is routed to the processor, so the waiting code can halt the processor instead of polling the completion queue. */
+static int Hard_Disk_NVMe_Is_Interrupt_Available = 0;
+
+/** The admin queues. */
+static volatile THardDiskNVMeSubmissionQueueEntry __attribute__((aligned(HARD_DISK_NVME_PAGE_SIZE))) Hard_Disk_NVMe_Admin_Submission_Queue[HARD_DISK_NVME_ADMIN_QUEUE_ENTRIES_COUNT];
+static volatile THardDiskNVMeCompletionQueueEntry __attribute__((aligned(HARD_DISK_NVME_PAGE_SIZE))) Hard_Disk_NVMe_Admin_Completion_Queue[HARD_DISK_NVME_ADMIN_QUEUE_ENTRIES_COUNT];
+static THardDiskNVMeQueuePair Hard_Disk_NVMe_Admin_Queue_Pair;
+
+/** The I/O queues. */
+static volatile THardDiskNVMeSubmissionQueueEntry __attribute__((aligned(HARD_DISK_NVME_PAGE_SIZE))) Hard_Disk_NVMe_IO_Submission_Queue[HARD_DISK_NVME_IO_QUEUE_MAXIMUM_ENTRIES_COUNT];
+static volatile THardDiskNVMeCompletionQueueEntry __attribute__((aligned(HARD_DISK_NVME_PAGE_SIZE))) Hard_Disk_NVMe_IO_Completion_Queue[HARD_DISK_NVME_IO_QUEUE_MAXIMUM_ENTRIES_COUNT];
+static THardDiskNVMeQueuePair Hard_Disk_NVMe_IO_Queue_Pair;
+
+/** How many I/O commands can be in flight at the same time, it depends on the I/O queues size. */
+static unsigned int Hard_Disk_NVMe_Slots_Count;
+
+/** Each slot PRP List, describing the data pages following the first one. A list must not cross a page boundary. */
+static volatile unsigned long long __attribute__((aligned(HARD_DISK_NVME_PRP_LIST_ENTRIES_COUNT * sizeof(unsigned long long)))) Hard_Disk_NVMe_PRP_Lists[HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT][HARD_DISK_NVME_PRP_LIST_ENTRIES_COUNT];
+
+/** When each slot command was posted, to measure its latency on completion. */
+static unsigned long long Hard_Disk_NVMe_Slots_Start_Timestamp[HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT];
+/** How many sectors each slot command transfers. */
+static unsigned int Hard_Disk_NVMe_Slots_Sectors_Count[HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT];
+
+/** The maximum data bytes count of a single command. */
+static unsigned int Hard_Disk_NVMe_Maximum_Bytes_Per_Command;
+
+/** The namespace size in sectors. */
+static unsigned int Hard_Disk_NVMe_Sectors_Count;
+
+/** Set to 1 when the controller has a volatile write cache. */
+static int Hard_Disk_NVMe_Is_Write_Cache_Supported = 0;
+/** Set to 1 when the controller acknowledges the writes before storing them on the media. */
+static int Hard_Disk_NVMe_Is_Write_Cache_Enabled = 0;
+
+/** The buffer used by the Identify commands. */
+static volatile unsigned char __attribute__((aligned(HARD_DISK_NVME_PAGE_SIZE))) Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_PAGE_SIZE];
+
+/** The buffer used to transfer data from or to buffers that are not double word-aligned. */
+static volatile unsigned char __attribute__((aligned(4))) Hard_Disk_NVMe_Buffer[HARD_DISK_SECTOR_SIZE];
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Disable the interrupts so a waiting condition can be checked without missing the interrupt that would wake the processor up.
+ * @return 1 if the interrupts were enabled by the caller, 0 if they were already disabled.
+ */
+static int HardDiskNVMeBeginWait(void)
+{
+	int Were_Interrupts_Enabled;
+	
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	return Were_Interrupts_Enabled;
+}
+
+/** Halt the processor until the next interrupt, or return immediately if the completion queue must be polled.
+ * @param Were_Interrupts_Enabled The value returned by HardDiskNVMeBeginWait(). The processor can't be halted when the caller runs with the interrupts disabled (system calls, timer handler...).
+ * @note The waiting condition must be checked again after each call, the timer interrupt also wakes the processor up.
+ */
+static inline __attribute__((always_inline)) void HardDiskNVMeWaitForInterrupt(int Were_Interrupts_Enabled)
+{
+	if (Were_Interrupts_Enabled && Hard_Disk_NVMe_Is_Interrupt_Available)
+	{
+		// The interrupt handler masks the interrupt vector because the interrupt line stays asserted until the completions are consumed
+		Pointer_Hard_Disk_NVMe_Controller_Registers->Interrupt_Mask_Clear = 1;
+		ARCHITECTURE_INTERRUPTS_WAIT();
+	}
+}
+
+/** Restore the caller interrupts state.
+ * @param Were_Interrupts_Enabled The value returned by HardDiskNVMeBeginWait().
+ */
+static inline __attribute__((always_inline)) void HardDiskNVMeEndWait(int Were_Interrupts_Enabled)
+{
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+}
+
+/** Compute a doorbell register address.
+ * @param Doorbell_Index Twice the queue identifier for a submission queue tail doorbell, twice the queue identifier plus one for a completion queue head doorbell.
+ * @return The doorbell address.
+ */
+static volatile unsigned int *HardDiskNVMeGetDoorbell(unsigned int Doorbell_Index)
+{
+	unsigned int Doorbell_Stride;
+	
+	Doorbell_Stride = 4 << HARD_DISK_NVME_GET_CAPABILITIES_DOORBELL_STRIDE(Pointer_Hard_Disk_NVMe_Controller_Registers->Capabilities_High);
+	return (volatile unsigned int *) ((unsigned int) Pointer_Hard_Disk_NVMe_Controller_Registers + 0x1000 + (Doorbell_Index * Doorbell_Stride));
+}
+
+/** Initialize a queue pair state.
+ * @param Pointer_Queue_Pair The queue pair to initialize.
+ * @param Queue_ID The queue pair identifier (0 is the admin queue pair).
+ * @param Pointer_Submission_Queue The submission queue memory.
+ * @param Pointer_Completion_Queue The completion queue memory.
+ * @param Entries_Count How many entries each queue has.
+ */
+static void HardDiskNVMeInitializeQueuePair(THardDiskNVMeQueuePair *Pointer_Queue_Pair, unsigned int Queue_ID, volatile THardDiskNVMeSubmissionQueueEntry *Pointer_Submission_Queue, volatile THardDiskNVMeCompletionQueueEntry *Pointer_Completion_Queue, unsigned int Entries_Count)
+{
+	memset((void *) Pointer_Submission_Queue, 0, Entries_Count * sizeof(THardDiskNVMeSubmissionQueueEntry)); // Explicit cast to avoid warning due to pointer volatile attribute
+	memset((void *) Pointer_Completion_Queue, 0, Entries_Count * sizeof(THardDiskNVMeCompletionQueueEntry)); // The controller posts its first entries with a phase tag set to 1
+	
+	Pointer_Queue_Pair->Pointer_Submission_Queue = Pointer_Submission_Queue;
+	Pointer_Queue_Pair->Pointer_Completion_Queue = Pointer_Completion_Queue;
+	Pointer_Queue_Pair->Pointer_Submission_Queue_Tail_Doorbell = HardDiskNVMeGetDoorbell(2 * Queue_ID);
+	Pointer_Queue_Pair->Pointer_Completion_Queue_Head_Doorbell = HardDiskNVMeGetDoorbell((2 * Queue_ID) + 1);
+	Pointer_Queue_Pair->Entries_Count = Entries_Count;
+	Pointer_Queue_Pair->Submission_Queue_Tail = 0;
+	Pointer_Queue_Pair->Completion_Queue_Head = 0;
+	Pointer_Queue_Pair->Expected_Phase_Tag = HARD_DISK_NVME_BIT_COMPLETION_QUEUE_ENTRY_PHASE_TAG;
+}
+
+/** Get the next submission queue entry and clear it. The controller does not see the entry until the submission queue tail doorbell is written.
+ * @param Pointer_Queue_Pair The queue pair to use.
+ * @return The entry to fill.
+ */
+static volatile THardDiskNVMeSubmissionQueueEntry *HardDiskNVMeAllocateSubmissionQueueEntry(THardDiskNVMeQueuePair *Pointer_Queue_Pair)
+{
+	volatile THardDiskNVMeSubmissionQueueEntry *Pointer_Entry;
+	
+	Pointer_Entry = &Pointer_Queue_Pair->Pointer_Submission_Queue[Pointer_Queue_Pair->Submission_Queue_Tail];
+	memset((void *) Pointer_Entry, 0, sizeof(THardDiskNVMeSubmissionQueueEntry)); // Explicit cast to avoid warning due to pointer volatile attribute
+	
+	Pointer_Queue_Pair->Submission_Queue_Tail++;
+	if (Pointer_Queue_Pair->Submission_Queue_Tail >= Pointer_Queue_Pair->Entries_Count) Pointer_Queue_Pair->Submission_Queue_Tail = 0;
+	return Pointer_Entry;
+}
+
+/** Get the next completion queue entry if the controller posted it.
+ * @param Pointer_Queue_Pair The queue pair to use.
+ * @param Pointer_Entry_Double_Word_3 On output, contain the entry command identifier, phase tag and status.
+ * @return 1 if a new entry was consumed,
+ * @return 0 if there is no new entry.
+ * @note The completion queue head doorbell is not written, so several entries can be released at once.
+ */
+static int HardDiskNVMeConsumeCompletionQueueEntry(THardDiskNVMeQueuePair *Pointer_Queue_Pair, unsigned int *Pointer_Entry_Double_Word_3)
+{
+	unsigned int Double_Word_3;
+	
+	Double_Word_3 = Pointer_Queue_Pair->Pointer_Completion_Queue[Pointer_Queue_Pair->Completion_Queue_Head].Command_Identifier_Phase_And_Status;
+	if ((Double_Word_3 & HARD_DISK_NVME_BIT_COMPLETION_QUEUE_ENTRY_PHASE_TAG) != Pointer_Queue_Pair->Expected_Phase_Tag) return 0;
+	
+	Pointer_Queue_Pair->Completion_Queue_Head++;
+	if (Pointer_Queue_Pair->Completion_Queue_Head >= Pointer_Queue_Pair->Entries_Count)
+	{
+		Pointer_Queue_Pair->Completion_Queue_Head = 0;
+		Pointer_Queue_Pair->Expected_Phase_Tag ^= HARD_DISK_NVME_BIT_COMPLETION_QUEUE_ENTRY_PHASE_TAG;
+	}
+	
+	*Pointer_Entry_Double_Word_3 = Double_Word_3;
+	return 1;
+}
+
+/** Tell whether the controller posted a completion queue entry that has not been consumed yet.
+ * @param Pointer_Queue_Pair The queue pair to check.
+ * @return 1 if a completion is pending, 0 if not.
+ */
+static inline __attribute__((always_inline)) int HardDiskNVMeIsCompletionPending(THardDiskNVMeQueuePair *Pointer_Queue_Pair)
+{
+	return (Pointer_Queue_Pair->Pointer_Completion_Queue[Pointer_Queue_Pair->Completion_Queue_Head].Command_Identifier_Phase_And_Status & HARD_DISK_NVME_BIT_COMPLETION_QUEUE_ENTRY_PHASE_TAG) == Pointer_Queue_Pair->Expected_Phase_Tag;
+}
+
+/** Execute an admin command and poll for its completion.
+ * @param Opcode The command opcode.
+ * @param Namespace_Identifier The namespace the command applies to, 0 if not relevant.
+ * @param Data_Address The command data page address, 0 if the command has no data.
+ * @param Command_Double_Word_10 The command-specific double word 10.
+ * @param Command_Double_Word_11 The command-specific double word 11.
+ * @return The command status field, 0 means success.
+ */
+static unsigned int HardDiskNVMeExecuteAdminCommand(unsigned char Opcode, unsigned int Namespace_Identifier, unsigned int Data_Address, unsigned int Command_Double_Word_10, unsigned int Command_Double_Word_11)
+{
+	volatile THardDiskNVMeSubmissionQueueEntry *Pointer_Entry;
+	unsigned int Double_Word_3;
+	
+	// Fill the command
+	Pointer_Entry = HardDiskNVMeAllocateSubmissionQueueEntry(&Hard_Disk_NVMe_Admin_Queue_Pair);
+	Pointer_Entry->Opcode = Opcode;
+	Pointer_Entry->Namespace_Identifier = Namespace_Identifier;
+	Pointer_Entry->PRP_Entry_1 = Data_Address;
+	Pointer_Entry->Command_Specific[0] = Command_Double_Word_10;
+	Pointer_Entry->Command_Specific[1] = Command_Double_Word_11;
+	
+	// Start executing the command
+	*Hard_Disk_NVMe_Admin_Queue_Pair.Pointer_Submission_Queue_Tail_Doorbell = Hard_Disk_NVMe_Admin_Queue_Pair.Submission_Queue_Tail;
+	
+	// Wait for command completion (the admin commands are only used during the initialization, so polling is enough)
+	while (!HardDiskNVMeConsumeCompletionQueueEntry(&Hard_Disk_NVMe_Admin_Queue_Pair, &Double_Word_3));
+	*Hard_Disk_NVMe_Admin_Queue_Pair.Pointer_Completion_Queue_Head_Doorbell = Hard_Disk_NVMe_Admin_Queue_Pair.Completion_Queue_Head;
+	
+	return HARD_DISK_NVME_GET_COMPLETION_QUEUE_ENTRY_STATUS(Double_Word_3);
+}
+
+/** Fill an I/O command and describe its data buffer with PRP entries. The controller is not notified.
+ * @param Slot_Index The slot to use, it is also the command identifier.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first LBA sector to access.
+ * @param Pointer_Buffer The data buffer, it must be double word-aligned.
+ * @param Bytes_Count The data size, it can't exceed Hard_Disk_NVMe_Maximum_Bytes_Per_Command.
+ */
+static void HardDiskNVMePostCommand(unsigned int Slot_Index, int Is_Write_Operation, unsigned int Logical_Sector_Number, void *Pointer_Buffer, unsigned int Bytes_Count)
+{
+	volatile THardDiskNVMeSubmissionQueueEntry *Pointer_Entry;
+	unsigned int Data_Address = (unsigned int) Pointer_Buffer, First_Page_Bytes_Count, Entries_Count = 0;
+	
+	Pointer_Entry = HardDiskNVMeAllocateSubmissionQueueEntry(&Hard_Disk_NVMe_IO_Queue_Pair);
+	if (Is_Write_Operation) Pointer_Entry->Opcode = HARD_DISK_NVME_COMMAND_WRITE;
+	else Pointer_Entry->Opcode = HARD_DISK_NVME_COMMAND_READ;
+	Pointer_Entry->Command_Identifier = Slot_Index;
+	Pointer_Entry->Namespace_Identifier = HARD_DISK_NVME_NAMESPACE_ID;
+	Pointer_Entry->Command_Specific[0] = Logical_Sector_Number; // Starting LBA low double word, the high double word is always 0 as the addresses are 32-bit long
+	Pointer_Entry->Command_Specific[2] = (Bytes_Count / HARD_DISK_SECTOR_SIZE) - 1; // The Number of Logical Blocks field is zero-based
+	
+	Hard_Disk_NVMe_Slots_Start_Timestamp[Slot_Index] = HardDiskStatisticsGetTimestamp();
+	Hard_Disk_NVMe_Slots_Sectors_Count[Slot_Index] = Bytes_Count / HARD_DISK_SECTOR_SIZE;
+	
+	// The first PRP entry describes the data up to the end of its page (the kernel memory is not paged, so the buffer is physically contiguous)
+	Pointer_Entry->PRP_Entry_1 = Data_Address;
+	First_Page_Bytes_Count = HARD_DISK_NVME_PAGE_SIZE - (Data_Address & (HARD_DISK_NVME_PAGE_SIZE - 1));
+	if (Bytes_Count <= First_Page_Bytes_Count) return;
+	Data_Address += First_Page_Bytes_Count;
+	Bytes_Count -= First_Page_Bytes_Count;
+	
+	// The second PRP entry directly describes the second page if there is no more data
+	if (Bytes_Count <= HARD_DISK_NVME_PAGE_SIZE)
+	{
+		Pointer_Entry->PRP_Entry_2 = Data_Address;
+		return;
+	}
+	
+	// Otherwise it points to the PRP List, which describes all the following pages
+	while (1)
+	{
+		Hard_Disk_NVMe_PRP_Lists[Slot_Index][Entries_Count] = Data_Address;
+		Entries_Count++;
+		
+		if (Bytes_Count <= HARD_DISK_NVME_PAGE_SIZE) break;
+		Data_Address += HARD_DISK_NVME_PAGE_SIZE;
+		Bytes_Count -= HARD_DISK_NVME_PAGE_SIZE;
+	}
+	Pointer_Entry->PRP_Entry_2 = (unsigned int) Hard_Disk_NVMe_PRP_Lists[Slot_Index];
+}
+
+/** Execute several requests of the same kind, keeping the I/O submission queue as full as possible.
+ * @param Is_Write_Operation Set to 1 to write the requests data, set to 0 to read it.
+ * @param Pointer_Requests The requests to execute, all buffers must be double word-aligned.
+ * @param Requests_Count How many requests to execute.
+ */
+static void HardDiskNVMeExecuteAlignedRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
+{
+	unsigned int i = 0, Free_Slots_Mask, Outstanding_Slots_Count = 0, Posted_Slots_Count, Slot_Index, Bytes_Count = 0, Command_Bytes_Count, Logical_Sector_Number = 0, Double_Word_3;
+	unsigned char *Pointer_Buffer = NULL;
+	int Were_Interrupts_Enabled, Is_Error_Detected = 0;
+	
+	// All slots are available
+	if (Hard_Disk_NVMe_Slots_Count == HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT) Free_Slots_Mask = 0xFFFFFFFF;
+	else Free_Slots_Mask = (1 << Hard_Disk_NVMe_Slots_Count) - 1;
+	
+	while (1)
+	{
+		// Fill the free slots
+		Posted_Slots_Count = 0;
+		while (Free_Slots_Mask != 0)
+		{
+			// Go to the next request when the current one has been fully posted
+			if (Bytes_Count == 0)
+			{
+				if (i >= Requests_Count) break;
+				Logical_Sector_Number = Pointer_Requests[i].Logical_Sector_Number;
+				Bytes_Count = Pointer_Requests[i].Sectors_Count * HARD_DISK_SECTOR_SIZE;
+				Pointer_Buffer = Pointer_Requests[i].Pointer_Buffer;
+				i++;
+				continue;
+			}
+			
+			// Find a free slot
+			Slot_Index = 0;
+			while (!(Free_Slots_Mask & (1 << Slot_Index))) Slot_Index++;
+			
+			// Split the request if it is too big for a single command
+			if (Bytes_Count > Hard_Disk_NVMe_Maximum_Bytes_Per_Command) Command_Bytes_Count = Hard_Disk_NVMe_Maximum_Bytes_Per_Command;
+			else Command_Bytes_Count = Bytes_Count;
+			
+			HardDiskNVMePostCommand(Slot_Index, Is_Write_Operation, Logical_Sector_Number, Pointer_Buffer, Command_Bytes_Count);
+			Free_Slots_Mask &= ~(1 << Slot_Index);
+			Posted_Slots_Count++;
+			
+			Logical_Sector_Number += Command_Bytes_Count / HARD_DISK_SECTOR_SIZE;
+			Pointer_Buffer += Command_Bytes_Count;
+			Bytes_Count -= Command_Bytes_Count;
+		}
+		
+		// Ring the submission queue doorbell only once for all the posted commands
+		if (Posted_Slots_Count > 0) *Hard_Disk_NVMe_IO_Queue_Pair.Pointer_Submission_Queue_Tail_Doorbell = Hard_Disk_NVMe_IO_Queue_Pair.Submission_Queue_Tail;
+		Outstanding_Slots_Count += Posted_Slots_Count;
+		
+		// Exit when all commands are completed
+		if (Outstanding_Slots_Count == 0) break;
+		
+		// Wait for at least one command completion
+		Were_Interrupts_Enabled = HardDiskNVMeBeginWait();
+		while (!HardDiskNVMeIsCompletionPending(&Hard_Disk_NVMe_IO_Queue_Pair)) HardDiskNVMeWaitForInterrupt(Were_Interrupts_Enabled);
+		HardDiskNVMeEndWait(Were_Interrupts_Enabled);
+		
+		// Release all the completed slots, then ring the completion queue doorbell only once
+		while (HardDiskNVMeConsumeCompletionQueueEntry(&Hard_Disk_NVMe_IO_Queue_Pair, &Double_Word_3))
+		{
+			Slot_Index = Double_Word_3 & 0xFFFF;
+			if (HARD_DISK_NVME_GET_COMPLETION_QUEUE_ENTRY_STATUS(Double_Word_3) != 0)
+			{
+				HardDiskStatisticsRecordTransfer(Is_Write_Operation, Hard_Disk_NVMe_Slots_Sectors_Count[Slot_Index], Hard_Disk_NVMe_Slots_Start_Timestamp[Slot_Index], 1);
+				Is_Error_Detected = 1;
+			}
+			else HardDiskStatisticsRecordTransfer(Is_Write_Operation, Hard_Disk_NVMe_Slots_Sectors_Count[Slot_Index], Hard_Disk_NVMe_Slots_Start_Timestamp[Slot_Index], 0);
+			
+			Free_Slots_Mask |= 1 << Slot_Index;
+			Outstanding_Slots_Count--;
+		}
+		*Hard_Disk_NVMe_IO_Queue_Pair.Pointer_Completion_Queue_Head_Doorbell = Hard_Disk_NVMe_IO_Queue_Pair.Completion_Queue_Head;
+	}
+	
+	// Was a command unsuccessful ?
+	if (Is_Error_Detected)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_NVME_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
+/** Read or write consecutive sectors from or to a buffer that is not double word-aligned, bouncing each sector through the driver buffer.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Pointer_Request The request to execute.
+ */
+static void HardDiskNVMeExecuteUnalignedRequest(int Is_Write_Operation, THardDiskRequest *Pointer_Request)
+{
+	THardDiskRequest Sector_Request;
+	unsigned int i;
+	unsigned char *Pointer_Buffer = Pointer_Request->Pointer_Buffer;
+	
+	Sector_Request.Sectors_Count = 1;
+	Sector_Request.Pointer_Buffer = (void *) Hard_Disk_NVMe_Buffer; // Explicit cast to avoid warning due to pointer volatile attribute
+	
+	for (i = 0; i < Pointer_Request->Sectors_Count; i++)
+	{
+		Sector_Request.Logical_Sector_Number = Pointer_Request->Logical_Sector_Number + i;
+		
+		if (Is_Write_Operation)
+		{
+			memcpy((void *) Hard_Disk_NVMe_Buffer, Pointer_Buffer, HARD_DISK_SECTOR_SIZE); // Explicit cast to avoid warning due to pointer volatile attribute
+			HardDiskNVMeExecuteAlignedRequests(1, &Sector_Request, 1);
+		}
+		else
+		{
+			HardDiskNVMeExecuteAlignedRequests(0, &Sector_Request, 1);
+			memcpy(Pointer_Buffer, (void *) Hard_Disk_NVMe_Buffer, HARD_DISK_SECTOR_SIZE); // Explicit cast to avoid warning due to pointer volatile attribute
+		}
+		
+		Pointer_Buffer += HARD_DISK_SECTOR_SIZE;
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int HardDiskInitialize(void)
+{
+	TPCIDeviceID NVMe_Device_ID;
+	TPCIConfigurationSpaceHeader Device_Configuration_Space_Header;
+	unsigned int Temp_Double_Word, Entries_Count, Interrupts_Enabled_Flag = 0;
+	unsigned char LBA_Format_Index;
+	
+	// Find the NVMe controller on the PCI bus
+	if (PCIFindDeviceFromClass(PCI_CLASS_CODE_BASE_MASS_STORAGE, PCI_CLASS_CODE_SUB_CLASS_NON_VOLATILE_MEMORY, &NVMe_Device_ID) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : no NVMe controller found.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	// Get the NVMe controller properties
+	if (PCIGetConfigurationSpaceHeader(&NVMe_Device_ID, &Device_Configuration_Space_Header) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to get the NVMe controller Configuration Space Header.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("NVMe controller found.\nVendor ID : 0x");
+		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Vendor_ID);
+		ScreenWriteString(", device ID : 0x");
+		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Device_ID);
+		ScreenWriteString(", BAR[0] : 0x");
+		DebugWriteHexadecimalInteger(PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[0]));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	// The registers are reachable only if the firmware mapped them in the first 4 GB (BAR 1 holds the upper address bits of a 64-bit BAR 0)
+	if ((((Device_Configuration_Space_Header.Base_Address_Registers[0] >> 1) & 0x03) == 2) && (Device_Configuration_Space_Header.Base_Address_Registers[1] != 0))
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : the controller registers are located above 4 GB.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	Pointer_Hard_Disk_NVMe_Controller_Registers = (THardDiskNVMeControllerRegisters *) PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[0]);
+	
+	// The controller reads and writes the queues and the data buffers by itself
+	PCIEnableBusMastering(&NVMe_Device_ID);
+	
+	// The driver always uses 4 KB memory pages
+	if (HARD_DISK_NVME_GET_CAPABILITIES_MEMORY_PAGE_SIZE_MINIMUM(Pointer_Hard_Disk_NVMe_Controller_Registers->Capabilities_High) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : the controller does not support 4 KB memory pages.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	// Disable the controller to be able to configure the admin queues
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Controller_Configuration &= ~HARD_DISK_NVME_BIT_CONTROLLER_CONFIGURATION_ENABLE;
+	while (Pointer_Hard_Disk_NVMe_Controller_Registers->Controller_Status & HARD_DISK_NVME_BIT_CONTROLLER_STATUS_READY);
+	
+	// Configure the admin queues
+	HardDiskNVMeInitializeQueuePair(&Hard_Disk_NVMe_Admin_Queue_Pair, 0, Hard_Disk_NVMe_Admin_Submission_Queue, Hard_Disk_NVMe_Admin_Completion_Queue, HARD_DISK_NVME_ADMIN_QUEUE_ENTRIES_COUNT);
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Admin_Queue_Attributes = ((HARD_DISK_NVME_ADMIN_QUEUE_ENTRIES_COUNT - 1) << 16) | (HARD_DISK_NVME_ADMIN_QUEUE_ENTRIES_COUNT - 1); // The sizes are zero-based
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Admin_Submission_Queue_Base_Address = (unsigned int) Hard_Disk_NVMe_Admin_Submission_Queue;
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Admin_Submission_Queue_Base_Address_High_Double_Word = 0;
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Admin_Completion_Queue_Base_Address = (unsigned int) Hard_Disk_NVMe_Admin_Completion_Queue;
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Admin_Completion_Queue_Base_Address_High_Double_Word = 0;
+	
+	// Enable the controller with the NVM command set, 4 KB memory pages and the standard I/O queue entries sizes
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Controller_Configuration = HARD_DISK_NVME_CONTROLLER_CONFIGURATION_IO_SUBMISSION_QUEUE_ENTRY_SIZE | HARD_DISK_NVME_CONTROLLER_CONFIGURATION_IO_COMPLETION_QUEUE_ENTRY_SIZE | HARD_DISK_NVME_BIT_CONTROLLER_CONFIGURATION_ENABLE;
+	while (1)
+	{
+		Temp_Double_Word = Pointer_Hard_Disk_NVMe_Controller_Registers->Controller_Status;
+		if (Temp_Double_Word & HARD_DISK_NVME_BIT_CONTROLLER_STATUS_FATAL_STATUS)
+		{
+			DEBUG_SECTION_START
+				DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+				ScreenWriteString("Error : the controller failed to start.\n");
+				KeyboardReadCharacter();
+			DEBUG_SECTION_END
+			return 2;
+		}
+		if (Temp_Double_Word & HARD_DISK_NVME_BIT_CONTROLLER_STATUS_READY) break;
+	}
+	
+	// Keep the interrupt masked while nobody waits for it, the interrupt line stays asserted until the completions are consumed
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Interrupt_Mask_Set = 1;
+	
+	// Get the controller maximum transfer size
+	if (HardDiskNVMeExecuteAdminCommand(HARD_DISK_NVME_ADMIN_COMMAND_IDENTIFY, 0, (unsigned int) Hard_Disk_NVMe_Identify_Buffer, HARD_DISK_NVME_IDENTIFY_CONTROLLER, 0) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to identify the controller.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	Hard_Disk_NVMe_Maximum_Bytes_Per_Command = HARD_DISK_NVME_PRP_LIST_ENTRIES_COUNT * HARD_DISK_NVME_PAGE_SIZE; // The PRP List size also limits the transfer size
+	Temp_Double_Word = Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_IDENTIFY_CONTROLLER_OFFSET_MAXIMUM_DATA_TRANSFER_SIZE];
+	if ((Temp_Double_Word != 0) && (Temp_Double_Word < 20) && (((unsigned int) HARD_DISK_NVME_PAGE_SIZE << Temp_Double_Word) < Hard_Disk_NVMe_Maximum_Bytes_Per_Command)) Hard_Disk_NVMe_Maximum_Bytes_Per_Command = HARD_DISK_NVME_PAGE_SIZE << Temp_Double_Word;
+	
+	// The write cache initial state is vendor-specific, consider it enabled until the kernel configures it so no flush is skipped
+	if (Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_IDENTIFY_CONTROLLER_OFFSET_VOLATILE_WRITE_CACHE] & 0x01)
+	{
+		Hard_Disk_NVMe_Is_Write_Cache_Supported = 1;
+		Hard_Disk_NVMe_Is_Write_Cache_Enabled = 1;
+	}
+	
+	// Get the namespace size and make sure its sectors are 512-byte long
+	if (HardDiskNVMeExecuteAdminCommand(HARD_DISK_NVME_ADMIN_COMMAND_IDENTIFY, HARD_DISK_NVME_NAMESPACE_ID, (unsigned int) Hard_Disk_NVMe_Identify_Buffer, HARD_DISK_NVME_IDENTIFY_NAMESPACE, 0) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to identify the namespace.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	LBA_Format_Index = Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_FORMATTED_LBA_SIZE] & 0x0F;
+	if ((1 << Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_LBA_FORMATS + (LBA_Format_Index * 4) + 2]) != HARD_DISK_SECTOR_SIZE) // The LBA Data Size field is a power of two
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : the namespace is not formatted with 512-byte sectors.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 1;
+	}
+	// The sector numbers are 32-bit long, so only the first 2 TB of a bigger namespace can be used
+	if (*((unsigned int *) &Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_SIZE + 4]) != 0) Hard_Disk_NVMe_Sectors_Count = 0xFFFFFFFF;
+	else Hard_Disk_NVMe_Sectors_Count = *((unsigned int *) &Hard_Disk_NVMe_Identify_Buffer[HARD_DISK_NVME_IDENTIFY_NAMESPACE_OFFSET_SIZE]);
+	
+	// Use the biggest I/O queues the controller allows (the Maximum Queue Entries Supported field is zero-based)
+	Entries_Count = (Pointer_Hard_Disk_NVMe_Controller_Registers->Capabilities_Low & 0xFFFF) + 1;
+	if (Entries_Count > HARD_DISK_NVME_IO_QUEUE_MAXIMUM_ENTRIES_COUNT) Entries_Count = HARD_DISK_NVME_IO_QUEUE_MAXIMUM_ENTRIES_COUNT;
+	// A queue is full when only one entry is free, so keep as many commands in flight as the queue can hold
+	Hard_Disk_NVMe_Slots_Count = Entries_Count - 1;
+	if (Hard_Disk_NVMe_Slots_Count > HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT) Hard_Disk_NVMe_Slots_Count = HARD_DISK_NVME_MAXIMUM_SLOTS_COUNT;
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("I/O queues entries count : ");
+		ScreenWriteString(itoa(Entries_Count));
+		ScreenWriteString(", maximum bytes per command : ");
+		ScreenWriteString(itoa(Hard_Disk_NVMe_Maximum_Bytes_Per_Command));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	// Route the controller interrupt to the processor if the firmware assigned a legacy interrupt line to it (lines 0 to 2 are used by the timer, the keyboard and the PIC cascade)
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Interrupt line : ");
+		ScreenWriteString(itoa(Device_Configuration_Space_Header.Interrupt_Line));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	if ((Device_Configuration_Space_Header.Interrupt_Line >= 3) && (Device_Configuration_Space_Header.Interrupt_Line <= 15))
+	{
+		ArchitectureInstallHardDiskInterruptHandler(Device_Configuration_Space_Header.Interrupt_Line);
+		Interrupts_Enabled_Flag = HARD_DISK_NVME_BIT_CREATE_QUEUE_INTERRUPTS_ENABLED;
+		Hard_Disk_NVMe_Is_Interrupt_Available = 1;
+	}
+	else
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("No usable interrupt line, the driver will poll the controller.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+	}
+	
+	// Request a single I/O queue pair (the values are zero-based), the kernel has only one processor to submit commands from
+	if (HardDiskNVMeExecuteAdminCommand(HARD_DISK_NVME_ADMIN_COMMAND_SET_FEATURES, 0, 0, HARD_DISK_NVME_FEATURE_NUMBER_OF_QUEUES, 0) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to set the I/O queues count.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	// Create the I/O completion queue first, as the submission queue is bound to it
+	HardDiskNVMeInitializeQueuePair(&Hard_Disk_NVMe_IO_Queue_Pair, HARD_DISK_NVME_IO_QUEUE_ID, Hard_Disk_NVMe_IO_Submission_Queue, Hard_Disk_NVMe_IO_Completion_Queue, Entries_Count);
+	if (HardDiskNVMeExecuteAdminCommand(HARD_DISK_NVME_ADMIN_COMMAND_CREATE_IO_COMPLETION_QUEUE, 0, (unsigned int) Hard_Disk_NVMe_IO_Completion_Queue, ((Entries_Count - 1) << 16) | HARD_DISK_NVME_IO_QUEUE_ID, Interrupts_Enabled_Flag | HARD_DISK_NVME_BIT_CREATE_QUEUE_PHYSICALLY_CONTIGUOUS) != 0) // Use the interrupt vector 0, the only one available without MSI
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to create the I/O completion queue.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	if (HardDiskNVMeExecuteAdminCommand(HARD_DISK_NVME_ADMIN_COMMAND_CREATE_IO_SUBMISSION_QUEUE, 0, (unsigned int) Hard_Disk_NVMe_IO_Submission_Queue, ((Entries_Count - 1) << 16) | HARD_DISK_NVME_IO_QUEUE_ID, (HARD_DISK_NVME_IO_QUEUE_ID << 16) | HARD_DISK_NVME_BIT_CREATE_QUEUE_PHYSICALLY_CONTIGUOUS) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to create the I/O submission queue.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Driver successfully initialized.\n");
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	return 0;
+}
+
+void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	HardDiskReadSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	HardDiskWriteSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	THardDiskRequest Request;
+	
+	Request.Logical_Sector_Number = Logical_Sector_Number;
+	Request.Sectors_Count = Sectors_Count;
+	Request.Pointer_Buffer = Pointer_Buffer;
+	HardDiskExecuteRequests(0, &Request, 1);
+}
+
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	THardDiskRequest Request;
+	
+	Request.Logical_Sector_Number = Logical_Sector_Number;
+	Request.Sectors_Count = Sectors_Count;
+	Request.Pointer_Buffer = Pointer_Buffer;
+	HardDiskExecuteRequests(1, &Request, 1);
+}
+
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
+{
+	unsigned int i;
+	
+	// The PRP entries must be double word-aligned, so execute the requests one by one if a buffer does not satisfy this constraint
+	for (i = 0; i < Requests_Count; i++)
+	{
+		if ((unsigned int) Pointer_Requests[i].Pointer_Buffer & 3) break;
+	}
+	if (i == Requests_Count)
+	{
+		HardDiskNVMeExecuteAlignedRequests(Is_Write_Operation, Pointer_Requests, Requests_Count);
+		return;
+	}
+	
+	for (i = 0; i < Requests_Count; i++)
+	{
+		if ((unsigned int) Pointer_Requests[i].Pointer_Buffer & 3) HardDiskNVMeExecuteUnalignedRequest(Is_Write_Operation, &Pointer_Requests[i]);
+		else HardDiskNVMeExecuteAlignedRequests(Is_Write_Operation, &Pointer_Requests[i], 1);
+	}
+}
+
+void HardDiskFlushCache(void)
+{
+	volatile THardDiskNVMeSubmissionQueueEntry *Pointer_Entry;
+	unsigned int Double_Word_3;
+	int Were_Interrupts_Enabled, Is_Error = 0;
+	unsigned long long Start_Timestamp;
+	
+	if (!Hard_Disk_NVMe_Is_Write_Cache_Enabled) return;
+	
+	// All I/O commands are completed when this function is called, so the flush can use any command identifier
+	Pointer_Entry = HardDiskNVMeAllocateSubmissionQueueEntry(&Hard_Disk_NVMe_IO_Queue_Pair);
+	Pointer_Entry->Opcode = HARD_DISK_NVME_COMMAND_FLUSH;
+	Pointer_Entry->Namespace_Identifier = HARD_DISK_NVME_NAMESPACE_ID;
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	*Hard_Disk_NVMe_IO_Queue_Pair.Pointer_Submission_Queue_Tail_Doorbell = Hard_Disk_NVMe_IO_Queue_Pair.Submission_Queue_Tail;
+	
+	// Wait for the controller to write the whole cache content
+	Were_Interrupts_Enabled = HardDiskNVMeBeginWait();
+	while (!HardDiskNVMeIsCompletionPending(&Hard_Disk_NVMe_IO_Queue_Pair)) HardDiskNVMeWaitForInterrupt(Were_Interrupts_Enabled);
+	HardDiskNVMeEndWait(Were_Interrupts_Enabled);
+	HardDiskNVMeConsumeCompletionQueueEntry(&Hard_Disk_NVMe_IO_Queue_Pair, &Double_Word_3);
+	*Hard_Disk_NVMe_IO_Queue_Pair.Pointer_Completion_Queue_Head_Doorbell = Hard_Disk_NVMe_IO_Queue_Pair.Completion_Queue_Head;
+	
+	if (HARD_DISK_NVME_GET_COMPLETION_QUEUE_ENTRY_STATUS(Double_Word_3) != 0) Is_Error = 1;
+	HardDiskStatisticsRecordFlush(Start_Timestamp, Is_Error);
+	
+	if (Is_Error)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_NVME_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
+int HardDiskSetWriteCacheEnabled(int Is_Enabled)
+{
+	if (!Hard_Disk_NVMe_Is_Write_Cache_Supported) return 1;
+	
+	if (Is_Enabled) Is_Enabled = 1;
+	else HardDiskFlushCache(); // Do not lose the cached data
+	
+	if (HardDiskNVMeExecuteAdminCommand(HARD_DISK_NVME_ADMIN_COMMAND_SET_FEATURES, 0, 0, HARD_DISK_NVME_FEATURE_VOLATILE_WRITE_CACHE, Is_Enabled) != 0) return 1;
+	Hard_Disk_NVMe_Is_Write_Cache_Enabled = Is_Enabled;
+	return 0;
+}
+
+int HardDiskIsWriteCacheEnabled(void)
+{
+	return Hard_Disk_NVMe_Is_Write_Cache_Enabled;
+}
+
+void *HardDiskMapSector(unsigned int __attribute__((unused)) Logical_Sector_Number)
+{
+	// The data can only be reached through the controller
+	return NULL;
+}
+
+unsigned int HardDiskGetDriveSizeSectors(void)
+{
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Total sectors count : ");
+		ScreenWriteString(itoa(Hard_Disk_NVMe_Sectors_Count));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	return Hard_Disk_NVMe_Sectors_Count;
+}
+
+void HardDiskInterruptHandler(void)
+{
+	// Mask the interrupt vector so the controller stops asserting its interrupt line, the waiting code consumes the completions and unmasks the vector when it needs to wait again
+	Pointer_Hard_Disk_NVMe_Controller_Registers->Interrupt_Mask_Set = 1;
+}
@@ -2,9 +2,11 @@
  * Simulate a hard disk storage by reading and writing a RAM area.
  * @author Adrien RICCIARDI
  */
+#include <Architecture.h>
 #include <Configuration.h>
 #include <Debug.h>
 #include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
 #include <Error_Codes.h>
 #include <File_System/File.h>
 #include <File_System/File_System.h>
@@ -14,8 +16,8 @@
 //-------------------------------------------------------------------------------------------------
 // Private constants
 //-------------------------------------------------------------------------------------------------
-/** Put the RAM disk area right after the user space area. */
-#define HARD_DISK_RAM_DISK_MEMORY_AREA_ADDRESS (CONFIGURATION_USER_SPACE_ADDRESS + CONFIGURATION_USER_SPACE_SIZE)
+/** The RAM disk area can't start before the user space area end. */
+#define HARD_DISK_RAM_DISK_MEMORY_AREA_MINIMUM_ADDRESS (CONFIGURATION_USER_SPACE_ADDRESS + CONFIGURATION_USER_SPACE_SIZE)
 
 //-------------------------------------------------------------------------------------------------
 // Private variables
@@ -24,7 +26,7 @@
 static unsigned int Hard_Disk_RAM_Disk_File_System_Total_Size_Sectors;
 
 /** The memory area itself. */
-static unsigned char *Pointer_Memory_Area = (unsigned char *) HARD_DISK_RAM_DISK_MEMORY_AREA_ADDRESS;
+static unsigned char *Pointer_Memory_Area;
 
 //-------------------------------------------------------------------------------------------------
 // Private functions
@@ -59,21 +61,52 @@ static int HardDiskRAMDiskInstallFiles(void)
 //-------------------------------------------------------------------------------------------------
 int HardDiskInitialize(void)
 {
-	// Compute the file system size in blocks (Files List size + Blocks list size + data blocks size)
-	Hard_Disk_RAM_Disk_File_System_Total_Size_Sectors = FileSystemComputeSizeSectors(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES);
+	unsigned int Memory_Area_Address, Memory_Area_Size_Bytes, Available_Sectors_Count, Blocks_Count, Files_Count;
+	
+	// Use the biggest free RAM area the BIOS reported above the kernel and user space areas
+	Memory_Area_Address = ArchitectureFindBiggestFreeMemoryArea(HARD_DISK_RAM_DISK_MEMORY_AREA_MINIMUM_ADDRESS, &Memory_Area_Size_Bytes);
+	if (Memory_Area_Address == 0)
+	{
+		// Without memory map, assume that the RAM right after user space is big enough for the biggest file system the kernel can mount
+		Memory_Area_Address = HARD_DISK_RAM_DISK_MEMORY_AREA_MINIMUM_ADDRESS;
+		Available_Sectors_Count = FileSystemComputeSizeSectors(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES);
+	}
+	else Available_Sectors_Count = Memory_Area_Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES;
+	Pointer_Memory_Area = (unsigned char *) Memory_Area_Address;
+	
+	// Fill the area with as many blocks as the kernel can mount, the file system structures need some room too
+	Blocks_Count = Available_Sectors_Count / (CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES / FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	if (Blocks_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES) Blocks_Count = CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES;
+	while (1)
+	{
+		if (Blocks_Count == 0) return 3;
+		
+		// A file needs at least one block
+		Files_Count = CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES;
+		if (Files_Count > Blocks_Count) Files_Count = Blocks_Count;
+		
+		// Compute the file system size in sectors (Files List size + Blocks list size + data blocks size)
+		Hard_Disk_RAM_Disk_File_System_Total_Size_Sectors = FileSystemComputeSizeSectors(Blocks_Count, Files_Count, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES);
+		if (Hard_Disk_RAM_Disk_File_System_Total_Size_Sectors <= Available_Sectors_Count) break;
+		Blocks_Count--;
+	}
 	
 	DEBUG_SECTION_START
 		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
 		ScreenWriteString("RAM disk memory area : 0x");
-		DebugWriteHexadecimalInteger(HARD_DISK_RAM_DISK_MEMORY_AREA_ADDRESS);
+		DebugWriteHexadecimalInteger(Memory_Area_Address);
 		ScreenWriteString("\nRAM disk sectors count : ");
 		ScreenWriteString(itoa(Hard_Disk_RAM_Disk_File_System_Total_Size_Sectors));
+		ScreenWriteString(", blocks count : ");
+		ScreenWriteString(itoa(Blocks_Count));
+		ScreenWriteString(", files count : ");
+		ScreenWriteString(itoa(Files_Count));
 		ScreenWriteCharacter('\n');
 		KeyboardReadCharacter();
 	DEBUG_SECTION_END
 	
 	// Create the file system in RAM
-	if (FileSystemCreate(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES, 0) != ERROR_CODE_NO_ERROR) return 3;
+	if (FileSystemCreate(Blocks_Count, Files_Count, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES, 0) != ERROR_CODE_NO_ERROR) return 3;
 	
 	// Load file system
 	if (!FileSystemInitialize(0)) return 4;
@@ -86,12 +119,63 @@ int HardDiskInitialize(void)
 
 void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
 {
-	memcpy(Pointer_Buffer, &Pointer_Memory_Area[Logical_Sector_Number * FILE_SYSTEM_SECTOR_SIZE_BYTES], FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	HardDiskReadSectors(Logical_Sector_Number, 1, Pointer_Buffer);
 }
 
 void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
 {
-	memcpy(&Pointer_Memory_Area[Logical_Sector_Number * FILE_SYSTEM_SECTOR_SIZE_BYTES], Pointer_Buffer, FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	HardDiskWriteSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned long long Start_Timestamp;
+	
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	memcpy(Pointer_Buffer, &Pointer_Memory_Area[Logical_Sector_Number * FILE_SYSTEM_SECTOR_SIZE_BYTES], Sectors_Count * FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	HardDiskStatisticsRecordTransfer(0, Sectors_Count, Start_Timestamp, 0);
+}
+
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned long long Start_Timestamp;
+	
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	memcpy(&Pointer_Memory_Area[Logical_Sector_Number * FILE_SYSTEM_SECTOR_SIZE_BYTES], Pointer_Buffer, Sectors_Count * FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	HardDiskStatisticsRecordTransfer(1, Sectors_Count, Start_Timestamp, 0);
+}
+
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
+{
+	unsigned int i;
+	
+	for (i = 0; i < Requests_Count; i++)
+	{
+		if (Is_Write_Operation) HardDiskWriteSectors(Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+		else HardDiskReadSectors(Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+	}
+}
+
+void HardDiskFlushCache(void)
+{
+	// The data are written to the memory right away
+}
+
+int HardDiskSetWriteCacheEnabled(int Is_Enabled)
+{
+	// There is no cache to enable
+	if (Is_Enabled) return 1;
+	return 0;
+}
+
+int HardDiskIsWriteCacheEnabled(void)
+{
+	return 0;
+}
+
+void *HardDiskMapSector(unsigned int Logical_Sector_Number)
+{
+	return &Pointer_Memory_Area[Logical_Sector_Number * FILE_SYSTEM_SECTOR_SIZE_BYTES];
 }
 
 unsigned int HardDiskGetDriveSizeSectors(void)
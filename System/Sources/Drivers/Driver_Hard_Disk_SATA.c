@@ -2,9 +2,11 @@
  * AHCI SATA hard disk driver. This driver is based on Serial ATA AHCI 1.0 Specification and Serial ATA Revision 3.0.
  * @author Adrien RICCIARDI
  */
+#include <Architecture.h>
 #include <Configuration.h>
 #include <Debug.h>
 #include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
 #include <Drivers/Driver_PCI.h>
 #include <Standard_Functions.h>
 #include <Strings.h>
@@ -17,10 +19,38 @@
 
 /** The ATA "IDENTIFY DEVICE" command. */
 #define HARD_DISK_SATA_COMMAND_IDENTIFY_DEVICE 0xEC
+/** The ATA "READ DMA" command. */
+#define HARD_DISK_SATA_COMMAND_READ_DMA 0xC8
+/** The ATA "WRITE DMA" command. */
+#define HARD_DISK_SATA_COMMAND_WRITE_DMA 0xCA
 /** The ATA "READ DMA EXT" command. */
 #define HARD_DISK_SATA_COMMAND_READ_DMA_EXTENDED 0x25
 /** The ATA "WRITE DMA EXT" command. */
 #define HARD_DISK_SATA_COMMAND_WRITE_DMA_EXTENDED 0x35
+/** The ATA "READ FPDMA QUEUED" command. */
+#define HARD_DISK_SATA_COMMAND_READ_FIRST_PARTY_DMA_QUEUED 0x60
+/** The ATA "WRITE FPDMA QUEUED" command. */
+#define HARD_DISK_SATA_COMMAND_WRITE_FIRST_PARTY_DMA_QUEUED 0x61
+/** The ATA "SET FEATURES" command. */
+#define HARD_DISK_SATA_COMMAND_SET_FEATURES 0xEF
+/** The ATA "FLUSH CACHE" command. */
+#define HARD_DISK_SATA_COMMAND_FLUSH_CACHE 0xE7
+/** The ATA "FLUSH CACHE EXT" command. */
+#define HARD_DISK_SATA_COMMAND_FLUSH_CACHE_EXTENDED 0xEA
+
+// SET FEATURES command useful features
+/** Enable the volatile write cache. */
+#define HARD_DISK_SATA_FEATURE_ENABLE_WRITE_CACHE 0x02
+/** Disable the volatile write cache. */
+#define HARD_DISK_SATA_FEATURE_DISABLE_WRITE_CACHE 0x82
+
+// Global HBA Control useful bits
+/** IE bit. */
+#define HARD_DISK_SATA_BIT_GENERIC_HOST_CONTROL_GLOBAL_HBA_CONTROL_INTERRUPT_ENABLE (1 << 1)
+
+// HBA Capabilities useful bits
+/** SNCQ bit. */
+#define HARD_DISK_SATA_BIT_GENERIC_HOST_CONTROL_CAPABILITIES_NATIVE_COMMAND_QUEUING (1 << 30)
 
 // Port Registers Command useful bits
 /** ST bit. */
@@ -41,6 +71,11 @@
 #define HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_PIO_SETUP_FIS_INTERRUPT (1 << 1)
 /** DHRS bit. */
 #define HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_DEVICE_TO_HOST_REGISTER_FIS_INTERRUPT (1 << 0)
+/** SDBS bit. */
+#define HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_SET_DEVICE_BITS_INTERRUPT (1 << 3)
+
+/** The port interrupt causes the driver waits for : synchronous command completion (some SATA controller answer with a PIO interrupt to a H2D request), queued command completion and errors. The same bits are used in the Interrupt Enable register. */
+#define HARD_DISK_SATA_PORT_INTERRUPTS_MASK (HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_TASK_FILE_ERROR_STATUS | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_SET_DEVICE_BITS_INTERRUPT | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_PIO_SETUP_FIS_INTERRUPT | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_DEVICE_TO_HOST_REGISTER_FIS_INTERRUPT)
 
 // Command List Structure Description Information useful bits
 /** W bit. */
@@ -54,9 +89,50 @@
 /** C bit. */
 #define HARD_DISK_SATA_FRAME_INFORMATION_STRUCTURE_REGISTER_HOST_TO_DEVICE_TRANSFER_WHEN_COMMAND_ISSUE_SET_BIT (1 << 7)
 
+// IDENTIFY DEVICE answer useful fields
+/** Word 75 low byte, bits 4 to 0 contain the maximum queue depth minus 1. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_QUEUE_DEPTH 150
+/** Word 76 high byte, bit 0 (i.e. word bit 8) tells whether the drive supports Native Command Queuing. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_SERIAL_ATA_CAPABILITIES_HIGH_BYTE 153
+/** Word 82 low byte, bit 5 tells whether the drive has a volatile write cache. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_COMMAND_SET_SUPPORTED_LOW_BYTE 164
+/** Word 85 low byte, bit 5 tells whether the volatile write cache is enabled. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_COMMAND_SET_ENABLED_LOW_BYTE 170
+/** Word 83 high byte, bit 2 (i.e. word bit 10) tells whether the drive supports the 48-bit Address feature set. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_COMMAND_SETS_SUPPORTED_HIGH_BYTE 167
+/** Words 60..61, the sectors count addressable with LBA-28 commands. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_28_SECTORS_COUNT 120
+/** Words 100..103, the sectors count addressable with LBA-48 commands. */
+#define HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT 200
+
+/** How many command slots an AHCI port can provide. */
+#define HARD_DISK_SATA_COMMAND_SLOTS_COUNT 32
+/** How many ports an AHCI controller can provide. */
+#define HARD_DISK_SATA_MAXIMUM_PORTS_COUNT 32
+
 /** SATA drive signature. */
 #define HARD_DISK_SATA_PORT_SIGNATURE_SATA_DRIVE 0x00000101
 
+/** The maximum sectors count an EXT or a queued command can transfer (a Count field of 0 means 65536 sectors). */
+#define HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND 65536
+
+/** The synchronous commands to use according to the configured addressing mode, the LBA-28 commands can only transfer 256 sectors (encoded as 0). */
+#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
+	#define HARD_DISK_SATA_COMMAND_READ HARD_DISK_SATA_COMMAND_READ_DMA
+	#define HARD_DISK_SATA_COMMAND_WRITE HARD_DISK_SATA_COMMAND_WRITE_DMA
+	#define HARD_DISK_SATA_MAXIMUM_SECTORS_PER_SYNCHRONOUS_COMMAND 256
+	#define HARD_DISK_SATA_COMMAND_FLUSH HARD_DISK_SATA_COMMAND_FLUSH_CACHE
+#else
+	#define HARD_DISK_SATA_COMMAND_READ HARD_DISK_SATA_COMMAND_READ_DMA_EXTENDED
+	#define HARD_DISK_SATA_COMMAND_WRITE HARD_DISK_SATA_COMMAND_WRITE_DMA_EXTENDED
+	#define HARD_DISK_SATA_MAXIMUM_SECTORS_PER_SYNCHRONOUS_COMMAND HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND
+	#define HARD_DISK_SATA_COMMAND_FLUSH HARD_DISK_SATA_COMMAND_FLUSH_CACHE_EXTENDED
+#endif
+/** The maximum bytes count a single PRDT entry can describe. */
+#define HARD_DISK_SATA_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT (4 * 1024 * 1024)
+/** How many PRDT entries are needed to transfer the biggest command payload. */
+#define HARD_DISK_SATA_PHYSICAL_REGION_DESCRIPTORS_COUNT ((HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND * HARD_DISK_SECTOR_SIZE) / HARD_DISK_SATA_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT)
+
 //-------------------------------------------------------------------------------------------------
 // Private types
 //-------------------------------------------------------------------------------------------------
@@ -138,153 +214,515 @@ typedef struct __attribute__((packed))
 	unsigned char Padding[0x40 - sizeof(THardDiskSATAFrameInformationStructureRegisterHostToDevice)];
 	unsigned char ATAPI_Command[32]; //! Not used here.
 	unsigned char Reserved[32];
-	THardDiskSATAPhysicalRegionDescriptorTable Physical_Region_Descriptor_Table; //! The only PRDT used.
+	THardDiskSATAPhysicalRegionDescriptorTable Physical_Region_Descriptor_Table[HARD_DISK_SATA_PHYSICAL_REGION_DESCRIPTORS_COUNT]; //! Enough entries to describe the biggest command payload.
 } THardDiskSATACommandTable;
 
+/** A drive connected to a controller port, with all the memory areas the port needs. */
+typedef struct
+{
+	volatile THardDiskSATACommandListStructure __attribute__((aligned(1024))) Command_List[HARD_DISK_SATA_COMMAND_SLOTS_COUNT]; //! The synchronous commands always use the first slot, the queued commands use as many slots as the queue depth.
+	volatile THardDiskSATACommandTable __attribute__((aligned(128))) Command_Tables[HARD_DISK_SATA_COMMAND_SLOTS_COUNT]; //! Each Command List slot's Command Table.
+	volatile unsigned char __attribute__((aligned(256))) Received_Frame_Information_Structure[256]; //! The FIS received from the device are stored here, but they are unused in this implementation.
+	volatile THardDiskSATAPortRegisters *Pointer_Port_Registers;
+	unsigned int Port_Index;
+	volatile unsigned int Recorded_Interrupt_Status; //! The port interrupt causes acknowledged by the interrupt handler and not yet consumed by the waiting code.
+	unsigned int Queue_Depth; //! How many queued commands can be in flight at the same time, 0 if Native Command Queuing is not supported by the controller or by the drive.
+	unsigned int Free_Slots_Mask; //! The queued commands slots that can be used.
+	unsigned int Outstanding_Slots_Mask; //! The queued commands the drive did not complete yet.
+	unsigned long long Slots_Start_Timestamp[HARD_DISK_SATA_COMMAND_SLOTS_COUNT]; //! When each queued command was issued, to measure its latency on completion.
+	unsigned int Slots_Sectors_Count[HARD_DISK_SATA_COMMAND_SLOTS_COUNT]; //! How many sectors each queued command transfers.
+	int Is_Write_Cache_Supported; //! Set to 1 when the drive has a volatile write cache.
+	int Is_Write_Cache_Enabled; //! Set to 1 when the drive acknowledges the writes before storing them on the media.
+} THardDiskSATADrive;
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
-/** The desired drive registers. */
-static volatile THardDiskSATAPortRegisters *Pointer_Hard_Disk_SATA_Drive_Port_Registers;
+/** The controller generic registers. */
+static volatile THardDiskSATAGenericHostControlRegisters *Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers;
 
-/** The device Command List. Only the first entry is used because all commands are executed sequentially. */
-static volatile THardDiskSATACommandListStructure __attribute__((aligned(1024))) Hard_Disk_SATA_Command_List;
+/** The striped drives, the volume first stripe is stored on the first drive. */
+static THardDiskSATADrive Hard_Disk_SATA_Drives[CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT];
+/** The ports the drives are connected to, as a bitmask. */
+static unsigned int Hard_Disk_SATA_Ports_Mask = 0;
 
-/** The first Command List slot's Command Table. */
-static volatile THardDiskSATACommandTable __attribute__((aligned(128))) Hard_Disk_SATA_Command_Table;
+/** Set to 1 when the controller interrupt is routed to the processor, so the waiting code can halt the processor instead of polling the registers. */
+static int Hard_Disk_SATA_Is_Interrupt_Available = 0;
 
-/** The FIS received from the device are stored in this structure, but it is unused in this implementation. */
-static volatile unsigned char __attribute__((aligned(256))) Hard_Disk_SATA_Received_Frame_Information_Structure[256];
+/** Set to 1 when all drives support Native Command Queuing, so the commands can be sent to all drives at the same time. */
+static int Hard_Disk_SATA_Is_Command_Queuing_Available = 0;
 
-/** The buffer used for all data transfer. */
+/** The buffer used by the IDENTIFY DEVICE command and to transfer data from or to buffers that are not word-aligned. */
 static volatile unsigned char __attribute__((aligned(2))) Hard_Disk_SATA_Buffer[HARD_DISK_SECTOR_SIZE];
 
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
-/** Execute the command located in the Command List 0 and wait for its completion. */
-static void HardDiskSATAControllerExecuteCommand(void)
+/** Disable the interrupts so a waiting condition can be checked without missing the interrupt that would wake the processor up.
+ * @return 1 if the interrupts were enabled by the caller, 0 if they were already disabled.
+ */
+static int HardDiskSATABeginWait(void)
 {
+	int Were_Interrupts_Enabled;
+	
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	return Were_Interrupts_Enabled;
+}
+
+/** Halt the processor until the next interrupt, or return immediately if the registers must be polled.
+ * @param Were_Interrupts_Enabled The value returned by HardDiskSATABeginWait(). The processor can't be halted when the caller runs with the interrupts disabled (system calls, timer handler...).
+ * @note The waiting condition must be checked again after each call, the timer interrupt also wakes the processor up.
+ */
+static inline __attribute__((always_inline)) void HardDiskSATAWaitForInterrupt(int Were_Interrupts_Enabled)
+{
+	if (Were_Interrupts_Enabled && Hard_Disk_SATA_Is_Interrupt_Available) ARCHITECTURE_INTERRUPTS_WAIT();
+}
+
+/** Restore the caller interrupts state.
+ * @param Were_Interrupts_Enabled The value returned by HardDiskSATABeginWait().
+ */
+static inline __attribute__((always_inline)) void HardDiskSATAEndWait(int Were_Interrupts_Enabled)
+{
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+}
+
+/** Get the port interrupt causes that occurred since the last reset, whether the interrupt handler already acknowledged them or not.
+ * @param Pointer_Drive The drive connected to the port.
+ * @return The port Interrupt Status register bits.
+ * @warning The interrupts must be disabled when calling this function.
+ */
+static unsigned int HardDiskSATAGetInterruptStatus(THardDiskSATADrive *Pointer_Drive)
+{
+	Pointer_Drive->Recorded_Interrupt_Status |= Pointer_Drive->Pointer_Port_Registers->Interrupt_Status; // The register is empty if the interrupt handler ran
+	return Pointer_Drive->Recorded_Interrupt_Status;
+}
+
+/** Reset all port interrupt causes.
+ * @param Pointer_Drive The drive connected to the port.
+ * @warning The interrupts must be disabled when calling this function.
+ */
+static void HardDiskSATAResetInterruptStatus(THardDiskSATADrive *Pointer_Drive)
+{
+	Pointer_Drive->Pointer_Port_Registers->Interrupt_Status = 0xFFFFFFFF; // Set a flag to '1' to reset it
+	Pointer_Drive->Recorded_Interrupt_Status = 0;
+}
+
+/** Execute the command located in the Command List 0 and wait for its completion.
+ * @param Pointer_Drive The drive to send the command to.
+ * @return 0 if the command succeeded,
+ * @return 1 if the drive reported an error.
+ */
+static int HardDiskSATAControllerExecuteCommand(THardDiskSATADrive *Pointer_Drive)
+{
+	int Were_Interrupts_Enabled;
+	unsigned int Interrupt_Status;
+	
+	Were_Interrupts_Enabled = HardDiskSATABeginWait();
+	
 	// Start executing the command
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command_Issue |= 1; // Always execute the first command as there is only one slot in the command list
+	Pointer_Drive->Pointer_Port_Registers->Command_Issue |= 1; // Always execute the first command as there is only one slot in the command list
 	
 	// Wait for command completion
-	while ((Pointer_Hard_Disk_SATA_Drive_Port_Registers->Interrupt_Status & (HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_TASK_FILE_ERROR_STATUS | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_PIO_SETUP_FIS_INTERRUPT | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_DEVICE_TO_HOST_REGISTER_FIS_INTERRUPT)) == 0); // Some SATA controller answer with a PIO interrupt to a H2D request, so check this interrupt too
+	while (1)
+	{
+		Interrupt_Status = HardDiskSATAGetInterruptStatus(Pointer_Drive);
+		if (Interrupt_Status & (HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_TASK_FILE_ERROR_STATUS | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_PIO_SETUP_FIS_INTERRUPT | HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_DEVICE_TO_HOST_REGISTER_FIS_INTERRUPT)) break; // Some SATA controller answer with a PIO interrupt to a H2D request, so check this interrupt too
+		HardDiskSATAWaitForInterrupt(Were_Interrupts_Enabled);
+	}
+	
+	// Reset all interrupt flags
+	HardDiskSATAResetInterruptStatus(Pointer_Drive);
+	HardDiskSATAEndWait(Were_Interrupts_Enabled);
 	
 	// Was the command successful ?
-	if (Pointer_Hard_Disk_SATA_Drive_Port_Registers->Interrupt_Status & HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_TASK_FILE_ERROR_STATUS)
+	if (Interrupt_Status & HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_TASK_FILE_ERROR_STATUS)
 	{
 		ScreenSetColor(SCREEN_COLOR_RED);
 		ScreenWriteString(STRING_DRIVER_HARD_DISK_SATA_ERROR_INPUT_OUTPUT);
 		ScreenSetColor(SCREEN_COLOR_BLUE);
 		KeyboardReadCharacter();
+		return 1;
 	}
-	
-	// Reset all interrupt flags
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Interrupt_Status = 0xFFFFFFFF; // Set a flag to '1' to reset it
+	return 0;
 }
 
-/** Fill the Command List slot 0 needed fields.
+/** Fill a Command List slot needed fields and describe the data buffer in the slot PRDT.
+ * @param Pointer_Drive The drive owning the Command List.
+ * @param Slot_Index The Command List slot to use.
  * @param Is_Write_Operation Set to 1 if it is a write operation, set to 0 if it is a read operation.
- * @param Is_Prefetchable Set to 1 if the data is prefetchable (the HBA can optimize the data transfer) or set to 0 if not.
+ * @param Is_Queued_Command Set to 1 for a Native Command Queuing command, which can't be prefetched nor clear the busy flag on acknowledge, set to 0 for a synchronous command.
+ * @param Pointer_Buffer The data buffer, it must be word-aligned.
+ * @param Bytes_Count The data size, it must be an even value and can't exceed HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND sectors.
  */
-static void HardDiskSATAPrepareCommand(int Is_Write_Operation, int Is_Prefetchable)
+static void HardDiskSATAPrepareCommand(THardDiskSATADrive *Pointer_Drive, unsigned int Slot_Index, int Is_Write_Operation, int Is_Queued_Command, volatile void *Pointer_Buffer, unsigned int Bytes_Count)
 {
-	// Initialize the Command List slot 0
-	Hard_Disk_SATA_Command_List.Description_Information = (sizeof(Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure) / 4) & 0x1F; // // Set the Frame Information Structure Length field (bits 4 to 0), the value unit is double-word
-	if (Is_Write_Operation) Hard_Disk_SATA_Command_List.Description_Information |= HARD_DISK_SATA_BIT_COMMAND_LIST_STRUCTURE_DESCRIPTION_INFORMATION_WRITE; // Is it a write operation ?
-	if (Is_Prefetchable) Hard_Disk_SATA_Command_List.Description_Information |= HARD_DISK_SATA_BIT_COMMAND_LIST_STRUCTURE_DESCRIPTION_INFORMATION_PREFETCHABLE; // Can the data transfer be optimized without looses ?
-	Hard_Disk_SATA_Command_List.Description_Information |= HARD_DISK_SATA_BIT_COMMAND_LIST_STRUCTURE_DESCRIPTION_INFORMATION_CLEAR_BUSY_ON_ACKNOWLEDGE; // Clear PxTFD.STS.BSY and PxCI.CI(z) when command is completed
-	Hard_Disk_SATA_Command_List.Description_Information |= 1 << 16; // There is always a single entry in the PRDT in this implementation
-	Hard_Disk_SATA_Command_List.Command_Status = 0; // This field will be incremented with the real transfered bytes amount
+	unsigned int Entries_Count = 0, Entry_Bytes_Count, Data_Address = (unsigned int) Pointer_Buffer;
+	volatile THardDiskSATACommandListStructure *Pointer_Command_List_Structure = &Pointer_Drive->Command_List[Slot_Index];
+	volatile THardDiskSATACommandTable *Pointer_Command_Table = &Pointer_Drive->Command_Tables[Slot_Index];
+	
+	// Split the buffer into as many PRDT entries as needed (the kernel memory is not paged, so the buffer is physically contiguous)
+	while (Bytes_Count > 0)
+	{
+		if (Bytes_Count > HARD_DISK_SATA_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT) Entry_Bytes_Count = HARD_DISK_SATA_PHYSICAL_REGION_DESCRIPTOR_MAXIMUM_BYTES_COUNT;
+		else Entry_Bytes_Count = Bytes_Count;
+		
+		Pointer_Command_Table->Physical_Region_Descriptor_Table[Entries_Count].Data_Base_Address = Data_Address;
+		Pointer_Command_Table->Physical_Region_Descriptor_Table[Entries_Count].Data_Base_Address_High_Double_Word = 0;
+		Pointer_Command_Table->Physical_Region_Descriptor_Table[Entries_Count].Data_Byte_Count = Entry_Bytes_Count - 1; // The size is zero-based, so a value of 0 = a size of 1 byte
+		
+		Data_Address += Entry_Bytes_Count;
+		Bytes_Count -= Entry_Bytes_Count;
+		Entries_Count++;
+	}
+	
+	// Initialize the Command List slot
+	Pointer_Command_List_Structure->Description_Information = (sizeof(Pointer_Command_Table->Command_Frame_Information_Structure) / 4) & 0x1F; // // Set the Frame Information Structure Length field (bits 4 to 0), the value unit is double-word
+	if (Is_Write_Operation) Pointer_Command_List_Structure->Description_Information |= HARD_DISK_SATA_BIT_COMMAND_LIST_STRUCTURE_DESCRIPTION_INFORMATION_WRITE; // Is it a write operation ?
+	if (!Is_Queued_Command)
+	{
+		Pointer_Command_List_Structure->Description_Information |= HARD_DISK_SATA_BIT_COMMAND_LIST_STRUCTURE_DESCRIPTION_INFORMATION_PREFETCHABLE; // The data transfer can be optimized without looses
+		Pointer_Command_List_Structure->Description_Information |= HARD_DISK_SATA_BIT_COMMAND_LIST_STRUCTURE_DESCRIPTION_INFORMATION_CLEAR_BUSY_ON_ACKNOWLEDGE; // Clear PxTFD.STS.BSY and PxCI.CI(z) when command is completed
+	}
+	Pointer_Command_List_Structure->Description_Information |= Entries_Count << 16; // Set the PRDT Length field
+	Pointer_Command_List_Structure->Command_Status = 0; // This field will be incremented with the real transfered bytes amount
 	
 	// Initialize the H2D FIS
-	memset((void *) &Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure, 0, sizeof(Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure)); // Explicit cast to avoid warning due to pointer volatile attribute
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Frame_Information_Structure_Type = HARD_DISK_SATA_FRAME_INFORMATION_STRUCTURE_TYPE_REGISTER_HOST_TO_DEVICE; // Set the FIS type
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Port_Multiplier_Port_And_Transfer_When_Command_Issue_Set_Bit = HARD_DISK_SATA_FRAME_INFORMATION_STRUCTURE_REGISTER_HOST_TO_DEVICE_TRANSFER_WHEN_COMMAND_ISSUE_SET_BIT; // The command will be executed when the corresponding bit in CI register will be set
+	memset((void *) &Pointer_Command_Table->Command_Frame_Information_Structure, 0, sizeof(Pointer_Command_Table->Command_Frame_Information_Structure)); // Explicit cast to avoid warning due to pointer volatile attribute
+	Pointer_Command_Table->Command_Frame_Information_Structure.Frame_Information_Structure_Type = HARD_DISK_SATA_FRAME_INFORMATION_STRUCTURE_TYPE_REGISTER_HOST_TO_DEVICE; // Set the FIS type
+	Pointer_Command_Table->Command_Frame_Information_Structure.Port_Multiplier_Port_And_Transfer_When_Command_Issue_Set_Bit = HARD_DISK_SATA_FRAME_INFORMATION_STRUCTURE_REGISTER_HOST_TO_DEVICE_TRANSFER_WHEN_COMMAND_ISSUE_SET_BIT; // The command will be executed when the corresponding bit in CI register will be set
 }
 
-/** Tell if the port 0 (i.e. the hard disk drive) is in idle state or in running state.
- * @return 1 if the port is in idle state,
- * @return 0 if the port is in running state.
+/** Read or write consecutive sectors with a single DMA command.
+ * @param Pointer_Drive The drive to access.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first drive LBA sector to access.
+ * @param Sectors_Count How many sectors to access, the maximum value is HARD_DISK_SATA_MAXIMUM_SECTORS_PER_SYNCHRONOUS_COMMAND.
+ * @param Pointer_Buffer The data buffer, it must be word-aligned.
  */
-static int HardDiskSATAIsPortIdle(void)
+static void HardDiskSATATransferSectors(THardDiskSATADrive *Pointer_Drive, int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, volatile void *Pointer_Buffer)
 {
-	unsigned int Temp_Double_Word;
+	volatile THardDiskSATAFrameInformationStructureRegisterHostToDevice *Pointer_Frame_Information_Structure = &Pointer_Drive->Command_Tables[0].Command_Frame_Information_Structure;
+	unsigned long long Start_Timestamp;
+	int Is_Error;
 	
-	Temp_Double_Word = Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command;
+	// Configure the Command List slot
+	HardDiskSATAPrepareCommand(Pointer_Drive, 0, Is_Write_Operation, 0, Pointer_Buffer, Sectors_Count * HARD_DISK_SECTOR_SIZE);
 	
-	if ((Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START) || (Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE) || (Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_RUNNING) || (Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_COMMAND_LIST_RUNNING)) return 0;
-	return 1;
+	// Create the H2D FIS content
+	if (Is_Write_Operation) Pointer_Frame_Information_Structure->Command = HARD_DISK_SATA_COMMAND_WRITE;
+	else Pointer_Frame_Information_Structure->Command = HARD_DISK_SATA_COMMAND_READ;
+	// Set the first LBA sector to access
+	Pointer_Frame_Information_Structure->LBA_Address_Low_Bytes[0] = (unsigned char) Logical_Sector_Number;
+	Pointer_Frame_Information_Structure->LBA_Address_Low_Bytes[1] = Logical_Sector_Number >> 8;
+	Pointer_Frame_Information_Structure->LBA_Address_Low_Bytes[2] = Logical_Sector_Number >> 16;
+	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
+		// Select device 0 in LBA mode, the 4 upper address bits are stored in the Device field
+		Pointer_Frame_Information_Structure->Device = 0x40 | ((Logical_Sector_Number >> 24) & 0x0F);
+		// Set the sectors count (256 sectors are encoded as 0)
+		Pointer_Frame_Information_Structure->Sectors_Count_Low_Byte = (unsigned char) Sectors_Count;
+	#else
+		// Address bytes 4 and 5 are always 0 as the addresses are 32-bit long
+		Pointer_Frame_Information_Structure->LBA_Address_High_Bytes[0] = Logical_Sector_Number >> 24;
+		// Set the sectors count (65536 sectors are encoded as 0)
+		Pointer_Frame_Information_Structure->Sectors_Count_Low_Byte = (unsigned char) Sectors_Count;
+		Pointer_Frame_Information_Structure->Sectors_Count_High_Byte = (unsigned char) (Sectors_Count >> 8);
+		// Select device 0 and configure for 48-LBA
+		Pointer_Frame_Information_Structure->Device = 0x40;
+	#endif
+	
+	// Execute the command and wait for its completion
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	Is_Error = HardDiskSATAControllerExecuteCommand(Pointer_Drive);
+	HardDiskStatisticsRecordTransfer(Is_Write_Operation, Sectors_Count, Start_Timestamp, Is_Error);
 }
 
-//-------------------------------------------------------------------------------------------------
-// Public functions
-//-------------------------------------------------------------------------------------------------
-int HardDiskInitialize(void)
+/** Start a Native Command Queuing read or write command without waiting for its completion.
+ * @param Pointer_Drive The drive to access.
+ * @param Slot_Index The Command List slot to use, it is also the command tag.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first drive LBA sector to access.
+ * @param Sectors_Count How many sectors to access, the maximum value is HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND.
+ * @param Pointer_Buffer The data buffer, it must be word-aligned.
+ */
+static void HardDiskSATAIssueQueuedCommand(THardDiskSATADrive *Pointer_Drive, unsigned int Slot_Index, int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
 {
-	TPCIDeviceID SATA_Device_ID;
-	TPCIConfigurationSpaceHeader Device_Configuration_Space_Header;
-	volatile THardDiskSATAGenericHostControlRegisters *Pointer_Generic_Host_Control_Registers;
-	unsigned int Temp_Double_Word;
+	volatile THardDiskSATAFrameInformationStructureRegisterHostToDevice *Pointer_Frame_Information_Structure = &Pointer_Drive->Command_Tables[Slot_Index].Command_Frame_Information_Structure;
 	
-	// Find the SATA controller on the PCI bus
-	if (PCIFindDeviceFromClass(PCI_CLASS_CODE_BASE_MASS_STORAGE, PCI_CLASS_CODE_SUB_CLASS_SATA, &SATA_Device_ID) != 0)
+	// Configure the Command List slot
+	HardDiskSATAPrepareCommand(Pointer_Drive, Slot_Index, Is_Write_Operation, 1, Pointer_Buffer, Sectors_Count * HARD_DISK_SECTOR_SIZE);
+	
+	// Create the H2D FIS content
+	if (Is_Write_Operation) Pointer_Frame_Information_Structure->Command = HARD_DISK_SATA_COMMAND_WRITE_FIRST_PARTY_DMA_QUEUED;
+	else Pointer_Frame_Information_Structure->Command = HARD_DISK_SATA_COMMAND_READ_FIRST_PARTY_DMA_QUEUED;
+	// Set the first LBA sector to access
+	Pointer_Frame_Information_Structure->LBA_Address_Low_Bytes[0] = (unsigned char) Logical_Sector_Number;
+	Pointer_Frame_Information_Structure->LBA_Address_Low_Bytes[1] = Logical_Sector_Number >> 8;
+	Pointer_Frame_Information_Structure->LBA_Address_Low_Bytes[2] = Logical_Sector_Number >> 16;
+	Pointer_Frame_Information_Structure->LBA_Address_High_Bytes[0] = Logical_Sector_Number >> 24;
+	// The sectors count is stored in the Features fields (65536 sectors are encoded as 0)
+	Pointer_Frame_Information_Structure->Features_Low_Byte = (unsigned char) Sectors_Count;
+	Pointer_Frame_Information_Structure->Features_High_Byte = (unsigned char) (Sectors_Count >> 8);
+	// The tag is stored in the Count field bits 7 to 3
+	Pointer_Frame_Information_Structure->Sectors_Count_Low_Byte = (unsigned char) (Slot_Index << 3);
+	// The FPDMA commands require the LBA bit to be set
+	Pointer_Frame_Information_Structure->Device = 0x40;
+	
+	// Tell the HBA that the tag is outstanding before issuing the command, writing a zero to these registers has no effect
+	Pointer_Drive->Slots_Start_Timestamp[Slot_Index] = HardDiskStatisticsGetTimestamp();
+	Pointer_Drive->Slots_Sectors_Count[Slot_Index] = Sectors_Count;
+	Pointer_Drive->Pointer_Port_Registers->SATA_Active = 1 << Slot_Index;
+	Pointer_Drive->Pointer_Port_Registers->Command_Issue = 1 << Slot_Index;
+	
+	Pointer_Drive->Free_Slots_Mask &= ~(1 << Slot_Index);
+	Pointer_Drive->Outstanding_Slots_Mask |= 1 << Slot_Index;
+}
+
+/** Account the completion of queued commands and release their slots.
+ * @param Pointer_Drive The drive that executed the commands.
+ * @param Slots_Mask The completed commands slots.
+ * @param Is_Write_Operation Set to 1 if the commands wrote sectors, set to 0 if they read them.
+ * @param Is_Error Set to 1 if the commands were aborted, set to 0 if they succeeded.
+ */
+static void HardDiskSATACompleteQueuedCommands(THardDiskSATADrive *Pointer_Drive, unsigned int Slots_Mask, int Is_Write_Operation, int Is_Error)
+{
+	unsigned int Slot_Index;
+	
+	for (Slot_Index = 0; Slot_Index < HARD_DISK_SATA_COMMAND_SLOTS_COUNT; Slot_Index++)
 	{
-		DEBUG_SECTION_START
-			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
-			ScreenWriteString("Error : no SATA controller found.\n");
-			KeyboardReadCharacter();
-		DEBUG_SECTION_END
-		return 2;
+		if (Slots_Mask & (1 << Slot_Index)) HardDiskStatisticsRecordTransfer(Is_Write_Operation, Pointer_Drive->Slots_Sectors_Count[Slot_Index], Pointer_Drive->Slots_Start_Timestamp[Slot_Index], Is_Error);
 	}
 	
-	// Get the SATA controller properties
-	if (PCIGetConfigurationSpaceHeader(&SATA_Device_ID, &Device_Configuration_Space_Header) != 0)
+	Pointer_Drive->Free_Slots_Mask |= Slots_Mask;
+	Pointer_Drive->Outstanding_Slots_Mask &= ~Slots_Mask;
+}
+
+/** Stop and restart the port command engine to recover from a queued command error. All outstanding commands are discarded.
+ * @param Pointer_Drive The drive connected to the port.
+ */
+static void HardDiskSATARestartCommandEngine(THardDiskSATADrive *Pointer_Drive)
+{
+	// Reset PxCMD.ST, this clears PxCI and PxSACT
+	Pointer_Drive->Pointer_Port_Registers->Command &= ~HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START;
+	while (Pointer_Drive->Pointer_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_COMMAND_LIST_RUNNING);
+	
+	// Clear the errors
+	Pointer_Drive->Pointer_Port_Registers->SATA_Error = 0x07FF0F03; // Put ones in all implemented bits (as asked by the specification)
+	HardDiskSATAResetInterruptStatus(Pointer_Drive);
+	
+	// Start Command Engine again
+	Pointer_Drive->Pointer_Port_Registers->Command |= HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START;
+}
+
+/** Wait until at least one queued command completes on any drive.
+ * @param Is_Write_Operation Set to 1 if the commands write sectors, set to 0 if they read them.
+ * @return 0 if the completed commands succeeded,
+ * @return 1 if a drive reported an error, all its outstanding commands are discarded.
+ */
+static int HardDiskSATAWaitForQueuedCommands(int Is_Write_Operation)
+{
+	unsigned int i, Active_Slots_Mask, Completed_Slots_Mask;
+	int Were_Interrupts_Enabled, Is_Command_Completed = 0, Is_Error = 0;
+	THardDiskSATADrive *Pointer_Drive;
+	
+	Were_Interrupts_Enabled = HardDiskSATABeginWait();
+	while (1)
 	{
-		DEBUG_SECTION_START
-			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
-			ScreenWriteString("Error : failed to get the SATA controller Configuration Space Header.\n");
-			KeyboardReadCharacter();
-		DEBUG_SECTION_END
-		return 2;
+		for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+		{
+			Pointer_Drive = &Hard_Disk_SATA_Drives[i];
+			if (Pointer_Drive->Outstanding_Slots_Mask == 0) continue;
+			
+			// The drive clears the corresponding PxSACT bit with a Set Device Bits FIS (read the register only once because more commands may complete meanwhile)
+			Active_Slots_Mask = Pointer_Drive->Pointer_Port_Registers->SATA_Active;
+			Completed_Slots_Mask = Pointer_Drive->Outstanding_Slots_Mask & ~Active_Slots_Mask;
+			if (Completed_Slots_Mask != 0)
+			{
+				HardDiskSATACompleteQueuedCommands(Pointer_Drive, Completed_Slots_Mask, Is_Write_Operation, 0);
+				Is_Command_Completed = 1;
+			}
+			// Was a command unsuccessful ?
+			else if (HardDiskSATAGetInterruptStatus(Pointer_Drive) & HARD_DISK_SATA_BIT_PORT_REGISTERS_INTERRUPT_STATUS_TASK_FILE_ERROR_STATUS)
+			{
+				// The drive aborts all outstanding commands on error
+				HardDiskSATARestartCommandEngine(Pointer_Drive);
+				HardDiskSATACompleteQueuedCommands(Pointer_Drive, Pointer_Drive->Outstanding_Slots_Mask, Is_Write_Operation, 1);
+				Is_Error = 1;
+			}
+		}
+		if (Is_Command_Completed || Is_Error) break;
+		
+		HardDiskSATAWaitForInterrupt(Were_Interrupts_Enabled);
 	}
+	HardDiskSATAEndWait(Were_Interrupts_Enabled);
 	
-	DEBUG_SECTION_START
-		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
-		ScreenWriteString("SATA controller found.\nVendor ID : 0x");
-		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Vendor_ID);
-		ScreenWriteString(", device ID : 0x");
-		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Device_ID);
-		ScreenWriteString(", BAR[5] : 0x");
-		DebugWriteHexadecimalInteger(PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[5]));
-		ScreenWriteCharacter('\n');
-		KeyboardReadCharacter();
-	DEBUG_SECTION_END
+	return Is_Error;
+}
+
+/** Find the drive storing a volume sector. The volume is split into stripes of CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS sectors, the first stripe is stored on the first drive, the second stripe on the second drive and so on.
+ * @param Logical_Sector_Number The volume LBA sector.
+ * @param Sectors_Count How many consecutive volume sectors are accessed starting from this sector.
+ * @param Pointer_Pointer_Drive On output, contain the drive storing the sector.
+ * @param Pointer_Drive_Sector_Number On output, contain the sector LBA address on the drive.
+ * @return How many of the accessed sectors are consecutively stored on the drive, it can't be bigger than Sectors_Count.
+ */
+static unsigned int HardDiskSATAMapVolumeSector(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, THardDiskSATADrive **Pointer_Pointer_Drive, unsigned int *Pointer_Drive_Sector_Number)
+{
+	#if CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT > 1
+		unsigned int Stripe_Index, Stripe_Offset;
+		
+		Stripe_Index = Logical_Sector_Number / CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS;
+		Stripe_Offset = Logical_Sector_Number % CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS;
+		
+		*Pointer_Pointer_Drive = &Hard_Disk_SATA_Drives[Stripe_Index % CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT];
+		*Pointer_Drive_Sector_Number = (Stripe_Index / CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT) * CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS + Stripe_Offset;
+		
+		// The following sectors are stored on the next drive when the stripe end is reached
+		if (Sectors_Count > CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS - Stripe_Offset) return CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS - Stripe_Offset;
+		return Sectors_Count;
+	#else
+		// The volume is the drive
+		*Pointer_Pointer_Drive = &Hard_Disk_SATA_Drives[0];
+		*Pointer_Drive_Sector_Number = Logical_Sector_Number;
+		return Sectors_Count;
+	#endif
+}
+
+/** Read or write consecutive volume sectors with synchronous commands, one drive after the other.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first volume LBA sector to access.
+ * @param Sectors_Count How many sectors to access.
+ * @param Pointer_Buffer The data buffer, it does not need to be aligned.
+ */
+static void HardDiskSATATransferSectorsSynchronously(int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, unsigned char *Pointer_Buffer)
+{
+	THardDiskSATADrive *Pointer_Drive;
+	unsigned int Drive_Sector_Number, Command_Sectors_Count;
 	
-	// Allow access to the generic registers
-	Pointer_Generic_Host_Control_Registers = (THardDiskSATAGenericHostControlRegisters *) PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[5]);
-	Pointer_Generic_Host_Control_Registers->Global_HBA_Control |= 1 << 31; // Enable use of AHCI communication mechanism only
+	while (Sectors_Count > 0)
+	{
+		// The DMA engine can't access a buffer that is not aligned on 2 bytes, so bounce each sector through the driver buffer
+		if ((unsigned int) Pointer_Buffer & 1)
+		{
+			Command_Sectors_Count = HardDiskSATAMapVolumeSector(Logical_Sector_Number, 1, &Pointer_Drive, &Drive_Sector_Number);
+			if (Is_Write_Operation)
+			{
+				memcpy((void *) Hard_Disk_SATA_Buffer, Pointer_Buffer, HARD_DISK_SECTOR_SIZE); // Explicit cast to avoid warning due to pointer volatile attribute
+				HardDiskSATATransferSectors(Pointer_Drive, 1, Drive_Sector_Number, 1, Hard_Disk_SATA_Buffer);
+			}
+			else
+			{
+				HardDiskSATATransferSectors(Pointer_Drive, 0, Drive_Sector_Number, 1, Hard_Disk_SATA_Buffer);
+				memcpy(Pointer_Buffer, (void *) Hard_Disk_SATA_Buffer, HARD_DISK_SECTOR_SIZE); // Explicit cast to avoid warning due to pointer volatile attribute
+			}
+		}
+		// Directly transfer the data with the provided buffer, using the biggest commands possible
+		else
+		{
+			Command_Sectors_Count = HardDiskSATAMapVolumeSector(Logical_Sector_Number, Sectors_Count, &Pointer_Drive, &Drive_Sector_Number);
+			if (Command_Sectors_Count > HARD_DISK_SATA_MAXIMUM_SECTORS_PER_SYNCHRONOUS_COMMAND) Command_Sectors_Count = HARD_DISK_SATA_MAXIMUM_SECTORS_PER_SYNCHRONOUS_COMMAND;
+			
+			HardDiskSATATransferSectors(Pointer_Drive, Is_Write_Operation, Drive_Sector_Number, Command_Sectors_Count, Pointer_Buffer);
+		}
+		
+		Logical_Sector_Number += Command_Sectors_Count;
+		Pointer_Buffer += Command_Sectors_Count * HARD_DISK_SECTOR_SIZE;
+		Sectors_Count -= Command_Sectors_Count;
+	}
+}
+
+/** Read or write consecutive volume sectors. When several drives are striped, all of them transfer their part of the data at the same time.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first volume LBA sector to access.
+ * @param Sectors_Count How many sectors to access.
+ * @param Pointer_Buffer The data buffer.
+ */
+static void HardDiskSATATransferVolumeSectors(int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	#if CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT > 1
+		THardDiskRequest Request;
+		
+		// Queue the commands of all drives, HardDiskExecuteRequests() uses synchronous commands if queuing can't be used
+		Request.Logical_Sector_Number = Logical_Sector_Number;
+		Request.Sectors_Count = Sectors_Count;
+		Request.Pointer_Buffer = Pointer_Buffer;
+		HardDiskExecuteRequests(Is_Write_Operation, &Request, 1);
+	#else
+		HardDiskSATATransferSectorsSynchronously(Is_Write_Operation, Logical_Sector_Number, Sectors_Count, Pointer_Buffer);
+	#endif
+}
+
+/** Send the IDENTIFY DEVICE command, the answer is stored in Hard_Disk_SATA_Buffer.
+ * @param Pointer_Drive The drive to identify.
+ */
+static void HardDiskSATAIdentifyDevice(THardDiskSATADrive *Pointer_Drive)
+{
+	// Configure the Command List slot
+	HardDiskSATAPrepareCommand(Pointer_Drive, 0, 0, 0, Hard_Disk_SATA_Buffer, HARD_DISK_SECTOR_SIZE); // Read operation
 	
-	DEBUG_SECTION_START
-		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
-		ScreenWriteString("AHCI version : 0x");
-		DebugWriteHexadecimalInteger(Pointer_Generic_Host_Control_Registers->AHCI_Version);
-		ScreenWriteString("\nports implemented bit mask : 0x");
-		DebugWriteHexadecimalInteger(Pointer_Generic_Host_Control_Registers->Ports_Implemented);
-		ScreenWriteCharacter('\n');
-		KeyboardReadCharacter();
-	DEBUG_SECTION_END
+	// Create the H2D FIS content
+	Pointer_Drive->Command_Tables[0].Command_Frame_Information_Structure.Command = HARD_DISK_SATA_COMMAND_IDENTIFY_DEVICE; // Set the command
+	
+	// Execute the command and wait for its completion
+	HardDiskSATAControllerExecuteCommand(Pointer_Drive);
+}
+
+/** Send a command that transfers no data and wait for its completion.
+ * @param Pointer_Drive The drive to send the command to.
+ * @param Features The Features field value.
+ * @param Command The command to send.
+ * @return 0 if the command succeeded,
+ * @return 1 if the drive reported an error.
+ */
+static int HardDiskSATAExecuteNonDataCommand(THardDiskSATADrive *Pointer_Drive, unsigned char Features, unsigned char Command)
+{
+	// Configure the Command List slot
+	HardDiskSATAPrepareCommand(Pointer_Drive, 0, 0, 0, NULL, 0);
+	
+	// Create the H2D FIS content
+	Pointer_Drive->Command_Tables[0].Command_Frame_Information_Structure.Command = Command;
+	Pointer_Drive->Command_Tables[0].Command_Frame_Information_Structure.Features_Low_Byte = Features;
+	Pointer_Drive->Command_Tables[0].Command_Frame_Information_Structure.Device = 0x40;
+	
+	// Execute the command and wait for its completion
+	return HardDiskSATAControllerExecuteCommand(Pointer_Drive);
+}
+
+/** Tell if a port is in idle state or in running state.
+ * @param Pointer_Drive The drive connected to the port.
+ * @return 1 if the port is in idle state,
+ * @return 0 if the port is in running state.
+ */
+static int HardDiskSATAIsPortIdle(THardDiskSATADrive *Pointer_Drive)
+{
+	unsigned int Temp_Double_Word;
+	
+	Temp_Double_Word = Pointer_Drive->Pointer_Port_Registers->Command;
+	
+	if ((Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START) || (Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE) || (Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_RUNNING) || (Temp_Double_Word & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_COMMAND_LIST_RUNNING)) return 0;
+	return 1;
+}
+
+/** Start a port and get the features of the drive connected to it.
+ * @param Pointer_Drive The drive to initialize.
+ * @param Port_Index The port the drive is connected to.
+ * @return 0 if the drive was successfully initialized,
+ * @return 1 if the drive does not support the configured LBA mode,
+ * @return 2 if no SATA drive is connected to the port.
+ */
+static int HardDiskSATAInitializeDrive(THardDiskSATADrive *Pointer_Drive, unsigned int Port_Index)
+{
+	unsigned int Temp_Double_Word;
 	
 	// Is the requested drive connected ?
 	DEBUG_SECTION_START
 		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
 		ScreenWriteString("SATA device index : ");
-		ScreenWriteString(itoa(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVE_INDEX));
+		ScreenWriteString(itoa(Port_Index));
 		ScreenWriteCharacter('\n');
 		KeyboardReadCharacter();
 	DEBUG_SECTION_END
-	if (!(Pointer_Generic_Host_Control_Registers->Ports_Implemented & (1 << CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVE_INDEX)))
+	if ((Port_Index >= HARD_DISK_SATA_MAXIMUM_PORTS_COUNT) || !(Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->Ports_Implemented & (1 << Port_Index)))
 	{
 		DEBUG_SECTION_START
 			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
@@ -295,12 +733,12 @@ int HardDiskInitialize(void)
 	}
 	
 	// Allow access to the drive registers
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers = (THardDiskSATAPortRegisters *) (Device_Configuration_Space_Header.Base_Address_Registers[5] + (0x0100 + (CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVE_INDEX * 128)));
+	Pointer_Drive->Port_Index = Port_Index;
+	Pointer_Drive->Pointer_Port_Registers = (THardDiskSATAPortRegisters *) ((unsigned int) Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers + 0x0100 + (Port_Index * 128));
 	
 	// Initialize the drive
 	// Is the controller in idle state ?
-	Temp_Double_Word = Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command;
-	if (!HardDiskSATAIsPortIdle())
+	if (!HardDiskSATAIsPortIdle(Pointer_Drive))
 	{
 		DEBUG_SECTION_START
 			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
@@ -309,18 +747,18 @@ int HardDiskInitialize(void)
 		DEBUG_SECTION_END
 		
 		// Reset PxCMD.ST
-		Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command &= ~HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START;
-		while (Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_COMMAND_LIST_RUNNING);
+		Pointer_Drive->Pointer_Port_Registers->Command &= ~HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START;
+		while (Pointer_Drive->Pointer_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_COMMAND_LIST_RUNNING);
 		
 		// Reset PxCMD.FRE
-		if (Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE)
+		if (Pointer_Drive->Pointer_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE)
 		{
-			Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command &= ~HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE;
-			while (Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_RUNNING);
+			Pointer_Drive->Pointer_Port_Registers->Command &= ~HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE;
+			while (Pointer_Drive->Pointer_Port_Registers->Command & HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_RUNNING);
 		}
 		
 		// Did the idle operation succeeded ?
-		if (!HardDiskSATAIsPortIdle())
+		if (!HardDiskSATAIsPortIdle(Pointer_Drive))
 		{
 			DEBUG_SECTION_START
 				DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
@@ -332,28 +770,28 @@ int HardDiskInitialize(void)
 	
 	// Configure the port's memory areas
 	// Set the Command List address
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command_List_Base_Address = (unsigned int) &Hard_Disk_SATA_Command_List;
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command_List_Base_Address_High_Double_Word = 0;
+	Pointer_Drive->Pointer_Port_Registers->Command_List_Base_Address = (unsigned int) Pointer_Drive->Command_List;
+	Pointer_Drive->Pointer_Port_Registers->Command_List_Base_Address_High_Double_Word = 0;
 	// Set the received FIS address
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Frame_Information_Structure_Base_Address = (unsigned int) Hard_Disk_SATA_Received_Frame_Information_Structure;
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Frame_Information_Structure_Base_Address_High_Double_Word = 0;
+	Pointer_Drive->Pointer_Port_Registers->Frame_Information_Structure_Base_Address = (unsigned int) Pointer_Drive->Received_Frame_Information_Structure;
+	Pointer_Drive->Pointer_Port_Registers->Frame_Information_Structure_Base_Address_High_Double_Word = 0;
 	
 	// Allow the device FIS to be received
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command |= HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE;
+	Pointer_Drive->Pointer_Port_Registers->Command |= HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_FRAME_INFORMATION_STRUCTURE_RECEIVE_ENABLE;
 	
 	// Clear PxSERR
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->SATA_Error = 0x07FF0F03; // Put ones in all implemented bits (as asked by the specification)
+	Pointer_Drive->Pointer_Port_Registers->SATA_Error = 0x07FF0F03; // Put ones in all implemented bits (as asked by the specification)
 	
 	DEBUG_SECTION_START
 		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
 		ScreenWriteString("Drive SATA status : 0x");
-		DebugWriteHexadecimalInteger(Pointer_Hard_Disk_SATA_Drive_Port_Registers->SATA_Status);
+		DebugWriteHexadecimalInteger(Pointer_Drive->Pointer_Port_Registers->SATA_Status);
 		ScreenWriteCharacter('\n');
 		KeyboardReadCharacter();
 	DEBUG_SECTION_END
 	
 	// Is the device present and active ?
-	Temp_Double_Word = Pointer_Hard_Disk_SATA_Drive_Port_Registers->SATA_Status; // Cache the value
+	Temp_Double_Word = Pointer_Drive->Pointer_Port_Registers->SATA_Status; // Cache the value
 	if (((Temp_Double_Word & 0x0000000F) != 3) || (((Temp_Double_Word >> 4) & 0x0000000F) == 0)) // 3 = "Device presence detected and Phy communication established", 0 = "Device not present or communication not established"
 	{
 		DEBUG_SECTION_START
@@ -374,7 +812,7 @@ int HardDiskInitialize(void)
 	}
 	
 	// Check the drive signature (only SATA devices are allowed)
-	Temp_Double_Word = Pointer_Hard_Disk_SATA_Drive_Port_Registers->Signature;
+	Temp_Double_Word = Pointer_Drive->Pointer_Port_Registers->Signature;
 	DEBUG_SECTION_START
 		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
 		ScreenWriteString("Drive signature : 0x");
@@ -393,92 +831,403 @@ int HardDiskInitialize(void)
 	}
 	
 	// Configure the Command List
-	// Set the first Command List slot's Command Table address
-	Hard_Disk_SATA_Command_List.Command_Table_Descriptor_Base_Address = (unsigned int) &Hard_Disk_SATA_Command_Table;
-	Hard_Disk_SATA_Command_List.Command_Table_Descriptor_Base_Address_High_Double_Word = 0;
-	// Set the command table data address once and for all
-	Hard_Disk_SATA_Command_Table.Physical_Region_Descriptor_Table.Data_Base_Address = (unsigned int) Hard_Disk_SATA_Buffer;
-	Hard_Disk_SATA_Command_Table.Physical_Region_Descriptor_Table.Data_Base_Address_High_Double_Word = 0;
-	Hard_Disk_SATA_Command_Table.Physical_Region_Descriptor_Table.Data_Byte_Count = HARD_DISK_SECTOR_SIZE - 1; // The size is zero-based, so a value of 0 = a size of 1 byte
+	// Set each Command List slot's Command Table address
+	for (Temp_Double_Word = 0; Temp_Double_Word < HARD_DISK_SATA_COMMAND_SLOTS_COUNT; Temp_Double_Word++)
+	{
+		Pointer_Drive->Command_List[Temp_Double_Word].Command_Table_Descriptor_Base_Address = (unsigned int) &Pointer_Drive->Command_Tables[Temp_Double_Word];
+		Pointer_Drive->Command_List[Temp_Double_Word].Command_Table_Descriptor_Base_Address_High_Double_Word = 0;
+	}
 	
 	// Reset the port interrupt flags
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Interrupt_Status = 0xFFFFFFFF; // Set a flag to '1' to reset it
+	Pointer_Drive->Pointer_Port_Registers->Interrupt_Status = 0xFFFFFFFF; // Set a flag to '1' to reset it
 	
 	// Start Command Engine
-	Pointer_Hard_Disk_SATA_Drive_Port_Registers->Command |= HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START; // ST bit, allow the commands to be processed
+	Pointer_Drive->Pointer_Port_Registers->Command |= HARD_DISK_SATA_BIT_PORT_REGISTERS_COMMAND_START; // ST bit, allow the commands to be processed
+	
+	// Get the drive features
+	HardDiskSATAIdentifyDevice(Pointer_Drive);
+	
+	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_48
+		// Make sure the EXT commands can be used
+		if (!(Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_COMMAND_SETS_SUPPORTED_HIGH_BYTE] & 0x04))
+		{
+			DEBUG_SECTION_START
+				DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+				ScreenWriteString("Error : the drive does not support LBA-48 addressing.\n");
+				KeyboardReadCharacter();
+			DEBUG_SECTION_END
+			return 1;
+		}
+	#endif
+	
+	// Use Native Command Queuing only if both the controller and the drive support it
+	Pointer_Drive->Queue_Depth = 0;
+	if (Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->HBA_Capabilities & HARD_DISK_SATA_BIT_GENERIC_HOST_CONTROL_CAPABILITIES_NATIVE_COMMAND_QUEUING)
+	{
+		if (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_SERIAL_ATA_CAPABILITIES_HIGH_BYTE] & 0x01)
+		{
+			// Keep the smallest queue depth
+			Pointer_Drive->Queue_Depth = (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_QUEUE_DEPTH] & 0x1F) + 1;
+			Temp_Double_Word = ((Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->HBA_Capabilities >> 8) & 0x1F) + 1; // Get the NCS field, the implemented command slots count
+			if (Temp_Double_Word < Pointer_Drive->Queue_Depth) Pointer_Drive->Queue_Depth = Temp_Double_Word;
+		}
+	}
+	
+	// Keep the write cache state the drive booted with until the kernel configures it
+	if (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_COMMAND_SET_SUPPORTED_LOW_BYTE] & 0x20)
+	{
+		Pointer_Drive->Is_Write_Cache_Supported = 1;
+		if (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_COMMAND_SET_ENABLED_LOW_BYTE] & 0x20) Pointer_Drive->Is_Write_Cache_Enabled = 1;
+	}
 	
 	DEBUG_SECTION_START
 		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
-		ScreenWriteString("Driver successfully initialized.\n");
+		ScreenWriteString("Native Command Queuing queue depth : ");
+		ScreenWriteString(itoa(Pointer_Drive->Queue_Depth));
+		ScreenWriteString(", write cache supported : ");
+		ScreenWriteString(itoa(Pointer_Drive->Is_Write_Cache_Supported));
+		ScreenWriteCharacter('\n');
 		KeyboardReadCharacter();
 	DEBUG_SECTION_END
 	
 	return 0;
 }
 
-void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+/** Get a drive size.
+ * @param Pointer_Drive The drive to identify.
+ * @return The drive size in sectors.
+ */
+static unsigned int HardDiskSATAGetDriveSizeSectors(THardDiskSATADrive *Pointer_Drive)
 {
-	// Configure the Command List slot
-	HardDiskSATAPrepareCommand(0, 1); // Read operation, allow data to be prefetched
+	unsigned int Sectors_Count;
 	
-	// Create the H2D FIS content
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Command = HARD_DISK_SATA_COMMAND_READ_DMA_EXTENDED; // Set the command
-	// Set the LBA sector to read from
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_Low_Bytes[0] = (unsigned char) Logical_Sector_Number;
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_Low_Bytes[1] = Logical_Sector_Number >> 8;
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_Low_Bytes[2] = Logical_Sector_Number >> 16;
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_High_Bytes[0] = Logical_Sector_Number >> 24;
-	// Set the sectors count
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Sectors_Count_Low_Byte = 1;
-	// Select device 0 and configure for 48-LBA TODO LBA 48 detection at initialization
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Device = 0x40;
+	HardDiskSATAIdentifyDevice(Pointer_Drive);
 	
-	// Execute the command and wait for its completion
-	HardDiskSATAControllerExecuteCommand();
+	// Retrieve the sectors count value
+	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_LOGICAL_BLOCK_ADDRESSING_MODE_28
+		Sectors_Count = (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_28_SECTORS_COUNT + 3] << 24) | (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_28_SECTORS_COUNT + 2] << 16) | (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_28_SECTORS_COUNT + 1] << 8) | Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_28_SECTORS_COUNT];
+	#else
+		// The sector numbers are 32-bit long, so only the first 2 TB of a bigger drive can be used
+		if (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT + 4] | Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT + 5]) Sectors_Count = 0xFFFFFFFF;
+		else Sectors_Count = (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT + 3] << 24) | (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT + 2] << 16) | (Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT + 1] << 8) | Hard_Disk_SATA_Buffer[HARD_DISK_SATA_IDENTIFY_DEVICE_OFFSET_LBA_48_SECTORS_COUNT];
+	#endif
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Port ");
+		ScreenWriteString(itoa(Pointer_Drive->Port_Index));
+		ScreenWriteString(" total sectors count : ");
+		ScreenWriteString(itoa(Sectors_Count));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	return Sectors_Count;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int HardDiskInitialize(void)
+{
+	TPCIDeviceID SATA_Device_ID;
+	TPCIConfigurationSpaceHeader Device_Configuration_Space_Header;
+	unsigned int i;
+	int Were_Interrupts_Enabled, Result;
+	
+	// Find the SATA controller on the PCI bus
+	if (PCIFindDeviceFromClass(PCI_CLASS_CODE_BASE_MASS_STORAGE, PCI_CLASS_CODE_SUB_CLASS_SATA, &SATA_Device_ID) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : no SATA controller found.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	// Get the SATA controller properties
+	if (PCIGetConfigurationSpaceHeader(&SATA_Device_ID, &Device_Configuration_Space_Header) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to get the SATA controller Configuration Space Header.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("SATA controller found.\nVendor ID : 0x");
+		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Vendor_ID);
+		ScreenWriteString(", device ID : 0x");
+		DebugWriteHexadecimalInteger(Device_Configuration_Space_Header.Device_ID);
+		ScreenWriteString(", BAR[5] : 0x");
+		DebugWriteHexadecimalInteger(PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[5]));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	// Allow access to the generic registers
+	Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers = (THardDiskSATAGenericHostControlRegisters *) PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[5]);
+	Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->Global_HBA_Control |= 1 << 31; // Enable use of AHCI communication mechanism only
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("AHCI version : 0x");
+		DebugWriteHexadecimalInteger(Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->AHCI_Version);
+		ScreenWriteString("\nports implemented bit mask : 0x");
+		DebugWriteHexadecimalInteger(Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->Ports_Implemented);
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	// Initialize all striped drives, they are connected to consecutive ports
+	Hard_Disk_SATA_Is_Command_Queuing_Available = 1;
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		Result = HardDiskSATAInitializeDrive(&Hard_Disk_SATA_Drives[i], CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVE_INDEX + i);
+		if (Result != 0) return Result;
+		
+		Hard_Disk_SATA_Ports_Mask |= 1 << Hard_Disk_SATA_Drives[i].Port_Index;
+		// The commands can be sent to all drives at the same time only if each drive can queue them
+		if (Hard_Disk_SATA_Drives[i].Queue_Depth == 0) Hard_Disk_SATA_Is_Command_Queuing_Available = 0;
+	}
+	
+	// Route the controller interrupt to the processor if the firmware assigned a legacy interrupt line to it (lines 0 to 2 are used by the timer, the keyboard and the PIC cascade)
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Interrupt line : ");
+		ScreenWriteString(itoa(Device_Configuration_Space_Header.Interrupt_Line));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	if ((Device_Configuration_Space_Header.Interrupt_Line >= 3) && (Device_Configuration_Space_Header.Interrupt_Line <= 15))
+	{
+		ArchitectureInstallHardDiskInterruptHandler(Device_Configuration_Space_Header.Interrupt_Line);
+		
+		// Enable the port interrupts the driver waits for
+		Were_Interrupts_Enabled = HardDiskSATABeginWait();
+		for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+		{
+			HardDiskSATAResetInterruptStatus(&Hard_Disk_SATA_Drives[i]);
+			Hard_Disk_SATA_Drives[i].Pointer_Port_Registers->Interrupt_Enable = HARD_DISK_SATA_PORT_INTERRUPTS_MASK;
+		}
+		Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->Interrupt_Status = Hard_Disk_SATA_Ports_Mask; // Set a flag to '1' to reset it
+		Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->Global_HBA_Control |= HARD_DISK_SATA_BIT_GENERIC_HOST_CONTROL_GLOBAL_HBA_CONTROL_INTERRUPT_ENABLE;
+		Hard_Disk_SATA_Is_Interrupt_Available = 1;
+		HardDiskSATAEndWait(Were_Interrupts_Enabled);
+	}
+	else
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("No usable interrupt line, the driver will poll the controller.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+	}
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Driver successfully initialized.\n");
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
 	
-	// Copy the data to the buffer (can't directly use the provided data pointer because the buffer must be aligned on 2 bytes)
-	memcpy(Pointer_Buffer, (void *) Hard_Disk_SATA_Buffer, HARD_DISK_SECTOR_SIZE);
+	return 0;
+}
+
+void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	HardDiskReadSectors(Logical_Sector_Number, 1, Pointer_Buffer);
 }
 
 void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
 {
-	// Configure the Command List slot
-	HardDiskSATAPrepareCommand(1, 1); // Write operation, allow data to be prefetched
+	HardDiskWriteSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	HardDiskSATATransferVolumeSectors(0, Logical_Sector_Number, Sectors_Count, Pointer_Buffer);
+}
+
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	HardDiskSATATransferVolumeSectors(1, Logical_Sector_Number, Sectors_Count, Pointer_Buffer);
+}
+
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
+{
+	unsigned int i, Drive_Index, Slot_Index, Command_Sectors_Count, Drive_Sector_Number, Logical_Sector_Number = 0, Sectors_Count = 0;
+	unsigned char *Pointer_Buffer = NULL;
+	int Were_Interrupts_Enabled, Is_Error = 0;
+	THardDiskSATADrive *Pointer_Drive;
 	
-	// Create the H2D FIS content
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Command = HARD_DISK_SATA_COMMAND_WRITE_DMA_EXTENDED; // Set the command
-	// Set the LBA sector to read from
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_Low_Bytes[0] = (unsigned char) Logical_Sector_Number;
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_Low_Bytes[1] = Logical_Sector_Number >> 8;
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_Low_Bytes[2] = Logical_Sector_Number >> 16;
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.LBA_Address_High_Bytes[0] = Logical_Sector_Number >> 24;
-	// Set the sectors count
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Sectors_Count_Low_Byte = 1;
-	// Select device 0 and configure for 48-LBA TODO LBA 48 detection at initialization
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Device = 0x40;
-	
-	// Copy the data to the buffer (can't directly use the provided data pointer because the buffer must be aligned on 2 bytes)
-	memcpy((void *) Hard_Disk_SATA_Buffer, Pointer_Buffer, HARD_DISK_SECTOR_SIZE); // Explicit cast to avoid warning due to pointer volatile attribute
+	// Fall back to synchronous commands when queuing can't be used, the DMA engine can't access a buffer that is not aligned on 2 bytes
+	for (i = 0; i < Requests_Count; i++)
+	{
+		if ((unsigned int) Pointer_Requests[i].Pointer_Buffer & 1) break;
+	}
+	if (!Hard_Disk_SATA_Is_Command_Queuing_Available || (i < Requests_Count))
+	{
+		for (i = 0; i < Requests_Count; i++) HardDiskSATATransferSectorsSynchronously(Is_Write_Operation, Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+		return;
+	}
 	
-	// Execute the command and wait for its completion
-	HardDiskSATAControllerExecuteCommand();
+	// All slots up to the queue depth are available
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		Pointer_Drive = &Hard_Disk_SATA_Drives[i];
+		if (Pointer_Drive->Queue_Depth == HARD_DISK_SATA_COMMAND_SLOTS_COUNT) Pointer_Drive->Free_Slots_Mask = 0xFFFFFFFF;
+		else Pointer_Drive->Free_Slots_Mask = (1 << Pointer_Drive->Queue_Depth) - 1;
+		Pointer_Drive->Outstanding_Slots_Mask = 0;
+	}
+	
+	i = 0;
+	while (1)
+	{
+		// Keep the drives queues full, the consecutive stripes are stored on different drives so all drives work at the same time (stop issuing commands after an error, but let the other drives complete the outstanding ones because they still access the buffers)
+		while (!Is_Error)
+		{
+			// Go to the next request when the current one has been fully issued
+			if (Sectors_Count == 0)
+			{
+				if (i >= Requests_Count) break;
+				Logical_Sector_Number = Pointer_Requests[i].Logical_Sector_Number;
+				Sectors_Count = Pointer_Requests[i].Sectors_Count;
+				Pointer_Buffer = Pointer_Requests[i].Pointer_Buffer;
+				i++;
+				continue;
+			}
+			
+			// Wait for a free slot if the drive storing the next sectors is busy
+			Command_Sectors_Count = HardDiskSATAMapVolumeSector(Logical_Sector_Number, Sectors_Count, &Pointer_Drive, &Drive_Sector_Number);
+			if (Pointer_Drive->Free_Slots_Mask == 0) break;
+			
+			// Find a free slot
+			Slot_Index = 0;
+			while (!(Pointer_Drive->Free_Slots_Mask & (1 << Slot_Index))) Slot_Index++;
+			
+			// Split the request if it is too big for a single command
+			if (Command_Sectors_Count > HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND) Command_Sectors_Count = HARD_DISK_SATA_MAXIMUM_SECTORS_PER_COMMAND;
+			
+			HardDiskSATAIssueQueuedCommand(Pointer_Drive, Slot_Index, Is_Write_Operation, Drive_Sector_Number, Command_Sectors_Count, Pointer_Buffer);
+			
+			Logical_Sector_Number += Command_Sectors_Count;
+			Pointer_Buffer += Command_Sectors_Count * HARD_DISK_SECTOR_SIZE;
+			Sectors_Count -= Command_Sectors_Count;
+		}
+		
+		// Exit when all drives completed their commands
+		for (Drive_Index = 0; Drive_Index < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; Drive_Index++)
+		{
+			if (Hard_Disk_SATA_Drives[Drive_Index].Outstanding_Slots_Mask != 0) break;
+		}
+		if (Drive_Index == CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT) break;
+		
+		if (HardDiskSATAWaitForQueuedCommands(Is_Write_Operation) != 0) Is_Error = 1;
+	}
+	
+	// Reset all interrupt flags
+	Were_Interrupts_Enabled = HardDiskSATABeginWait();
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++) HardDiskSATAResetInterruptStatus(&Hard_Disk_SATA_Drives[i]);
+	HardDiskSATAEndWait(Were_Interrupts_Enabled);
+	
+	// The drive aborted all its outstanding commands, so the remaining requests are discarded too
+	if (Is_Error)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_SATA_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
 }
 
-unsigned int HardDiskGetDriveSizeSectors(void)
+void HardDiskFlushCache(void)
 {
-	unsigned int Sectors_Count;
+	unsigned int i;
+	unsigned long long Start_Timestamp;
+	int Is_Error;
 	
-	// Configure the Command List slot
-	HardDiskSATAPrepareCommand(0, 1); // Read operation, allow data to be prefetched
+	// The queued commands are all completed when the request functions return, so the flush can't overtake a write
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		if (!Hard_Disk_SATA_Drives[i].Is_Write_Cache_Enabled) continue;
+		
+		Start_Timestamp = HardDiskStatisticsGetTimestamp();
+		Is_Error = HardDiskSATAExecuteNonDataCommand(&Hard_Disk_SATA_Drives[i], 0, HARD_DISK_SATA_COMMAND_FLUSH);
+		HardDiskStatisticsRecordFlush(Start_Timestamp, Is_Error);
+	}
+}
+
+int HardDiskSetWriteCacheEnabled(int Is_Enabled)
+{
+	unsigned int i;
 	
-	// Create the H2D FIS content
-	Hard_Disk_SATA_Command_Table.Command_Frame_Information_Structure.Command = HARD_DISK_SATA_COMMAND_IDENTIFY_DEVICE; // Set the command
+	// All drives must behave the same way, otherwise the volume would be partially cached
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		if (!Hard_Disk_SATA_Drives[i].Is_Write_Cache_Supported) return 1;
+	}
 	
-	// Execute the command and wait for its completion
-	HardDiskSATAControllerExecuteCommand();
+	if (Is_Enabled)
+	{
+		for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+		{
+			if (HardDiskSATAExecuteNonDataCommand(&Hard_Disk_SATA_Drives[i], HARD_DISK_SATA_FEATURE_ENABLE_WRITE_CACHE, HARD_DISK_SATA_COMMAND_SET_FEATURES) != 0) return 1;
+			Hard_Disk_SATA_Drives[i].Is_Write_Cache_Enabled = 1;
+		}
+	}
+	else
+	{
+		// Do not lose the cached data
+		HardDiskFlushCache();
+		for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+		{
+			if (HardDiskSATAExecuteNonDataCommand(&Hard_Disk_SATA_Drives[i], HARD_DISK_SATA_FEATURE_DISABLE_WRITE_CACHE, HARD_DISK_SATA_COMMAND_SET_FEATURES) != 0) return 1;
+			Hard_Disk_SATA_Drives[i].Is_Write_Cache_Enabled = 0;
+		}
+	}
+	return 0;
+}
+
+int HardDiskIsWriteCacheEnabled(void)
+{
+	unsigned int i;
 	
-	// Retrieve the sectors count value
-	Sectors_Count = (Hard_Disk_SATA_Buffer[203] << 24) | (Hard_Disk_SATA_Buffer[202] << 16) | (Hard_Disk_SATA_Buffer[201] << 8) | Hard_Disk_SATA_Buffer[200];
+	// A single caching drive is enough for the volume to acknowledge writes before storing them
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		if (Hard_Disk_SATA_Drives[i].Is_Write_Cache_Enabled) return 1;
+	}
+	return 0;
+}
+
+void *HardDiskMapSector(unsigned int __attribute__((unused)) Logical_Sector_Number)
+{
+	// The data can only be reached through the controller
+	return NULL;
+}
+
+unsigned int HardDiskGetDriveSizeSectors(void)
+{
+	unsigned int i, Sectors_Count, Smallest_Drive_Sectors_Count = 0xFFFFFFFF;
+	
+	// Each drive stores the same amount of stripes, so the smallest drive limits the volume size
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		Sectors_Count = HardDiskSATAGetDriveSizeSectors(&Hard_Disk_SATA_Drives[i]);
+		if (Sectors_Count < Smallest_Drive_Sectors_Count) Smallest_Drive_Sectors_Count = Sectors_Count;
+	}
+	
+	#if CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT > 1
+		// Only use full stripes, the sector numbers are 32-bit long so only the first 2 TB of a bigger volume can be used
+		Smallest_Drive_Sectors_Count -= Smallest_Drive_Sectors_Count % CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_STRIPE_SIZE_SECTORS;
+		if (Smallest_Drive_Sectors_Count > 0xFFFFFFFF / CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT) Sectors_Count = 0xFFFFFFFF;
+		else Sectors_Count = Smallest_Drive_Sectors_Count * CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT;
+	#else
+		Sectors_Count = Smallest_Drive_Sectors_Count;
+	#endif
 	DEBUG_SECTION_START
 		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
 		ScreenWriteString("Total sectors count : ");
@@ -487,6 +1236,21 @@ unsigned int HardDiskGetDriveSizeSectors(void)
 		KeyboardReadCharacter();
 	DEBUG_SECTION_END
 	
-	// TODO handle 48-bit value
 	return Sectors_Count;
-}
\ No newline at end of file
+}
+
+void HardDiskInterruptHandler(void)
+{
+	unsigned int i, Interrupt_Status;
+	volatile THardDiskSATAPortRegisters *Pointer_Port_Registers;
+	
+	// Keep each port interrupt causes for the waiting code, then acknowledge them so the controller stops asserting its interrupt line
+	for (i = 0; i < CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_SATA_DRIVES_COUNT; i++)
+	{
+		Pointer_Port_Registers = Hard_Disk_SATA_Drives[i].Pointer_Port_Registers;
+		Interrupt_Status = Pointer_Port_Registers->Interrupt_Status;
+		Hard_Disk_SATA_Drives[i].Recorded_Interrupt_Status |= Interrupt_Status;
+		Pointer_Port_Registers->Interrupt_Status = Interrupt_Status; // Set a flag to '1' to reset it
+	}
+	Pointer_Hard_Disk_SATA_Generic_Host_Control_Registers->Interrupt_Status = Hard_Disk_SATA_Ports_Mask; // The port flags must be reset before the global ones
+}
@@ -0,0 +1,159 @@
+/** @file Driver_Hard_Disk_Statistics.c
+ * See Driver_Hard_Disk_Statistics.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Architecture.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
+#include <Drivers/Driver_Timer.h>
+#include <Standard_Functions.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants and macros
+//-------------------------------------------------------------------------------------------------
+/** How many timer periods of 1 ms the timestamp counter frequency measurement lasts. */
+#define HARD_DISK_STATISTICS_CALIBRATION_PERIODS_COUNT 10
+
+/** The EFLAGS bit that can be toggled only if the processor supports the "cpuid" instruction. */
+#define HARD_DISK_STATISTICS_EFLAGS_BIT_IDENTIFICATION (1 << 21)
+/** The "cpuid" function 1 EDX register bit telling that the "rdtsc" instruction is available. */
+#define HARD_DISK_STATISTICS_CPUID_FEATURE_BIT_TIMESTAMP_COUNTER (1 << 4)
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** All counters, the clock frequency is measured when the driver is initialized. */
+static TSystemCallHardDiskStatistics Hard_Disk_Statistics;
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+int Hard_Disk_Statistics_Is_Timestamp_Counter_Available = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Find the histogram bucket corresponding to a command duration.
+ * @param Cycles_Count The command duration in timestamp counter cycles.
+ * @return The bucket index, which is the duration base 2 logarithm.
+ */
+static unsigned int HardDiskStatisticsGetLatencyBucketIndex(unsigned long long Cycles_Count)
+{
+	unsigned int High_Double_Word, Low_Double_Word, Bucket_Index;
+	
+	// Find the most significant bit set without using a 64-bit operation that would need the compiler runtime library
+	High_Double_Word = (unsigned int) (Cycles_Count >> 32);
+	Low_Double_Word = (unsigned int) Cycles_Count;
+	if (High_Double_Word != 0) Bucket_Index = 63 - __builtin_clz(High_Double_Word);
+	else if (Low_Double_Word != 0) Bucket_Index = 31 - __builtin_clz(Low_Double_Word);
+	else Bucket_Index = 0;
+	
+	// Very long commands (several minutes) share the last bucket
+	if (Bucket_Index >= SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT) Bucket_Index = SYSTEM_CALL_HARD_DISK_STATISTICS_LATENCY_BUCKETS_COUNT - 1;
+	return Bucket_Index;
+}
+
+/** Tell whether the processor has a timestamp counter.
+ * @return 1 if the "rdtsc" instruction can be used,
+ * @return 0 if the processor has no timestamp counter.
+ */
+static int HardDiskStatisticsIsTimestampCounterAvailable(void)
+{
+	unsigned int Changed_Flags, Features;
+	
+	// The i486 and older processors have no "cpuid" instruction, only the newer ones can toggle the EFLAGS identification bit
+	asm
+	(
+		"pushfd\n"
+		"pop eax\n"
+		"mov ecx, eax\n"
+		"xor eax, %1\n"
+		"push eax\n"
+		"popfd\n"
+		"pushfd\n"
+		"pop eax\n"
+		"push ecx\n"
+		"popfd\n" // Restore the original flags
+		"xor eax, ecx"
+		: "=a" (Changed_Flags)
+		: "i" (HARD_DISK_STATISTICS_EFLAGS_BIT_IDENTIFICATION)
+		: "ecx", "cc"
+	);
+	if (!(Changed_Flags & HARD_DISK_STATISTICS_EFLAGS_BIT_IDENTIFICATION)) return 0;
+	
+	// Get the processor features
+	asm volatile ("cpuid" : "=d" (Features) : "a" (1) : "ebx", "ecx");
+	if (Features & HARD_DISK_STATISTICS_CPUID_FEATURE_BIT_TIMESTAMP_COUNTER) return 1;
+	return 0;
+}
+
+/** Measure the timestamp counter frequency against the timer.
+ * @return How many timestamp counter cycles elapse in 1 ms.
+ */
+static unsigned int HardDiskStatisticsMeasureCyclesPerMillisecond(void)
+{
+	unsigned int Timer_Start_Value;
+	unsigned long long Start_Timestamp;
+	int Were_Interrupts_Enabled;
+	
+	// The timer counter is only incremented when the interrupts are enabled
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	
+	// Start on a timer period boundary
+	Timer_Start_Value = Timer_Counter;
+	while (Timer_Counter == Timer_Start_Value) ARCHITECTURE_INTERRUPTS_WAIT();
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	
+	Timer_Start_Value = Timer_Counter;
+	while (Timer_Counter - Timer_Start_Value < HARD_DISK_STATISTICS_CALIBRATION_PERIODS_COUNT) ARCHITECTURE_INTERRUPTS_WAIT();
+	
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+	
+	// Less than 2^32 cycles elapse during the measurement with any existing processor, so a 32-bit division is enough
+	return (unsigned int) (HardDiskStatisticsGetTimestamp() - Start_Timestamp) / HARD_DISK_STATISTICS_CALIBRATION_PERIODS_COUNT;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void HardDiskStatisticsInitialize(void)
+{
+	if (!HardDiskStatisticsIsTimestampCounterAvailable()) return; // The frequency stays zero to tell that the latencies are not measured
+	Hard_Disk_Statistics_Is_Timestamp_Counter_Available = 1;
+	
+	Hard_Disk_Statistics.Cycles_Per_Millisecond = HardDiskStatisticsMeasureCyclesPerMillisecond();
+}
+
+void HardDiskStatisticsRecordTransfer(int Is_Write_Operation, unsigned int Sectors_Count, unsigned long long Start_Timestamp, int Is_Error)
+{
+	unsigned int Bucket_Index;
+	
+	Bucket_Index = HardDiskStatisticsGetLatencyBucketIndex(HardDiskStatisticsGetTimestamp() - Start_Timestamp);
+	
+	if (Is_Write_Operation)
+	{
+		Hard_Disk_Statistics.Write_Commands_Count++;
+		Hard_Disk_Statistics.Written_Sectors_Count += Sectors_Count;
+		Hard_Disk_Statistics.Write_Latency_Histogram[Bucket_Index]++;
+	}
+	else
+	{
+		Hard_Disk_Statistics.Read_Commands_Count++;
+		Hard_Disk_Statistics.Read_Sectors_Count += Sectors_Count;
+		Hard_Disk_Statistics.Read_Latency_Histogram[Bucket_Index]++;
+	}
+	
+	if (Is_Error) Hard_Disk_Statistics.Errors_Count++;
+}
+
+void HardDiskStatisticsRecordFlush(unsigned long long Start_Timestamp, int Is_Error)
+{
+	Hard_Disk_Statistics.Flush_Commands_Count++;
+	Hard_Disk_Statistics.Flush_Latency_Histogram[HardDiskStatisticsGetLatencyBucketIndex(HardDiskStatisticsGetTimestamp() - Start_Timestamp)]++;
+	
+	if (Is_Error) Hard_Disk_Statistics.Errors_Count++;
+}
+
+void HardDiskStatisticsGet(TSystemCallHardDiskStatistics *Pointer_Statistics)
+{
+	memcpy(Pointer_Statistics, &Hard_Disk_Statistics, sizeof(Hard_Disk_Statistics));
+}
@@ -0,0 +1,630 @@
+/** @file Driver_Hard_Disk_Virtio.c
+ * Virtio block device driver, using the legacy PCI transport provided by QEMU and KVM. This driver is based on Virtual I/O Device (VIRTIO) Version 1.0 Specification, section "Legacy Interfaces".
+ * @author Adrien RICCIARDI
+ */
+#include <Architecture.h>
+#include <Configuration.h>
+#include <Debug.h>
+#include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
+#include <Drivers/Driver_PCI.h>
+#include <Hardware_Functions.h>
+#include <Standard_Functions.h>
+#include <Strings.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The transitional block device PCI device ID. */
+#define HARD_DISK_VIRTIO_PCI_DEVICE_ID_BLOCK 0x1001
+
+// Legacy I/O registers offsets (relative to BAR 0)
+/** Device Features register (32 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_DEVICE_FEATURES 0x00
+/** Guest Features register (32 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_GUEST_FEATURES 0x04
+/** Queue Address register (32 bits), it holds the virtqueue physical page number. */
+#define HARD_DISK_VIRTIO_REGISTER_QUEUE_ADDRESS 0x08
+/** Queue Size register (16 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_QUEUE_SIZE 0x0C
+/** Queue Select register (16 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_QUEUE_SELECT 0x0E
+/** Queue Notify register (16 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_QUEUE_NOTIFY 0x10
+/** Device Status register (8 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_DEVICE_STATUS 0x12
+/** ISR Status register (8 bits), reading it acknowledges the interrupt. */
+#define HARD_DISK_VIRTIO_REGISTER_ISR_STATUS 0x13
+/** The block device configuration "capacity" field (64 bits), the device-specific configuration follows the common registers when MSI-X is disabled. */
+#define HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_CAPACITY 0x14
+/** The block device configuration "size_max" field (32 bits). */
+#define HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_SIZE_MAXIMUM 0x1C
+/** The block device configuration "writeback" field (8 bits), it tells whether the write cache is enabled. */
+#define HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_WRITEBACK 0x34
+
+// Device Status register bits
+/** ACKNOWLEDGE bit. */
+#define HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_ACKNOWLEDGE (1 << 0)
+/** DRIVER bit. */
+#define HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_DRIVER (1 << 1)
+/** DRIVER_OK bit. */
+#define HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_DRIVER_OK (1 << 2)
+/** FAILED bit. */
+#define HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_FAILED (1 << 7)
+
+// Block device feature bits
+/** VIRTIO_BLK_F_SIZE_MAX bit, the size_max configuration field is valid. */
+#define HARD_DISK_VIRTIO_BIT_FEATURE_SIZE_MAXIMUM (1 << 1)
+/** VIRTIO_BLK_F_FLUSH bit, the device has a write cache and handles the flush requests. */
+#define HARD_DISK_VIRTIO_BIT_FEATURE_FLUSH (1 << 9)
+/** VIRTIO_BLK_F_CONFIG_WCE bit, the write cache can be enabled or disabled with the writeback configuration field. */
+#define HARD_DISK_VIRTIO_BIT_FEATURE_CONFIGURABLE_WRITE_CACHE (1 << 11)
+
+// Descriptor flags
+/** VIRTQ_DESC_F_NEXT bit, the Next field is valid. */
+#define HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_NEXT (1 << 0)
+/** VIRTQ_DESC_F_WRITE bit, the buffer is written by the device. */
+#define HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_WRITE (1 << 1)
+
+/** VIRTQ_AVAIL_F_NO_INTERRUPT bit, tell the device not to send interrupts. */
+#define HARD_DISK_VIRTIO_BIT_AVAILABLE_RING_FLAGS_NO_INTERRUPT (1 << 0)
+/** VIRTQ_USED_F_NO_NOTIFY bit, the device does not need to be notified of new available buffers. */
+#define HARD_DISK_VIRTIO_BIT_USED_RING_FLAGS_NO_NOTIFY (1 << 0)
+
+// Block request types
+/** VIRTIO_BLK_T_IN request, read sectors. */
+#define HARD_DISK_VIRTIO_REQUEST_TYPE_READ 0
+/** VIRTIO_BLK_T_OUT request, write sectors. */
+#define HARD_DISK_VIRTIO_REQUEST_TYPE_WRITE 1
+/** VIRTIO_BLK_T_FLUSH request, write the cache content to the media. */
+#define HARD_DISK_VIRTIO_REQUEST_TYPE_FLUSH 4
+
+/** VIRTIO_BLK_S_OK request status. */
+#define HARD_DISK_VIRTIO_REQUEST_STATUS_SUCCESS 0
+
+/** The legacy interface virtqueue parts alignment, it is also the Queue Address register unit. */
+#define HARD_DISK_VIRTIO_QUEUE_ALIGNMENT 4096
+/** The biggest queue size the driver can handle (QEMU uses 256 entries by default), the device imposes its queue size with the legacy interface. */
+#define HARD_DISK_VIRTIO_MAXIMUM_QUEUE_SIZE 256
+
+/** Each request uses a fixed chain of 3 descriptors : the request header, the data buffer and the status byte. */
+#define HARD_DISK_VIRTIO_DESCRIPTORS_PER_REQUEST 3
+/** How many requests can be in flight at the same time, the device can execute them in any order. */
+#define HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT 32
+
+/** The maximum bytes count a single data descriptor describes when the device does not impose a limit. */
+#define HARD_DISK_VIRTIO_DEFAULT_MAXIMUM_BYTES_PER_REQUEST (4 * 1024 * 1024)
+
+/** Round a value up to the virtqueue alignment. */
+#define HARD_DISK_VIRTIO_ALIGN(Value) (((Value) + HARD_DISK_VIRTIO_QUEUE_ALIGNMENT - 1) & ~(HARD_DISK_VIRTIO_QUEUE_ALIGNMENT - 1))
+/** The available ring offset in the virtqueue memory area. */
+#define HARD_DISK_VIRTIO_AVAILABLE_RING_OFFSET(Queue_Size) (sizeof(THardDiskVirtioDescriptor) * (Queue_Size))
+/** The used ring offset in the virtqueue memory area, it must be aligned on a page. */
+#define HARD_DISK_VIRTIO_USED_RING_OFFSET(Queue_Size) HARD_DISK_VIRTIO_ALIGN(HARD_DISK_VIRTIO_AVAILABLE_RING_OFFSET(Queue_Size) + (sizeof(unsigned short) * (3 + (Queue_Size))))
+/** The whole virtqueue size. */
+#define HARD_DISK_VIRTIO_QUEUE_SIZE_BYTES(Queue_Size) (HARD_DISK_VIRTIO_USED_RING_OFFSET(Queue_Size) + HARD_DISK_VIRTIO_ALIGN((sizeof(unsigned short) * 3) + (sizeof(THardDiskVirtioUsedRingElement) * (Queue_Size))))
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** A virtqueue descriptor, describing a guest buffer. */
+typedef struct __attribute__((packed))
+{
+	unsigned long long Address; //!< The buffer physical address.
+	unsigned int Length; //!< The buffer size in bytes.
+	unsigned short Flags;
+	unsigned short Next; //!< The next descriptor index in the chain.
+} THardDiskVirtioDescriptor;
+
+/** The available ring, where the driver puts the descriptor chains the device must process. */
+typedef struct __attribute__((packed))
+{
+	unsigned short Flags;
+	unsigned short Index; //!< Where the driver will put the next entry in the ring (this value is never wrapped).
+	unsigned short Ring[]; //!< The descriptor chain heads, followed by the unused "used_event" field.
+} THardDiskVirtioAvailableRing;
+
+/** A used ring element, describing a processed descriptor chain. */
+typedef struct __attribute__((packed))
+{
+	unsigned int ID; //!< The descriptor chain head index.
+	unsigned int Length; //!< How many bytes were written to the chain buffers.
+} THardDiskVirtioUsedRingElement;
+
+/** The used ring, where the device puts the processed descriptor chains. */
+typedef struct __attribute__((packed))
+{
+	unsigned short Flags;
+	unsigned short Index; //!< Where the device will put the next entry in the ring (this value is never wrapped).
+	THardDiskVirtioUsedRingElement Ring[]; //!< The processed chains, followed by the unused "avail_event" field.
+} THardDiskVirtioUsedRing;
+
+/** A block request header, read by the device. */
+typedef struct __attribute__((packed))
+{
+	unsigned int Type; //!< Read, write or flush.
+	unsigned int Reserved;
+	unsigned long long Sector; //!< The first sector to access, always in 512-byte unit.
+} THardDiskVirtioRequestHeader;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The device legacy registers I/O base address. */
+static unsigned short Hard_Disk_Virtio_Base_Port;
+
+/** The features negotiated with the device. */
+static unsigned int Hard_Disk_Virtio_Features;
+
+/** Set to 1 when the device interrupt is routed to the processor, so the waiting code can halt the processor instead of polling the used ring. */
+static int Hard_Disk_Virtio_Is_Interrupt_Available = 0;
+
+/** The request queue memory (descriptors table, available ring and used ring), sized for the biggest supported queue. */
+static volatile unsigned char __attribute__((aligned(HARD_DISK_VIRTIO_QUEUE_ALIGNMENT))) Hard_Disk_Virtio_Queue[HARD_DISK_VIRTIO_QUEUE_SIZE_BYTES(HARD_DISK_VIRTIO_MAXIMUM_QUEUE_SIZE)];
+
+/** The request queue parts, located in Hard_Disk_Virtio_Queue according to the device queue size. */
+static volatile THardDiskVirtioDescriptor *Pointer_Hard_Disk_Virtio_Descriptors;
+static volatile THardDiskVirtioAvailableRing *Pointer_Hard_Disk_Virtio_Available_Ring;
+static volatile THardDiskVirtioUsedRing *Pointer_Hard_Disk_Virtio_Used_Ring;
+
+/** How many entries the request queue has. */
+static unsigned int Hard_Disk_Virtio_Queue_Size;
+
+/** The used ring index following the last processed entry. */
+static unsigned short Hard_Disk_Virtio_Last_Used_Index = 0;
+
+/** How many requests can be in flight at the same time, it depends on the queue size. */
+static unsigned int Hard_Disk_Virtio_Slots_Count;
+
+/** The maximum data bytes count of a single request. */
+static unsigned int Hard_Disk_Virtio_Maximum_Bytes_Per_Request;
+
+/** Each slot request header. */
+static volatile THardDiskVirtioRequestHeader Hard_Disk_Virtio_Request_Headers[HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT];
+
+/** Each slot request status, written by the device. */
+static volatile unsigned char Hard_Disk_Virtio_Request_Statuses[HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT];
+
+/** When each slot request was posted, to measure its latency on completion. */
+static unsigned long long Hard_Disk_Virtio_Slots_Start_Timestamp[HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT];
+/** How many sectors each slot request transfers. */
+static unsigned int Hard_Disk_Virtio_Slots_Sectors_Count[HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT];
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Disable the interrupts so a waiting condition can be checked without missing the interrupt that would wake the processor up.
+ * @return 1 if the interrupts were enabled by the caller, 0 if they were already disabled.
+ */
+static int HardDiskVirtioBeginWait(void)
+{
+	int Were_Interrupts_Enabled;
+	
+	Were_Interrupts_Enabled = ArchitectureAreInterruptsEnabled();
+	ARCHITECTURE_INTERRUPTS_DISABLE();
+	return Were_Interrupts_Enabled;
+}
+
+/** Halt the processor until the next interrupt, or return immediately if the used ring must be polled.
+ * @param Were_Interrupts_Enabled The value returned by HardDiskVirtioBeginWait(). The processor can't be halted when the caller runs with the interrupts disabled (system calls, timer handler...).
+ * @note The waiting condition must be checked again after each call, the timer interrupt also wakes the processor up.
+ */
+static inline __attribute__((always_inline)) void HardDiskVirtioWaitForInterrupt(int Were_Interrupts_Enabled)
+{
+	if (Were_Interrupts_Enabled && Hard_Disk_Virtio_Is_Interrupt_Available) ARCHITECTURE_INTERRUPTS_WAIT();
+}
+
+/** Restore the caller interrupts state.
+ * @param Were_Interrupts_Enabled The value returned by HardDiskVirtioBeginWait().
+ */
+static inline __attribute__((always_inline)) void HardDiskVirtioEndWait(int Were_Interrupts_Enabled)
+{
+	if (Were_Interrupts_Enabled) ARCHITECTURE_INTERRUPTS_ENABLE();
+}
+
+/** Fill a slot descriptor chain and make it available to the device. The device is not notified.
+ * @param Slot_Index The slot to use.
+ * @param Is_Write_Operation Set to 1 to write the sectors, set to 0 to read them.
+ * @param Logical_Sector_Number The first LBA sector to access.
+ * @param Pointer_Buffer The data buffer.
+ * @param Bytes_Count The data size, it can't exceed Hard_Disk_Virtio_Maximum_Bytes_Per_Request.
+ */
+static void HardDiskVirtioPostRequest(unsigned int Slot_Index, int Is_Write_Operation, unsigned int Logical_Sector_Number, void *Pointer_Buffer, unsigned int Bytes_Count)
+{
+	unsigned int First_Descriptor_Index = Slot_Index * HARD_DISK_VIRTIO_DESCRIPTORS_PER_REQUEST;
+	volatile THardDiskVirtioDescriptor *Pointer_Data_Descriptor = &Pointer_Hard_Disk_Virtio_Descriptors[First_Descriptor_Index + 1];
+	
+	// Fill the request header
+	if (Is_Write_Operation) Hard_Disk_Virtio_Request_Headers[Slot_Index].Type = HARD_DISK_VIRTIO_REQUEST_TYPE_WRITE;
+	else Hard_Disk_Virtio_Request_Headers[Slot_Index].Type = HARD_DISK_VIRTIO_REQUEST_TYPE_READ;
+	Hard_Disk_Virtio_Request_Headers[Slot_Index].Sector = Logical_Sector_Number;
+	Hard_Disk_Virtio_Request_Statuses[Slot_Index] = 0xFF; // Make sure a status not written by the device is seen as an error
+	
+	// Describe the data buffer, the header and status descriptors never change (the kernel memory is not paged, so the buffer is physically contiguous)
+	Pointer_Data_Descriptor->Address = (unsigned int) Pointer_Buffer;
+	Pointer_Data_Descriptor->Length = Bytes_Count;
+	if (Is_Write_Operation) Pointer_Data_Descriptor->Flags = HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_NEXT;
+	else Pointer_Data_Descriptor->Flags = HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_NEXT | HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_WRITE; // The device fills the buffer
+	
+	Hard_Disk_Virtio_Slots_Start_Timestamp[Slot_Index] = HardDiskStatisticsGetTimestamp();
+	Hard_Disk_Virtio_Slots_Sectors_Count[Slot_Index] = Bytes_Count / HARD_DISK_SECTOR_SIZE;
+	
+	// Add the chain head to the available ring, the device will see it only when the ring index is updated
+	Pointer_Hard_Disk_Virtio_Available_Ring->Ring[Pointer_Hard_Disk_Virtio_Available_Ring->Index % Hard_Disk_Virtio_Queue_Size] = First_Descriptor_Index;
+	Pointer_Hard_Disk_Virtio_Available_Ring->Index++;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int HardDiskInitialize(void)
+{
+	TPCIDeviceID Virtio_Device_ID;
+	TPCIConfigurationSpaceHeader Device_Configuration_Space_Header;
+	unsigned int i, Descriptor_Index;
+	int Were_Interrupts_Enabled;
+	
+	// Find the virtio block device on the PCI bus
+	if (PCIFindDeviceFromIDs(PCI_VENDOR_ID_VIRTIO, HARD_DISK_VIRTIO_PCI_DEVICE_ID_BLOCK, &Virtio_Device_ID) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : no virtio block device found.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	// Get the device properties
+	if (PCIGetConfigurationSpaceHeader(&Virtio_Device_ID, &Device_Configuration_Space_Header) != 0)
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : failed to get the virtio block device Configuration Space Header.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	
+	// The legacy registers are always located in the I/O space
+	if (!(Device_Configuration_Space_Header.Base_Address_Registers[0] & 1))
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : the device does not provide the legacy interface.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		return 2;
+	}
+	Hard_Disk_Virtio_Base_Port = PCI_GET_BASE_ADDRESS(Device_Configuration_Space_Header.Base_Address_Registers[0]);
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Virtio block device found, I/O base address : 0x");
+		DebugWriteHexadecimalInteger(Hard_Disk_Virtio_Base_Port);
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	// The device reads and writes the queue and the data buffers by itself
+	PCIEnableBusMastering(&Virtio_Device_ID);
+	
+	// Reset the device, then tell it that a driver has been found
+	outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_DEVICE_STATUS, 0);
+	outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_DEVICE_STATUS, HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_ACKNOWLEDGE);
+	outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_DEVICE_STATUS, HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_ACKNOWLEDGE | HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_DRIVER);
+	
+	// Only use the maximum request size and the write cache features, the other ones are not needed
+	Hard_Disk_Virtio_Features = ind(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_DEVICE_FEATURES) & (HARD_DISK_VIRTIO_BIT_FEATURE_SIZE_MAXIMUM | HARD_DISK_VIRTIO_BIT_FEATURE_FLUSH | HARD_DISK_VIRTIO_BIT_FEATURE_CONFIGURABLE_WRITE_CACHE);
+	outd(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_GUEST_FEATURES, Hard_Disk_Virtio_Features);
+	
+	// Use the biggest requests the device allows, keeping the data size a multiple of the sector size
+	Hard_Disk_Virtio_Maximum_Bytes_Per_Request = HARD_DISK_VIRTIO_DEFAULT_MAXIMUM_BYTES_PER_REQUEST;
+	if (Hard_Disk_Virtio_Features & HARD_DISK_VIRTIO_BIT_FEATURE_SIZE_MAXIMUM)
+	{
+		i = ind(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_SIZE_MAXIMUM) & ~(HARD_DISK_SECTOR_SIZE - 1);
+		if ((i > 0) && (i < Hard_Disk_Virtio_Maximum_Bytes_Per_Request)) Hard_Disk_Virtio_Maximum_Bytes_Per_Request = i;
+	}
+	
+	// Get the request queue size, the device imposes it with the legacy interface
+	outw(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_QUEUE_SELECT, 0);
+	Hard_Disk_Virtio_Queue_Size = inw(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_QUEUE_SIZE);
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Queue size : ");
+		ScreenWriteString(itoa(Hard_Disk_Virtio_Queue_Size));
+		ScreenWriteString(", maximum bytes per request : ");
+		ScreenWriteString(itoa(Hard_Disk_Virtio_Maximum_Bytes_Per_Request));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	if ((Hard_Disk_Virtio_Queue_Size < HARD_DISK_VIRTIO_DESCRIPTORS_PER_REQUEST) || (Hard_Disk_Virtio_Queue_Size > HARD_DISK_VIRTIO_MAXIMUM_QUEUE_SIZE))
+	{
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("Error : unsupported queue size.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+		outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_DEVICE_STATUS, HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_FAILED);
+		return 2;
+	}
+	
+	// Keep as many requests in flight as the descriptors allow
+	Hard_Disk_Virtio_Slots_Count = Hard_Disk_Virtio_Queue_Size / HARD_DISK_VIRTIO_DESCRIPTORS_PER_REQUEST;
+	if (Hard_Disk_Virtio_Slots_Count > HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT) Hard_Disk_Virtio_Slots_Count = HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT;
+	
+	// Lay the queue parts out as the legacy interface requires
+	memset((void *) Hard_Disk_Virtio_Queue, 0, sizeof(Hard_Disk_Virtio_Queue)); // Explicit cast to avoid warning due to pointer volatile attribute
+	Pointer_Hard_Disk_Virtio_Descriptors = (volatile THardDiskVirtioDescriptor *) Hard_Disk_Virtio_Queue;
+	Pointer_Hard_Disk_Virtio_Available_Ring = (volatile THardDiskVirtioAvailableRing *) (Hard_Disk_Virtio_Queue + HARD_DISK_VIRTIO_AVAILABLE_RING_OFFSET(Hard_Disk_Virtio_Queue_Size));
+	Pointer_Hard_Disk_Virtio_Used_Ring = (volatile THardDiskVirtioUsedRing *) (Hard_Disk_Virtio_Queue + HARD_DISK_VIRTIO_USED_RING_OFFSET(Hard_Disk_Virtio_Queue_Size));
+	Hard_Disk_Virtio_Last_Used_Index = 0;
+	
+	// Build each slot fixed descriptor chain : the header, the data buffer (filled for each request) and the status byte
+	for (i = 0; i < Hard_Disk_Virtio_Slots_Count; i++)
+	{
+		Descriptor_Index = i * HARD_DISK_VIRTIO_DESCRIPTORS_PER_REQUEST;
+		
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index].Address = (unsigned int) &Hard_Disk_Virtio_Request_Headers[i];
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index].Length = sizeof(THardDiskVirtioRequestHeader);
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index].Flags = HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_NEXT;
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index].Next = Descriptor_Index + 1;
+		
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index + 1].Next = Descriptor_Index + 2;
+		
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index + 2].Address = (unsigned int) &Hard_Disk_Virtio_Request_Statuses[i];
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index + 2].Length = 1;
+		Pointer_Hard_Disk_Virtio_Descriptors[Descriptor_Index + 2].Flags = HARD_DISK_VIRTIO_BIT_DESCRIPTOR_FLAGS_WRITE;
+	}
+	
+	// Give the queue to the device
+	outd(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_QUEUE_ADDRESS, (unsigned int) Hard_Disk_Virtio_Queue / HARD_DISK_VIRTIO_QUEUE_ALIGNMENT);
+	
+	// Route the device interrupt to the processor if the firmware assigned a legacy interrupt line to it (lines 0 to 2 are used by the timer, the keyboard and the PIC cascade)
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Interrupt line : ");
+		ScreenWriteString(itoa(Device_Configuration_Space_Header.Interrupt_Line));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	if ((Device_Configuration_Space_Header.Interrupt_Line >= 3) && (Device_Configuration_Space_Header.Interrupt_Line <= 15))
+	{
+		ArchitectureInstallHardDiskInterruptHandler(Device_Configuration_Space_Header.Interrupt_Line);
+		
+		Were_Interrupts_Enabled = HardDiskVirtioBeginWait();
+		inb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_ISR_STATUS); // Acknowledge any pending interrupt
+		Hard_Disk_Virtio_Is_Interrupt_Available = 1;
+		HardDiskVirtioEndWait(Were_Interrupts_Enabled);
+	}
+	else
+	{
+		// Tell the device not to raise its interrupt line as nobody would acknowledge it
+		Pointer_Hard_Disk_Virtio_Available_Ring->Flags = HARD_DISK_VIRTIO_BIT_AVAILABLE_RING_FLAGS_NO_INTERRUPT;
+		
+		DEBUG_SECTION_START
+			DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+			ScreenWriteString("No usable interrupt line, the driver will poll the used ring.\n");
+			KeyboardReadCharacter();
+		DEBUG_SECTION_END
+	}
+	
+	// The device can be used now
+	outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_DEVICE_STATUS, HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_ACKNOWLEDGE | HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_DRIVER | HARD_DISK_VIRTIO_BIT_DEVICE_STATUS_DRIVER_OK);
+	
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Driver successfully initialized.\n");
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	return 0;
+}
+
+void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	HardDiskReadSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	HardDiskWriteSectors(Logical_Sector_Number, 1, Pointer_Buffer);
+}
+
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	THardDiskRequest Request;
+	
+	Request.Logical_Sector_Number = Logical_Sector_Number;
+	Request.Sectors_Count = Sectors_Count;
+	Request.Pointer_Buffer = Pointer_Buffer;
+	HardDiskExecuteRequests(0, &Request, 1);
+}
+
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	THardDiskRequest Request;
+	
+	Request.Logical_Sector_Number = Logical_Sector_Number;
+	Request.Sectors_Count = Sectors_Count;
+	Request.Pointer_Buffer = Pointer_Buffer;
+	HardDiskExecuteRequests(1, &Request, 1);
+}
+
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
+{
+	unsigned int i = 0, Free_Slots_Mask, Outstanding_Slots_Count = 0, Posted_Slots_Count, Slot_Index, Bytes_Count = 0, Request_Bytes_Count, Logical_Sector_Number = 0;
+	unsigned char *Pointer_Buffer = NULL;
+	unsigned short Used_Index;
+	int Were_Interrupts_Enabled, Is_Error_Detected = 0;
+	
+	// All slots are available
+	if (Hard_Disk_Virtio_Slots_Count == HARD_DISK_VIRTIO_MAXIMUM_SLOTS_COUNT) Free_Slots_Mask = 0xFFFFFFFF;
+	else Free_Slots_Mask = (1 << Hard_Disk_Virtio_Slots_Count) - 1;
+	
+	while (1)
+	{
+		// Fill the free slots
+		Posted_Slots_Count = 0;
+		while (Free_Slots_Mask != 0)
+		{
+			// Go to the next request when the current one has been fully posted
+			if (Bytes_Count == 0)
+			{
+				if (i >= Requests_Count) break;
+				Logical_Sector_Number = Pointer_Requests[i].Logical_Sector_Number;
+				Bytes_Count = Pointer_Requests[i].Sectors_Count * HARD_DISK_SECTOR_SIZE;
+				Pointer_Buffer = Pointer_Requests[i].Pointer_Buffer;
+				i++;
+				continue;
+			}
+			
+			// Find a free slot
+			Slot_Index = 0;
+			while (!(Free_Slots_Mask & (1 << Slot_Index))) Slot_Index++;
+			
+			// Split the request if it is too big for the device
+			if (Bytes_Count > Hard_Disk_Virtio_Maximum_Bytes_Per_Request) Request_Bytes_Count = Hard_Disk_Virtio_Maximum_Bytes_Per_Request;
+			else Request_Bytes_Count = Bytes_Count;
+			
+			HardDiskVirtioPostRequest(Slot_Index, Is_Write_Operation, Logical_Sector_Number, Pointer_Buffer, Request_Bytes_Count);
+			Free_Slots_Mask &= ~(1 << Slot_Index);
+			Posted_Slots_Count++;
+			
+			Logical_Sector_Number += Request_Bytes_Count / HARD_DISK_SECTOR_SIZE;
+			Pointer_Buffer += Request_Bytes_Count;
+			Bytes_Count -= Request_Bytes_Count;
+		}
+		
+		// Notify the device only once for all the posted requests, unless it is already processing the available ring
+		if ((Posted_Slots_Count > 0) && !(Pointer_Hard_Disk_Virtio_Used_Ring->Flags & HARD_DISK_VIRTIO_BIT_USED_RING_FLAGS_NO_NOTIFY)) outw(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_QUEUE_NOTIFY, 0);
+		Outstanding_Slots_Count += Posted_Slots_Count;
+		
+		// Exit when all requests are completed
+		if (Outstanding_Slots_Count == 0) break;
+		
+		// Wait for at least one request completion
+		Were_Interrupts_Enabled = HardDiskVirtioBeginWait();
+		while (Pointer_Hard_Disk_Virtio_Used_Ring->Index == Hard_Disk_Virtio_Last_Used_Index) HardDiskVirtioWaitForInterrupt(Were_Interrupts_Enabled);
+		HardDiskVirtioEndWait(Were_Interrupts_Enabled);
+		
+		// Release the completed slots (read the ring index only once because more requests may complete meanwhile)
+		Used_Index = Pointer_Hard_Disk_Virtio_Used_Ring->Index;
+		while (Hard_Disk_Virtio_Last_Used_Index != Used_Index)
+		{
+			Slot_Index = Pointer_Hard_Disk_Virtio_Used_Ring->Ring[Hard_Disk_Virtio_Last_Used_Index % Hard_Disk_Virtio_Queue_Size].ID / HARD_DISK_VIRTIO_DESCRIPTORS_PER_REQUEST;
+			if (Hard_Disk_Virtio_Request_Statuses[Slot_Index] != HARD_DISK_VIRTIO_REQUEST_STATUS_SUCCESS)
+			{
+				HardDiskStatisticsRecordTransfer(Is_Write_Operation, Hard_Disk_Virtio_Slots_Sectors_Count[Slot_Index], Hard_Disk_Virtio_Slots_Start_Timestamp[Slot_Index], 1);
+				Is_Error_Detected = 1;
+			}
+			else HardDiskStatisticsRecordTransfer(Is_Write_Operation, Hard_Disk_Virtio_Slots_Sectors_Count[Slot_Index], Hard_Disk_Virtio_Slots_Start_Timestamp[Slot_Index], 0);
+			
+			Free_Slots_Mask |= 1 << Slot_Index;
+			Outstanding_Slots_Count--;
+			Hard_Disk_Virtio_Last_Used_Index++;
+		}
+	}
+	
+	// Was a request unsuccessful ?
+	if (Is_Error_Detected)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_VIRTIO_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
+void HardDiskFlushCache(void)
+{
+	volatile THardDiskVirtioDescriptor *Pointer_Header_Descriptor = &Pointer_Hard_Disk_Virtio_Descriptors[0];
+	int Were_Interrupts_Enabled, Is_Error = 0;
+	unsigned long long Start_Timestamp;
+	
+	if (!HardDiskIsWriteCacheEnabled()) return;
+	
+	// A flush request has no data buffer, so make the slot 0 header descriptor point directly to the status descriptor (all requests are completed when this function is called, so the slot is free)
+	Hard_Disk_Virtio_Request_Headers[0].Type = HARD_DISK_VIRTIO_REQUEST_TYPE_FLUSH;
+	Hard_Disk_Virtio_Request_Headers[0].Sector = 0;
+	Hard_Disk_Virtio_Request_Statuses[0] = 0xFF; // Make sure a status not written by the device is seen as an error
+	Pointer_Header_Descriptor->Next = 2;
+	
+	Start_Timestamp = HardDiskStatisticsGetTimestamp();
+	Pointer_Hard_Disk_Virtio_Available_Ring->Ring[Pointer_Hard_Disk_Virtio_Available_Ring->Index % Hard_Disk_Virtio_Queue_Size] = 0;
+	Pointer_Hard_Disk_Virtio_Available_Ring->Index++;
+	if (!(Pointer_Hard_Disk_Virtio_Used_Ring->Flags & HARD_DISK_VIRTIO_BIT_USED_RING_FLAGS_NO_NOTIFY)) outw(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_QUEUE_NOTIFY, 0);
+	
+	// Wait for the device to write the whole cache content
+	Were_Interrupts_Enabled = HardDiskVirtioBeginWait();
+	while (Pointer_Hard_Disk_Virtio_Used_Ring->Index == Hard_Disk_Virtio_Last_Used_Index) HardDiskVirtioWaitForInterrupt(Were_Interrupts_Enabled);
+	HardDiskVirtioEndWait(Were_Interrupts_Enabled);
+	Hard_Disk_Virtio_Last_Used_Index++;
+	
+	// Restore the slot read and write chain
+	Pointer_Header_Descriptor->Next = 1;
+	
+	if (Hard_Disk_Virtio_Request_Statuses[0] != HARD_DISK_VIRTIO_REQUEST_STATUS_SUCCESS) Is_Error = 1;
+	HardDiskStatisticsRecordFlush(Start_Timestamp, Is_Error);
+	
+	if (Is_Error)
+	{
+		ScreenSetColor(SCREEN_COLOR_RED);
+		ScreenWriteString(STRING_DRIVER_HARD_DISK_VIRTIO_ERROR_INPUT_OUTPUT);
+		ScreenSetColor(SCREEN_COLOR_BLUE);
+		KeyboardReadCharacter();
+	}
+}
+
+int HardDiskSetWriteCacheEnabled(int Is_Enabled)
+{
+	// The cache mode is chosen by the host when the device does not allow to configure it
+	if (!(Hard_Disk_Virtio_Features & HARD_DISK_VIRTIO_BIT_FEATURE_CONFIGURABLE_WRITE_CACHE)) return 1;
+	
+	if (Is_Enabled) outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_WRITEBACK, 1);
+	else
+	{
+		// Do not lose the cached data
+		HardDiskFlushCache();
+		outb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_WRITEBACK, 0);
+	}
+	return 0;
+}
+
+int HardDiskIsWriteCacheEnabled(void)
+{
+	// A device that can't flush its cache writes the data through
+	if (!(Hard_Disk_Virtio_Features & HARD_DISK_VIRTIO_BIT_FEATURE_FLUSH)) return 0;
+	if (!(Hard_Disk_Virtio_Features & HARD_DISK_VIRTIO_BIT_FEATURE_CONFIGURABLE_WRITE_CACHE)) return 1;
+	return inb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_WRITEBACK) != 0;
+}
+
+void *HardDiskMapSector(unsigned int __attribute__((unused)) Logical_Sector_Number)
+{
+	// The data can only be reached through the device
+	return NULL;
+}
+
+unsigned int HardDiskGetDriveSizeSectors(void)
+{
+	unsigned int Sectors_Count;
+	
+	// The sector numbers are 32-bit long, so only the first 2 TB of a bigger drive can be used
+	if (ind(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_CAPACITY + 4) != 0) Sectors_Count = 0xFFFFFFFF;
+	else Sectors_Count = ind(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_CONFIGURATION_CAPACITY);
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Total sectors count : ");
+		ScreenWriteString(itoa(Sectors_Count));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
+	return Sectors_Count;
+}
+
+void HardDiskInterruptHandler(void)
+{
+	// Reading the register acknowledges the interrupt, so the device stops asserting its interrupt line, the waiting code checks the used ring by itself
+	inb(Hard_Disk_Virtio_Base_Port + HARD_DISK_VIRTIO_REGISTER_ISR_STATUS);
+}
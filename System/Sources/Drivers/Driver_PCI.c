@@ -24,6 +24,9 @@
 /** "CONFIG_DATA" I/O port. */
 #define PCI_PORT_CONFIGURATION_DATA 0x0CFC
 
+/** The Command register Bus Master Enable bit. */
+#define PCI_COMMAND_BIT_BUS_MASTER_ENABLE (1 << 2)
+
 /** A non-existing PCI device will return this vendor ID value. */
 #define PCI_VENDOR_ID_NO_DEVICE 0xFFFF
 
@@ -141,6 +144,20 @@ int PCIGetConfigurationSpaceHeader(TPCIDeviceID *Pointer_Device_ID, TPCIConfigur
 	return 0;
 }
 
+void PCIEnableBusMastering(TPCIDeviceID *Pointer_Device_ID)
+{
+	unsigned int Command_And_Status;
+	
+	// Load the register containing the Command (low word) and Status (high word) fields
+	outd(PCI_PORT_CONFIGURATION_ADDRESS, PCI_FILL_CONFIGURATION_ADDRESS(1, Pointer_Device_ID->Bus_ID, Pointer_Device_ID->Unit_ID, Pointer_Device_ID->Function_ID, 1, 0));
+	Command_And_Status = ind(PCI_PORT_CONFIGURATION_DATA);
+	
+	// Write the Status field with zeros as its bits are cleared by writing ones
+	Command_And_Status = (Command_And_Status & 0x0000FFFF) | PCI_COMMAND_BIT_BUS_MASTER_ENABLE;
+	outd(PCI_PORT_CONFIGURATION_ADDRESS, PCI_FILL_CONFIGURATION_ADDRESS(1, Pointer_Device_ID->Bus_ID, Pointer_Device_ID->Unit_ID, Pointer_Device_ID->Function_ID, 1, 0));
+	outd(PCI_PORT_CONFIGURATION_DATA, Command_And_Status);
+}
+
 #ifdef CONFIGURATION_SYSTEM_IS_DEBUG_ENABLED
 	void PCIDebugShowDevices(void)
 	{
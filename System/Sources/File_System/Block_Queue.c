@@ -0,0 +1,177 @@
+/** @file Block_Queue.c
+ * See Block_Queue.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Configuration.h>
+#include <Drivers/Driver_Hard_Disk.h>
+#include <File_System/Block_Queue.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants and macros
+//-------------------------------------------------------------------------------------------------
+/** Tell whether a transfer starts right where a queued request ends, both on the disk and in memory. */
+#define BLOCK_QUEUE_IS_REQUEST_FOLLOWED_BY(Pointer_Request, Sector_Number, Pointer_Data) (((Pointer_Request)->Logical_Sector_Number + (Pointer_Request)->Sectors_Count == (Sector_Number)) && ((unsigned char *) (Pointer_Request)->Pointer_Buffer + ((Pointer_Request)->Sectors_Count * HARD_DISK_SECTOR_SIZE) == (unsigned char *) (Pointer_Data)))
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The queued requests, sorted by increasing sector number. */
+static THardDiskRequest Block_Queue_Requests[CONFIGURATION_FILE_SYSTEM_BLOCK_QUEUE_MAXIMUM_REQUESTS_COUNT];
+/** How many requests are queued. */
+static unsigned int Block_Queue_Requests_Count = 0;
+/** All queued requests are of this kind. */
+static int Block_Queue_Is_Write_Operation;
+
+/** The sector following the last one accessed by the previous dispatch, this is where the disk head is located. */
+static unsigned int Block_Queue_Head_Sector_Number = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Give consecutive queued requests to the hard disk driver.
+ * @param First_Request_Index The first request to dispatch.
+ * @param Requests_Count How many requests to dispatch.
+ */
+static void BlockQueueDispatch(unsigned int First_Request_Index, unsigned int Requests_Count)
+{
+	unsigned int Batch_Requests_Count;
+	
+	// Give as many requests at once as the driver can handle
+	while (Requests_Count > 0)
+	{
+		Batch_Requests_Count = Requests_Count;
+		if (Batch_Requests_Count > HARD_DISK_MAXIMUM_REQUESTS_COUNT) Batch_Requests_Count = HARD_DISK_MAXIMUM_REQUESTS_COUNT;
+		
+		HardDiskExecuteRequests(Block_Queue_Is_Write_Operation, &Block_Queue_Requests[First_Request_Index], Batch_Requests_Count);
+		
+		First_Request_Index += Batch_Requests_Count;
+		Requests_Count -= Batch_Requests_Count;
+	}
+}
+
+/** Remove a request from the queue, keeping the other requests order.
+ * @param Request_Index The request to remove.
+ */
+static void BlockQueueRemoveRequest(unsigned int Request_Index)
+{
+	Block_Queue_Requests_Count--;
+	for (; Request_Index < Block_Queue_Requests_Count; Request_Index++) Block_Queue_Requests[Request_Index] = Block_Queue_Requests[Request_Index + 1];
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void BlockQueueAddRequest(int Is_Write_Operation, unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	unsigned int i;
+	THardDiskRequest *Pointer_Request;
+	
+	if (Sectors_Count == 0) return;
+	
+	// Reads and writes are not mixed, so a read can't overtake the write of the same sectors
+	if ((Block_Queue_Requests_Count > 0) && (Is_Write_Operation != Block_Queue_Is_Write_Operation)) BlockQueueFlush();
+	Block_Queue_Is_Write_Operation = Is_Write_Operation;
+	
+	// Find where to insert the request to keep the queue sorted
+	for (i = 0; i < Block_Queue_Requests_Count; i++)
+	{
+		Pointer_Request = &Block_Queue_Requests[i];
+		
+		// Two writes to the same sectors must reach the disk in submission order, which sorting can't guarantee
+		if (Is_Write_Operation && (Logical_Sector_Number < Pointer_Request->Logical_Sector_Number + Pointer_Request->Sectors_Count) && (Pointer_Request->Logical_Sector_Number < Logical_Sector_Number + Sectors_Count))
+		{
+			BlockQueueFlush();
+			i = 0;
+			break;
+		}
+		
+		if (Pointer_Request->Logical_Sector_Number > Logical_Sector_Number) break;
+	}
+	
+	// Try to append the request to the previous one
+	if (i > 0)
+	{
+		Pointer_Request = &Block_Queue_Requests[i - 1];
+		if (BLOCK_QUEUE_IS_REQUEST_FOLLOWED_BY(Pointer_Request, Logical_Sector_Number, Pointer_Buffer))
+		{
+			Pointer_Request->Sectors_Count += Sectors_Count;
+			
+			// The grown request may fill the gap with the next one
+			if ((i < Block_Queue_Requests_Count) && BLOCK_QUEUE_IS_REQUEST_FOLLOWED_BY(Pointer_Request, Block_Queue_Requests[i].Logical_Sector_Number, Block_Queue_Requests[i].Pointer_Buffer))
+			{
+				Pointer_Request->Sectors_Count += Block_Queue_Requests[i].Sectors_Count;
+				BlockQueueRemoveRequest(i);
+			}
+			return;
+		}
+	}
+	
+	// Try to prepend the request to the next one
+	if (i < Block_Queue_Requests_Count)
+	{
+		Pointer_Request = &Block_Queue_Requests[i];
+		if ((Logical_Sector_Number + Sectors_Count == Pointer_Request->Logical_Sector_Number) && ((unsigned char *) Pointer_Buffer + (Sectors_Count * HARD_DISK_SECTOR_SIZE) == (unsigned char *) Pointer_Request->Pointer_Buffer))
+		{
+			Pointer_Request->Logical_Sector_Number = Logical_Sector_Number;
+			Pointer_Request->Sectors_Count += Sectors_Count;
+			Pointer_Request->Pointer_Buffer = Pointer_Buffer;
+			return;
+		}
+	}
+	
+	// Make room for a new request
+	if (Block_Queue_Requests_Count == CONFIGURATION_FILE_SYSTEM_BLOCK_QUEUE_MAXIMUM_REQUESTS_COUNT)
+	{
+		BlockQueueFlush();
+		Block_Queue_Is_Write_Operation = Is_Write_Operation;
+		i = 0;
+	}
+	
+	// Insert the request
+	for (Pointer_Request = &Block_Queue_Requests[Block_Queue_Requests_Count]; Pointer_Request > &Block_Queue_Requests[i]; Pointer_Request--) *Pointer_Request = *(Pointer_Request - 1);
+	Pointer_Request->Logical_Sector_Number = Logical_Sector_Number;
+	Pointer_Request->Sectors_Count = Sectors_Count;
+	Pointer_Request->Pointer_Buffer = Pointer_Buffer;
+	Block_Queue_Requests_Count++;
+}
+
+void BlockQueueFlush(void)
+{
+	unsigned int First_Request_Index, Sweep_From_Head_Distance, Sweep_From_Lowest_Distance, Gap_Distance;
+	THardDiskRequest *Pointer_Last_Request, *Pointer_Request;
+	
+	if (Block_Queue_Requests_Count == 0) return;
+	
+	// Find the first request located after the head
+	for (First_Request_Index = 0; First_Request_Index < Block_Queue_Requests_Count; First_Request_Index++)
+	{
+		if (Block_Queue_Requests[First_Request_Index].Logical_Sector_Number >= Block_Queue_Head_Sector_Number) break;
+	}
+	
+	// The requests are always served in increasing order (circular elevator), choose the sweep start that moves the head the least
+	if ((First_Request_Index > 0) && (First_Request_Index < Block_Queue_Requests_Count))
+	{
+		// Serve the requests located after the head, then go back to the lowest one
+		Pointer_Last_Request = &Block_Queue_Requests[Block_Queue_Requests_Count - 1];
+		Sweep_From_Head_Distance = (Block_Queue_Requests[First_Request_Index].Logical_Sector_Number - Block_Queue_Head_Sector_Number) + (Pointer_Last_Request->Logical_Sector_Number + Pointer_Last_Request->Sectors_Count - Block_Queue_Requests[0].Logical_Sector_Number);
+		
+		// Go back to the lowest request first, the head has to cross the gap between the requests located before and after it
+		Pointer_Request = &Block_Queue_Requests[First_Request_Index - 1];
+		if (Pointer_Request->Logical_Sector_Number + Pointer_Request->Sectors_Count < Block_Queue_Requests[First_Request_Index].Logical_Sector_Number) Gap_Distance = Block_Queue_Requests[First_Request_Index].Logical_Sector_Number - (Pointer_Request->Logical_Sector_Number + Pointer_Request->Sectors_Count);
+		else Gap_Distance = 0; // Read requests can overlap
+		Sweep_From_Lowest_Distance = (Block_Queue_Head_Sector_Number - Block_Queue_Requests[0].Logical_Sector_Number) + Gap_Distance;
+		
+		if (Sweep_From_Lowest_Distance <= Sweep_From_Head_Distance) First_Request_Index = 0;
+	}
+	else First_Request_Index = 0; // All requests are on the same side of the head
+	
+	BlockQueueDispatch(First_Request_Index, Block_Queue_Requests_Count - First_Request_Index);
+	BlockQueueDispatch(0, First_Request_Index);
+	
+	// Remember where the head stopped
+	if (First_Request_Index > 0) Pointer_Last_Request = &Block_Queue_Requests[First_Request_Index - 1];
+	else Pointer_Last_Request = &Block_Queue_Requests[Block_Queue_Requests_Count - 1];
+	Block_Queue_Head_Sector_Number = Pointer_Last_Request->Logical_Sector_Number + Pointer_Last_Request->Sectors_Count;
+	
+	Block_Queue_Requests_Count = 0;
+}
@@ -3,6 +3,7 @@
  * @author Adrien RICCIARDI
  */
 #include <Configuration.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
 #include <Error_Codes.h>
 #include <File_System/File.h>
 #include <File_System/File_System.h>
@@ -23,9 +24,23 @@ typedef struct
 	char Opening_Mode; //!< Tell if the file was open in read ('r') or write ('w') mode.
 	int Is_Entry_Free; //!< Indicate if the entry can be used to identify a new open file or not.
 	int Is_Write_Possible; //!< For a file opened in write mode, indicate if it is possible to write data or if there is no more space on the file system.
-	unsigned char Buffer[CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES]; //!< A cache used to store partial read or written data until their size reaches a block size.
+	unsigned char *Pointer_Block_Data; //!< The current block data, it points to the Buffer field or directly to the block in the RAM disk.
+	unsigned char Buffer[CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES]; //!< A cache used to store partial read or written data until their size reaches a block size (sized for the biggest block size the kernel can mount).
 } TFileDescriptor;
 
+/** A read or write request processed a block at a time by the file system calls. */
+typedef struct
+{
+	unsigned int File_Descriptor_Index; //!< The file the request applies to.
+	unsigned char *Pointer_Buffer; //!< Where to read data to or write data from (points to the next byte to process).
+	unsigned int Remaining_Bytes_Count; //!< How many bytes are left to process.
+	unsigned int Processed_Bytes_Count; //!< How many bytes were processed yet.
+	unsigned int Sequence_Number; //!< Requests are processed in the order they were submitted.
+	int Status; //!< The request result, valid only when the request is completed.
+	int Is_Completed; //!< Set when all bytes were processed or an error occurred.
+	int Is_Entry_Free; //!< Indicate if the entry can be used to submit a new request or not.
+} TFileAsynchronousRequest;
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
@@ -35,6 +50,318 @@ static unsigned int File_System_Last_Listed_File;
 /** All the file descriptors. */
 static TFileDescriptor File_Descriptors[CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT];
 
+/** All the asynchronous requests, a request identifier is its index in this table. */
+static TFileAsynchronousRequest File_Asynchronous_Requests[CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT];
+/** The sequence number to give to the next submitted request. */
+static unsigned int File_Asynchronous_Requests_Next_Sequence_Number = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Make a block the file descriptor current block. A RAM disk block is referenced in place, other blocks are read to the descriptor buffer in read mode.
+ * @param Pointer_File_Descriptor The file descriptor.
+ * @param Block The block to use.
+ */
+static void FileSetCurrentBlock(TFileDescriptor *Pointer_File_Descriptor, unsigned int Block)
+{
+	Pointer_File_Descriptor->Pointer_Block_Data = FileSystemMapBlock(Block);
+	
+	// In read mode the current block index is the next block to read
+	if (Pointer_File_Descriptor->Opening_Mode == 'r')
+	{
+		if (Pointer_File_Descriptor->Pointer_Block_Data != NULL)
+		{
+			Pointer_File_Descriptor->Current_Block_Index = File_System.Blocks_List[Block];
+			// The block is read in place, account it like a driver read so the disk statistics still reflect the file system activity
+			HardDiskStatisticsRecordTransfer(0, File_System.File_System_Informations.Block_Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES, HardDiskStatisticsGetTimestamp(), 0);
+		}
+		else
+		{
+			Pointer_File_Descriptor->Current_Block_Index = FileSystemReadBlocks(Block, 1, Pointer_File_Descriptor->Buffer);
+			Pointer_File_Descriptor->Pointer_Block_Data = Pointer_File_Descriptor->Buffer;
+		}
+	}
+	else
+	{
+		Pointer_File_Descriptor->Current_Block_Index = Block;
+		if (Pointer_File_Descriptor->Pointer_Block_Data == NULL) Pointer_File_Descriptor->Pointer_Block_Data = Pointer_File_Descriptor->Buffer; // The data will be written to the disk when the block is full
+	}
+}
+
+/** Read data from a file, see FileRead() for parameters description. The file pending asynchronous requests are not taken into account. */
+static int FileReadData(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count, unsigned int *Pointer_Bytes_Read)
+{
+	TFileDescriptor *Pointer_File_Descriptor;
+	unsigned int Bytes_To_Read, Blocks_Count, Chunk_Size;
+	unsigned char *Pointer_Buffer_Byte = Pointer_Buffer;
+	
+	// Is there something to read ?
+	if (Bytes_Count == 0)
+	{
+		*Pointer_Bytes_Read = 0;
+		return ERROR_CODE_NO_ERROR;
+	}
+	// Is the file opened ?
+	if (File_Descriptor_Index >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) return ERROR_CODE_BAD_FILE_DESCRIPTOR;
+	Pointer_File_Descriptor = &File_Descriptors[File_Descriptor_Index];
+	if (Pointer_File_Descriptor->Is_Entry_Free) return ERROR_CODE_FILE_NOT_OPENED;
+	// Is the file in read mode ?
+	if (Pointer_File_Descriptor->Opening_Mode != 'r') return ERROR_CODE_BAD_OPENING_MODE;
+	
+	// Check how many more bytes can be read from the file
+	Bytes_To_Read = Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes - Pointer_File_Descriptor->Offset_File;
+	// If there is no more byte to read the file end is reached
+	if (Bytes_To_Read == 0)
+	{
+		*Pointer_Bytes_Read = 0;
+		return ERROR_CODE_NO_ERROR;
+	}
+	
+	// Adjust remaining bytes to read count according to file size
+	if (Bytes_Count > Bytes_To_Read) Bytes_Count = Bytes_To_Read;
+	else Bytes_To_Read = Bytes_Count; // Keep bytes to read count for later
+	
+	// Read data from file
+	while (Bytes_Count > 0)
+	{
+		// Load next block when needed (i.e. when a block is fully read)
+		if (Pointer_File_Descriptor->Offset_Buffer >= File_System.File_System_Informations.Block_Size_Bytes)
+		{
+			// Read all remaining whole blocks directly to the destination buffer, so the disk receives them all at once
+			Blocks_Count = Bytes_Count / File_System.File_System_Informations.Block_Size_Bytes;
+			if (Blocks_Count > 0)
+			{
+				Pointer_File_Descriptor->Current_Block_Index = FileSystemReadBlocks(Pointer_File_Descriptor->Current_Block_Index, Blocks_Count, Pointer_Buffer_Byte);
+				Pointer_Buffer_Byte += Blocks_Count * File_System.File_System_Informations.Block_Size_Bytes;
+				Bytes_Count -= Blocks_Count * File_System.File_System_Informations.Block_Size_Bytes;
+				continue; // The descriptor buffer is still empty
+			}
+			
+			FileSetCurrentBlock(Pointer_File_Descriptor, Pointer_File_Descriptor->Current_Block_Index);
+			Pointer_File_Descriptor->Offset_Buffer = 0;
+		}
+	
+		// Copy as many bytes as possible from the current block into the destination buffer
+		Chunk_Size = File_System.File_System_Informations.Block_Size_Bytes - Pointer_File_Descriptor->Offset_Buffer;
+		if (Chunk_Size > Bytes_Count) Chunk_Size = Bytes_Count;
+		memcpy(Pointer_Buffer_Byte, &Pointer_File_Descriptor->Pointer_Block_Data[Pointer_File_Descriptor->Offset_Buffer], Chunk_Size);
+		Pointer_Buffer_Byte += Chunk_Size;
+		Pointer_File_Descriptor->Offset_Buffer += Chunk_Size;
+		Bytes_Count -= Chunk_Size;
+	}
+	
+	Pointer_File_Descriptor->Offset_File += Bytes_To_Read;
+	*Pointer_Bytes_Read = Bytes_To_Read;
+
+	return ERROR_CODE_NO_ERROR;
+}
+
+/** Write data to a file, see FileWrite() for parameters description. The file pending asynchronous requests are not taken into account. */
+static int FileWriteData(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count)
+{
+	TFileDescriptor *Pointer_File_Descriptor;
+	unsigned int New_Block, Written_Bytes_Count, Chunk_Size;
+	unsigned char *Pointer_Buffer_Byte = Pointer_Buffer;
+
+	// Is the file opened ?
+	if (File_Descriptor_Index >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) return ERROR_CODE_BAD_FILE_DESCRIPTOR;
+	Pointer_File_Descriptor = &File_Descriptors[File_Descriptor_Index];
+	if (Pointer_File_Descriptor->Is_Entry_Free) return ERROR_CODE_FILE_NOT_OPENED;
+	// Is the file in write mode ?
+	if (Pointer_File_Descriptor->Opening_Mode != 'w') return ERROR_CODE_BAD_OPENING_MODE;
+	// Is there enough room on the file system to write to ?
+	if (!Pointer_File_Descriptor->Is_Write_Possible) return ERROR_CODE_BLOCKS_LIST_FULL;
+	
+	Written_Bytes_Count = Bytes_Count;
+	while (Bytes_Count > 0)
+	{
+		// Check if the cache is not full
+		if (Pointer_File_Descriptor->Offset_Buffer >= File_System.File_System_Informations.Block_Size_Bytes)
+		{
+			// Use the next block if it was preallocated (writing the current block will mark it as the last one)
+			New_Block = File_System.Blocks_List[Pointer_File_Descriptor->Current_Block_Index];
+			
+			// Flush current block to disk
+			FileSystemWriteBlocks(Pointer_File_Descriptor->Current_Block_Index, 1, Pointer_File_Descriptor->Pointer_Block_Data);
+			Pointer_File_Descriptor->Offset_Buffer = 0;
+			
+			// Try to allocate a new block
+			if (New_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) New_Block = FileSystemAllocateBlock();
+			// Has the block been allocated or the Blocks List is full ?
+			if (New_Block == FILE_SYSTEM_BLOCKS_LIST_FULL_CODE)
+			{
+				Pointer_File_Descriptor->Is_Write_Possible = 0;
+				return ERROR_CODE_BLOCKS_LIST_FULL;
+			}
+			
+			// Link the new block index to the flushed block Blocks List entry
+			File_System.Blocks_List[Pointer_File_Descriptor->Current_Block_Index] = New_Block;
+			FileSetCurrentBlock(Pointer_File_Descriptor, New_Block);
+		}
+		
+		// Copy as many bytes as possible to the current block
+		Chunk_Size = File_System.File_System_Informations.Block_Size_Bytes - Pointer_File_Descriptor->Offset_Buffer;
+		if (Chunk_Size > Bytes_Count) Chunk_Size = Bytes_Count;
+		memcpy(&Pointer_File_Descriptor->Pointer_Block_Data[Pointer_File_Descriptor->Offset_Buffer], Pointer_Buffer_Byte, Chunk_Size);
+		Pointer_File_Descriptor->Offset_Buffer += Chunk_Size;
+		Pointer_Buffer_Byte += Chunk_Size;
+		Bytes_Count -= Chunk_Size;
+	}
+	
+	// Update the file size
+	Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes += Written_Bytes_Count;
+	
+	return ERROR_CODE_NO_ERROR;
+}
+
+/** Give a blocks chain back to the free blocks list by appending the chain to the free blocks list beginning (the free blocks list head will become the chain first block).
+ * @param First_Block The chain first block.
+ */
+static void FileFreeBlocks(unsigned int First_Block)
+{
+	unsigned int Last_Block, Next_Block;
+	
+	// Find the chain last block
+	Last_Block = First_Block;
+	Next_Block = First_Block;
+	while (Next_Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
+	{
+		// Get next block
+		Next_Block = File_System.Blocks_List[Last_Block];
+		if (Next_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) break; // Keep the block that contains FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF value
+		
+		// Go to next block
+		Last_Block = Next_Block;
+	}
+	// The chain end will point to the free blocks list head
+	File_System.Blocks_List[Last_Block] = File_System.File_System_Informations.Free_Blocks_List_Head;
+	// The free blocks list head will point to the chain beginning
+	File_System.File_System_Informations.Free_Blocks_List_Head = First_Block;
+}
+
+/** Give back the preallocated blocks that were not needed by a file opened in write mode (they follow the block currently written).
+ * @param Pointer_File_Descriptor The file descriptor.
+ * @return 1 if blocks were released,
+ * @return 0 if the file had no unused preallocated block.
+ */
+static int FileReleasePreallocatedBlocks(TFileDescriptor *Pointer_File_Descriptor)
+{
+	unsigned int Unused_Block;
+	
+	Unused_Block = File_System.Blocks_List[Pointer_File_Descriptor->Current_Block_Index];
+	if (Unused_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) return 0;
+	
+	File_System.Blocks_List[Pointer_File_Descriptor->Current_Block_Index] = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+	FileFreeBlocks(Unused_Block);
+	return 1;
+}
+
+/** Find the oldest pending asynchronous request.
+ * @param File_Descriptor_Index Consider only the requests of this file, or all requests if the value is CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT.
+ * @return NULL if there is no pending request,
+ * @return a pointer on the request if one was found.
+ */
+static TFileAsynchronousRequest *FileFindOldestPendingAsynchronousRequest(unsigned int File_Descriptor_Index)
+{
+	TFileAsynchronousRequest *Pointer_Request, *Pointer_Oldest_Request = NULL;
+	int i;
+	
+	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT; i++)
+	{
+		Pointer_Request = &File_Asynchronous_Requests[i];
+		if (Pointer_Request->Is_Entry_Free || Pointer_Request->Is_Completed) continue;
+		if ((File_Descriptor_Index != CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) && (Pointer_Request->File_Descriptor_Index != File_Descriptor_Index)) continue;
+		
+		// Compare sequence numbers difference to stay correct when the counter wraps around
+		if ((Pointer_Oldest_Request == NULL) || ((int) (Pointer_Request->Sequence_Number - Pointer_Oldest_Request->Sequence_Number) < 0)) Pointer_Oldest_Request = Pointer_Request;
+	}
+	
+	return Pointer_Oldest_Request;
+}
+
+/** Process up to one block of an asynchronous request, completing the request when all its data are processed or when an error occurs.
+ * @param Pointer_Request The pending request to process.
+ */
+static void FileProcessAsynchronousRequestChunk(TFileAsynchronousRequest *Pointer_Request)
+{
+	unsigned int Bytes_Count, Bytes_Read;
+	int Is_File_End_Reached = 0;
+	
+	// Do not process more than a block at a time to keep each system call short
+	Bytes_Count = Pointer_Request->Remaining_Bytes_Count;
+	if (Bytes_Count > File_System.File_System_Informations.Block_Size_Bytes) Bytes_Count = File_System.File_System_Informations.Block_Size_Bytes;
+	
+	// The descriptor opening mode tells the request kind
+	if (File_Descriptors[Pointer_Request->File_Descriptor_Index].Opening_Mode == 'r')
+	{
+		Pointer_Request->Status = FileReadData(Pointer_Request->File_Descriptor_Index, Pointer_Request->Pointer_Buffer, Bytes_Count, &Bytes_Read);
+		if (Bytes_Read < Bytes_Count) Is_File_End_Reached = 1;
+		Bytes_Count = Bytes_Read;
+	}
+	else Pointer_Request->Status = FileWriteData(Pointer_Request->File_Descriptor_Index, Pointer_Request->Pointer_Buffer, Bytes_Count);
+	
+	if (Pointer_Request->Status != ERROR_CODE_NO_ERROR)
+	{
+		Pointer_Request->Is_Completed = 1;
+		return;
+	}
+	
+	Pointer_Request->Pointer_Buffer += Bytes_Count;
+	Pointer_Request->Processed_Bytes_Count += Bytes_Count;
+	Pointer_Request->Remaining_Bytes_Count -= Bytes_Count;
+	if ((Pointer_Request->Remaining_Bytes_Count == 0) || Is_File_End_Reached) Pointer_Request->Is_Completed = 1;
+}
+
+/** Make the asynchronous requests progress by processing up to one block of the oldest pending request, whatever the file it belongs to. */
+static void FileProcessOldestAsynchronousRequest(void)
+{
+	TFileAsynchronousRequest *Pointer_Request;
+	
+	Pointer_Request = FileFindOldestPendingAsynchronousRequest(CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT);
+	if (Pointer_Request != NULL) FileProcessAsynchronousRequestChunk(Pointer_Request);
+}
+
+/** Complete all the pending asynchronous requests of a file, so that data are processed in the same order than they were submitted.
+ * @param File_Descriptor_Index The file descriptor identifying the file.
+ */
+static void FileCompletePendingAsynchronousRequests(unsigned int File_Descriptor_Index)
+{
+	TFileAsynchronousRequest *Pointer_Request;
+	
+	while (1)
+	{
+		Pointer_Request = FileFindOldestPendingAsynchronousRequest(File_Descriptor_Index);
+		if (Pointer_Request == NULL) break;
+		FileProcessAsynchronousRequestChunk(Pointer_Request);
+	}
+}
+
+/** Release all the asynchronous requests of a file that is not opened anymore. Pending requests are completed with an error.
+ * @param File_Descriptor_Index The file descriptor identifying the file.
+ * @param Is_Completed_Request_Released Set to 1 to free the completed requests too, set to 0 to keep them until the program collects their status.
+ */
+static void FileReleaseAsynchronousRequests(unsigned int File_Descriptor_Index, int Is_Completed_Request_Released)
+{
+	TFileAsynchronousRequest *Pointer_Request;
+	int i;
+	
+	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT; i++)
+	{
+		Pointer_Request = &File_Asynchronous_Requests[i];
+		if (Pointer_Request->Is_Entry_Free || (Pointer_Request->File_Descriptor_Index != File_Descriptor_Index)) continue;
+		
+		if (Pointer_Request->Is_Completed)
+		{
+			if (Is_Completed_Request_Released) Pointer_Request->Is_Entry_Free = 1;
+		}
+		else
+		{
+			Pointer_Request->Status = ERROR_CODE_FILE_NOT_OPENED;
+			Pointer_Request->Is_Completed = 1;
+		}
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
@@ -92,7 +419,6 @@ int FileRename(char *String_Current_File_Name, char *String_New_File_Name)
 int FileDelete(char *String_File_Name)
 {
 	TFilesListEntry *Pointer_Files_List_Entry;
-	unsigned int First_Block, Last_Block, Next_Block;
 	int i;
 	
 	// Check if file name is valid
@@ -105,31 +431,16 @@ int FileDelete(char *String_File_Name)
 	// Close the file if it was opened
 	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT; i++)
 	{
-		if (strcmp(File_Descriptors[i].Pointer_Files_List_Entry->String_Name, String_File_Name) == 0)
+		if ((!File_Descriptors[i].Is_Entry_Free) && (strcmp(File_Descriptors[i].Pointer_Files_List_Entry->String_Name, String_File_Name) == 0)) // A never used descriptor has no Files List entry
 		{
 			File_Descriptors[i].Is_Entry_Free = 1;
+			FileReleaseAsynchronousRequests(i, 0);
 			break; // A file can be opened only once at a time, no need to check other file descriptors
 		}
 	}
 	
-	// Free allocated blocks by appending the file blocks list to the free blocks list beginning (the free blocks list head will become the file first block)
-	First_Block = Pointer_Files_List_Entry->Start_Block;
-	// Find the file last block
-	Last_Block = First_Block;
-	Next_Block = First_Block;
-	while (Next_Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
-	{
-		// Get next block
-		Next_Block = File_System.Blocks_List[Last_Block];
-		if (Next_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) break; // Keep the block that contains FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF value
-		
-		// Go to next block
-		Last_Block = Next_Block;
-	}
-	// The file blocks list end will point to the free blocks list head
-	File_System.Blocks_List[Last_Block] = File_System.File_System_Informations.Free_Blocks_List_Head;
-	// The free blocks list head will point to the file blocks list beginning
-	File_System.File_System_Informations.Free_Blocks_List_Head = First_Block;
+	// Free allocated blocks
+	FileFreeBlocks(Pointer_Files_List_Entry->Start_Block);
 	
 	// Free the file entry
 	Pointer_Files_List_Entry->String_Name[0] = 0;
@@ -155,15 +466,24 @@ unsigned int FileSize(char *String_File_Name)
 
 void FileResetFileDescriptors(void)
 {
-	int i;
+	int i, Is_File_System_Modified = 0;
+	
+	FileCancelAsynchronousRequests();
 	
-	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT; i++) File_Descriptors[i].Is_Entry_Free = 1;
+	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT; i++)
+	{
+		// The program exited without closing this file, so the blocks it preallocated and did not write would stay in the file blocks chain
+		if ((!File_Descriptors[i].Is_Entry_Free) && (File_Descriptors[i].Opening_Mode == 'w')) Is_File_System_Modified |= FileReleasePreallocatedBlocks(&File_Descriptors[i]);
+		File_Descriptors[i].Is_Entry_Free = 1;
+	}
+	
+	if (Is_File_System_Modified) FileSystemSave();
 }
 
 int FileOpen(char *String_File_Name, char Opening_Mode, unsigned int *Pointer_File_Descriptor_Index)
 {
 	TFilesListEntry *Pointer_Files_List_Entry;
-	unsigned int i, Free_File_Descriptor_Index;
+	unsigned int i, Free_File_Descriptor_Index, Block;
 	TFileDescriptor *Pointer_File_Descriptor;
 	
 	// Check if file name is valid
@@ -187,6 +507,7 @@ int FileOpen(char *String_File_Name, char Opening_Mode, unsigned int *Pointer_Fi
 	Pointer_File_Descriptor = &File_Descriptors[Free_File_Descriptor_Index];
 	
 	// Open file
+	Pointer_File_Descriptor->Opening_Mode = Opening_Mode; // Needed to load the first block
 	switch (Opening_Mode)
 	{
 		// Read only
@@ -198,7 +519,7 @@ int FileOpen(char *String_File_Name, char Opening_Mode, unsigned int *Pointer_Fi
 			Pointer_File_Descriptor->Is_Write_Possible = 0;
 			
 			// Fetch the first block if the file is not empty
-			if (Pointer_Files_List_Entry->Size_Bytes > 0) Pointer_File_Descriptor->Current_Block_Index = FileSystemReadBlocks(Pointer_Files_List_Entry->Start_Block, 1, Pointer_File_Descriptor->Buffer);
+			if (Pointer_Files_List_Entry->Size_Bytes > 0) FileSetCurrentBlock(Pointer_File_Descriptor, Pointer_Files_List_Entry->Start_Block);
 			break;
 			
 		// Write only
@@ -210,11 +531,12 @@ int FileOpen(char *String_File_Name, char Opening_Mode, unsigned int *Pointer_Fi
 			if (FileSystemWriteFilesListEntry(String_File_Name, &Pointer_Files_List_Entry) != ERROR_CODE_NO_ERROR) return ERROR_CODE_FILES_LIST_FULL;
 			
 			// Allocate the first block
-			Pointer_File_Descriptor->Current_Block_Index = FileSystemAllocateBlock();
-			if (Pointer_File_Descriptor->Current_Block_Index == FILE_SYSTEM_BLOCKS_LIST_FULL_CODE) return ERROR_CODE_BLOCKS_LIST_FULL;
+			Block = FileSystemAllocateBlock();
+			if (Block == FILE_SYSTEM_BLOCKS_LIST_FULL_CODE) return ERROR_CODE_BLOCKS_LIST_FULL;
+			FileSetCurrentBlock(Pointer_File_Descriptor, Block);
 			
 			// For now consider the file as empty
-			Pointer_Files_List_Entry->Start_Block = Pointer_File_Descriptor->Current_Block_Index;
+			Pointer_Files_List_Entry->Start_Block = Block;
 			Pointer_Files_List_Entry->Size_Bytes = 0;
 			
 			Pointer_File_Descriptor->Is_Write_Possible = 1;
@@ -227,7 +549,6 @@ int FileOpen(char *String_File_Name, char Opening_Mode, unsigned int *Pointer_Fi
 	
 	// Fill descriptor entry
 	Pointer_File_Descriptor->Pointer_Files_List_Entry = Pointer_Files_List_Entry;
-	Pointer_File_Descriptor->Opening_Mode = Opening_Mode;
 	Pointer_File_Descriptor->Offset_File = 0;
 	Pointer_File_Descriptor->Offset_Buffer = 0;
 	Pointer_File_Descriptor->Is_Entry_Free = 0;
@@ -238,109 +559,24 @@ int FileOpen(char *String_File_Name, char Opening_Mode, unsigned int *Pointer_Fi
 
 int FileRead(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count, unsigned int *Pointer_Bytes_Read)
 {
-	TFileDescriptor *Pointer_File_Descriptor;
-	unsigned int Bytes_To_Read;
-	unsigned char *Pointer_Buffer_Byte = Pointer_Buffer;
-	
-	// Is there something to read ?
-	if (Bytes_Count == 0)
-	{
-		*Pointer_Bytes_Read = 0;
-		return ERROR_CODE_NO_ERROR;
-	}
 	// Is the file opened ?
 	if (File_Descriptor_Index >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) return ERROR_CODE_BAD_FILE_DESCRIPTOR;
-	Pointer_File_Descriptor = &File_Descriptors[File_Descriptor_Index];
-	if (Pointer_File_Descriptor->Is_Entry_Free) return ERROR_CODE_FILE_NOT_OPENED;
-	// Is the file in read mode ?
-	if (Pointer_File_Descriptor->Opening_Mode != 'r') return ERROR_CODE_BAD_OPENING_MODE;
-	
-	// Check how many more bytes can be read from the file
-	Bytes_To_Read = Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes - Pointer_File_Descriptor->Offset_File;
-	// If there is no more byte to read the file end is reached
-	if (Bytes_To_Read == 0)
-	{
-		*Pointer_Bytes_Read = 0;
-		return ERROR_CODE_NO_ERROR;
-	}
-	
-	// Adjust remaining bytes to read count according to file size
-	if (Bytes_Count > Bytes_To_Read) Bytes_Count = Bytes_To_Read;
-	else Bytes_To_Read = Bytes_Count; // Keep bytes to read count for later
-	
-	// Read data from file
-	while (Bytes_Count > 0)
-	{
-		// Load next block when needed (i.e. when a block is fully read)
-		if (Pointer_File_Descriptor->Offset_Buffer >= CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES)
-		{
-			Pointer_File_Descriptor->Current_Block_Index = FileSystemReadBlocks(Pointer_File_Descriptor->Current_Block_Index, 1, Pointer_File_Descriptor->Buffer);
-			Pointer_File_Descriptor->Offset_Buffer = 0;
-		}
 	
-		// Copy bytes one at a time into the destination buffer
-		*Pointer_Buffer_Byte = Pointer_File_Descriptor->Buffer[Pointer_File_Descriptor->Offset_Buffer];
-		Pointer_Buffer_Byte++;
-		Pointer_File_Descriptor->Offset_Buffer++;
-		Bytes_Count--;
-	}
+	// Previously submitted reads must get their data first
+	FileCompletePendingAsynchronousRequests(File_Descriptor_Index);
 	
-	Pointer_File_Descriptor->Offset_File += Bytes_To_Read;
-	*Pointer_Bytes_Read = Bytes_To_Read;
-
-	return ERROR_CODE_NO_ERROR;
+	return FileReadData(File_Descriptor_Index, Pointer_Buffer, Bytes_Count, Pointer_Bytes_Read);
 }
 
 int FileWrite(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count)
 {
-	TFileDescriptor *Pointer_File_Descriptor;
-	unsigned int New_Block, Written_Bytes_Count;
-	unsigned char *Pointer_Buffer_Byte = Pointer_Buffer;
-
 	// Is the file opened ?
 	if (File_Descriptor_Index >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) return ERROR_CODE_BAD_FILE_DESCRIPTOR;
-	Pointer_File_Descriptor = &File_Descriptors[File_Descriptor_Index];
-	if (Pointer_File_Descriptor->Is_Entry_Free) return ERROR_CODE_FILE_NOT_OPENED;
-	// Is the file in write mode ?
-	if (Pointer_File_Descriptor->Opening_Mode != 'w') return ERROR_CODE_BAD_OPENING_MODE;
-	// Is there enough room on the file system to write to ?
-	if (!Pointer_File_Descriptor->Is_Write_Possible) return ERROR_CODE_BLOCKS_LIST_FULL;
-	
-	Written_Bytes_Count = Bytes_Count;
-	while (Bytes_Count > 0)
-	{
-		// Check if the cache is not full
-		if (Pointer_File_Descriptor->Offset_Buffer >= CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES)
-		{
-			// Flush current block to disk
-			FileSystemWriteBlocks(Pointer_File_Descriptor->Current_Block_Index, 1, Pointer_File_Descriptor->Buffer);
-			Pointer_File_Descriptor->Offset_Buffer = 0;
-			
-			// Try to allocate a new block
-			New_Block = FileSystemAllocateBlock();
-			// Has the block been allocated or the Blocks List is full ?
-			if (New_Block == FILE_SYSTEM_BLOCKS_LIST_FULL_CODE)
-			{
-				Pointer_File_Descriptor->Is_Write_Possible = 0;
-				return ERROR_CODE_BLOCKS_LIST_FULL;
-			}
-			
-			// Link the new block index to the flushed block Blocks List entry
-			File_System.Blocks_List[Pointer_File_Descriptor->Current_Block_Index] = New_Block;
-			Pointer_File_Descriptor->Current_Block_Index = New_Block;
-		}
-		
-		// Copy the byte to the cache
-		Pointer_File_Descriptor->Buffer[Pointer_File_Descriptor->Offset_Buffer] = *Pointer_Buffer_Byte;
-		Pointer_File_Descriptor->Offset_Buffer++;
-		Pointer_Buffer_Byte++;
-		Bytes_Count--;
-	}
 	
-	// Update the file size
-	Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes += Written_Bytes_Count;
+	// Previously submitted writes must be stored before these data
+	FileCompletePendingAsynchronousRequests(File_Descriptor_Index);
 	
-	return ERROR_CODE_NO_ERROR;
+	return FileWriteData(File_Descriptor_Index, Pointer_Buffer, Bytes_Count);
 }
 
 void FileClose(unsigned int File_Descriptor_Index)
@@ -354,14 +590,131 @@ void FileClose(unsigned int File_Descriptor_Index)
 	// Is the file opened ?
 	if (Pointer_File_Descriptor->Is_Entry_Free) return;
 	
+	// Data from the pending asynchronous requests must be in the file before it is closed
+	FileCompletePendingAsynchronousRequests(File_Descriptor_Index);
+	FileReleaseAsynchronousRequests(File_Descriptor_Index, 1);
+	
 	// Save file system if the file was opened in write mode to backup newly allocated Blocks List blocks
 	if (Pointer_File_Descriptor->Opening_Mode == 'w')
 	{
+		FileReleasePreallocatedBlocks(Pointer_File_Descriptor);
+		
 		// Flush the last block if the file is not empty (the last block is never flushed by FileWrite() as it would need one more call, but FileClose() is called instead)
-		if (Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes > 0) FileSystemWriteBlocks(Pointer_File_Descriptor->Current_Block_Index, 1, Pointer_File_Descriptor->Buffer);
+		if (Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes > 0) FileSystemWriteBlocks(Pointer_File_Descriptor->Current_Block_Index, 1, Pointer_File_Descriptor->Pointer_Block_Data);
 		FileSystemSave();
 	}
 	
 	// Free descriptor entry
 	Pointer_File_Descriptor->Is_Entry_Free = 1;
 }
+
+int FilePreallocate(unsigned int File_Descriptor_Index, unsigned int Bytes_Count)
+{
+	TFileDescriptor *Pointer_File_Descriptor;
+	unsigned int Blocks_Count, First_Block;
+	
+	// Is the file opened ?
+	if (File_Descriptor_Index >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) return ERROR_CODE_BAD_FILE_DESCRIPTOR;
+	Pointer_File_Descriptor = &File_Descriptors[File_Descriptor_Index];
+	if (Pointer_File_Descriptor->Is_Entry_Free) return ERROR_CODE_FILE_NOT_OPENED;
+	// Is the file in write mode ?
+	if (Pointer_File_Descriptor->Opening_Mode != 'w') return ERROR_CODE_BAD_OPENING_MODE;
+	
+	// Pending writes can't go to the preallocated blocks
+	FileCompletePendingAsynchronousRequests(File_Descriptor_Index);
+	if (Pointer_File_Descriptor->Pointer_Files_List_Entry->Size_Bytes > 0) return ERROR_CODE_FILE_NOT_EMPTY;
+	
+	// Compute how many blocks are needed (an empty file owns a block too)
+	Blocks_Count = Bytes_Count / File_System.File_System_Informations.Block_Size_Bytes;
+	if ((Bytes_Count % File_System.File_System_Informations.Block_Size_Bytes != 0) || (Blocks_Count == 0)) Blocks_Count++;
+	
+	// Give the single block allocated when opening the file back, so it can be part of the contiguous area. It is the free blocks list head now, so it is allocated again if the preallocation fails
+	FileFreeBlocks(Pointer_File_Descriptor->Current_Block_Index);
+	First_Block = FileSystemAllocateBlocks(Blocks_Count);
+	if (First_Block == FILE_SYSTEM_BLOCKS_LIST_FULL_CODE)
+	{
+		FileSystemAllocateBlock();
+		return ERROR_CODE_BLOCKS_LIST_FULL;
+	}
+	
+	FileSetCurrentBlock(Pointer_File_Descriptor, First_Block);
+	Pointer_File_Descriptor->Pointer_Files_List_Entry->Start_Block = First_Block;
+	return ERROR_CODE_NO_ERROR;
+}
+
+int FileSubmitAsynchronousRequest(unsigned int File_Descriptor_Index, void *Pointer_Buffer, unsigned int Bytes_Count, unsigned int *Pointer_Request_ID)
+{
+	TFileAsynchronousRequest *Pointer_Request;
+	unsigned int i;
+	
+	// Is the file opened ?
+	if (File_Descriptor_Index >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_OPENED_FILES_COUNT) return ERROR_CODE_BAD_FILE_DESCRIPTOR;
+	if (File_Descriptors[File_Descriptor_Index].Is_Entry_Free) return ERROR_CODE_FILE_NOT_OPENED;
+	
+	// Search for a free request slot
+	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT; i++)
+	{
+		if (File_Asynchronous_Requests[i].Is_Entry_Free) break;
+	}
+	if (i == CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT) return ERROR_CODE_CANT_SUBMIT_MORE_ASYNCHRONOUS_REQUESTS;
+	Pointer_Request = &File_Asynchronous_Requests[i];
+	
+	// Fill the request
+	Pointer_Request->File_Descriptor_Index = File_Descriptor_Index;
+	Pointer_Request->Pointer_Buffer = Pointer_Buffer;
+	Pointer_Request->Remaining_Bytes_Count = Bytes_Count;
+	Pointer_Request->Processed_Bytes_Count = 0;
+	Pointer_Request->Sequence_Number = File_Asynchronous_Requests_Next_Sequence_Number;
+	File_Asynchronous_Requests_Next_Sequence_Number++;
+	Pointer_Request->Status = ERROR_CODE_NO_ERROR;
+	Pointer_Request->Is_Completed = (Bytes_Count == 0); // Nothing to do for an empty request
+	Pointer_Request->Is_Entry_Free = 0;
+	
+	// Requests are not processed from an interrupt handler, so each submission makes them progress
+	FileProcessOldestAsynchronousRequest();
+	
+	*Pointer_Request_ID = i;
+	return ERROR_CODE_NO_ERROR;
+}
+
+int FilePollAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count)
+{
+	TFileAsynchronousRequest *Pointer_Request;
+	
+	// Is the request existing ?
+	if (Request_ID >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT) return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST;
+	Pointer_Request = &File_Asynchronous_Requests[Request_ID];
+	if (Pointer_Request->Is_Entry_Free) return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST;
+	
+	// A program polling its requests lets them progress
+	if (!Pointer_Request->Is_Completed) FileProcessOldestAsynchronousRequest();
+	
+	*Pointer_Processed_Bytes_Count = Pointer_Request->Processed_Bytes_Count;
+	if (!Pointer_Request->Is_Completed) return ERROR_CODE_ASYNCHRONOUS_REQUEST_PENDING;
+	
+	// The status has been retrieved, the request is no more needed
+	Pointer_Request->Is_Entry_Free = 1;
+	return Pointer_Request->Status;
+}
+
+int FileWaitAsynchronousRequest(unsigned int Request_ID, unsigned int *Pointer_Processed_Bytes_Count)
+{
+	TFileAsynchronousRequest *Pointer_Request;
+	
+	// Is the request existing ?
+	if (Request_ID >= CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT) return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST;
+	Pointer_Request = &File_Asynchronous_Requests[Request_ID];
+	if (Pointer_Request->Is_Entry_Free) return ERROR_CODE_BAD_ASYNCHRONOUS_REQUEST;
+	
+	// Process the older requests of the same file first to keep the file content ordered
+	while (!Pointer_Request->Is_Completed) FileProcessAsynchronousRequestChunk(FileFindOldestPendingAsynchronousRequest(Pointer_Request->File_Descriptor_Index));
+	
+	return FilePollAsynchronousRequest(Request_ID, Pointer_Processed_Bytes_Count);
+}
+
+void FileCancelAsynchronousRequests(void)
+{
+	int i;
+	
+	for (i = 0; i < CONFIGURATION_FILE_SYSTEM_MAXIMUM_ASYNCHRONOUS_REQUESTS_COUNT; i++) File_Asynchronous_Requests[i].Is_Entry_Free = 1;
+}
@@ -5,9 +5,11 @@
 #include <Configuration.h>
 #include <Debug.h>
 #include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
 #include <Drivers/Driver_Keyboard.h>
 #include <Drivers/Driver_Screen.h>
 #include <Error_Codes.h>
+#include <File_System/Block_Queue.h>
 #include <File_System/File.h>
 #include <File_System/File_System.h>
 #include <Standard_Functions.h>
@@ -15,8 +17,12 @@
 //-------------------------------------------------------------------------------------------------
 // Private constants and macros
 //-------------------------------------------------------------------------------------------------
-/** Tell if a correct file system is stored on the disk or not. */
-#define FILE_SYSTEM_MAGIC_NUMBER 0x12345678
+#if (CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES < FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES) || (CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES > FILE_SYSTEM_MAXIMUM_BLOCK_SIZE_BYTES) || ((CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES & (CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES - 1)) != 0)
+	#error "The file system block size must be a power of two between 1024 and 65536 bytes."
+#endif
+
+/** Tell whether a block is free in the free blocks bitmap. */
+#define FILE_SYSTEM_IS_BLOCK_FREE(Block) (File_System_Free_Blocks_Bitmap[(Block) / 8] & (1 << ((Block) % 8)))
 
 //-------------------------------------------------------------------------------------------------
 // Private variables
@@ -33,47 +39,20 @@ static unsigned int Files_List_First_Sector_Number;
 
 /** First sector dedicated to data, located right after the file system. */
 static unsigned int Data_First_Sector_Number;
+/** How many sectors in a block of the mounted file system. */
+static unsigned int Block_Size_Sectors;
+
+/** Used by FileSystemAllocateBlocks() to find contiguous free blocks (a bit is set when the corresponding block is free). */
+static unsigned char File_System_Free_Blocks_Bitmap[(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES + 7) / 8];
+
+/** Set to 1 when data blocks were written since the last drive cache flush. */
+static int File_System_Is_Data_Flush_Needed = 0;
 
 //-------------------------------------------------------------------------------------------------
 // Public variables
 //-------------------------------------------------------------------------------------------------
 TFileSystem File_System;
 
-//-------------------------------------------------------------------------------------------------
-// Private functions
-//-------------------------------------------------------------------------------------------------
-/** Read several sectors from the hard disk.
- * @param First_Sector_Number The sector to start reading from.
- * @param Sectors_Count How many sectors to read.
- * @param Pointer_Buffer On output, will contain the read data.
- */
-static void FileSystemReadSectors(unsigned int First_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
-{
-	while (Sectors_Count > 0)
-	{
-		HardDiskReadSector(First_Sector_Number, Pointer_Buffer);
-		First_Sector_Number++;
-		Pointer_Buffer += FILE_SYSTEM_SECTOR_SIZE_BYTES;
-		Sectors_Count--;
-	}
-}
-
-/** Write several sectors to the hard disk.
- * @param First_Sector_Number The sector to start writing to.
- * @param Sectors_Count How many sectors to write.
- * @param Pointer_Buffer The buffer containing the data to write.
- */
-static void FileSystemWriteSectors(unsigned int First_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
-{
-	while (Sectors_Count > 0)
-	{
-		HardDiskWriteSector(First_Sector_Number, Pointer_Buffer);
-		First_Sector_Number++;
-		Pointer_Buffer += FILE_SYSTEM_SECTOR_SIZE_BYTES;
-		Sectors_Count--;
-	}
-}
-
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
@@ -88,6 +67,9 @@ int FileSystemInitialize(unsigned int Starting_Sector)
 	if (File_System.File_System_Informations.Magic_Number != FILE_SYSTEM_MAGIC_NUMBER) return 0;
 	// Check if the file system is small enough to fit into the kernel reserved memory space
 	if ((File_System.File_System_Informations.Total_Blocks_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES) || (File_System.File_System_Informations.Total_Files_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES)) return 0;
+	// Check if the file descriptors buffers can hold a block
+	if ((File_System.File_System_Informations.Block_Size_Bytes < FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES) || (File_System.File_System_Informations.Block_Size_Bytes > CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES) || ((File_System.File_System_Informations.Block_Size_Bytes & (File_System.File_System_Informations.Block_Size_Bytes - 1)) != 0)) return 0;
+	Block_Size_Sectors = File_System.File_System_Informations.Block_Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES;
 	
 	// Compute Blocks List size in sectors
 	Temp = File_System.File_System_Informations.Total_Blocks_Count * sizeof(unsigned int) + sizeof(TFileSystemInformations); // Take into account the file system informations to ease their handling
@@ -105,8 +87,9 @@ int FileSystemInitialize(unsigned int Starting_Sector)
 	Data_First_Sector_Number = Files_List_First_Sector_Number + Files_List_Size_Sectors;
 	
 	// Load Blocks List and Files List
-	FileSystemReadSectors(Blocks_List_First_Sector_Number, Blocks_List_Size_Sectors, &File_System); // The file system informations are reloaded, but this is the easiest way
-	FileSystemReadSectors(Files_List_First_Sector_Number, Files_List_Size_Sectors, &File_System.Files_List);
+	BlockQueueAddRequest(0, Blocks_List_First_Sector_Number, Blocks_List_Size_Sectors, &File_System); // The file system informations are reloaded, but this is the easiest way
+	BlockQueueAddRequest(0, Files_List_First_Sector_Number, Files_List_Size_Sectors, &File_System.Files_List);
+	BlockQueueFlush();
 	
 	// Allow the File functions to work in kernel mode
 	FileResetFileDescriptors();
@@ -117,8 +100,20 @@ int FileSystemInitialize(unsigned int Starting_Sector)
 
 void FileSystemSave(void)
 {
-	FileSystemWriteSectors(Blocks_List_First_Sector_Number, Blocks_List_Size_Sectors, &File_System);
-	FileSystemWriteSectors(Files_List_First_Sector_Number, Files_List_Size_Sectors, &File_System.Files_List);
+	// The data blocks must reach the media before the lists referencing them, or a power loss could leave files pointing to stale data
+	if (File_System_Is_Data_Flush_Needed)
+	{
+		HardDiskFlushCache();
+		File_System_Is_Data_Flush_Needed = 0;
+	}
+	
+	// Give both lists to the drive at once
+	BlockQueueAddRequest(1, Blocks_List_First_Sector_Number, Blocks_List_Size_Sectors, &File_System);
+	BlockQueueAddRequest(1, Files_List_First_Sector_Number, Files_List_Size_Sectors, &File_System.Files_List);
+	BlockQueueFlush();
+	
+	// This is the commit point, the lists must be on the media when the function returns
+	HardDiskFlushCache();
 }
 
 unsigned int FileSystemGetFreeBlocksCount(void)
@@ -148,9 +143,14 @@ unsigned int FileSystemGetFreeFilesListEntriesCount(void)
 	return File_List_Entries_Count;
 }
 
+unsigned char *FileSystemMapBlock(unsigned int Block)
+{
+	return HardDiskMapSector((Block * Block_Size_Sectors) + Data_First_Sector_Number);
+}
+
 unsigned int FileSystemReadBlocks(unsigned int Start_Block, unsigned int Blocks_Count, unsigned char *Pointer_Buffer)
 {
-	unsigned int i, j, Block, Sector;
+	unsigned int i, Block;
 	
 	// Is end of file reached ?
 	if (Start_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) return FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
@@ -158,39 +158,38 @@ unsigned int FileSystemReadBlocks(unsigned int Start_Block, unsigned int Blocks_
 	Block = Start_Block;
 	for (i = 0; i < Blocks_Count; i++)
 	{
-		// Read block
-		Sector = (Block * (CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES / FILE_SYSTEM_SECTOR_SIZE_BYTES)) + Data_First_Sector_Number;
-		for (j = 0; j < CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES / FILE_SYSTEM_SECTOR_SIZE_BYTES; j++)
-		{
-			HardDiskReadSector(Sector, Pointer_Buffer);
-			Sector++;
-			Pointer_Buffer += FILE_SYSTEM_SECTOR_SIZE_BYTES;
-		}
+		// The queue merges the blocks that are contiguous on the disk, so each file extent needs a single command
+		BlockQueueAddRequest(0, (Block * Block_Size_Sectors) + Data_First_Sector_Number, Block_Size_Sectors, Pointer_Buffer);
+		Pointer_Buffer += File_System.File_System_Informations.Block_Size_Bytes;
 
 		// Next block
 		Block = File_System.Blocks_List[Block];
 		// Tell that the end of file is reached
 		if (Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) break;
 	}
+	
+	// Read all extents at once
+	BlockQueueFlush();
 	return Block;
 }
 
 unsigned int FileSystemWriteBlocks(unsigned int Start_Block, unsigned int Blocks_Count, unsigned char *Pointer_Buffer)
 {
-	unsigned int i, j, Block, Next_Block, Sector;
+	unsigned int i, Block, Next_Block;
 	
 	Block = Start_Block;
 	
 	for (i = 0; i < Blocks_Count; i++)
 	{
-		// Write block
-		Sector = (Block * (CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES / FILE_SYSTEM_SECTOR_SIZE_BYTES)) + Data_First_Sector_Number;
-		for (j = 0; j < CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES / FILE_SYSTEM_SECTOR_SIZE_BYTES; j++)
+		// Queue the whole block, unless the data was written in place
+		if (Pointer_Buffer != FileSystemMapBlock(Block))
 		{
-			HardDiskWriteSector(Sector, Pointer_Buffer);
-			Sector++;
-			Pointer_Buffer += FILE_SYSTEM_SECTOR_SIZE_BYTES;
+			BlockQueueAddRequest(1, (Block * Block_Size_Sectors) + Data_First_Sector_Number, Block_Size_Sectors, Pointer_Buffer);
+			File_System_Is_Data_Flush_Needed = 1;
 		}
+		// The block was written in place, account it like a driver write so the disk statistics still reflect the file system activity
+		else HardDiskStatisticsRecordTransfer(1, Block_Size_Sectors, HardDiskStatisticsGetTimestamp(), 0);
+		Pointer_Buffer += File_System.File_System_Informations.Block_Size_Bytes;
 		
 		// Write end-of-file in the last block
 		if (i == Blocks_Count - 1) File_System.Blocks_List[Block] = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
@@ -204,6 +203,9 @@ unsigned int FileSystemWriteBlocks(unsigned int Start_Block, unsigned int Blocks
 		}
 	}
 	
+	// Write the contiguous blocks with a single command, the caller can reuse the buffer when the function returns
+	BlockQueueFlush();
+	
 	// Last written block
 	return Block;
 }
@@ -256,8 +258,74 @@ unsigned int FileSystemAllocateBlock(void)
 	return New_Block;
 }
 
+unsigned int FileSystemAllocateBlocks(unsigned int Blocks_Count)
+{
+	unsigned int Block, Previous_Block, First_Block, Contiguous_Blocks_Count = 0, i;
+	
+	// Find which blocks are free
+	memset(File_System_Free_Blocks_Bitmap, 0, sizeof(File_System_Free_Blocks_Bitmap));
+	Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+	i = 0;
+	while (Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
+	{
+		File_System_Free_Blocks_Bitmap[Block / 8] |= 1 << (Block % 8);
+		Block = File_System.Blocks_List[Block];
+		i++;
+	}
+	// Fail without modifying anything if the file system can't store all blocks
+	if (i < Blocks_Count) return FILE_SYSTEM_BLOCKS_LIST_FULL_CODE;
+	
+	// Search for the first free area large enough
+	First_Block = 0;
+	for (Block = 0; Block < File_System.File_System_Informations.Total_Blocks_Count; Block++)
+	{
+		if (FILE_SYSTEM_IS_BLOCK_FREE(Block))
+		{
+			if (Contiguous_Blocks_Count == 0) First_Block = Block;
+			Contiguous_Blocks_Count++;
+			if (Contiguous_Blocks_Count == Blocks_Count) break;
+		}
+		else Contiguous_Blocks_Count = 0;
+	}
+	
+	// The free space is too fragmented, use the free blocks as they come
+	if (Contiguous_Blocks_Count < Blocks_Count)
+	{
+		First_Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+		Block = First_Block;
+		for (i = 1; i < Blocks_Count; i++) Block = File_System.Blocks_List[Block];
+		File_System.File_System_Informations.Free_Blocks_List_Head = File_System.Blocks_List[Block];
+		File_System.Blocks_List[Block] = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+		return First_Block;
+	}
+	
+	// Remove the area blocks from the free blocks list
+	Previous_Block = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+	Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+	while (Block != FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF)
+	{
+		if ((Block >= First_Block) && (Block < First_Block + Blocks_Count))
+		{
+			// Unlink the block
+			if (Previous_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) File_System.File_System_Informations.Free_Blocks_List_Head = File_System.Blocks_List[Block];
+			else File_System.Blocks_List[Previous_Block] = File_System.Blocks_List[Block];
+		}
+		else Previous_Block = Block;
+		
+		// Previous_Block is always a block still in the list, so its link is up to date
+		if (Previous_Block == FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF) Block = File_System.File_System_Informations.Free_Blocks_List_Head;
+		else Block = File_System.Blocks_List[Previous_Block];
+	}
+	
+	// Chain the area blocks in order
+	for (Block = First_Block; Block < First_Block + Blocks_Count - 1; Block++) File_System.Blocks_List[Block] = Block + 1;
+	File_System.Blocks_List[Block] = FILE_SYSTEM_BLOCKS_LIST_BLOCK_EOF;
+	
+	return First_Block;
+}
+
 #if CONFIGURATION_BUILD_INSTALLER || CONFIGURATION_BUILD_RAM_DISK
-	int FileSystemCreate(unsigned int Blocks_Count, unsigned int Files_Count, unsigned int Starting_Sector)
+	int FileSystemCreate(unsigned int Blocks_Count, unsigned int Files_Count, unsigned int Block_Size_Bytes, unsigned int Starting_Sector)
 	{
 		unsigned int i, Required_Disk_Size;
 		
@@ -266,9 +334,11 @@ unsigned int FileSystemAllocateBlock(void)
 		
 		// Check if the file system is not too big to be mounted by the kernel
 		if ((Blocks_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES) || (Files_Count > CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES)) return 1;
+		// The block size must fit in the file descriptors buffers and be a sectors count power of two
+		if ((Block_Size_Bytes < FILE_SYSTEM_MINIMUM_BLOCK_SIZE_BYTES) || (Block_Size_Bytes > CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES) || ((Block_Size_Bytes & (Block_Size_Bytes - 1)) != 0)) return 1;
 		
 		// Check if the file system can fit on the hard disk
-		Required_Disk_Size = FileSystemComputeSizeSectors(Blocks_Count, Files_Count);
+		Required_Disk_Size = FileSystemComputeSizeSectors(Blocks_Count, Files_Count, Block_Size_Bytes);
 		// Add the partition starting offset
 		Required_Disk_Size += Starting_Sector;
 		DEBUG_SECTION_START
@@ -285,6 +355,7 @@ unsigned int FileSystemAllocateBlock(void)
 		File_System.File_System_Informations.Magic_Number = FILE_SYSTEM_MAGIC_NUMBER;
 		File_System.File_System_Informations.Total_Blocks_Count = Blocks_Count;
 		File_System.File_System_Informations.Total_Files_Count = Files_Count;
+		File_System.File_System_Informations.Block_Size_Bytes = Block_Size_Bytes;
 		
 		// Create the free blocks list
 		File_System.File_System_Informations.Free_Blocks_List_Head = 0; // Set the first block as the list head
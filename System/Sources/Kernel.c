@@ -7,6 +7,7 @@
 #include <Debug.h>
 #include <Drivers/Driver_Ethernet.h>
 #include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
 #include <Drivers/Driver_Keyboard.h>
 #include <Drivers/Driver_PIC.h>
 #include <Drivers/Driver_Screen.h>
@@ -96,6 +97,9 @@ void __attribute__((section(".init"))) KernelEntryPoint(void)
 		KeyboardReadCharacter();
 	DEBUG_SECTION_END
 	
+	// The hard disk commands latency measurement needs the timer to be running
+	HardDiskStatisticsInitialize();
+	
 	// Initialize the compilation-selected hard disk driver
 	Result = HardDiskInitialize();
 	if (Result != 0)
@@ -107,7 +111,13 @@ void __attribute__((section(".init"))) KernelEntryPoint(void)
 				break;
 				
 			case 2:
-				String_Error_Message = STRING_KERNEL_ERROR_SATA_HARD_DISK_NOT_FOUND;
+				#if defined(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_VIRTIO)
+					String_Error_Message = STRING_KERNEL_ERROR_VIRTIO_HARD_DISK_NOT_FOUND;
+				#elif defined(CONFIGURATION_SYSTEM_HARD_DISK_DRIVER_NVME)
+					String_Error_Message = STRING_KERNEL_ERROR_NVME_HARD_DISK_NOT_FOUND;
+				#else
+					String_Error_Message = STRING_KERNEL_ERROR_SATA_HARD_DISK_NOT_FOUND;
+				#endif
 				break;
 				
 			case 3:
@@ -132,6 +142,20 @@ void __attribute__((section(".init"))) KernelEntryPoint(void)
 		KeyboardRebootSystem();
 	}
 	
+	// Configure the drive write cache, the file system flushes it each time it saves its lists
+	#ifdef CONFIGURATION_SYSTEM_HARD_DISK_ENABLE_WRITE_CACHE
+		HardDiskSetWriteCacheEnabled(1);
+	#else
+		HardDiskSetWriteCacheEnabled(0);
+	#endif
+	DEBUG_SECTION_START
+		DEBUG_DISPLAY_CURRENT_FUNCTION_NAME();
+		ScreenWriteString("Hard disk write cache enabled : ");
+		ScreenWriteString(itoa(HardDiskIsWriteCacheEnabled()));
+		ScreenWriteCharacter('\n');
+		KeyboardReadCharacter();
+	DEBUG_SECTION_END
+	
 	// Allow ethernet support to RAM disk build or to system build, do not include it for a normal installer build
 	#if !defined(CONFIGURATION_SYSTEM_ETHERNET_CONTROLLER_DRIVER_NONE) && ((!CONFIGURATION_BUILD_INSTALLER) || (CONFIGURATION_BUILD_INSTALLER && CONFIGURATION_BUILD_RAM_DISK))
 		Result = EthernetInitialize();
@@ -163,8 +187,10 @@ void __attribute__((section(".init"))) KernelEntryPoint(void)
 	{
 		// Retrieve the partition starting sector from the partition table located in the MBR
 		unsigned int Partition_Starting_Sector = *((unsigned int *) (CONFIGURATION_SYSTEM_MBR_LOAD_ADDRESS + 446 + 8)); // The partition table is located at offset 446, and the first partition starting LBA sector is located at offset 8 of the beginning of the partition table
+		// The file system starts right after the kernel, which size has been recorded in the MBR by the installer
+		unsigned int Kernel_Sectors_Count = *((unsigned short *) (CONFIGURATION_SYSTEM_MBR_LOAD_ADDRESS + CONFIGURATION_FILE_SYSTEM_MBR_KERNEL_SECTORS_COUNT_OFFSET));
 		
-		if (!FileSystemInitialize(Partition_Starting_Sector + CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET))
+		if (!FileSystemInitialize(Partition_Starting_Sector + CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET(Kernel_Sectors_Count)))
 		{
 			// Show error message
 			ScreenSetColor(SCREEN_COLOR_RED); // Color must be set before in order to clear screen with this value
@@ -218,6 +244,10 @@ void __attribute__((section(".init"))) KernelEntryPoint(void)
 void KernelStartShell(void)
 {
 	KERNEL_RESET_STACK();
+	
+	// The terminated program buffers must not be accessed anymore by the asynchronous file requests (this also releases the processing lock if the program crashed during a file system call)
+	FileCancelAsynchronousRequests();
+	
 	ARCHITECTURE_INTERRUPTS_ENABLE();
 	Shell();
 }
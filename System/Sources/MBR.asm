@@ -11,6 +11,9 @@
 ; V 1.8 : 31/08/2015, added the ability to choose between LBA-28 and LBA-48.
 ; V 1.9 : 06/11/2015, added automatic LBA addressing mode selection (LBA28 or LBA48).
 ; V 1.10 : 02/04/2016, used BIOS INT13 extension to load the kernel from LBA hard disks in order to be compatible with SATA drivers. Really old BIOSes won't work with this extension.
+; V 1.11 : 19/10/2026, retrieve the BIOS physical memory map for the kernel.
+; V 1.12 : 19/10/2026, the kernel size is stored in the MBR by the installer, the System kernel is loaded with multi-sector reads.
+; V 1.13 : 19/10/2026, a failing kernel read is retried a few times after a disk reset, then an error message is displayed.
 [BITS 16]
 [ORG 0]
 
@@ -21,6 +24,13 @@
 MBR_LOAD_SEGMENT EQU 07C0h
 KERNEL_LOAD_SEGMENT EQU 1000h
 KERNEL_PROTECTED_MODE_ADDRESS EQU (KERNEL_LOAD_SEGMENT * 16)
+MEMORY_MAP_ADDRESS EQU 500h ; Must match CONFIGURATION_SYSTEM_MEMORY_MAP_ADDRESS
+MEMORY_MAP_ENTRIES_ADDRESS EQU (MEMORY_MAP_ADDRESS + 8) ; Entries are 8-byte aligned after the entries count
+MEMORY_MAP_MAXIMUM_ENTRIES_COUNT EQU 32 ; Must match CONFIGURATION_SYSTEM_MEMORY_MAP_MAXIMUM_ENTRIES_COUNT
+MEMORY_MAP_ENTRY_SIZE EQU 24
+MEMORY_MAP_SIGNATURE EQU 534D4150h ; "SMAP"
+KERNEL_SECTORS_PER_READ EQU 64 ; 32 KB, the destination buffer stays 32 KB-aligned so a read never crosses a 64 KB DMA boundary, and this is below the 127 sectors some BIOSes can read at once
+KERNEL_READ_ATTEMPTS_COUNT EQU 3 ; How many times a kernel read is tried before giving up
 
 ;--------------------------------------------------------------------------------------------------
 ; Entry point
@@ -50,6 +60,9 @@ Entry_Point:
 	xor bl, bl
 	int 10h
 
+	; Tell the kernel where the RAM is
+	call RetrieveMemoryMap
+
 	; Load the Installer kernel from the boot device (there only one partition starting from zero, there is no need to read the partitions table)
 	%ifdef CONFIGURATION_BUILD_INSTALLER
 		call LoadKernelFromInstallationMedia
@@ -136,7 +149,7 @@ Entry_Point:
 		mov ax, KERNEL_LOAD_SEGMENT
 		mov es, ax
 		xor bx, bx
-		mov cx, SECTORS_TO_LOAD_COUNT
+		mov cx, [Kernel_Sectors_Count]
 
 		; Loop for loading kernel sectors
 	.Load_Kernel_From_Installation_Media_Loop:
@@ -176,28 +189,108 @@ Entry_Point:
 		ret
 %else
 	LoadKernelFromHardDisk:
-		mov cx, SECTORS_TO_LOAD_COUNT
+		mov cx, [Kernel_Sectors_Count]
 		
 		; Load the kernel to the specified address
 		mov eax, KERNEL_LOAD_SEGMENT << 16 ; Intel is little-endian, so invert segment:offset order (offset value is zero)
 		mov [Disk_Address_Packet_Destination_Buffer], eax
 	
 	.Load_Kernel_From_Hard_Disk_Loop:
-		; Load a sector
+		mov di, KERNEL_READ_ATTEMPTS_COUNT
+		
+		; Read as many sectors as possible at once
+		mov ax, KERNEL_SECTORS_PER_READ
+		cmp cx, ax
+		jae .Load_Kernel_From_Hard_Disk_Read_Sectors
+		mov ax, cx ; Read the remaining sectors
+		
+	.Load_Kernel_From_Hard_Disk_Read_Sectors:
+		mov [Disk_Address_Packet_Sectors_Count], ax ; The BIOS overwrites this field with the read sectors count, so set it before each read
+		push ax
 		mov ah, 42h
 		mov dl, [Boot_Device]
 		mov si, Disk_Address_Packet
 		int 13h
+		pop ax
+		jnc .Load_Kernel_From_Hard_Disk_Read_Succeeded
 		
-		; Prepare for the next sector read
-		add DWORD [Disk_Address_Packet_Destination_Buffer], 512 ; Increment the buffer address
-		inc DWORD [Disk_Address_Packet_Starting_Sector_LBA_Low] ; Increment only the lower part of the LBA address for now, TODO use whole 64 bits
+		; Reset the disk before trying again, give up if the disk keeps failing
+		dec di
+		jz .Load_Kernel_From_Hard_Disk_Error
+		push ax
+		xor ah, ah
+		mov dl, [Boot_Device]
+		int 13h
+		pop ax
+		jmp .Load_Kernel_From_Hard_Disk_Read_Sectors
+		
+	.Load_Kernel_From_Hard_Disk_Read_Succeeded:
+		; Prepare for the next sectors read
+		add WORD [Disk_Address_Packet_Destination_Buffer + 2], KERNEL_SECTORS_PER_READ * 512 / 16 ; Go to the next segment (only the last read can be smaller, so the buffer address does not matter after it)
+		movzx eax, ax
+		add DWORD [Disk_Address_Packet_Starting_Sector_LBA_Low], eax ; Increment only the lower part of the LBA address for now, TODO use whole 64 bits
 		
-		loop .Load_Kernel_From_Hard_Disk_Loop
+		sub cx, ax
+		jnz .Load_Kernel_From_Hard_Disk_Loop
 	
 		ret
+		
+		; Display the message directly in the video memory because the BIOS cursor is hidden
+	.Load_Kernel_From_Hard_Disk_Error:
+		mov ax, 0B800h
+		mov es, ax
+		xor di, di
+		mov si, String_Kernel_Loading_Error
+		mov ah, 4 ; Red
+		cld
+		
+	.Load_Kernel_From_Hard_Disk_Error_Display_Loop:
+		lodsb
+		or al, al
+		jz .Load_Kernel_From_Hard_Disk_Error_Halt
+		stosw
+		jmp .Load_Kernel_From_Hard_Disk_Error_Display_Loop
+		
+		; The system can't start, stop here
+	.Load_Kernel_From_Hard_Disk_Error_Halt:
+		cli
+		hlt
+		jmp .Load_Kernel_From_Hard_Disk_Error_Halt
 %endif
 
+; Store the BIOS INT 15h, function E820h memory map at a fixed address, the entries count stays zero if the BIOS does not support this function
+RetrieveMemoryMap:
+	push es
+	xor ax, ax
+	mov es, ax
+	mov [es:MEMORY_MAP_ADDRESS], ax
+	mov di, MEMORY_MAP_ENTRIES_ADDRESS
+	xor ebx, ebx ; Start from the first entry
+
+.Retrieve_Memory_Map_Loop:
+	mov eax, 0E820h
+	mov edx, MEMORY_MAP_SIGNATURE
+	mov ecx, MEMORY_MAP_ENTRY_SIZE
+	mov DWORD [es:di + 20], 1 ; Mark the entry as valid for the BIOSes that do not return the ACPI 3.0 extended attributes
+	int 15h
+	jc .Retrieve_Memory_Map_End ; The function is not supported or the list end has been reached
+	cmp eax, MEMORY_MAP_SIGNATURE
+	jne .Retrieve_Memory_Map_End
+
+	; Keep the entry
+	add di, MEMORY_MAP_ENTRY_SIZE
+	inc WORD [es:MEMORY_MAP_ADDRESS]
+	cmp WORD [es:MEMORY_MAP_ADDRESS], MEMORY_MAP_MAXIMUM_ENTRIES_COUNT
+	jae .Retrieve_Memory_Map_End
+
+	; A zero continuation value means that this was the last entry
+	test ebx, ebx
+	jnz .Retrieve_Memory_Map_Loop
+
+.Retrieve_Memory_Map_End:
+	pop es
+	ret
+
 %ifdef DEBUG
 	; Convert a number in its hexadecimal representation and display it
 	; @param ax : The number to display
@@ -269,14 +362,19 @@ Boot_Device DB 0
 	Disk_Address_Packet:
 	DB 16 ; Packet size, 16-byte long, do not use the 64-bit buffer address extension
 	DB 0 ; Unused
-	DW 1 ; Sectors to read count, always read 1 sector at a time to make it simpler
+	Disk_Address_Packet_Sectors_Count DW 0
 	Disk_Address_Packet_Destination_Buffer DD 0
 	Disk_Address_Packet_Starting_Sector_LBA_Low DD 0 ; Intel is little-endian, so low first
 	Disk_Address_Packet_Starting_Sector_LBA_High DD 0
+	
+	String_Kernel_Loading_Error DB "Kernel loading error.", 0
 %endif
 
+; The kernel size in sectors is stored right before the partition table (the installer sets it in the System MBR), keep in sync with CONFIGURATION_FILE_SYSTEM_MBR_KERNEL_SECTORS_COUNT_OFFSET
+times 444 - ($ - $$) nop
+Kernel_Sectors_Count DW SECTORS_TO_LOAD_COUNT
+
 ; The partition table starts at offset 446
-times 446 - ($ - $$) nop
 ; First partition entry
 DB 80h, ; Mark the partition as active
 DB 01h, 01h, 00h ; CHS address of first absolute sector in partition (genisoimage wants it to be 0/1/1)
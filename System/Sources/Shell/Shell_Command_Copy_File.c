@@ -11,13 +11,19 @@
 #include <Standard_Functions.h> // To have the NULL definition
 #include <Strings.h>
 
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many bytes to copy at a time (the buffer is stored on the small kernel stack, so it does not follow the file system block size). */
+#define SHELL_COMMAND_COPY_FILE_BUFFER_SIZE 4096
+
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
 void ShellCommandCopyFile(char *String_File_Name_Source, char *String_File_Name_Destination)
 {
 	unsigned int Free_Bytes_Count, File_Size_Bytes, File_ID_Source, File_ID_Destination, Read_Bytes_Count;
-	unsigned char Buffer[CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES];
+	unsigned char Buffer[SHELL_COMMAND_COPY_FILE_BUFFER_SIZE];
 
 	// Set the console color to red only one time as many errors can occur
 	ScreenSetColor(SCREEN_COLOR_RED);
@@ -37,7 +43,7 @@ void ShellCommandCopyFile(char *String_File_Name_Source, char *String_File_Name_
 	}
 	
 	// Check if there is enough room to store the new file
-	Free_Bytes_Count = FileSystemGetFreeBlocksCount() * CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES;
+	Free_Bytes_Count = FileSystemGetFreeBlocksCount() * File_System.File_System_Informations.Block_Size_Bytes;
 	File_Size_Bytes = FileSize(String_File_Name_Source);
 	if (File_Size_Bytes > Free_Bytes_Count)
 	{
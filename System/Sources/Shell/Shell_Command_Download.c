@@ -102,7 +102,7 @@ void ShellCommandDownload(void)
 		return;
 	}
 	// There is not enough room to store the file on the file system
-	if (Total_Download_Bytes_Count > FileSystemGetFreeBlocksCount() * CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES)
+	if (Total_Download_Bytes_Count > FileSystemGetFreeBlocksCount() * File_System.File_System_Informations.Block_Size_Bytes)
 	{
 		ScreenWriteString(STRING_SHELL_DOWNLOAD_NO_MORE_BLOCK_LIST_ENTRY);
 		UARTWriteByte(SHELL_COMMAND_DOWNLOAD_PROTOCOL_COMMAND_ABORT_DOWNLOAD); // Stop transfer
@@ -114,6 +114,17 @@ void ShellCommandDownload(void)
 	{
 		ScreenSetColor(SCREEN_COLOR_RED);
 		ScreenWriteString(STRING_SHELL_DOWNLOAD_FILE_OPENING_FAILED);
+		UARTWriteByte(SHELL_COMMAND_DOWNLOAD_PROTOCOL_COMMAND_ABORT_DOWNLOAD); // Stop transfer
+		return;
+	}
+	
+	// Reserve the whole file at once, so the download can't fail halfway through (the previous check is only an estimation because opening the file may have deleted an older file with the same name)
+	if (FilePreallocate(File_Descriptor, Total_Download_Bytes_Count) != ERROR_CODE_NO_ERROR)
+	{
+		FileClose(File_Descriptor);
+		FileDelete(String_File_Name);
+		ScreenWriteString(STRING_SHELL_DOWNLOAD_NO_MORE_BLOCK_LIST_ENTRY);
+		UARTWriteByte(SHELL_COMMAND_DOWNLOAD_PROTOCOL_COMMAND_ABORT_DOWNLOAD); // Stop transfer
 		return;
 	}
 	
@@ -33,16 +33,33 @@ static void ShellReboot(void)
 	while (1);
 }
 
+/** Compute how many sectors the kernel needs on the hard disk.
+ * @param Pointer_Kernel_File The file entry containing the kernel.
+ * @return The kernel size in sectors.
+ */
+static unsigned int ShellComputeKernelSectorsCount(TEmbeddedFile *Pointer_Kernel_File)
+{
+	unsigned int Sectors_Count;
+	
+	Sectors_Count = Pointer_Kernel_File->Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES;
+	if (Pointer_Kernel_File->Size_Bytes % FILE_SYSTEM_SECTOR_SIZE_BYTES != 0) Sectors_Count++;
+	return Sectors_Count;
+}
+
 /** Copy the MBR code and the partition table at the partition starting sector.
  * @param Pointer_Lemon_Partition_Table The partition table to put on the Lemon MBR.
+ * @param Kernel_Sectors_Count The kernel size in sectors, the MBR needs it to load the kernel.
  */
-static void ShellInstallMBR(TFileSystemMasterBootLoaderPartitionTableEntry *Pointer_Lemon_Partition_Table)
+static void ShellInstallMBR(TFileSystemMasterBootLoaderPartitionTableEntry *Pointer_Lemon_Partition_Table, unsigned int Kernel_Sectors_Count)
 {
 	unsigned char Sector_Temp[FILE_SYSTEM_SECTOR_SIZE_BYTES];
 	
 	// Extract the MBR code
 	memcpy(Sector_Temp, Embedded_Files[0].Pointer_Data, FILE_SYSTEM_SECTOR_SIZE_BYTES);
 	
+	// Record the kernel size
+	*((unsigned short *) &Sector_Temp[CONFIGURATION_FILE_SYSTEM_MBR_KERNEL_SECTORS_COUNT_OFFSET]) = (unsigned short) Kernel_Sectors_Count;
+	
 	// Merge the partition table
 	memcpy(&Sector_Temp[FILE_SYSTEM_MASTER_BOOT_LOADER_PARTITION_TABLE_OFFSET], Pointer_Lemon_Partition_Table, FILE_SYSTEM_MASTER_BOOT_LOADER_PARTITION_TABLE_SIZE);
 	
@@ -56,19 +73,7 @@ static void ShellInstallMBR(TFileSystemMasterBootLoaderPartitionTableEntry *Poin
  */
 static void ShellInstallKernel(TEmbeddedFile *Pointer_Kernel_File, unsigned int Starting_Sector)
 {
-	unsigned char *Pointer_Data;
-	int i, Sectors_Count;
-	
-	// Compute the number of sectors the kernel needs
-	Sectors_Count = Pointer_Kernel_File->Size_Bytes / FILE_SYSTEM_SECTOR_SIZE_BYTES;
-	if (Pointer_Kernel_File->Size_Bytes % FILE_SYSTEM_SECTOR_SIZE_BYTES != 0) Sectors_Count++;
-	
-	Pointer_Data = Pointer_Kernel_File->Pointer_Data;
-	for (i = 0; i < Sectors_Count; i++)
-	{
-		HardDiskWriteSector(Starting_Sector + i, Pointer_Data);
-		Pointer_Data += FILE_SYSTEM_SECTOR_SIZE_BYTES;
-	}
+	HardDiskWriteSectors(Starting_Sector, ShellComputeKernelSectorsCount(Pointer_Kernel_File), Pointer_Kernel_File->Pointer_Data);
 }
 
 /** Install all remaining embedded files to the hard disk. */
@@ -145,7 +150,7 @@ void ShellInstallerDisplayTitle(char *String_Title)
 void Shell(void)
 {
 	TFileSystemMasterBootLoaderPartitionTableEntry *Pointer_Lemon_Partition_Table, Default_Lemon_Partition_Table;
-	unsigned int Partition_Starting_Sector, File_System_Starting_Sector;
+	unsigned int Partition_Starting_Sector, File_System_Starting_Sector, Kernel_Sectors_Count;
 	
 	// Show the title
 	ScreenSetColor(SCREEN_COLOR_LIGHT_BLUE);
@@ -164,6 +169,9 @@ void Shell(void)
 		ShellReboot();
 	}
 	
+	// The file system is stored right after the kernel
+	Kernel_Sectors_Count = ShellComputeKernelSectorsCount(&Embedded_Files[1]);
+	
 	// Ask the user whether he wants to use the whole disk or not
 	ShellInstallerDisplayTitle(STRING_SHELL_INSTALLER_SECTION_HARD_DISK_TITLE);
 	ScreenWriteString(STRING_SHELL_INSTALLER_SECTION_HARD_DISK_MESSAGE);
@@ -174,21 +182,21 @@ void Shell(void)
 		Default_Lemon_Partition_Table.Status = 0x80; // Tell that the partition is bootable
 		Default_Lemon_Partition_Table.Type = FILE_SYSTEM_MASTER_BOOT_LOADER_PARTITION_TABLE_PARTITION_TYPE_LEMON;
 		Default_Lemon_Partition_Table.First_Sector_LBA = 0; // Start from the disk beginning
-		Default_Lemon_Partition_Table.Sectors_Count = FileSystemComputeSizeSectors(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES);
+		Default_Lemon_Partition_Table.Sectors_Count = CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET(Kernel_Sectors_Count) + FileSystemComputeSizeSectors(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES); // The partition contains the MBR and the kernel too
 		Pointer_Lemon_Partition_Table = &Default_Lemon_Partition_Table;
 	}
 	else Pointer_Lemon_Partition_Table = ShellInstallerPartitionMenu(); // Select the installation partition
 	
 	// Compute the selected partition necessary offsets
 	Partition_Starting_Sector = Pointer_Lemon_Partition_Table[0].First_Sector_LBA;
-	File_System_Starting_Sector = Partition_Starting_Sector + CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET;
+	File_System_Starting_Sector = Partition_Starting_Sector + CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET(Kernel_Sectors_Count);
 	
 	// Start the installation
 	ShellInstallerDisplayTitle(STRING_SHELL_INSTALLER_INSTALLATION_BEGINNING);
 	
 	// Create file system
 	ScreenWriteString(STRING_SHELL_INSTALLER_CREATING_FILE_SYSTEM);
-	switch (FileSystemCreate(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES, File_System_Starting_Sector))
+	switch (FileSystemCreate(CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_BLOCKS_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES, CONFIGURATION_SYSTEM_FILE_SYSTEM_BLOCK_SIZE_BYTES, File_System_Starting_Sector))
 	{
 		case 1:
 			ScreenSetColor(SCREEN_COLOR_RED);
@@ -210,7 +218,7 @@ void Shell(void)
 	FileSystemInitialize(File_System_Starting_Sector);
 	
 	// Install MBR
-	ShellInstallMBR(Pointer_Lemon_Partition_Table);
+	ShellInstallMBR(Pointer_Lemon_Partition_Table, Kernel_Sectors_Count);
 	
 	// Install kernel
 	ShellInstallKernel(&Embedded_Files[1], Partition_Starting_Sector + 1);
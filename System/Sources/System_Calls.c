@@ -5,6 +5,7 @@
 #include <Architecture.h>
 #include <Configuration.h>
 #include <Drivers/Driver_Ethernet.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
 #include <Drivers/Driver_Keyboard.h>
 #include <Drivers/Driver_RTC.h>
 #include <Drivers/Driver_Screen.h>
@@ -68,7 +69,7 @@ static void SystemCallSystemGetParameter(void)
 			break;
 			
 		case SYSTEM_CALL_SYSTEM_PARAMETER_ID_FILE_SYSTEM_BLOCK_SIZE:
-			*Pointer_Result = CONFIGURATION_FILE_SYSTEM_BLOCK_SIZE_BYTES;
+			*Pointer_Result = File_System.File_System_Informations.Block_Size_Bytes;
 			break;
 			
 		case SYSTEM_CALL_SYSTEM_PARAMETER_ID_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES_COUNT:
@@ -103,6 +104,18 @@ static void SystemCallSystemGetParameter(void)
 			#endif
 			break;
 			
+		case SYSTEM_CALL_SYSTEM_PARAMETER_ID_HARD_DISK_STATISTICS:
+			HardDiskStatisticsGet((TSystemCallHardDiskStatistics *) Pointer_Result);
+			break;
+			
+		case SYSTEM_CALL_SYSTEM_PARAMETER_ID_ETHERNET_CONTROLLER_OFFLOAD_CAPABILITIES:
+			#ifndef CONFIGURATION_SYSTEM_ETHERNET_CONTROLLER_DRIVER_NONE
+				*Pointer_Result = EthernetGetOffloadCapabilities();
+			#else
+				*Pointer_Result = 0;
+			#endif
+			break;
+			
 		// Unknown parameter
 		default:
 			Return_Value = 1;
@@ -212,7 +225,8 @@ static void SystemCallEthernetSendPacket(void)
 {
 	#ifndef CONFIGURATION_SYSTEM_ETHERNET_CONTROLLER_DRIVER_NONE
 		ARCHITECTURE_INTERRUPTS_ENABLE(); // Allow F12 key to work
-		EthernetSendPacket(Integer_1, Pointer_1);
+		if (Integer_2 & SYSTEM_CALL_ETHERNET_SEND_PACKET_FLAG_SEGMENT_TCP) EthernetSendSegmentedTCPPacket(Integer_1, Pointer_1, Pointer_2, (unsigned int) Integer_2 >> 16); // The segment size is stored in the flags upper word
+		else EthernetSendPacket(Integer_1, Pointer_1, Integer_2);
 	#endif
 }
 
@@ -273,6 +287,26 @@ static void SystemCallFileClose(void)
 	FileClose(Integer_1);
 }
 
+static void SystemCallFilePreallocate(void)
+{
+	Return_Value = FilePreallocate((unsigned int) Integer_1, (unsigned int) Integer_2);
+}
+
+static void SystemCallFileSubmitAsynchronousRequest(void)
+{
+	Return_Value = FileSubmitAsynchronousRequest((unsigned int) Integer_1, Pointer_1, (unsigned int) Integer_2, Pointer_2);
+}
+
+static void SystemCallFilePollAsynchronousRequest(void)
+{
+	Return_Value = FilePollAsynchronousRequest((unsigned int) Integer_1, Pointer_1);
+}
+
+static void SystemCallFileWaitAsynchronousRequest(void)
+{
+	Return_Value = FileWaitAsynchronousRequest((unsigned int) Integer_1, Pointer_1);
+}
+
 //====================================================================================================================
 // RTC calls
 //====================================================================================================================
@@ -325,7 +359,11 @@ TSystemCallHandler System_Calls_Handlers[] =
 	SystemCallFileWrite, // SYSTEM_CALL_FILE_WRITE
 	SystemCallFileClose, // SYSTEM_CALL_FILE_CLOSE
 	SystemCallRTCGetDate, // SYSTEM_CALL_RTC_GET_DATE
-	SystemCallRTCGetTime // SYSTEM_CALL_RTC_GET_TIME
+	SystemCallRTCGetTime, // SYSTEM_CALL_RTC_GET_TIME
+	SystemCallFileSubmitAsynchronousRequest, // SYSTEM_CALL_FILE_SUBMIT_ASYNCHRONOUS_REQUEST
+	SystemCallFilePollAsynchronousRequest, // SYSTEM_CALL_FILE_POLL_ASYNCHRONOUS_REQUEST
+	SystemCallFileWaitAsynchronousRequest, // SYSTEM_CALL_FILE_WAIT_ASYNCHRONOUS_REQUEST
+	SystemCallFilePreallocate // SYSTEM_CALL_FILE_PREALLOCATE
 };
 
 //-------------------------------------------------------------------------------------------------
@@ -0,0 +1,363 @@
+/** @file Main.c
+ * Run the kernel file system code on the host against a simulated hard disk and display the disk accesses cost of some representative workloads.
+ * @author Adrien RICCIARDI
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Configuration.h>
+#include <Error_Codes.h>
+#include <File_System/File.h>
+#include <File_System/File_System.h>
+#include "Simulated_Hard_Disk.h"
+
+//-------------------------------------------------------------------------------------------------
+// Private constants and macros
+//-------------------------------------------------------------------------------------------------
+/** The file system is located after the MBR and a 128-sector kernel, like on a real disk. */
+#define FILE_SYSTEM_STARTING_SECTOR CONFIGURATION_FILE_SYSTEM_STARTING_SECTOR_OFFSET(128)
+
+/** All block sizes share the same data area size, so only the block size changes between the results. */
+#define FILE_SYSTEM_DATA_SIZE_BYTES (8 * 1024 * 1024)
+/** Create the biggest Files List the kernel can mount. */
+#define FILE_SYSTEM_FILES_COUNT CONFIGURATION_SYSTEM_FILE_SYSTEM_MAXIMUM_FILES_LIST_ENTRIES
+
+/** The small files workload files count. */
+#define WORKLOAD_SMALL_FILES_COUNT 100
+/** The large file workload file size in bytes. */
+#define WORKLOAD_LARGE_FILE_SIZE (6 * 1024 * 1024)
+/** The churn workload files count. */
+#define WORKLOAD_CHURN_FILES_COUNT 32
+/** How many delete/recreate passes are done by the churn workload. */
+#define WORKLOAD_CHURN_ROUNDS_COUNT 8
+
+/** The biggest buffer size used by FileRead() and FileWrite() calls. */
+#define TRANSFER_BUFFER_SIZE 65536
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** A workload to run on a freshly formatted file system. */
+typedef struct
+{
+	char *String_Name; //!< The name displayed in the results.
+	int (*Run)(void); //!< The workload code, returning 0 on success.
+} TWorkload;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** All block sizes to run the workloads with. */
+static unsigned int Block_Sizes_Bytes[] = { 1024, 4096, 16384, 65536 };
+
+/** The simulated disk storage. */
+static unsigned char *Pointer_Disk_Storage;
+/** The simulated disk size in sectors. */
+static unsigned int Disk_Sectors_Count;
+
+/** The buffer used to transfer data to and from files. */
+static unsigned char Transfer_Buffer[TRANSFER_BUFFER_SIZE];
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Generate a file content byte that depends on the file identifier and the byte offset, so any misplaced block is detected.
+ * @param File_ID The file identifier.
+ * @param Offset The byte offset in the file.
+ * @return The byte value.
+ */
+static inline unsigned char GetPatternByte(unsigned int File_ID, unsigned int Offset)
+{
+	return (unsigned char) ((File_ID * 151) + (Offset * 7) + (Offset >> 9));
+}
+
+/** Create a file filled with the file identifier pattern.
+ * @param String_File_Name The file name.
+ * @param File_ID The file identifier.
+ * @param Size_Bytes The file size.
+ * @param Chunk_Size How many bytes to give to each FileWrite() call.
+ * @param Is_Preallocated Set to 1 to reserve the file blocks with FilePreallocate() before writing.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int CreateFile(char *String_File_Name, unsigned int File_ID, unsigned int Size_Bytes, unsigned int Chunk_Size, int Is_Preallocated)
+{
+	unsigned int File_Descriptor, Offset = 0, Bytes_Count, i;
+	int Result;
+
+	Result = FileOpen(String_File_Name, 'w', &File_Descriptor);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		printf("Error : failed to create the file '%s' (error %d).\n", String_File_Name, Result);
+		return -1;
+	}
+
+	if (Is_Preallocated)
+	{
+		Result = FilePreallocate(File_Descriptor, Size_Bytes);
+		if (Result != ERROR_CODE_NO_ERROR)
+		{
+			printf("Error : failed to preallocate the file '%s' (error %d).\n", String_File_Name, Result);
+			FileClose(File_Descriptor);
+			return -1;
+		}
+	}
+
+	while (Offset < Size_Bytes)
+	{
+		Bytes_Count = Size_Bytes - Offset;
+		if (Bytes_Count > Chunk_Size) Bytes_Count = Chunk_Size;
+		for (i = 0; i < Bytes_Count; i++) Transfer_Buffer[i] = GetPatternByte(File_ID, Offset + i);
+
+		Result = FileWrite(File_Descriptor, Transfer_Buffer, Bytes_Count);
+		if (Result != ERROR_CODE_NO_ERROR)
+		{
+			printf("Error : failed to write to the file '%s' (error %d).\n", String_File_Name, Result);
+			FileClose(File_Descriptor);
+			return -1;
+		}
+		Offset += Bytes_Count;
+	}
+
+	FileClose(File_Descriptor);
+	return 0;
+}
+
+/** Read a whole file and check its content.
+ * @param String_File_Name The file name.
+ * @param File_ID The file identifier.
+ * @param Size_Bytes The expected file size.
+ * @param Chunk_Size How many bytes to request on each FileRead() call.
+ * @return 0 if the file content is right,
+ * @return -1 if an error occurred.
+ */
+static int VerifyFile(char *String_File_Name, unsigned int File_ID, unsigned int Size_Bytes, unsigned int Chunk_Size)
+{
+	unsigned int File_Descriptor, Offset = 0, Bytes_Count, i;
+	int Result;
+
+	if (FileSize(String_File_Name) != Size_Bytes)
+	{
+		printf("Error : the file '%s' size is %u bytes instead of %u bytes.\n", String_File_Name, FileSize(String_File_Name), Size_Bytes);
+		return -1;
+	}
+
+	Result = FileOpen(String_File_Name, 'r', &File_Descriptor);
+	if (Result != ERROR_CODE_NO_ERROR)
+	{
+		printf("Error : failed to open the file '%s' (error %d).\n", String_File_Name, Result);
+		return -1;
+	}
+
+	while (Offset < Size_Bytes)
+	{
+		Result = FileRead(File_Descriptor, Transfer_Buffer, Chunk_Size, &Bytes_Count);
+		if ((Result != ERROR_CODE_NO_ERROR) || (Bytes_Count == 0))
+		{
+			printf("Error : failed to read from the file '%s' at offset %u (error %d).\n", String_File_Name, Offset, Result);
+			FileClose(File_Descriptor);
+			return -1;
+		}
+
+		for (i = 0; i < Bytes_Count; i++)
+		{
+			if (Transfer_Buffer[i] != GetPatternByte(File_ID, Offset + i))
+			{
+				printf("Error : the file '%s' content is corrupted at offset %u.\n", String_File_Name, Offset + i);
+				FileClose(File_Descriptor);
+				return -1;
+			}
+		}
+		Offset += Bytes_Count;
+	}
+
+	FileClose(File_Descriptor);
+	return 0;
+}
+
+/** Many files smaller than a block, written in one call and read back by small chunks.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int WorkloadSmallFiles(void)
+{
+	unsigned int i;
+	char String_File_Name[CONFIGURATION_FILE_NAME_LENGTH + 1];
+
+	for (i = 0; i < WORKLOAD_SMALL_FILES_COUNT; i++)
+	{
+		sprintf(String_File_Name, "Small_%03u", i);
+		if (CreateFile(String_File_Name, i, 64 + ((i * 97) % 1500), TRANSFER_BUFFER_SIZE, 0) != 0) return -1;
+	}
+
+	for (i = 0; i < WORKLOAD_SMALL_FILES_COUNT; i++)
+	{
+		sprintf(String_File_Name, "Small_%03u", i);
+		if (VerifyFile(String_File_Name, i, 64 + ((i * 97) % 1500), 256) != 0) return -1;
+	}
+	return 0;
+}
+
+/** A single big file written by sector-sized chunks and read back by block-sized chunks.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int WorkloadLargeSequentialFile(void)
+{
+	if (CreateFile("Large", 0, WORKLOAD_LARGE_FILE_SIZE, 512, 0) != 0) return -1;
+	return VerifyFile("Large", 0, WORKLOAD_LARGE_FILE_SIZE, File_System.File_System_Informations.Block_Size_Bytes);
+}
+
+/** A single big file written and read back by big chunks, so the file system can give several blocks at once to the disk.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int WorkloadLargeFileBigTransfers(void)
+{
+	if (CreateFile("Large", 0, WORKLOAD_LARGE_FILE_SIZE, TRANSFER_BUFFER_SIZE, 0) != 0) return -1;
+	return VerifyFile("Large", 0, WORKLOAD_LARGE_FILE_SIZE, TRANSFER_BUFFER_SIZE);
+}
+
+/** Repeatedly delete and recreate half of the files with a different size to fragment the free blocks list.
+ * @param Is_Preallocated Set to 1 to preallocate each file before writing it.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int RunChurn(int Is_Preallocated)
+{
+	unsigned int i, Round, File_IDs[WORKLOAD_CHURN_FILES_COUNT], Sizes[WORKLOAD_CHURN_FILES_COUNT];
+	char String_File_Name[CONFIGURATION_FILE_NAME_LENGTH + 1];
+
+	for (i = 0; i < WORKLOAD_CHURN_FILES_COUNT; i++)
+	{
+		File_IDs[i] = i;
+		Sizes[i] = ((i * 12377) % 60000) + 1;
+		sprintf(String_File_Name, "Churn_%02u", i);
+		if (CreateFile(String_File_Name, File_IDs[i], Sizes[i], 1000, Is_Preallocated) != 0) return -1;
+	}
+
+	for (Round = 0; Round < WORKLOAD_CHURN_ROUNDS_COUNT; Round++)
+	{
+		for (i = Round % 2; i < WORKLOAD_CHURN_FILES_COUNT; i += 2)
+		{
+			sprintf(String_File_Name, "Churn_%02u", i);
+			if (FileDelete(String_File_Name) != ERROR_CODE_NO_ERROR)
+			{
+				printf("Error : failed to delete the file '%s'.\n", String_File_Name);
+				return -1;
+			}
+
+			File_IDs[i] += WORKLOAD_CHURN_FILES_COUNT;
+			Sizes[i] = ((File_IDs[i] * 12377) % 60000) + 1;
+			if (CreateFile(String_File_Name, File_IDs[i], Sizes[i], 1000, Is_Preallocated) != 0) return -1;
+		}
+	}
+
+	for (i = 0; i < WORKLOAD_CHURN_FILES_COUNT; i++)
+	{
+		sprintf(String_File_Name, "Churn_%02u", i);
+		if (VerifyFile(String_File_Name, File_IDs[i], Sizes[i], 3000) != 0) return -1;
+	}
+	return 0;
+}
+
+/** The churn workload with files growing block by block.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int WorkloadChurn(void)
+{
+	return RunChurn(0);
+}
+
+/** The churn workload with files preallocated at their final size.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int WorkloadPreallocatedChurn(void)
+{
+	return RunChurn(1);
+}
+
+/** All workloads to run. */
+static TWorkload Workloads[] =
+{
+	{ "small_files", WorkloadSmallFiles },
+	{ "large_sequential_file", WorkloadLargeSequentialFile },
+	{ "large_file_big_transfers", WorkloadLargeFileBigTransfers },
+	{ "delete_recreate_churn", WorkloadChurn },
+	{ "preallocated_churn", WorkloadPreallocatedChurn }
+};
+
+/** Create an empty file system on a blank disk and mount it.
+ * @param Block_Size_Bytes The file system block size.
+ * @return 0 on success,
+ * @return -1 if an error occurred.
+ */
+static int FormatDisk(unsigned int Block_Size_Bytes)
+{
+	memset(Pointer_Disk_Storage, 0, (size_t) Disk_Sectors_Count * FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	SimulatedHardDiskCreate(Disk_Sectors_Count, Pointer_Disk_Storage);
+
+	if (FileSystemCreate(FILE_SYSTEM_DATA_SIZE_BYTES / Block_Size_Bytes, FILE_SYSTEM_FILES_COUNT, Block_Size_Bytes, FILE_SYSTEM_STARTING_SECTOR) != 0)
+	{
+		printf("Error : failed to create the file system.\n");
+		return -1;
+	}
+	if (!FileSystemInitialize(FILE_SYSTEM_STARTING_SECTOR))
+	{
+		printf("Error : failed to mount the file system.\n");
+		return -1;
+	}
+
+	// Do not account the formatting
+	SimulatedHardDiskResetStatistics();
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------------------
+int main(void)
+{
+	unsigned int i, j, Size_Sectors, Block_Size_Bytes, Used_Size_Kilobytes;
+	TSimulatedHardDiskStatistics *Pointer_Statistics = &Simulated_Hard_Disk_Statistics;
+
+	// FileSystemCreate() requires the disk to contain the file system size (which includes the MBR and kernel area) plus the file system starting sector, the smallest blocks need the biggest Blocks List
+	Disk_Sectors_Count = 0;
+	for (i = 0; i < sizeof(Block_Sizes_Bytes) / sizeof(unsigned int); i++)
+	{
+		Size_Sectors = FileSystemComputeSizeSectors(FILE_SYSTEM_DATA_SIZE_BYTES / Block_Sizes_Bytes[i], FILE_SYSTEM_FILES_COUNT, Block_Sizes_Bytes[i]) + FILE_SYSTEM_STARTING_SECTOR;
+		if (Size_Sectors > Disk_Sectors_Count) Disk_Sectors_Count = Size_Sectors;
+	}
+	Pointer_Disk_Storage = malloc((size_t) Disk_Sectors_Count * FILE_SYSTEM_SECTOR_SIZE_BYTES);
+	if (Pointer_Disk_Storage == NULL)
+	{
+		printf("Error : failed to allocate the simulated disk.\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%-24s %10s %12s %12s %12s %12s %14s %10s %10s\n", "Workload", "Block size", "Read sect.", "Write sect.", "Read cmds", "Write cmds", "Seek sectors", "Flushes", "Used KB");
+	for (i = 0; i < sizeof(Block_Sizes_Bytes) / sizeof(unsigned int); i++)
+	{
+		Block_Size_Bytes = Block_Sizes_Bytes[i];
+
+		for (j = 0; j < sizeof(Workloads) / sizeof(TWorkload); j++)
+		{
+			if (FormatDisk(Block_Size_Bytes) != 0) return EXIT_FAILURE;
+			if (Workloads[j].Run() != 0)
+			{
+				printf("Error : the workload '%s' failed with %u-byte blocks.\n", Workloads[j].String_Name, Block_Size_Bytes);
+				return EXIT_FAILURE;
+			}
+
+			// The used space shows how much is lost in the files last block
+			Used_Size_Kilobytes = (File_System.File_System_Informations.Total_Blocks_Count - FileSystemGetFreeBlocksCount()) * (Block_Size_Bytes / 1024);
+
+			printf("%-24s %10u %12llu %12llu %12llu %12llu %14llu %10llu %10u\n", Workloads[j].String_Name, Block_Size_Bytes, Pointer_Statistics->Read_Sectors_Count, Pointer_Statistics->Written_Sectors_Count, Pointer_Statistics->Read_Commands_Count, Pointer_Statistics->Written_Commands_Count, Pointer_Statistics->Seek_Distance_Sectors, Pointer_Statistics->Flush_Commands_Count, Used_Size_Kilobytes);
+		}
+	}
+
+	free(Pointer_Disk_Storage);
+	return EXIT_SUCCESS;
+}
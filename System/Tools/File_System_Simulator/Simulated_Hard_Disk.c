@@ -0,0 +1,155 @@
+/** @file Simulated_Hard_Disk.c
+ * See Simulated_Hard_Disk.h for description. This file is compiled against the kernel headers only, it also provides the few kernel functions needed by the file system.
+ * @author Adrien RICCIARDI
+ */
+#include <Drivers/Driver_Hard_Disk.h>
+#include <Drivers/Driver_Hard_Disk_Statistics.h>
+#include <Drivers/Driver_Keyboard.h>
+#include <Drivers/Driver_Screen.h>
+#include <Standard_Functions.h>
+#include "Simulated_Hard_Disk.h"
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The disk content. */
+static unsigned char *Pointer_Disk_Storage;
+/** The disk size in sectors. */
+static unsigned int Disk_Sectors_Count;
+/** The sector the head is located on after the last command. */
+static unsigned int Head_Sector_Number;
+/** Behave like a drive with a write cache, so the file system flushes are counted. */
+static int Is_Write_Cache_Enabled = 1;
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+TSimulatedHardDiskStatistics Simulated_Hard_Disk_Statistics;
+/** The file system never reads the timestamp counter on the host, as the simulated disk is never mapped. */
+int Hard_Disk_Statistics_Is_Timestamp_Counter_Available = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Account a command and move the head.
+ * @param First_Sector_Number The first sector accessed by the command.
+ * @param Sectors_Count How many sectors are accessed by the command.
+ */
+static void SimulatedHardDiskUpdateHead(unsigned int First_Sector_Number, unsigned int Sectors_Count)
+{
+	if (First_Sector_Number >= Head_Sector_Number) Simulated_Hard_Disk_Statistics.Seek_Distance_Sectors += First_Sector_Number - Head_Sector_Number;
+	else Simulated_Hard_Disk_Statistics.Seek_Distance_Sectors += Head_Sector_Number - First_Sector_Number;
+	Head_Sector_Number = First_Sector_Number + Sectors_Count;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void SimulatedHardDiskCreate(unsigned int Sectors_Count, void *Pointer_Storage)
+{
+	Pointer_Disk_Storage = Pointer_Storage;
+	Disk_Sectors_Count = Sectors_Count;
+	SimulatedHardDiskResetStatistics();
+}
+
+void SimulatedHardDiskResetStatistics(void)
+{
+	memset(&Simulated_Hard_Disk_Statistics, 0, sizeof(Simulated_Hard_Disk_Statistics));
+	Head_Sector_Number = 0;
+}
+
+// Driver_Hard_Disk.h implementation
+int HardDiskInitialize(void)
+{
+	return 0;
+}
+
+void HardDiskReadSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	if (Logical_Sector_Number >= Disk_Sectors_Count) return;
+	
+	memcpy(Pointer_Buffer, Pointer_Disk_Storage + Logical_Sector_Number * HARD_DISK_SECTOR_SIZE, HARD_DISK_SECTOR_SIZE);
+	Simulated_Hard_Disk_Statistics.Read_Sectors_Count++;
+	Simulated_Hard_Disk_Statistics.Read_Commands_Count++;
+	SimulatedHardDiskUpdateHead(Logical_Sector_Number, 1);
+}
+
+void HardDiskWriteSector(unsigned int Logical_Sector_Number, void *Pointer_Buffer)
+{
+	if (Logical_Sector_Number >= Disk_Sectors_Count) return;
+	
+	memcpy(Pointer_Disk_Storage + Logical_Sector_Number * HARD_DISK_SECTOR_SIZE, Pointer_Buffer, HARD_DISK_SECTOR_SIZE);
+	Simulated_Hard_Disk_Statistics.Written_Sectors_Count++;
+	Simulated_Hard_Disk_Statistics.Written_Commands_Count++;
+	SimulatedHardDiskUpdateHead(Logical_Sector_Number, 1);
+}
+
+void HardDiskReadSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	if ((Logical_Sector_Number >= Disk_Sectors_Count) || (Sectors_Count > Disk_Sectors_Count - Logical_Sector_Number)) return;
+	
+	memcpy(Pointer_Buffer, Pointer_Disk_Storage + Logical_Sector_Number * HARD_DISK_SECTOR_SIZE, Sectors_Count * HARD_DISK_SECTOR_SIZE);
+	Simulated_Hard_Disk_Statistics.Read_Sectors_Count += Sectors_Count;
+	Simulated_Hard_Disk_Statistics.Read_Commands_Count++; // A ranged access is a single command
+	SimulatedHardDiskUpdateHead(Logical_Sector_Number, Sectors_Count);
+}
+
+void HardDiskWriteSectors(unsigned int Logical_Sector_Number, unsigned int Sectors_Count, void *Pointer_Buffer)
+{
+	if ((Logical_Sector_Number >= Disk_Sectors_Count) || (Sectors_Count > Disk_Sectors_Count - Logical_Sector_Number)) return;
+	
+	memcpy(Pointer_Disk_Storage + Logical_Sector_Number * HARD_DISK_SECTOR_SIZE, Pointer_Buffer, Sectors_Count * HARD_DISK_SECTOR_SIZE);
+	Simulated_Hard_Disk_Statistics.Written_Sectors_Count += Sectors_Count;
+	Simulated_Hard_Disk_Statistics.Written_Commands_Count++; // A ranged access is a single command
+	SimulatedHardDiskUpdateHead(Logical_Sector_Number, Sectors_Count);
+}
+
+void HardDiskExecuteRequests(int Is_Write_Operation, THardDiskRequest *Pointer_Requests, unsigned int Requests_Count)
+{
+	unsigned int i;
+	
+	for (i = 0; i < Requests_Count; i++)
+	{
+		if (Is_Write_Operation) HardDiskWriteSectors(Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+		else HardDiskReadSectors(Pointer_Requests[i].Logical_Sector_Number, Pointer_Requests[i].Sectors_Count, Pointer_Requests[i].Pointer_Buffer);
+	}
+}
+
+void HardDiskFlushCache(void)
+{
+	if (Is_Write_Cache_Enabled) Simulated_Hard_Disk_Statistics.Flush_Commands_Count++;
+}
+
+int HardDiskSetWriteCacheEnabled(int Is_Enabled)
+{
+	Is_Write_Cache_Enabled = Is_Enabled;
+	return 0;
+}
+
+int HardDiskIsWriteCacheEnabled(void)
+{
+	return Is_Write_Cache_Enabled;
+}
+
+void *HardDiskMapSector(unsigned int __attribute__((unused)) Logical_Sector_Number)
+{
+	// Behave like a real disk, so the simulated I/O counts match the hardware ones
+	return NULL;
+}
+
+unsigned int HardDiskGetDriveSizeSectors(void)
+{
+	return Disk_Sectors_Count;
+}
+
+// The file system accounts the blocks accessed in place, which never happens with the simulated disk
+void HardDiskStatisticsRecordTransfer(int __attribute__((unused)) Is_Write_Operation, unsigned int __attribute__((unused)) Sectors_Count, unsigned long long __attribute__((unused)) Start_Timestamp, int __attribute__((unused)) Is_Error) {}
+
+// The file system debug code needs these functions to link, they do nothing on the host
+void ScreenWriteCharacter(char __attribute__((unused)) Character) {}
+void ScreenWriteString(char __attribute__((unused)) *String) {}
+void ScreenSetColor(unsigned char __attribute__((unused)) Color_Code) {}
+unsigned char KeyboardReadCharacter(void)
+{
+	return '\n';
+}
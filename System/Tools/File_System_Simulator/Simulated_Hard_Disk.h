@@ -0,0 +1,40 @@
+/** @file Simulated_Hard_Disk.h
+ * A RAM hard disk implementing Driver_Hard_Disk.h on the host, counting every access to measure the file system algorithms cost.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_SIMULATED_HARD_DISK_H
+#define H_SIMULATED_HARD_DISK_H
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All the counters gathered by the simulated disk. */
+typedef struct
+{
+	unsigned long long Read_Sectors_Count; //!< How many sectors were read.
+	unsigned long long Written_Sectors_Count; //!< How many sectors were written.
+	unsigned long long Read_Commands_Count; //!< How many read commands were issued to the disk.
+	unsigned long long Written_Commands_Count; //!< How many write commands were issued to the disk.
+	unsigned long long Seek_Distance_Sectors; //!< Sum of the distances between the sector following the previous command and the first sector of the next command.
+	unsigned long long Flush_Commands_Count; //!< How many cache flush commands were issued to the disk.
+} TSimulatedHardDiskStatistics;
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** The counters, they can be reset by the workloads. */
+extern TSimulatedHardDiskStatistics Simulated_Hard_Disk_Statistics;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Attach the caller storage to the simulated disk and reset all counters. The storage is neither allocated nor cleared by this function.
+ * @param Sectors_Count The disk size in sectors, accesses beyond the last sector are ignored.
+ * @param Pointer_Storage A buffer of at least Sectors_Count * HARD_DISK_SECTOR_SIZE bytes owned by the caller, its current content is the disk content.
+ */
+void SimulatedHardDiskCreate(unsigned int Sectors_Count, void *Pointer_Storage);
+
+/** Reset all counters and park the disk head on the first sector. */
+void SimulatedHardDiskResetStatistics(void);
+
+#endif